@@ -19,6 +19,7 @@ using namespace zen;
 namespace
 {
 constexpr std::chrono::seconds FOLDER_EXISTENCE_CHECK_INTERVAL(1);
+constexpr size_t CHANGED_PATHS_MAX = 100'000;
 
 
 //wait until all directories become available (again) + logs in network share
@@ -114,32 +115,103 @@ std::set<Zstring, LessNativePath> waitForMissingDirs(const std::vector<Zstring>&
 }
 
 
-//wait until changes are detected or if a directory is not available (anymore)
-DirWatcher::Change waitForChanges(const std::set<Zstring, LessNativePath>& folderPaths, //throw FileError
-                                  const std::function<void(bool readyForSync)>& requestUiUpdate, std::chrono::milliseconds cbInterval)
-{
-    if (folderPaths.empty()) //pathological case, but we have to check else this function will wait endlessly
-        throw FileError(_("A folder input field is empty.")); //should have been checked by caller!
+using FolderWatches = std::vector<std::pair<Zstring /*folderPath*/, std::unique_ptr<DirWatcher>>>;
 
-    std::vector<std::pair<Zstring, std::unique_ptr<DirWatcher>>> watches;
+//fetch changes of all watches once: accumulate changed paths, return the last change (ChangeType::baseFolderUnavailable takes precedence)
+//commandRunning: inotify can't tell the command's own changes apart => add them to "changedPaths", but don't report them as reason for another execution
+std::optional<DirWatcher::Change> fetchChanges(FolderWatches& watches, std::set<Zstring, LessNativePath>& changedPaths, bool commandRunning, //throw FileError
+                                               const std::function<void()>& requestUiUpdate, std::chrono::milliseconds cbInterval)
+{
+    std::optional<DirWatcher::Change> lastChange;
 
-    for (const Zstring& folderPath : folderPaths)
+    for (auto& [folderPath, watcher] : watches)
         try
         {
-            watches.emplace_back(folderPath, std::make_unique<DirWatcher>(folderPath)); //throw FileError
+            std::vector<DirWatcher::Change> changes = watcher->fetchChanges(requestUiUpdate, cbInterval); //throw FileError
+
+            //give precedence to ChangeType::baseFolderUnavailable
+            for (const DirWatcher::Change& change : changes)
+                if (change.type == DirWatcher::ChangeType::baseFolderUnavailable)
+                    return change;
+
+            std::erase_if(changes, [](const DirWatcher::Change& e)
+            {
+                return
+                    e.ownProcessTree || //e.g. files written by the command we run: syncing them again is redundant
+                    endsWith(e.itemPath, Zstr(".ffs_tmp"))  || //sync.8ea2.ffs_tmp
+                    endsWith(e.itemPath, Zstr(".ffs_lock")) || //sync.ffs_lock, sync.Del.ffs_lock
+                    endsWith(e.itemPath, Zstr(".ffs_db"));     //sync.ffs_db
+                //no need to ignore temporary recycle bin directory: this must be caused by a file deletion anyway
+            });
+
+            for (const DirWatcher::Change& change : changes)
+                changedPaths.insert(change.itemPath);
+
+            if (!changes.empty() && (!commandRunning || watcher->identifiesOwnProcessTree()))
+                lastChange = changes.back();
+
+            //event queue overflow is reported as change of the base folder (=> everything changed): recreate the watch, e.g. inotify misses new sub folders
+            if (std::any_of(changes.begin(), changes.end(), [&](const DirWatcher::Change& change) { return change.itemPath == folderPath; }))
+                watcher = std::make_unique<DirWatcher>(folderPath); //throw FileError
         }
         catch (FileError&)
         {
             try { getItemType(folderPath); } //throw FileError
-            catch (FileError&)
-            {
-                assert(false); //why "unavailable"!? violating waitForChanges() precondition!
-                return {DirWatcher::ChangeType::baseFolderUnavailable, folderPath};
-            }
+            catch (FileError&) { return DirWatcher::Change{DirWatcher::ChangeType::baseFolderUnavailable, folderPath}; }
 
             throw;
         }
 
+    if (changedPaths.size() > CHANGED_PATHS_MAX) //scoping the sync is pointless: report base folders instead => all changed
+    {
+        changedPaths.clear();
+        for (const auto& [folderPath, watcher] : watches)
+            changedPaths.insert(folderPath);
+    }
+    return lastChange;
+}
+
+
+//returns false on time-out
+bool waitForWatches(const FolderWatches& watches, std::chrono::milliseconds timeout) //throw FileError
+{
+    std::vector<const DirWatcher*> watchers;
+    for (const auto& [folderPath, watcher] : watches)
+        watchers.push_back(watcher.get());
+
+    return DirWatcher::waitForChanges(watchers, timeout); //throw FileError
+}
+
+
+//wait until changes are detected or if a directory is not available (anymore)
+//"watches" is created on demand and kept between calls until the caller removes it: setup time is significant for large folder trees!
+DirWatcher::Change waitForChanges(const std::set<Zstring, LessNativePath>& folderPaths, FolderWatches& watches, //throw FileError
+                                  std::set<Zstring, LessNativePath>& changedPaths, //accumulate *all* changes
+                                  const std::function<void(bool readyForSync)>& requestUiUpdate, std::chrono::milliseconds cbInterval)
+{
+    if (folderPaths.empty()) //pathological case, but we have to check else this function will wait endlessly
+        throw FileError(_("A folder input field is empty.")); //should have been checked by caller!
+
+    for (const Zstring& folderPath : folderPaths)
+        if (std::none_of(watches.begin(), watches.end(), [&](const auto& item) { return item.first == folderPath; }))
+            try
+            {
+                watches.emplace_back(folderPath, std::make_unique<DirWatcher>(folderPath)); //throw FileError
+                changedPaths.insert(folderPath); //changes before the watch existed are unknown => all changed
+            }
+            catch (FileError&)
+            {
+                watches.clear();
+                try { getItemType(folderPath); } //throw FileError
+                catch (FileError&)
+                {
+                    assert(false); //why "unavailable"!? violating waitForChanges() precondition!
+                    return {DirWatcher::ChangeType::baseFolderUnavailable, folderPath};
+                }
+
+                throw;
+            }
+
     auto lastCheckTime = std::chrono::steady_clock::now();
     for (;;)
     {
@@ -154,48 +226,19 @@ DirWatcher::Change waitForChanges(const std::set<Zstring, LessNativePath>& folde
             return false;
         }();
 
-        for (const auto& [folderPath, watcher] : watches)
-        {
-            //IMPORTANT CHECK: DirWatcher has problems detecting removal of top watched directories!
-            if (checkDirNow)
+        //IMPORTANT CHECK: DirWatcher has problems detecting removal of top watched directories!
+        if (checkDirNow)
+            for (const auto& [folderPath, watcher] : watches)
                 try //catch errors related to directory removal, e.g. ERROR_NETNAME_DELETED
                 {
                     getItemType(folderPath); //throw FileError
                 }
                 catch (FileError&) { return {DirWatcher::ChangeType::baseFolderUnavailable, folderPath}; }
 
-            try
-            {
-                std::vector<DirWatcher::Change> changes = watcher->fetchChanges([&] { requestUiUpdate(false /*readyForSync*/); /*throw X*/ },
-                                                                                cbInterval); //throw FileError
-
-                //give precedence to ChangeType::baseFolderUnavailable
-                for (const DirWatcher::Change& change : changes)
-                    if (change.type == DirWatcher::ChangeType::baseFolderUnavailable)
-                        return change;
-
-                std::erase_if(changes, [](const DirWatcher::Change& e)
-                {
-                    return
-                        endsWith(e.itemPath, Zstr(".ffs_tmp"))  || //sync.8ea2.ffs_tmp
-                        endsWith(e.itemPath, Zstr(".ffs_lock")) || //sync.ffs_lock, sync.Del.ffs_lock
-                        endsWith(e.itemPath, Zstr(".ffs_db"));     //sync.ffs_db
-                    //no need to ignore temporary recycle bin directory: this must be caused by a file deletion anyway
-                });
-
-                if (!changes.empty())
-                    return changes[0];
-            }
-            catch (FileError&)
-            {
-                try { getItemType(folderPath); } //throw FileError
-                catch (FileError&) { return {DirWatcher::ChangeType::baseFolderUnavailable, folderPath}; }
+        if (const std::optional<DirWatcher::Change> lastChange = fetchChanges(watches, changedPaths, false /*commandRunning*/, [&] { requestUiUpdate(false /*readyForSync*/); /*throw X*/ }, cbInterval)) //throw FileError
+            return *lastChange;
 
-                throw;
-            }
-        }
-
-        std::this_thread::sleep_for(cbInterval);
+        waitForWatches(watches, cbInterval); //throw FileError
         requestUiUpdate(true /*readyForSync*/); //throw X: may start sync at this presumably idle time
     }
 }
@@ -223,7 +266,7 @@ struct ExecCommandNowException {};
 
 
 void rts::monitorDirectories(const std::vector<Zstring>& folderPathPhrases, std::chrono::seconds delay,
-                             const std::function<void(const Zstring& itemPath, const std::wstring& actionName)>& executeExternalCommand /*throw FileError*/,
+                             const std::function<void(const Zstring& itemPath, const std::wstring& actionName, const std::vector<Zstring>& changedPaths)>& executeExternalCommand /*throw FileError*/,
                              const std::function<void(const Zstring* missingFolderPath)>& requestUiUpdate,
                              const std::function<void(const std::wstring& msg         )>& reportError,
                              std::chrono::milliseconds cbInterval)
@@ -236,9 +279,13 @@ void rts::monitorDirectories(const std::vector<Zstring>& folderPathPhrases, std:
         try
         {
             std::set<Zstring, LessNativePath> folderPaths = waitForMissingDirs(folderPathPhrases, [&](const Zstring& folderPath) { requestUiUpdate(&folderPath); }, cbInterval); //throw FileError
+            FolderWatches watches;
 
             //schedule initial execution (*after* all directories have arrived)
             auto nextExecTime = std::chrono::steady_clock::now() + delay;
+            std::set<Zstring, LessNativePath> changedPaths(folderPaths.begin(), folderPaths.end()); //initially: everything
+
+            std::optional<DirWatcher::Change> changePending; //detected while the command was running
 
             for (;;) //command executions
             {
@@ -247,30 +294,92 @@ void rts::monitorDirectories(const std::vector<Zstring>& folderPathPhrases, std:
                 {
                     for (;;) //detected changes
                     {
-                        lastChangeDetected = waitForChanges(folderPaths, [&](bool readyForSync) //throw FileError, ExecCommandNowException
+                        if (changePending)
                         {
-                            requestUiUpdate(nullptr);
-
-                            if (readyForSync && std::chrono::steady_clock::now() >= nextExecTime)
-                                throw ExecCommandNowException(); //abort wait and start sync
-                        }, cbInterval);
+                            lastChangeDetected = *changePending;
+                            changePending.reset();
+                        }
+                        else
+                            lastChangeDetected = waitForChanges(folderPaths, watches, changedPaths, [&](bool readyForSync) //throw FileError, ExecCommandNowException
+                            {
+                                requestUiUpdate(nullptr);
+
+                                if (readyForSync && std::chrono::steady_clock::now() >= nextExecTime)
+                                    throw ExecCommandNowException(); //abort wait and start sync
+                            }, cbInterval);
 
                         if (lastChangeDetected.type == DirWatcher::ChangeType::baseFolderUnavailable)
+                        {
+                            watches.clear();
                             //don't execute the command before all directories are available!
                             folderPaths = waitForMissingDirs(folderPathPhrases, [&](const Zstring& folderPath) { requestUiUpdate(&folderPath); }, cbInterval); //throw FileError
 
+                            changedPaths.insert(folderPaths.begin(), folderPaths.end()); //changes while unavailable are unknown
+                        }
                         nextExecTime = std::chrono::steady_clock::now() + delay;
                     }
                 }
                 catch (ExecCommandNowException&) {}
 
-                try
+                /* keep the watches while the command runs: setting up inotify watches is slow for large folder trees, and a new watch means "everything changed"
+                   => collect changes on a worker thread meanwhile, so that the kernel's event queue does not overflow during long runs
+                   - fanotify: changes by other processes are reported for the next execution
+                   - inotify: can't tell the command's own changes apart: changes while the command runs (time window) don't trigger another execution,
+                              but are part of the change list of the next one => a partial comparison finds these items in sync, while changes by others are not lost   */
+                std::set<Zstring, LessNativePath> changedPathsExec;
+                bool changesLostExec = false;
                 {
-                    executeExternalCommand(lastChangeDetected.itemPath, getChangeTypeName(lastChangeDetected.type)); //throw FileError
-                }
-                catch (const FileError& e) { reportError(e.toString()); }
+                    InterruptibleThread collector([&] //"watches" is used by this thread only until joined
+                    {
+                        try
+                        {
+                            for (;;)
+                            {
+                                if (std::optional<DirWatcher::Change> change = fetchChanges(watches, changedPathsExec, true /*commandRunning*/, [] {}, cbInterval)) //throw FileError
+                                {
+                                    changePending = *change;
+                                    if (change->type == DirWatcher::ChangeType::baseFolderUnavailable)
+                                        return;
+                                }
+                                waitForWatches(watches, cbInterval); //throw FileError
+                                interruptionPoint(); //throw ThreadStopRequest
+                            }
+                        }
+                        catch (FileError&) { changesLostExec = true; }
+                    });
 
+                    try
+                    {
+                        executeExternalCommand(lastChangeDetected.itemPath, getChangeTypeName(lastChangeDetected.type),
+                                               std::vector<Zstring>(changedPaths.begin(), changedPaths.end())); //throw FileError
+                        changedPaths.clear();
+                    }
+                    catch (const FileError& e) { reportError(e.toString()); } //keep changedPaths for next execution
+                } //~InterruptibleThread(): stop and join collector
+
+                //changes queued until the command ended, but not yet fetched: fanotify => fetch before forgetting the command's processes; inotify => still within the time window
+                if (!changesLostExec && !(changePending && changePending->type == DirWatcher::ChangeType::baseFolderUnavailable))
+                    try
+                    {
+                        for (int i = 0; i < 1000 && waitForWatches(watches, std::chrono::milliseconds(0)); ++i) //throw FileError
+                            //don't loop endlessly: fanotify's file system-wide mark also reports changes outside of the watched folders
+                            if (std::optional<DirWatcher::Change> change = fetchChanges(watches, changedPathsExec, true /*commandRunning*/, [] {}, cbInterval)) //throw FileError
+                            {
+                                changePending = *change;
+                                if (change->type == DirWatcher::ChangeType::baseFolderUnavailable)
+                                    break;
+                            }
+                    }
+                    catch (FileError&) { changesLostExec = true; }
+
+                for (const auto& [folderPath, watcher] : watches)
+                    watcher->forgetProcesses(); //the command's processes have ended: their pids may be reused
+
+                changedPaths.insert(changedPathsExec.begin(), changedPathsExec.end());
                 nextExecTime = std::chrono::steady_clock::time_point::max();
+
+                if (changesLostExec) //watch failed, e.g. base folder removed: let waitForChanges() recreate the watches and report the error
+                    watches.clear();
             }
         }
         catch (const FileError& e)
@@ -17,7 +17,8 @@ namespace rts
 void monitorDirectories(const std::vector<Zstring>& folderPathPhrases,
                         //non-formatted paths that yet require call to getFormattedDirectoryName(); empty directories must be checked by caller!
                         std::chrono::seconds delay,
-                        const std::function<void(const Zstring& changedItemPath, const std::wstring& actionName)>& executeExternalCommand,
+                        //changedPaths: all items changed since last execution (folder: including sub items); base folder paths if unknown
+                        const std::function<void(const Zstring& changedItemPath, const std::wstring& actionName, const std::vector<Zstring>& changedPaths)>& executeExternalCommand,
                         const std::function<void(const Zstring* missingFolderPath)>& requestUiUpdate, //either waiting for change notifications or at least one folder is missing
                         const std::function<void(const std::wstring& msg         )>& reportError, //automatically retries after return!
                         std::chrono::milliseconds cbInterval);
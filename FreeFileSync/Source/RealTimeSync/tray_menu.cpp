@@ -15,10 +15,14 @@
 #include <wx/timer.h>
 #include <wx+/image_tools.h>
 #include <zen/process_exec.h>
+#include <zen/file_access.h>
+#include <zen/file_io.h>
 #include <wx+/popup_dlg.h>
 #include <wx+/image_resources.h>
 #include "monitor.h"
 
+    #include <unistd.h> //getpid
+
 using namespace zen;
 using namespace rts;
 
@@ -249,10 +253,21 @@ rts::CancelReason rts::runFolderMonitor(const XmlRealConfig& config, const wxStr
 
     TrayIconHolder trayIcon(jobname);
 
-    auto executeExternalCommand = [&](const Zstring& changedItemPath, const std::wstring& actionName) //throw FileError
+    auto executeExternalCommand = [&](const Zstring& changedItemPath, const std::wstring& actionName, const std::vector<Zstring>& changedPaths) //throw FileError
     {
+        //all changes since last execution: one path per line => e.g. scope the next sync: FreeFileSync <job>.ffs_batch -ChangeList "%change_list%"
+        const Zstring changeListPath = appendPath(getTempFolderPath(), Zstr("RealTimeSync.") + numberTo<Zstring>(::getpid()) + Zstr(".changes")); //throw FileError
+        {
+            std::string changeList;
+            for (const Zstring& itemPath : changedPaths)
+                changeList += utfTo<std::string>(itemPath) + '\n';
+            setFileContent(changeListPath, changeList, nullptr /*notifyUnbufferedIO*/); //throw FileError
+        }
+        ZEN_ON_SCOPE_EXIT(try { removeFilePlain(changeListPath); /*throw FileError*/ } catch (FileError&) {});
+
         ::wxSetEnv(L"change_path", utfTo<wxString>(changedItemPath)); //crude way to report changed file
         ::wxSetEnv(L"change_action", actionName);                     //
+        ::wxSetEnv(L"change_list", utfTo<wxString>(changeListPath));  //
         auto cmdLineExp = expandMacros(cmdLine);
 
         try
@@ -9,6 +9,9 @@
 #include <zen/guid.h>
 #include <zen/crc.h>
 #include <zen/ring_buffer.h>
+#include <zen/rate_limiter.h>
+#include <zen/globals.h>
+#include <zen/thread.h>
 #include <typeindex>
 
 using namespace zen;
@@ -91,17 +94,124 @@ void AFS::traverseFolder(const AfsPath& folderPath, //throw FileError
 }
 
 
+namespace
+{
+class DeviceThrottle
+{
+public:
+    explicit DeviceThrottle(const AFS::IoLimits& limits)
+    {
+        if (limits.bytesPerSec > 0) bytesBucket_.emplace(static_cast<double>(limits.bytesPerSec));
+        if (limits.filesPerSec > 0) filesBucket_.emplace(static_cast<double>(limits.filesPerSec));
+    }
+
+    void throttleBytes(int64_t bytes) { if (bytesBucket_ && bytes > 0) wait(bytesBucket_->consume(static_cast<double>(bytes))); } //throw ThreadStopRequest
+    void throttleFile()               { if (filesBucket_)               wait(filesBucket_->consume(1)); }                          //
+
+private:
+    static void wait(std::chrono::steady_clock::duration delay) //throw ThreadStopRequest
+    {
+        if (delay > std::chrono::steady_clock::duration::zero())
+            interruptibleSleep(delay); //throw ThreadStopRequest
+    }
+
+    std::optional<TokenBucket> bytesBucket_;
+    std::optional<TokenBucket> filesBucket_;
+};
+
+using DeviceThrottles = std::map<AfsDevice, std::shared_ptr<DeviceThrottle>>;
+
+constinit Global<const DeviceThrottles> globalDeviceThrottles;
+constinit std::atomic<bool> globalDeviceThrottlesActive{false}; //skip locking + lookup when no limits are set
+
+
+std::shared_ptr<DeviceThrottle> getDeviceThrottle(const AfsDevice& afsDevice)
+{
+    if (!globalDeviceThrottlesActive || runningOnMainThread()) //don't freeze the UI
+        return nullptr;
+
+    if (const std::shared_ptr<const DeviceThrottles> throttles = globalDeviceThrottles.get())
+        if (auto it = throttles->find(afsDevice);
+            it != throttles->end())
+            return it->second;
+    return nullptr;
+}
+
+
+class ThrottledInputStream : public AFS::InputStream
+{
+public:
+    ThrottledInputStream(std::unique_ptr<AFS::InputStream>&& streamIn, const std::shared_ptr<DeviceThrottle>& throttle) :
+        streamIn_(std::move(streamIn)), throttle_(throttle) {}
+
+    size_t getBlockSize() override { return streamIn_->getBlockSize(); } //throw FileError
+
+    size_t tryRead(void* buffer, size_t bytesToRead, const IoCallback& notifyUnbufferedIO /*throw X*/) override //throw FileError, ErrorFileLocked, X, ThreadStopRequest
+    {
+        const size_t bytesRead = streamIn_->tryRead(buffer, bytesToRead, notifyUnbufferedIO); //throw FileError, ErrorFileLocked, X
+        throttle_->throttleBytes(bytesRead); //throw ThreadStopRequest
+        return bytesRead;
+    }
+
+    std::optional<AFS::StreamAttributes> tryGetAttributesFast() override { return streamIn_->tryGetAttributesFast(); } //throw FileError
+
+    bool allowReadFromOtherThread() override { return streamIn_->allowReadFromOtherThread(); }
+
+private:
+    const std::unique_ptr<AFS::InputStream> streamIn_;
+    const std::shared_ptr<DeviceThrottle> throttle_;
+};
+}
+
+
+void AFS::setDeviceIoLimits(const std::map<AfsDevice, IoLimits>& deviceLimits)
+{
+    auto throttles = std::make_unique<DeviceThrottles>();
+    for (const auto& [afsDevice, limits] : deviceLimits)
+        if (limits.bytesPerSec > 0 || limits.filesPerSec > 0)
+            throttles->emplace(afsDevice, std::make_shared<DeviceThrottle>(limits));
+
+    globalDeviceThrottlesActive = !throttles->empty();
+    globalDeviceThrottles.set(std::move(throttles));
+}
+
+
+std::unique_ptr<AFS::InputStream> AFS::getInputStream(const AbstractPath& filePath) //throw FileError, ErrorFileLocked
+{
+    std::unique_ptr<InputStream> streamIn = filePath.afsDevice.ref().getInputStream(filePath.afsPath); //throw FileError, ErrorFileLocked
+
+    if (const std::shared_ptr<DeviceThrottle> throttle = getDeviceThrottle(filePath.afsDevice))
+    {
+        throttle->throttleFile(); //throw ThreadStopRequest
+        return std::make_unique<ThrottledInputStream>(std::move(streamIn), throttle);
+    }
+    return streamIn;
+}
+
+
 //already existing: undefined behavior! (e.g. fail/overwrite/auto-rename)
 AFS::FileCopyResult AFS::copyFileAsStream(const AfsPath& sourcePath, const StreamAttributes& attrSource, //throw FileError, ErrorFileLocked, X
-                                          const AbstractPath& targetPath, const IoCallback& notifyUnbufferedIO /*throw X*/) const
+                                          const AbstractPath& targetPath, const IoCallback& notifyUnbufferedIO /*throw X*/,
+                                          const IoDataCallback& onSourceData /*throw X*/,
+                                          const IoCallback& notifyBytesRead /*throw X*/, const IoCallback& notifyBytesWritten /*throw X*/) const
 {
     int64_t totalBytesNotified = 0;
     IOCallbackDivider notifyIoDiv(notifyUnbufferedIO, totalBytesNotified);
 
     int64_t totalBytesRead    = 0;
     int64_t totalBytesWritten = 0;
-    IoCallback /*[!] not auto!*/ notifyUnbufferedRead  = [&](int64_t bytesDelta) { totalBytesRead    += bytesDelta; notifyIoDiv(bytesDelta); };
-    IoCallback                   notifyUnbufferedWrite = [&](int64_t bytesDelta) { totalBytesWritten += bytesDelta; notifyIoDiv(bytesDelta); };
+    IoCallback /*[!] not auto!*/ notifyUnbufferedRead = [&](int64_t bytesDelta)
+    {
+        totalBytesRead += bytesDelta;
+        notifyIoDiv(bytesDelta); //throw X
+        if (notifyBytesRead) notifyBytesRead(bytesDelta); //throw X
+    };
+    IoCallback notifyUnbufferedWrite = [&](int64_t bytesDelta)
+    {
+        totalBytesWritten += bytesDelta;
+        notifyIoDiv(bytesDelta); //throw X
+        if (notifyBytesWritten) notifyBytesWritten(bytesDelta); //throw X
+    };
     //--------------------------------------------------------------------------------------------------------
 
     auto streamIn = getInputStream(sourcePath); //throw FileError, ErrorFileLocked
@@ -120,7 +230,10 @@ AFS::FileCopyResult AFS::copyFileAsStream(const AfsPath& sourcePath, const Strea
 
     unbufferedStreamCopy([&](void* buffer, size_t bytesToRead)
     {
-        return streamIn->tryRead(buffer, bytesToRead, notifyUnbufferedRead); //throw FileError, ErrorFileLocked, X
+        const size_t bytesRead = streamIn->tryRead(buffer, bytesToRead, notifyUnbufferedRead); //throw FileError, ErrorFileLocked, X
+        if (onSourceData)
+            onSourceData(buffer, bytesRead); //throw X
+        return bytesRead;
     },
     streamIn->getBlockSize() /*throw FileError*/,
 
@@ -154,6 +267,7 @@ AFS::FileCopyResult AFS::copyFileAsStream(const AfsPath& sourcePath, const Strea
         .sourceFilePrint = attrSourceNew.filePrint,
         .targetFilePrint = finResult.filePrint,
         .errorModTime    = finResult.errorModTime,
+        .copyMethod      = FileCopyMethod::stream,
         /* Failing to set modification time is not a fatal error from synchronization perspective (treat like external update)
                 => Support additional scenarios:
                 - GVFS failing to set modTime for FTP: https://freefilesync.org/forum/viewtopic.php?t=2372
@@ -170,14 +284,34 @@ AFS::FileCopyResult AFS::copyFileTransactional(const AbstractPath& sourcePath, c
                                                bool copyFilePermissions,
                                                bool transactionalCopy,
                                                const std::function<void()>& onDeleteTargetFile,
-                                               const IoCallback& notifyUnbufferedIO /*throw X*/)
+                                               const IoCallback& notifyUnbufferedIO /*throw X*/,
+                                               const IoDataCallback& onSourceData /*throw X*/)
 {
+    //device throttling: bytes read are charged to the source device only, bytes written to the target device only
+    //=> reflink/server-side copy transfer no data: not charged
+    const std::shared_ptr<DeviceThrottle> throttleSource = getDeviceThrottle(sourcePath.afsDevice);
+    const std::shared_ptr<DeviceThrottle> throttleTarget = getDeviceThrottle(targetPath.afsDevice);
+
+    IoCallback notifyBytesRead;
+    IoCallback notifyBytesWritten;
+    if (throttleSource)
+    {
+        throttleSource->throttleFile(); //throw ThreadStopRequest
+        notifyBytesRead = [&](int64_t bytesDelta) { throttleSource->throttleBytes(bytesDelta); }; //throw ThreadStopRequest
+    }
+    if (throttleTarget)
+    {
+        throttleTarget->throttleFile(); //throw ThreadStopRequest
+        notifyBytesWritten = [&](int64_t bytesDelta) { throttleTarget->throttleBytes(bytesDelta); }; //throw ThreadStopRequest
+    }
+
     auto copyFilePlain = [&](const AbstractPath& targetPathTmp)
     {
         //caveat: typeid returns static type for pointers, dynamic type for references!!!
         if (typeid(sourcePath.afsDevice.ref()) == typeid(targetPathTmp.afsDevice.ref()))
             return sourcePath.afsDevice.ref().copyFileForSameAfsType(sourcePath.afsPath, attrSource,
-                                                                     targetPathTmp, copyFilePermissions, notifyUnbufferedIO); //throw FileError, ErrorFileLocked, X
+                                                                     targetPathTmp, copyFilePermissions, notifyUnbufferedIO, onSourceData,
+                                                                     notifyBytesRead, notifyBytesWritten); //throw FileError, ErrorFileLocked, X
         //already existing: undefined behavior! (e.g. fail/overwrite/auto-rename)
 
         //fall back to stream-based file copy:
@@ -186,7 +320,8 @@ AFS::FileCopyResult AFS::copyFileTransactional(const AbstractPath& sourcePath, c
                             _("Operation not supported between different devices."));
 
         //already existing: undefined behavior! (e.g. fail/overwrite/auto-rename)
-        return sourcePath.afsDevice.ref().copyFileAsStream(sourcePath.afsPath, attrSource, targetPathTmp, notifyUnbufferedIO); //throw FileError, ErrorFileLocked, X
+        return sourcePath.afsDevice.ref().copyFileAsStream(sourcePath.afsPath, attrSource, targetPathTmp, notifyUnbufferedIO, onSourceData,
+                                                           notifyBytesRead, notifyBytesWritten); //throw FileError, ErrorFileLocked, X
     };
 
     if (transactionalCopy && !hasNativeTransactionalCopy(targetPath))
@@ -9,6 +9,7 @@
 
 #include <functional>
 #include <chrono>
+#include <map>
 #include <zen/file_error.h>
 #include <zen/file_path.h>
 #include <zen/serialize.h> //InputStream/OutputStream support buffered stream concept
@@ -150,9 +151,13 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
 
         //only returns attributes if they are already buffered within stream handle and determination would be otherwise expensive (e.g. FTP/SFTP):
         virtual std::optional<StreamAttributes> tryGetAttributesFast() = 0; //throw FileError
+
+        //tryRead() may be called from a thread other than the creating one, concurrently to other streams of the same device (e.g. read ahead)
+        //=> not for sessions bound to the creating thread (e.g. SFTP)
+        virtual bool allowReadFromOtherThread() = 0;
     };
     //return value always bound:
-    static std::unique_ptr<InputStream> getInputStream(const AbstractPath& filePath) { return filePath.afsDevice.ref().getInputStream(filePath.afsPath); } //throw FileError, ErrorFileLocked
+    static std::unique_ptr<InputStream> getInputStream(const AbstractPath& filePath); //throw FileError, ErrorFileLocked
 
     //----------------------------------------------------------------------------------------------------------------
 
@@ -243,6 +248,9 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
 
         virtual HandleError reportDirError (const ErrorInfo& errorInfo)                          = 0; //failed directory traversal -> consider directory data at current level as incomplete!
         virtual HandleError reportItemError(const ErrorInfo& errorInfo, const Zstring& itemName) = 0; //failed to get data for single file/dir/symlink only!
+
+        //opt-in (initial workload items only): traverser may reuse listings of folders unchanged since the previous traversal, see setNativeTraversalSnapshot()
+        virtual bool allowFolderSnapshot() const { return false; }
     };
 
     using TraverserWorkload = std::vector<std::pair<AfsPath, std::shared_ptr<TraverserCallback> /*throw X*/>>;
@@ -268,6 +276,13 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
     static inline constexpr ZstringView TEMP_FILE_ENDING = Zstr(".ffs_tmp"); //don't use Zstring as global constant: avoid static initialization order problem in global namespace!
     // caveat: ending is hard-coded by RealTimeSync
 
+    enum class FileCopyMethod : unsigned char
+    {
+        stream,        //via user space buffers: onSourceData received all source data
+        offloaded,     //in-kernel/server-side copy: data not seen by onSourceData
+        sharedExtents, //reflink: no data copied at all
+    };
+
     struct FileCopyResult
     {
         uint64_t fileSize = 0;
@@ -275,6 +290,7 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
         FingerPrint sourceFilePrint = 0; //optional
         FingerPrint targetFilePrint = 0; //
         std::optional<zen::FileError> errorModTime; //failure to set modification time
+        FileCopyMethod copyMethod = FileCopyMethod::offloaded; //onSourceData received all source data only for FileCopyMethod::stream
     };
 
     //symlink handling: follow
@@ -288,7 +304,22 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
                                                 //if transactionalCopy == true, full read access on source had been proven at this point, so it's safe to delete it.
                                                 const std::function<void()>& onDeleteTargetFile /*throw X*/,
                                                 //accummulated delta != file size! consider ADS, sparse, compressed files
-                                                const zen::IoCallback& notifyUnbufferedIO /*throw X*/);
+                                                const zen::IoCallback& notifyUnbufferedIO /*throw X*/,
+                                                //optional: receives all source bytes in file order, e.g. to hash while copying
+                                                //=> only if the result's copyMethod is FileCopyMethod::stream: server-side copy, reflink, copy_file_range bypass user space
+                                                const zen::IoDataCallback& onSourceData /*throw X*/);
+    struct IoLimits
+    {
+        uint64_t bytesPerSec = 0; //0: no limit
+        uint64_t filesPerSec = 0; //
+
+        bool operator==(const IoLimits&) const = default;
+    };
+    /* throttle file content I/O per device (token bucket): copyFileTransactional() + getInputStream() (e.g. compare by content, verification)
+        - worker threads only: never blocks the main (UI) thread
+        - no limits set: overhead is a single atomic load per file     */
+    static void setDeviceIoLimits(const std::map<AfsDevice, IoLimits>& deviceLimits);
+
     //already existing: fail
     //symlink handling: follow
     static void copyNewFolder(const AbstractPath& sourcePath, const AbstractPath& targetPath, bool copyFilePermissions); //throw FileError
@@ -346,7 +377,10 @@ protected:
 
     //already existing: undefined behavior! (e.g. fail/overwrite/auto-rename)
     FileCopyResult copyFileAsStream(const AfsPath& sourcePath, const StreamAttributes& attrSource, //throw FileError, ErrorFileLocked, X
-                                    const AbstractPath& targetPath, const zen::IoCallback& notifyUnbufferedIO /*throw X*/) const;
+                                    const AbstractPath& targetPath, const zen::IoCallback& notifyUnbufferedIO /*throw X*/,
+                                    const zen::IoDataCallback& onSourceData /*throw X; optional*/,
+                                    const zen::IoCallback& notifyBytesRead    /*throw X; optional: see copyFileForSameAfsType()*/,
+                                    const zen::IoCallback& notifyBytesWritten /*throw X; optional*/) const;
 
 
     std::wstring generateMoveErrorMsg(const AfsPath& pathFrom, const AbstractPath& pathTo) const
@@ -415,7 +449,12 @@ private:
     virtual FileCopyResult copyFileForSameAfsType(const AfsPath& sourcePath, const StreamAttributes& attrSource, //throw FileError, ErrorFileLocked, X
                                                   const AbstractPath& targetPath, bool copyFilePermissions,
                                                   //accummulated delta != file size! consider ADS, sparse, compressed files
-                                                  const zen::IoCallback& notifyUnbufferedIO /*throw X*/) const = 0;
+                                                  const zen::IoCallback& notifyUnbufferedIO /*throw X*/,
+                                                  const zen::IoDataCallback& onSourceData /*throw X; optional: see copyFileTransactional()*/,
+                                                  //optional: bytes actually transferred from source/to target device, e.g. for device throttling
+                                                  //=> nothing to report for server-side copy or reflink
+                                                  const zen::IoCallback& notifyBytesRead    /*throw X*/,
+                                                  const zen::IoCallback& notifyBytesWritten /*throw X*/) const = 0;
 
 
     //symlink handling: follow
@@ -59,6 +59,128 @@ bool tryReportingItemError(Command cmd, AbstractFileSystem::TraverserCallback& c
 
 //==========================================================================================
 
+/* Recursive folder traversal distributing the directory reads over up to "parallelOps" worker threads:
+    - readFolder(folderPath):                            context of worker thread;  throw FileError
+    - evalFolder(folderPath, content, cb, subFolders):   context of calling thread; throw X
+        => report folder content to TraverserCallback and append the sub folders to traverse next
+    - all TraverserCallback calls happen on the calling thread: same (single-threaded) contract as for sequential traversal
+    - parallelOps <= 1: no worker threads, readFolder() is run on the calling thread in "seqOrder"     */
+enum class SequentialOrder
+{
+    depthFirst,   //LIFO
+    breadthFirst, //FIFO
+};
+
+template <class NativePath, class ReadFolder, class EvalFolder>
+void traverseFolderRecursiveParallel(const std::vector<std::pair<NativePath, std::shared_ptr<AbstractFileSystem::TraverserCallback>>>& workload /*throw X*/,
+                                     size_t parallelOps, SequentialOrder seqOrder, const Zstring& threadGroupName, ReadFolder readFolder, EvalFolder evalFolder) //throw X
+{
+    using namespace zen;
+    using WorkItem      = std::pair<NativePath, std::shared_ptr<AbstractFileSystem::TraverserCallback>>;
+    using FolderContent = decltype(readFolder(std::declval<const NativePath&>()));
+
+    std::vector<WorkItem> subFolders; //buffer for evalFolder()
+
+    if (parallelOps <= 1)
+    {
+        RingBuffer<WorkItem> pending;
+        for (const WorkItem& wi : workload)
+            pending.push_back(wi);
+
+        while (!pending.empty())
+        {
+            const bool lifo = seqOrder == SequentialOrder::depthFirst;
+            WorkItem wi = std::move(lifo ? pending.back() : pending.front()); //yes, no strong exception guarantee (std::bad_alloc)
+            if (lifo) pending.pop_back(); else pending.pop_front();         //
+            const auto& [folderPath, cb] = wi;
+
+            std::optional<FolderContent> content;
+            tryReportingDirError([&] //throw X
+            {
+                content = readFolder(folderPath); //throw FileError
+            }, *cb);
+
+            if (content)
+            {
+                evalFolder(folderPath, *content, *cb, subFolders); //throw X
+                for (WorkItem& wiSub : subFolders)
+                    pending.push_back(std::move(wiSub));
+                subFolders.clear();
+            }
+        }
+        return;
+    }
+
+    struct FolderResult
+    {
+        WorkItem wi;
+        size_t retryNumber = 0;
+        std::optional<FolderContent> content; //either or
+        std::optional<FileError> error;       //
+    };
+    std::mutex lockResults;
+    std::condition_variable conditionNewResult;
+    RingBuffer<FolderResult> results; //FIFO: completion order
+
+    ThreadGroup<std::function<void()>> tg(parallelOps, threadGroupName); //manage life time: destroy *before* "results"!
+    size_t foldersPending = 0; //context of calling thread only
+
+    auto scheduleFolder = [&](WorkItem&& wi, size_t retryNumber)
+    {
+        ++foldersPending;
+        tg.run([&, wi = std::move(wi), retryNumber]
+        {
+            FolderResult res{wi, retryNumber};
+            try
+            {
+                res.content = readFolder(res.wi.first); //throw FileError, (ThreadStopRequest)
+            }
+            catch (const FileError& e) { res.error = e; }
+            {
+                std::lock_guard dummy(lockResults);
+                results.push_back(std::move(res));
+            }
+            conditionNewResult.notify_all();
+        });
+    };
+
+    for (const WorkItem& wi : workload)
+        scheduleFolder(WorkItem(wi), 0);
+
+    while (foldersPending > 0)
+    {
+        FolderResult res;
+        {
+            std::unique_lock dummy(lockResults);
+            interruptibleWait(conditionNewResult, dummy, [&] { return !results.empty(); }); //throw ThreadStopRequest
+
+            res = std::move(results.    front()); //noexcept thanks to move
+            /**/            results.pop_front();  //
+        }
+        --foldersPending;
+        const auto& [folderPath, cb] = res.wi;
+
+        if (res.error)
+            switch (cb->reportDirError({res.error->toString(), std::chrono::steady_clock::now(), res.retryNumber})) //throw X
+            {
+                case AbstractFileSystem::TraverserCallback::HandleError::retry:
+                    scheduleFolder(std::move(res.wi), res.retryNumber + 1);
+                    break;
+                case AbstractFileSystem::TraverserCallback::HandleError::ignore:
+                    break;
+            }
+        else
+        {
+            evalFolder(folderPath, *res.content, *cb, subFolders); //throw X
+            for (WorkItem& wiSub : subFolders)
+                scheduleFolder(std::move(wiSub), 0);
+            subFolders.clear();
+        }
+    }
+}
+
+//==========================================================================================
+
 //Google Drive/MTP happily create duplicate files/folders with the same names, without failing
 //=> however, FFS's "check if already exists after failure" idiom *requires* failure
 //=> best effort: serialize access (at path level) so that GdriveFileState existence check and file/folder creation act as a single operation
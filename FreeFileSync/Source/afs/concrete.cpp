@@ -16,6 +16,7 @@ using namespace zen;
 
 void fff::initAfs(const AfsConfig& cfg)
 {
+    nativeInit(appendPath(cfg.configDirPath, Zstr("FolderSnapshots")));
     ftpInit();
     sftpInit();
     gdriveInit(appendPath(cfg.configDirPath,   Zstr("GoogleDrive")),
@@ -1770,94 +1770,78 @@ private:
 };
 
 
-class SingleFolderTraverser
+std::vector<FtpItem> getDirContentFlat(const FtpLogin& login, const AfsPath& dirPath) //throw FileError
 {
-public:
-    SingleFolderTraverser(const FtpLogin& login, const std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>>& workload /*throw X*/)
-        : workload_(workload), login_(login)
+    try
     {
-        while (!workload_.empty())
-        {
-            auto wi = std::move(workload_.    back()); //yes, no strong exception guarantee (std::bad_alloc)
-            /**/                workload_.pop_back();  //
-            const auto& [folderPath, cb] = wi;
-
-            tryReportingDirError([&] //throw X
-            {
-                traverseWithException(folderPath, *cb); //throw FileError, X
-            }, *cb);
-        }
+        return FtpDirectoryReader::execute(login, dirPath); //throw SysError, SysErrorFtpProtocol
     }
+    catch (const SysError& e) { throw FileError(replaceCpy(_("Cannot read directory %x."), L"%x", fmtPath(getCurlDisplayPath(login, dirPath))), e.toString()); }
+}
 
-private:
-    SingleFolderTraverser           (const SingleFolderTraverser&) = delete;
-    SingleFolderTraverser& operator=(const SingleFolderTraverser&) = delete;
 
-    void traverseWithException(const AfsPath& dirPath, AFS::TraverserCallback& cb) //throw FileError, X
+void evalFolderContent(const FtpLogin& login, const AfsPath& dirPath, const std::vector<FtpItem>& folderContent, AFS::TraverserCallback& cb, //throw X
+                       std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>>& subFolders)
+{
+    for (const FtpItem& item : folderContent)
     {
-        std::vector<FtpItem> items;
-        try
-        {
-            items = FtpDirectoryReader::execute(login_, dirPath); //throw SysError, SysErrorFtpProtocol
-        }
-        catch (const SysError& e)
-        {
-            throw FileError(replaceCpy(_("Cannot read directory %x."), L"%x", fmtPath(getCurlDisplayPath(login_, dirPath))), e.toString());
-        }
+        const AfsPath itemPath(appendPath(dirPath.value, item.itemName));
 
-        for (const FtpItem& item : items)
+        switch (item.type)
         {
-            const AfsPath itemPath(appendPath(dirPath.value, item.itemName));
+            case AFS::ItemType::file:
+                cb.onFile({item.itemName, item.fileSize, item.modTime, item.filePrint, false /*isFollowedSymlink*/}); //throw X
+                break;
 
-            switch (item.type)
-            {
-                case AFS::ItemType::file:
-                    cb.onFile({item.itemName, item.fileSize, item.modTime, item.filePrint, false /*isFollowedSymlink*/}); //throw X
-                    break;
+            case AFS::ItemType::folder:
+                if (std::shared_ptr<AFS::TraverserCallback> cbSub = cb.onFolder({item.itemName, false /*isFollowedSymlink*/})) //throw X
+                    subFolders.emplace_back(itemPath, std::move(cbSub));
+                break;
 
-                case AFS::ItemType::folder:
-                    if (std::shared_ptr<AFS::TraverserCallback> cbSub = cb.onFolder({item.itemName, false /*isFollowedSymlink*/})) //throw X
-                        workload_.push_back({itemPath, std::move(cbSub)});
-                    break;
-
-                case AFS::ItemType::symlink:
-                    switch (cb.onSymlink({item.itemName, item.modTime})) //throw X
+            case AFS::ItemType::symlink:
+                switch (cb.onSymlink({item.itemName, item.modTime})) //throw X
+                {
+                    case AFS::TraverserCallback::HandleLink::follow:
                     {
-                        case AFS::TraverserCallback::HandleLink::follow:
-                        {
-                            FtpItem target = {};
-                            if (!tryReportingItemError([&] //throw X
-                        {
-                            target = getFtpSymlinkInfo(login_, itemPath); //throw FileError
-                            }, cb, item.itemName))
-                            continue;
+                        FtpItem target = {};
+                        if (!tryReportingItemError([&] //throw X
+                    {
+                        target = getFtpSymlinkInfo(login, itemPath); //throw FileError
+                        }, cb, item.itemName))
+                        continue;
 
-                            if (target.type == AFS::ItemType::folder)
-                            {
-                                if (std::shared_ptr<AFS::TraverserCallback> cbSub = cb.onFolder({item.itemName, true /*isFollowedSymlink*/})) //throw X
-                                    workload_.push_back({itemPath, std::move(cbSub)});
-                            }
-                            else //a file or named pipe, etc.
-                                cb.onFile({item.itemName, target.fileSize, target.modTime, item.filePrint, true /*isFollowedSymlink*/}); //throw X
+                        if (target.type == AFS::ItemType::folder)
+                        {
+                            if (std::shared_ptr<AFS::TraverserCallback> cbSub = cb.onFolder({item.itemName, true /*isFollowedSymlink*/})) //throw X
+                                subFolders.emplace_back(itemPath, std::move(cbSub));
                         }
-                        break;
-
-                        case AFS::TraverserCallback::HandleLink::skip:
-                            break;
+                        else //a file or named pipe, etc.
+                            cb.onFile({item.itemName, target.fileSize, target.modTime, item.filePrint, true /*isFollowedSymlink*/}); //throw X
                     }
                     break;
-            }
+
+                    case AFS::TraverserCallback::HandleLink::skip:
+                        break;
+                }
+                break;
         }
     }
-
-    std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>> workload_;
-    const FtpLogin login_;
-};
+}
 
 
-void traverseFolderRecursiveFTP(const FtpLogin& login, const std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>>& workload /*throw X*/, size_t) //throw X
+/* parallelOps > 1: up to "parallelOps" control connections list directories concurrently: FtpSessionManager hands out one (pooled) session per call
+    => scanning is bound by round-trips per directory (EPSV + data connection + MLSD/LIST), not bandwidth
+    => no CWD for MLSD (CURLFTPMETHOD_NOCWD); LIST: one absolute CWD per folder (CURLFTPMETHOD_SINGLECWD), whichever session lists it
+    => TraverserCallback is still called from the single traverser thread only        */
+void traverseFolderRecursiveFTP(const FtpLogin& login, const std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>>& workload /*throw X*/, size_t parallelOps) //throw X
 {
-    SingleFolderTraverser dummy(login, workload); //throw X
+    traverseFolderRecursiveParallel(workload, parallelOps, SequentialOrder::depthFirst, Zstr("Traverser[FTP]"), //throw X
+    [&](const AfsPath& dirPath) { return getDirContentFlat(login, dirPath); /*throw FileError*/ },
+    [&](const AfsPath& dirPath, const std::vector<FtpItem>& folderContent, AFS::TraverserCallback& cb, //throw X
+        std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>>& subFolders)
+    {
+        evalFolderContent(login, dirPath, folderContent, cb, subFolders); //throw X
+    });
 }
 //===========================================================================================================================
 //===========================================================================================================================
@@ -2027,6 +2011,8 @@ struct InputStreamFtp : public AFS::InputStream
     //  CURLOPT_FILETIME:                                           test case 77 files, 4MB: overall copy time increases by 12%
     //  CURLOPT_PREQUOTE/CURLOPT_PREQUOTE/CURLOPT_POSTQUOTE + MDTM: test case 77 files, 4MB: overall copy time increases by 12%
 
+    bool allowReadFromOtherThread() override { return false; } //download already runs on worker thread
+
 private:
     void reportBytesProcessed(const IoCallback& notifyUnbufferedIO /*throw X*/) //throw X
     {
@@ -2425,14 +2411,16 @@ private:
     //symlink handling: follow
     //already existing: undefined behavior! (e.g. fail/overwrite/auto-rename)
     FileCopyResult copyFileForSameAfsType(const AfsPath& sourcePath, const StreamAttributes& attrSource, //throw FileError, (ErrorFileLocked), X
-                                          const AbstractPath& targetPath, bool copyFilePermissions, const IoCallback& notifyUnbufferedIO /*throw X*/) const override
+                                          const AbstractPath& targetPath, bool copyFilePermissions, const IoCallback& notifyUnbufferedIO /*throw X*/,
+                                          const IoDataCallback& onSourceData /*throw X*/,
+                                          const IoCallback& notifyBytesRead /*throw X*/, const IoCallback& notifyBytesWritten /*throw X*/) const override
     {
         //no native FTP file copy => use stream-based file copy:
         if (copyFilePermissions)
             throw FileError(replaceCpy(_("Cannot write permissions of %x."), L"%x", fmtPath(AFS::getDisplayPath(targetPath))), _("Operation not supported by device."));
 
         //already existing: undefined behavior! (e.g. fail/overwrite/auto-rename)
-        return copyFileAsStream(sourcePath, attrSource, targetPath, notifyUnbufferedIO); //throw FileError, (ErrorFileLocked), X
+        return copyFileAsStream(sourcePath, attrSource, targetPath, notifyUnbufferedIO, onSourceData, notifyBytesRead, notifyBytesWritten); //throw FileError, (ErrorFileLocked), X
     }
 
     //symlink handling: follow
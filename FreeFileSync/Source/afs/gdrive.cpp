@@ -80,6 +80,7 @@ constexpr std::chrono::seconds GDRIVE_SYNC_INTERVAL         (5);
 const size_t GDRIVE_BLOCK_SIZE_DOWNLOAD =  64 * 1024; //libcurl returns blocks of only 16 kB as returned by recv() even if we request larger blocks via CURLOPT_BUFFERSIZE
 const size_t GDRIVE_BLOCK_SIZE_UPLOAD   =  64 * 1024; //libcurl requests blocks of 64 kB. larger blocksizes set via CURLOPT_UPLOAD_BUFFERSIZE do not seem to make a difference
 const size_t GDRIVE_STREAM_BUFFER_SIZE = 1024 * 1024; //unit: [byte]
+const size_t GDRIVE_SMALL_UPLOAD_SIZE_MAX = 256 * 1024; //upload in a single multiplexed request: buffered in memory!
 //stream buffer should be big enough to facilitate prefetching during alternating read/write operations => e.g. see serialize.h::unbufferedStreamCopy()
 
 constexpr ZstringView gdrivePrefix = Zstr("gdrive:");
@@ -227,6 +228,21 @@ public:
         useHttpSession(httpSession->session); //throw X
     }
 
+    //one multiplexed connection per sessionId for small buffered requests: created on first use, removed by clean-up thread when idle
+    std::shared_ptr<HttpMultiplexer> getMultiplexer(const HttpSessionId& sessionId) //throw SysError
+    {
+        std::shared_ptr<HttpInitMultiplexer> muxInit;
+
+        multiplexers_.access([&](GlobalHttpMultiplexers& multiplexers)
+        {
+            std::shared_ptr<HttpInitMultiplexer>& mux = multiplexers[sessionId];
+            if (!mux)
+                mux = std::make_shared<HttpInitMultiplexer>(sessionId.server, caCertFilePath_); //throw SysError
+            muxInit = mux;
+        });
+        return std::shared_ptr<HttpMultiplexer>(muxInit, &muxInit->mux); //keep alive while in use
+    }
+
 private:
     HttpSessionManager           (const HttpSessionManager&) = delete;
     HttpSessionManager& operator=(const HttpSessionManager&) = delete;
@@ -240,7 +256,17 @@ private:
         const std::shared_ptr<UniCounterCookie> cookie{getLibsshCurlUnifiedInitCookie(httpSessionCount)}; //throw SysError
         HttpSession session; //life time must be subset of UniCounterCookie
     };
-    static bool isHealthy(const HttpSession& s) { return std::chrono::steady_clock::now() - s.getLastUseTime() <= HTTP_SESSION_MAX_IDLE_TIME; }
+    struct HttpInitMultiplexer
+    {
+        HttpInitMultiplexer(const Zstring& server, const Zstring& caCertFilePath) :
+            mux(server, true /*useTls*/, caCertFilePath) {} //throw SysError
+
+        const std::shared_ptr<UniCounterCookie> cookie{getLibsshCurlUnifiedInitCookie(httpSessionCount)}; //throw SysError
+        HttpMultiplexer mux; //life time must be subset of UniCounterCookie
+    };
+
+    static bool isHealthy(const HttpSession&     s) { return std::chrono::steady_clock::now() - s.getLastUseTime() <= HTTP_SESSION_MAX_IDLE_TIME; }
+    static bool isHealthy(const HttpMultiplexer& m) { return std::chrono::steady_clock::now() - m.getLastUseTime() <= HTTP_SESSION_MAX_IDLE_TIME; }
 
     using HttpSessionCache = std::vector<std::unique_ptr<HttpInitSession>>;
 
@@ -299,12 +325,30 @@ private:
                         break;
                     std::this_thread::yield();
                 }
+
+            //idle multiplexers: same as idle sessions, but only if not in use by another thread (=> use_count() == 1)
+            std::vector<std::shared_ptr<HttpInitMultiplexer>> idleMultiplexers;
+
+            multiplexers_.access([&](GlobalHttpMultiplexers& multiplexers)
+            {
+                for (auto it = multiplexers.begin(); it != multiplexers.end();)
+                    if (it->second.use_count() == 1 && !isHealthy(it->second->mux))
+                    {
+                        idleMultiplexers.push_back(std::move(it->second));
+                        it = multiplexers.erase(it);
+                    }
+                    else
+                        ++it;
+            });
+            idleMultiplexers.clear(); //run ~HttpMultiplexer *outside* the lock: joins worker thread, closes connections
         }
     }
 
-    using GlobalHttpSessions = std::unordered_map<HttpSessionId, Protected<HttpSessionCache>>;
+    using GlobalHttpSessions     = std::unordered_map<HttpSessionId, Protected<HttpSessionCache>>;
+    using GlobalHttpMultiplexers = std::unordered_map<HttpSessionId, std::shared_ptr<HttpInitMultiplexer>>;
 
     Protected<GlobalHttpSessions> globalSessionCache_;
+    Protected<GlobalHttpMultiplexers> multiplexers_;
     const Zstring caCertFilePath_;
     InterruptibleThread sessionCleaner_;
 };
@@ -366,6 +410,34 @@ HttpSession::Result gdriveHttpsRequest(const std::string& serverRelPath, //throw
                               receiveHeader /*throw X*/, access.timeoutSec); //throw SysError, X
 }
 
+
+/* small metadata requests (listing, delete, move, set mod time, ...): share a single HTTP/2 connection instead of one connection per thread
+    => parallel file operations are sent as concurrent streams: similar effect as Google's batch API, without the multipart encoding
+    - response is buffered, then reported to writeResponse() on the calling thread
+    - no streaming => use gdriveHttpsRequest() for downloads and uploads, except for small files: see gdriveUploadSmallFile()   */
+HttpSession::Result gdriveHttpsRequestMux(const std::string& serverRelPath, //throw SysError, X
+                                          std::vector<std::string> extraHeaders,
+                                          std::vector<CurlOption> extraOptions,
+                                          const std::function<void(std::span<const char> buf)>& writeResponse /*throw X*/, //optional
+                                          const GdriveAccess& access)
+{
+    extraHeaders.push_back("Authorization: Bearer " + access.token);
+    extraOptions.emplace_back(CURLOPT_USERAGENT, "FreeFileSync (gzip)"); //see googleHttpsRequest()
+
+    const std::shared_ptr<HttpSessionManager> mgr = globalHttpSessionManager.get();
+    if (!mgr)
+        throw SysError(formatSystemError("gdriveHttpsRequestMux", L"", L"Function call not allowed during init/shutdown."));
+
+    const HttpMultiplexer::Result muxResult = mgr->getMultiplexer(HttpSessionId(GOOGLE_REST_API_SERVER))-> //throw SysError
+                                              perform(serverRelPath, extraHeaders, extraOptions, access.timeoutSec); //
+    if (writeResponse)
+        writeResponse(muxResult.response); //throw X
+
+    HttpSession::Result httpResult;
+    httpResult.statusCode = muxResult.statusCode;
+    return httpResult;
+}
+
 //========================================================================================================
 
 struct GdriveUser
@@ -381,8 +453,8 @@ GdriveUser getGdriveUser(const GdriveAccess& access) //throw SysError
         {"fields", "user/displayName,user/emailAddress"},
     });
     std::string response;
-    gdriveHttpsRequest("/drive/v3/about?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    gdriveHttpsRequestMux("/drive/v3/about?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); }
@@ -735,9 +807,8 @@ int64_t gdriveGetMyDriveFreeSpace(const GdriveAccess& access) //throw SysError
 {
     //https://developers.google.com/drive/api/v3/reference/about
     std::string response;
-    gdriveHttpsRequest("/drive/v3/about?fields=storageQuota", {} /*extraHeaders*/, {} /*extraOptions*/,
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-    nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    gdriveHttpsRequestMux("/drive/v3/about?fields=storageQuota", {} /*extraHeaders*/, {} /*extraOptions*/,
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); }
@@ -773,9 +844,8 @@ std::string /*itemId*/ getMyDriveId(const GdriveAccess& access) //throw SysError
         {"fields", "id"},
     });
     std::string response;
-    gdriveHttpsRequest("/drive/v3/files/root?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-    nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    gdriveHttpsRequestMux("/drive/v3/files/root?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); }
@@ -811,9 +881,8 @@ std::vector<DriveDetails> getSharedDrives(const GdriveAccess& access) //throw Sy
                 queryParams += '&' + xWwwFormUrlEncode({{"pageToken", *nextPageToken}});
 
             std::string response;
-            gdriveHttpsRequest("/drive/v3/drives?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
-            [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-            nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+            gdriveHttpsRequestMux("/drive/v3/drives?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
+            [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
             JsonValue jresponse;
             try { jresponse = parseJson(response); }
@@ -868,9 +937,8 @@ std::vector<StarredFolderDetails> getStarredFolders(const GdriveAccess& access)
                 queryParams += '&' + xWwwFormUrlEncode({{"pageToken", *nextPageToken}});
 
             std::string response;
-            gdriveHttpsRequest("/drive/v3/files?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
-            [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-            nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+            gdriveHttpsRequestMux("/drive/v3/files?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
+            [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
             JsonValue jresponse;
             try { jresponse = parseJson(response); }
@@ -998,9 +1066,8 @@ GdriveItemDetails getItemDetails(const std::string& itemId, const GdriveAccess&
         {"supportsAllDrives", "true"},
     });
     std::string response;
-    gdriveHttpsRequest("/drive/v3/files/" + itemId + '?' + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-    nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    gdriveHttpsRequestMux("/drive/v3/files/" + itemId + '?' + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
     try
     {
         const JsonValue jvalue = parseJson(response); //throw JsonParsingError
@@ -1045,9 +1112,8 @@ std::vector<GdriveItem> readFolderContent(const std::string& folderId, const Gdr
                 queryParams += '&' + xWwwFormUrlEncode({{"pageToken", *nextPageToken}});
 
             std::string response;
-            gdriveHttpsRequest("/drive/v3/files?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
-            [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-            nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+            gdriveHttpsRequestMux("/drive/v3/files?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
+            [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
             JsonValue jresponse;
             try { jresponse = parseJson(response); }
@@ -1116,9 +1182,8 @@ ChangesDelta getChangesDelta(const std::string& sharedDriveId /*empty for "My Dr
             queryParams += '&' + xWwwFormUrlEncode({{"driveId", sharedDriveId}}); //only allowed for shared drives!
 
         std::string response;
-        gdriveHttpsRequest("/drive/v3/changes?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
-        [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-        nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+        gdriveHttpsRequestMux("/drive/v3/changes?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
+        [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
         JsonValue jresponse;
         try { jresponse = parseJson(response); }
@@ -1210,9 +1275,8 @@ std::string /*startPageToken*/ getChangesCurrentToken(const std::string& sharedD
         queryParams += '&' + xWwwFormUrlEncode({{"driveId", sharedDriveId}}); //only allowed for shared drives!
 
     std::string response;
-    gdriveHttpsRequest("/drive/v3/changes/startPageToken?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-    nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    gdriveHttpsRequestMux("/drive/v3/changes/startPageToken?" + queryParams, {} /*extraHeaders*/, {} /*extraOptions*/,
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); }
@@ -1236,9 +1300,8 @@ void gdriveDeleteItem(const std::string& itemId, const GdriveAccess& access) //t
         {"supportsAllDrives", "true"},
     });
     std::string response;
-    const HttpSession::Result httpResult = gdriveHttpsRequest("/drive/v3/files/" + itemId + '?' + queryParams,
-    {} /*extraHeaders*/, {{CURLOPT_CUSTOMREQUEST, "DELETE"}}, [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-    nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    const HttpSession::Result httpResult = gdriveHttpsRequestMux("/drive/v3/files/" + itemId + '?' + queryParams,
+    {} /*extraHeaders*/, {{CURLOPT_CUSTOMREQUEST, "DELETE"}}, [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     if (response.empty() && httpResult.statusCode == 204)
         return; //"If successful, this method returns an empty response body"
@@ -1258,9 +1321,9 @@ void gdriveUnlinkParent(const std::string& itemId, const std::string& parentId,
         {"fields", "id,parents"}, //for test if operation was successful
     });
     std::string response;
-    const HttpSession::Result httpResult = gdriveHttpsRequest("/drive/v3/files/" + itemId + '?' + queryParams,
+    const HttpSession::Result httpResult = gdriveHttpsRequestMux("/drive/v3/files/" + itemId + '?' + queryParams,
     {"Content-Type: application/json; charset=UTF-8"}, {{CURLOPT_CUSTOMREQUEST, "PATCH"}, { CURLOPT_POSTFIELDS, "{}"}},
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     if (response.empty() && httpResult.statusCode == 204)
         return; //removing last parent of item not owned by us returns "204 No Content" (instead of 200 + file body)
@@ -1295,9 +1358,9 @@ void gdriveMoveToTrash(const std::string& itemId, const GdriveAccess& access) //
     const std::string postBuf = R"({ "trashed": true })";
 
     std::string response;
-    gdriveHttpsRequest("/drive/v3/files/" + itemId + '?' + queryParams,
+    gdriveHttpsRequestMux("/drive/v3/files/" + itemId + '?' + queryParams,
     {"Content-Type: application/json; charset=UTF-8"}, {{CURLOPT_CUSTOMREQUEST, "PATCH"}, {CURLOPT_POSTFIELDS, postBuf.c_str()}},
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); /*throw JsonParsingError*/ }
@@ -1325,9 +1388,9 @@ std::string /*folderId*/ gdriveCreateFolderPlain(const Zstring& folderName, cons
     const std::string& postBuf = serializeJson(postParams, "" /*lineBreak*/, "" /*indent*/);
 
     std::string response;
-    gdriveHttpsRequest("/drive/v3/files?" + queryParams,
+    gdriveHttpsRequestMux("/drive/v3/files?" + queryParams,
     {"Content-Type: application/json; charset=UTF-8"}, {{CURLOPT_POSTFIELDS, postBuf.c_str()}},
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); }
@@ -1362,9 +1425,8 @@ std::string /*shortcutId*/ gdriveCreateShortcutPlain(const Zstring& shortcutName
     const std::string& postBuf = serializeJson(postParams, "" /*lineBreak*/, "" /*indent*/);
 
     std::string response;
-    gdriveHttpsRequest("/drive/v3/files?" + queryParams, {"Content-Type: application/json; charset=UTF-8"},
-    {{CURLOPT_POSTFIELDS, postBuf.c_str()}}, [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-    nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    gdriveHttpsRequestMux("/drive/v3/files?" + queryParams, {"Content-Type: application/json; charset=UTF-8"},
+    {{CURLOPT_POSTFIELDS, postBuf.c_str()}}, [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); }
@@ -1402,10 +1464,9 @@ std::string /*fileId*/ gdriveCopyFile(const std::string& fileId, const std::stri
     const std::string& postBuf = serializeJson(postParams, "" /*lineBreak*/, "" /*indent*/);
 
     std::string response;
-    gdriveHttpsRequest("/drive/v3/files/" + fileId + "/copy?" + queryParams,
+    gdriveHttpsRequestMux("/drive/v3/files/" + fileId + "/copy?" + queryParams,
     {"Content-Type: application/json; charset=UTF-8"}, {{CURLOPT_POSTFIELDS, postBuf.c_str()}},
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-    nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); /*throw JsonParsingError*/ }
@@ -1451,10 +1512,9 @@ void gdriveMoveAndRenameItem(const std::string& itemId, const std::string& paren
     const std::string& postBuf = serializeJson(postParams, "" /*lineBreak*/, "" /*indent*/);
 
     std::string response;
-    gdriveHttpsRequest("/drive/v3/files/" + itemId + '?' + queryParams,
+    gdriveHttpsRequestMux("/drive/v3/files/" + itemId + '?' + queryParams,
     {"Content-Type: application/json; charset=UTF-8"}, {{CURLOPT_CUSTOMREQUEST, "PATCH"}, {CURLOPT_POSTFIELDS, postBuf.c_str()}},
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-    nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); /*throw JsonParsingError*/ }
@@ -1489,10 +1549,9 @@ void setModTime(const std::string& itemId, time_t modTime, const GdriveAccess& a
     const std::string postBuf = R"({ "modifiedTime": ")" + modTimeRfc + "\" }";
 
     std::string response;
-    gdriveHttpsRequest("/drive/v3/files/" + itemId + '?' + queryParams,
+    gdriveHttpsRequestMux("/drive/v3/files/" + itemId + '?' + queryParams,
     {"Content-Type: application/json; charset=UTF-8"}, {{CURLOPT_CUSTOMREQUEST, "PATCH"}, {CURLOPT_POSTFIELDS, postBuf.c_str()}},
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-    nullptr /*readRequest*/, nullptr /*receiveHeader*/, access); //throw SysError
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); /*throw JsonParsingError*/ }
@@ -1583,23 +1642,23 @@ void gdriveDownloadFile(const std::string& fileId, const std::function<void(cons
 }
 
 
-#if 0
 //file name already existing? => duplicate file created!
 //note: Google Drive upload is already transactional!
-//upload "small files" (5 MB or less; enforced by Google?) in a single round-trip
-std::string /*itemId*/ gdriveUploadSmallFile(const Zstring& fileName, const std::string& parentId, uint64_t streamSize, std::optional<time_t> modTime, //throw SysError, X
-                                             const std::function<size_t(void* buffer, size_t bytesToRead)>& readBlock /*throw X; return "bytesToRead" bytes unless end of stream*/,
+//upload small files in a single round-trip, multiplexed with other requests => no connection per thread, no separate upload session
+std::string /*itemId*/ gdriveUploadSmallFile(const Zstring& fileName, const std::string& parentId, std::optional<time_t> modTime, //throw SysError
+                                             const std::string& fileContent,
                                              const GdriveAccess& access)
 {
+    assert(fileContent.size() <= GDRIVE_SMALL_UPLOAD_SIZE_MAX);
     //https://developers.google.com/drive/api/v3/folder#inserting_a_file_in_a_folder
-    //https://developers.google.com/drive/api/v3/manage-uploads#http_1
+    //https://developers.google.com/drive/api/v3/manage-uploads#multipart
 
     JsonValue postParams(JsonValue::Type::object);
     postParams.objectVal.emplace("name", utfTo<std::string>(fileName));
     postParams.objectVal.emplace("parents", std::vector<JsonValue> {JsonValue(parentId)});
     if (modTime) //convert to RFC 3339 date-time: e.g. "2018-09-29T08:39:12.053Z"
     {
-        const std::string& modTimeRfc = utfTo<std::string>(formatTime(Zstr("%Y-%m-%dT%H:%M:%S.000Z"), getUtcTime2(*modTime))); //returns empty string on error
+        const std::string& modTimeRfc = utfTo<std::string>(formatTime(Zstr("%Y-%m-%dT%H:%M:%S.000Z"), getUtcTime(*modTime))); //returns empty string on error
         if (modTimeRfc.empty())
             throw SysError(L"Invalid modification time (time_t: " + numberTo<std::wstring>(*modTime) + L')');
 
@@ -1610,55 +1669,15 @@ std::string /*itemId*/ gdriveUploadSmallFile(const Zstring& fileName, const std:
     //allowed chars for border: DIGIT ALPHA ' ( ) + _ , - . / : = ?
     const std::string boundaryString = stringEncodeBase64(generateGUID() + generateGUID());
 
-    const std::string postBufHead = "--" + boundaryString +                         "\r\n"
-                                    "Content-Type: application/json; charset=UTF-8" "\r\n"
-                                    /**/                                            "\r\n" +
-                                    metaDataBuf +                                   "\r\n"
-                                    "--" + boundaryString +                         "\r\n"
-                                    "Content-Type: application/octet-stream"        "\r\n"
-                                    /**/                                            "\r\n";
-
-    const std::string postBufTail = "\r\n--" + boundaryString + "--";
-
-    auto readMultipartBlock = [&, headPos = size_t(0), eof = false, tailPos = size_t(0)](void* buffer, size_t bytesToRead) mutable -> size_t
-    {
-        const auto bufStart = buffer;
-
-        if (headPos < postBufHead.size())
-        {
-            const size_t junkSize = std::min<ptrdiff_t>(postBufHead.size() - headPos, bytesToRead);
-            std::memcpy(buffer, postBufHead.c_str() + headPos, junkSize);
-            headPos += junkSize;
-            buffer = static_cast<std::byte*>(buffer) + junkSize;
-            bytesToRead -= junkSize;
-        }
-        if (bytesToRead > 0)
-        {
-            if (!eof) //don't assume readBlock() will return streamSize bytes as promised => exhaust and let Google Drive fail if there is a mismatch in Content-Length!
-            {
-                const size_t bytesRead = readBlock(buffer, bytesToRead); //throw X; return "bytesToRead" bytes unless end of stream
-                buffer = static_cast<std::byte*>(buffer) + bytesRead;
-                bytesToRead -= bytesRead;
-
-                if (bytesToRead > 0)
-                    eof = true;
-            }
-            if (bytesToRead > 0)
-                if (tailPos < postBufTail.size())
-                {
-                    const size_t junkSize = std::min<ptrdiff_t>(postBufTail.size() - tailPos, bytesToRead);
-                    std::memcpy(buffer, postBufTail.c_str() + tailPos, junkSize);
-                    tailPos += junkSize;
-                    buffer = static_cast<std::byte*>(buffer) + junkSize;
-                    bytesToRead -= junkSize;
-                }
-        }
-        return static_cast<std::byte*>(buffer) -
-               static_cast<std::byte*>(bufStart);
-    };
-
-TODO:
-    gzip-compress HTTP request body!
+    const std::string postBuf = "--" + boundaryString +                         "\r\n"
+                                "Content-Type: application/json; charset=UTF-8" "\r\n"
+                                /**/                                            "\r\n" +
+                                metaDataBuf +                                   "\r\n"
+                                "--" + boundaryString +                         "\r\n"
+                                "Content-Type: application/octet-stream"        "\r\n"
+                                /**/                                            "\r\n" +
+                                fileContent +                                   "\r\n"
+                                "--" + boundaryString + "--";
 
     const std::string& queryParams = xWwwFormUrlEncode(
     {
@@ -1666,14 +1685,9 @@ TODO:
         {"uploadType", "multipart"},
     });
     std::string response;
-    const HttpSession::Result httpResult = gdriveHttpsRequest("/upload/drive/v3/files?" + queryParams,
-    {
-        "Content-Type: multipart/related; boundary=" + boundaryString,
-        "Content-Length: " + numberTo<std::string>(postBufHead.size() + streamSize + postBufTail.size())
-    },
-    {{CURLOPT_POST, 1}}, //otherwise HttpSession::perform() will PUT
-    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); },
-    readMultipartBlock, nullptr /*receiveHeader*/, access); //throw SysError, X
+    gdriveHttpsRequestMux("/upload/drive/v3/files?" + queryParams, {"Content-Type: multipart/related; boundary=" + boundaryString},
+    {{CURLOPT_POSTFIELDS, postBuf.data()}, {CURLOPT_POSTFIELDSIZE_LARGE, postBuf.size()}}, //binary data: don't use strlen()
+    [&](std::span<const char> buf) { response.append(buf.data(), buf.size()); }, access); //throw SysError
 
     JsonValue jresponse;
     try { jresponse = parseJson(response); }
@@ -1685,7 +1699,6 @@ TODO:
 
     return *itemId;
 }
-#endif
 
 
 //file name already existing? => duplicate file created!
@@ -3156,6 +3169,8 @@ struct InputStreamGdrive : public AFS::InputStream
         return std::move(attr); //[!]
     }
 
+    bool allowReadFromOtherThread() override { return false; } //download already runs on worker thread
+
 private:
     void reportBytesProcessed(const IoCallback& notifyUnbufferedIO /*throw X*/) //throw X
     {
@@ -3176,7 +3191,7 @@ private:
 struct OutputStreamGdrive : public AFS::OutputStreamImpl
 {
     OutputStreamGdrive(const GdrivePath& gdrivePath,
-                       std::optional<uint64_t> /*streamSize*/,
+                       std::optional<uint64_t> streamSize,
                        std::optional<time_t> modTime,
                        std::unique_ptr<PathAccessLock>&& pal) //throw SysError
     {
@@ -3199,7 +3214,7 @@ struct OutputStreamGdrive : public AFS::OutputStreamImpl
             parentId = ps.existingItemId;
         });
 
-        worker_ = InterruptibleThread([gdrivePath, modTime, fileName, asyncStreamIn = this->asyncStreamOut_,
+        worker_ = InterruptibleThread([gdrivePath, streamSize, modTime, fileName, asyncStreamIn = this->asyncStreamOut_,
                                                    pFilePrint = std::move(promFilePrint),
                                                    parentId   = std::move(parentId),
                                                    aai        = std::move(aai),
@@ -3213,11 +3228,29 @@ struct OutputStreamGdrive : public AFS::OutputStreamImpl
                 {
                     return asyncStreamIn->tryRead(buffer, bytesToRead); //throw ThreadStopRequest
                 };
-                //for whatever reason, gdriveUploadFile() is slightly faster than gdriveUploadSmallFile()! despite its two roundtrips! even when file sizes are 0!
-                //=> 1. issue likely on Google's side => 2. persists even after having fixed "Expect: 100-continue"
-                const std::string fileIdNew = //streamSize && *streamSize < 5 * 1024 * 1024 ?
-                    //gdriveUploadSmallFile(fileName, parentId, *streamSize, modTime,    readBlock, aai.access) : //throw SysError, ThreadStopRequest
-                    gdriveUploadFile       (fileName, parentId,              modTime, tryReadBlock, aai.access);  //throw SysError, ThreadStopRequest
+                std::string fileIdNew;
+                //on a dedicated connection, gdriveUploadFile() is slightly faster than a multipart upload despite its two roundtrips (likely an issue on Google's side)
+                //=> but small files uploaded in parallel share the multiplexed connection instead of one connection each
+                if (streamSize && *streamSize <= GDRIVE_SMALL_UPLOAD_SIZE_MAX)
+                {
+                    std::string fileContent;
+                    for (;;)
+                    {
+                        const size_t bytesOld = fileContent.size();
+                        fileContent.resize(bytesOld + GDRIVE_BLOCK_SIZE_UPLOAD);
+                        const size_t bytesRead = tryReadBlock(fileContent.data() + bytesOld, GDRIVE_BLOCK_SIZE_UPLOAD); //throw ThreadStopRequest
+                        fileContent.resize(bytesOld + bytesRead);
+                        if (bytesRead == 0) //EOF
+                            break;
+
+                        if (fileContent.size() > *streamSize) //don't buffer a file that keeps growing!
+                            throw SysError(_("Unexpected size of data stream:") + L' ' + formatNumber(fileContent.size()) + L'\n' +
+                                           _("Expected:") + L' ' + formatNumber(*streamSize));
+                    }
+                    fileIdNew = gdriveUploadSmallFile(fileName, parentId, modTime, fileContent, aai.access); //throw SysError
+                }
+                else
+                    fileIdNew = gdriveUploadFile(fileName, parentId, modTime, tryReadBlock, aai.access); //throw SysError, ThreadStopRequest
                 assert(asyncStreamIn->getTotalBytesRead() == asyncStreamIn->getTotalBytesWritten());
                 //already existing: creates duplicate
 
@@ -3620,7 +3653,9 @@ private:
     //already existing: undefined behavior! (e.g. fail/overwrite/auto-rename)
     //=> actual behavior: 1. fails or 2. creates duplicate (unlikely)
     FileCopyResult copyFileForSameAfsType(const AfsPath& sourcePath, const StreamAttributes& attrSource, //throw FileError, (ErrorFileLocked), (X)
-                                          const AbstractPath& targetPath, bool copyFilePermissions, const IoCallback& notifyUnbufferedIO /*throw X*/) const override
+                                          const AbstractPath& targetPath, bool copyFilePermissions, const IoCallback& notifyUnbufferedIO /*throw X*/,
+                                          const IoDataCallback& onSourceData /*throw X*/,
+                                          const IoCallback& notifyBytesRead /*throw X*/, const IoCallback& notifyBytesWritten /*throw X*/) const override
     {
         //no native Google Drive file copy => use stream-based file copy:
         if (copyFilePermissions)
@@ -3631,7 +3666,7 @@ private:
         if (!equalAsciiNoCase(gdriveLogin_.email, fsTarget.gdriveLogin_.email))
             //already existing: undefined behavior! (e.g. fail/overwrite/auto-rename)
             //=> actual behavior: 1. fails or 2. creates duplicate (unlikely)
-            return copyFileAsStream(sourcePath, attrSource, targetPath, notifyUnbufferedIO); //throw FileError, (ErrorFileLocked), X
+            return copyFileAsStream(sourcePath, attrSource, targetPath, notifyUnbufferedIO, onSourceData, notifyBytesRead, notifyBytesWritten); //throw FileError, (ErrorFileLocked), X
         //else: copying files within account works, e.g. between My Drive <-> shared drives
 
         try
@@ -3692,6 +3727,7 @@ private:
                 .sourceFilePrint = getGdriveFilePrint(itemIdSrc),
                 .targetFilePrint = getGdriveFilePrint(fileIdTrg),
                 /*.errorModTime = */
+                .copyMethod = FileCopyMethod::offloaded, //server-side copy: onSourceData never sees the data
             };
         }
         catch (const SysError& e)
@@ -20,6 +20,22 @@ AbstractPath createItemPathNativeNoFormatting(const Zstring& nativePath); //noex
 
 //return empty, if not a native path
 Zstring getNativeItemPath(const AbstractPath& itemPath);
+
+//Linux: stat folder items via io_uring batches during traversal (opt-in); falls back to fstatat() if not supported by the kernel
+void setNativeTraversalIoUring(bool enable);
+bool nativeTraversalIoUringSupported(); //creates the calling thread's io_uring instance
+
+void nativeInit(const Zstring& snapshotDirPath);
+
+//Linux: reuse the listings of folders unchanged since the previous traversal (same modification/change time and inode)
+//=> only for clients opting in via TraverserCallback::allowFolderSnapshot(), e.g. comparison
+enum class FolderSnapshotMode
+{
+    off,
+    statFiles,       //skip reading unchanged folders, but still get fresh file details
+    trustFolderTime, //skip file details, too: misses file changes that don't update the parent folder, e.g. in-place writes!
+};
+void setNativeTraversalSnapshot(FolderSnapshotMode mode);
 }
 
 #endif //FS_NATIVE_183247018532434563465
@@ -100,6 +100,14 @@ SFTP_OPTIMAL_BLOCK_SIZE_READ:              SFTP_OPTIMAL_BLOCK_SIZE_WRITE:
 
 => libssh2_sftp_read/libssh2_sftp_write may take quite long for 16x and larger => use smallest multiple that fills bandwidth!            */
 
+/* Pipelining: block size alone caps throughput at "data in flight / round-trip time" => high-latency links stay far below bandwidth
+    read:  libssh2 keeps up to 4 x buffer size of read requests in flight: read into a larger internal buffer, return as soon as *any* data arrived
+    write: keep unacknowledged data buffered and pass it again with each libssh2_sftp_write() call (as required by libssh2)
+           => new chunks are sent while older ones are still waiting for their "ack"
+    => each SFTP call still completes before returning: no pending libssh2 command when other streams use the same SFTP channel (same thread)  */
+const size_t SFTP_PIPELINE_BLOCKS_READ  = 4; //=> 4 x 4 x SFTP_OPTIMAL_BLOCK_SIZE_READ in flight (libssh2 caps read-ahead at 4 x LIBSSH2_CHANNEL_WINDOW_DEFAULT)
+const size_t SFTP_PIPELINE_BLOCKS_WRITE = 4; //=> 4 x SFTP_OPTIMAL_BLOCK_SIZE_WRITE unacknowledged
+
 
 inline
 uint16_t getEffectivePort(int portOption)
@@ -1123,11 +1131,16 @@ struct SftpItem
 };
 std::vector<SftpItem> getDirContentFlat(const SftpLogin& login, const AfsPath& dirPath) //throw FileError
 {
+    //hold on to session while the directory handle is open: don't use runSftpCommand()!
+    //=> concurrent traverser threads might otherwise grab the session (returned to idle pool) in between calls
+    std::shared_ptr<SftpSessionManager::SshSessionShared> session;
     LIBSSH2_SFTP_HANDLE* dirHandle = nullptr;
     try
     {
-        runSftpCommand(login, "libssh2_sftp_opendir", //throw SysError, SysErrorSftpProtocol
-                       [&](const SshSession::Details& sd) //noexcept!
+        session = getSharedSftpSession(login); //throw SysError
+
+        session->executeBlocking("libssh2_sftp_opendir", //throw SysError, SysErrorSftpProtocol
+                                 [&](const SshSession::Details& sd) //noexcept!
         {
             dirHandle = ::libssh2_sftp_opendir(sd.sftpChannel, getLibssh2Path(dirPath));
             if (!dirHandle)
@@ -1139,7 +1152,7 @@ std::vector<SftpItem> getDirContentFlat(const SftpLogin& login, const AfsPath& d
 
     ZEN_ON_SCOPE_EXIT(try
     {
-        runSftpCommand(login, "libssh2_sftp_closedir", //throw SysError, SysErrorSftpProtocol
+        session->executeBlocking("libssh2_sftp_closedir", //throw SysError, SysErrorSftpProtocol
         [&](const SshSession::Details& sd) { return ::libssh2_sftp_closedir(dirHandle); }); //noexcept!
     }
     catch (const SysError& e) { logExtraError(replaceCpy(_("Cannot read directory %x."), L"%x", fmtPath(getSftpDisplayPath(login, dirPath))) + L"\n\n" + e.toString()); });
@@ -1152,7 +1165,7 @@ std::vector<SftpItem> getDirContentFlat(const SftpLogin& login, const AfsPath& d
         int rc = 0;
         try
         {
-            runSftpCommand(login, "libssh2_sftp_readdir", //throw SysError, SysErrorSftpProtocol
+            session->executeBlocking("libssh2_sftp_readdir", //throw SysError, SysErrorSftpProtocol
             [&](const SshSession::Details& sd) { return rc = ::libssh2_sftp_readdir(dirHandle, buf.data(), buf.size(), &attribs); }); //noexcept!
         }
         catch (const SysError& e) { throw FileError(replaceCpy(_("Cannot read directory %x."), L"%x", fmtPath(getSftpDisplayPath(login, dirPath))), e.toString()); }
@@ -1218,89 +1231,67 @@ SftpItemDetails getSymlinkTargetDetails(const SftpLogin& login, const AfsPath& l
 }
 
 
-class SingleFolderTraverser
+void evalFolderContent(const SftpLogin& login, const AfsPath& dirPath, const std::vector<SftpItem>& folderContent, AFS::TraverserCallback& cb, //throw X
+                       std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>>& subFolders)
 {
-public:
-    using WorkItem = std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>;
-
-    SingleFolderTraverser(const SftpLogin& login, const std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>>& workload /*throw X*/) :
-        login_(login)
+    for (const SftpItem& item : folderContent)
     {
-        for (const auto& [folderPath, cb] : workload)
-            workload_.push_back(WorkItem{folderPath, cb});
-
-        while (!workload_.empty())
-        {
-            auto wi = std::move(workload_.    front()); //yes, no strong exception guarantee (std::bad_alloc)
-            /**/                workload_.pop_front();  //
-            const auto& [folderPath, cb] = wi;
-
-            tryReportingDirError([&] //throw X
-            {
-                traverseWithException(folderPath, *cb); //throw FileError, X
-            }, *cb);
-        }
-    }
-
-private:
-    SingleFolderTraverser           (const SingleFolderTraverser&) = delete;
-    SingleFolderTraverser& operator=(const SingleFolderTraverser&) = delete;
+        const AfsPath itemPath(appendPath(dirPath.value, item.itemName));
 
-    void traverseWithException(const AfsPath& dirPath, AFS::TraverserCallback& cb) //throw FileError, X
-    {
-        for (const SftpItem& item : getDirContentFlat(login_, dirPath)) //throw FileError
+        switch (item.details.type)
         {
-            const AfsPath itemPath(appendPath(dirPath.value, item.itemName));
-
-            switch (item.details.type)
-            {
-                case AFS::ItemType::file:
-                    cb.onFile({item.itemName, item.details.fileSize, item.details.modTime, AFS::FingerPrint() /*not supported by SFTP*/, false /*isFollowedSymlink*/}); //throw X
-                    break;
+            case AFS::ItemType::file:
+                cb.onFile({item.itemName, item.details.fileSize, item.details.modTime, AFS::FingerPrint() /*not supported by SFTP*/, false /*isFollowedSymlink*/}); //throw X
+                break;
 
-                case AFS::ItemType::folder:
-                    if (std::shared_ptr<AFS::TraverserCallback> cbSub = cb.onFolder({item.itemName, false /*isFollowedSymlink*/})) //throw X
-                        workload_.push_back(WorkItem{itemPath, std::move(cbSub)});
-                    break;
+            case AFS::ItemType::folder:
+                if (std::shared_ptr<AFS::TraverserCallback> cbSub = cb.onFolder({item.itemName, false /*isFollowedSymlink*/})) //throw X
+                    subFolders.emplace_back(itemPath, std::move(cbSub));
+                break;
 
-                case AFS::ItemType::symlink:
-                    switch (cb.onSymlink({item.itemName, item.details.modTime})) //throw X
+            case AFS::ItemType::symlink:
+                switch (cb.onSymlink({item.itemName, item.details.modTime})) //throw X
+                {
+                    case AFS::TraverserCallback::HandleLink::follow:
                     {
-                        case AFS::TraverserCallback::HandleLink::follow:
-                        {
-                            SftpItemDetails targetDetails = {};
-                            if (!tryReportingItemError([&] //throw X
-                        {
-                            targetDetails = getSymlinkTargetDetails(login_, itemPath); //throw FileError
-                            }, cb, item.itemName))
-                            continue;
+                        SftpItemDetails targetDetails = {};
+                        if (!tryReportingItemError([&] //throw X
+                    {
+                        targetDetails = getSymlinkTargetDetails(login, itemPath); //throw FileError
+                        }, cb, item.itemName))
+                        continue;
 
-                            if (targetDetails.type == AFS::ItemType::folder)
-                            {
-                                if (std::shared_ptr<AFS::TraverserCallback> cbSub = cb.onFolder({item.itemName, true /*isFollowedSymlink*/})) //throw X
-                                    workload_.push_back(WorkItem{itemPath, std::move(cbSub)});
-                            }
-                            else //a file or named pipe, etc.
-                                cb.onFile({item.itemName, targetDetails.fileSize, targetDetails.modTime, AFS::FingerPrint() /*not supported by SFTP*/, true /*isFollowedSymlink*/}); //throw X
+                        if (targetDetails.type == AFS::ItemType::folder)
+                        {
+                            if (std::shared_ptr<AFS::TraverserCallback> cbSub = cb.onFolder({item.itemName, true /*isFollowedSymlink*/})) //throw X
+                                subFolders.emplace_back(itemPath, std::move(cbSub));
                         }
-                        break;
-
-                        case AFS::TraverserCallback::HandleLink::skip:
-                            break;
+                        else //a file or named pipe, etc.
+                            cb.onFile({item.itemName, targetDetails.fileSize, targetDetails.modTime, AFS::FingerPrint() /*not supported by SFTP*/, true /*isFollowedSymlink*/}); //throw X
                     }
                     break;
-            }
+
+                    case AFS::TraverserCallback::HandleLink::skip:
+                        break;
+                }
+                break;
         }
     }
-
-    const SftpLogin login_;
-    RingBuffer<WorkItem> workload_;
-};
+}
 
 
-void traverseFolderRecursiveSftp(const SftpLogin& login, const std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>>& workload /*throw X*/, size_t) //throw X
+/* parallelOps > 1: each worker thread lists directories over its own (pooled) SSH session: getSharedSftpSession() has thread affinity
+    => scanning is bound by one round-trip per directory, not bandwidth: overlap as many requests as the user allows
+    => TraverserCallback is still called from the single traverser thread only        */
+void traverseFolderRecursiveSftp(const SftpLogin& login, const std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>>& workload /*throw X*/, size_t parallelOps) //throw X
 {
-    SingleFolderTraverser dummy(login, workload); //throw X
+    traverseFolderRecursiveParallel(workload, parallelOps, SequentialOrder::breadthFirst, Zstr("Traverser[SFTP]"), //throw X
+    [&](const AfsPath& dirPath) { return getDirContentFlat(login, dirPath); /*throw FileError*/ },
+    [&](const AfsPath& dirPath, const std::vector<SftpItem>& folderContent, AFS::TraverserCallback& cb, //throw X
+        std::vector<std::pair<AfsPath, std::shared_ptr<AFS::TraverserCallback>>>& subFolders)
+    {
+        evalFolderContent(login, dirPath, folderContent, cb, subFolders); //throw X
+    });
 }
 
 //===========================================================================================================================
@@ -1346,32 +1337,48 @@ struct InputStreamSftp : public AFS::InputStream
             throw std::logic_error(std::string(__FILE__) + '[' + numberTo<std::string>(__LINE__) + "] Contract violation!");
         assert(bytesToRead % getBlockSize() == 0);
 
-        ssize_t bytesRead = 0;
-        try
+        if (bufPos_ == bufEnd_) //buffer empty => get more data from server
         {
-            session_->executeBlocking("libssh2_sftp_read", //throw SysError, SysErrorSftpProtocol
-                                      [&](const SshSession::Details& sd) //noexcept!
+            ssize_t bytesRead = 0;
+            try
             {
-                bytesRead = ::libssh2_sftp_read(fileHandle_, static_cast<char*>(buffer), bytesToRead);
-                return static_cast<int>(bytesRead);
-            });
+                session_->executeBlocking("libssh2_sftp_read", //throw SysError, SysErrorSftpProtocol
+                                          [&](const SshSession::Details& sd) //noexcept!
+                {
+                    bytesRead = ::libssh2_sftp_read(fileHandle_, reinterpret_cast<char*>(&buffer_[0]), buffer_.size()); //returns early: doesn't wait for full buffer
+                    return static_cast<int>(bytesRead);
+                });
 
-            ASSERT_SYSERROR(makeUnsigned(bytesRead) <= bytesToRead); //better safe than sorry (user should never see this)
+                ASSERT_SYSERROR(makeUnsigned(bytesRead) <= buffer_.size()); //better safe than sorry (user should never see this)
+            }
+            catch (const SysError& e) { throw FileError(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(displayPath_)), e.toString()); }
+
+            bufPos_ = 0;
+            bufEnd_ = bytesRead;
+
+            if (notifyUnbufferedIO) notifyUnbufferedIO(bytesRead); //throw X
         }
-        catch (const SysError& e) { throw FileError(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(displayPath_)), e.toString()); }
 
-        if (notifyUnbufferedIO) notifyUnbufferedIO(bytesRead); //throw X
-        return bytesRead; //"zero indicates end of file"
+        const size_t bytesCopied = std::min(bytesToRead, bufEnd_ - bufPos_);
+        std::memcpy(buffer, &buffer_[bufPos_], bytesCopied);
+        bufPos_ += bytesCopied;
+        return bytesCopied; //"zero indicates end of file"
     }
 
     std::optional<AFS::StreamAttributes> tryGetAttributesFast() override { return {}; }//throw FileError
     //although we have an SFTP stream handle, attribute access requires an extra (expensive) round-trip!
     //PERF: test case 148 files, 1MB: overall copy time increases by 20% if libssh2_sftp_fstat() gets called per each file
 
+    bool allowReadFromOtherThread() override { return false; } //SshSessionShared is bound to the creating thread!
+
 private:
     const std::wstring displayPath_;
     LIBSSH2_SFTP_HANDLE* fileHandle_ = nullptr;
     std::shared_ptr<SftpSessionManager::SshSessionShared> session_;
+
+    std::vector<std::byte> buffer_ = std::vector<std::byte>(SFTP_PIPELINE_BLOCKS_READ * SFTP_OPTIMAL_BLOCK_SIZE_READ); //buffer size determines libssh2 read-ahead
+    size_t bufPos_ = 0;
+    size_t bufEnd_ = 0;
 };
 
 //===========================================================================================================================
@@ -1426,31 +1433,29 @@ struct OutputStreamSftp : public AFS::OutputStreamImpl
             throw std::logic_error(std::string(__FILE__) + '[' + numberTo<std::string>(__LINE__) + "] Contract violation!");
         assert(bytesToWrite % getBlockSize() == 0 || bytesToWrite < getBlockSize());
 
-        ssize_t bytesWritten = 0;
-        try
-        {
-            session_->executeBlocking("libssh2_sftp_write", //throw SysError, SysErrorSftpProtocol
-                                      [&](const SshSession::Details& sd) //noexcept!
-            {
-                bytesWritten = ::libssh2_sftp_write(fileHandle_, static_cast<const char*>(buffer), bytesToWrite);
-                /*  "If this function returns zero it should not be considered an error, but simply that there was no error but yet no payload data got sent to the other end."
-                     => sounds like BS, but is it really true!?
-                    From the libssh2_sftp_write code it appears that the function always waits for at least one "ack", unless we give it so much data _libssh2_channel_write() can't sent it all! */
-                assert(bytesWritten != 0);
-                return static_cast<int>(bytesWritten);
-            });
+        const size_t pipelineSize = SFTP_PIPELINE_BLOCKS_WRITE * SFTP_OPTIMAL_BLOCK_SIZE_WRITE;
 
-            ASSERT_SYSERROR(makeUnsigned(bytesWritten) <= bytesToWrite); //better safe than sorry
-        }
-        catch (const SysError& e) { throw FileError(replaceCpy(_("Cannot write file %x."), L"%x", fmtPath(displayPath_)), e.toString()); }
+        while (unacked_.size() - unackedPos_ > pipelineSize - getBlockSize()) //pipeline full => wait for "acks" of (at least) one block
+            writeUnacked(); //throw FileError
+
+        const size_t bytesAccepted = std::min(bytesToWrite, pipelineSize - (unacked_.size() - unackedPos_));
+
+        unacked_.erase(unacked_.begin(), unacked_.begin() + unackedPos_); //memmove at most once per block: negligible compared to network
+        unackedPos_ = 0;
+        unacked_.insert(unacked_.end(), static_cast<const std::byte*>(buffer), static_cast<const std::byte*>(buffer) + bytesAccepted);
+
+        writeUnacked(); //throw FileError; send new data
 
-        if (notifyUnbufferedIO) notifyUnbufferedIO(bytesWritten); //throw X!
+        if (notifyUnbufferedIO) notifyUnbufferedIO(bytesAccepted); //throw X!
 
-        return bytesWritten;
+        return bytesAccepted;
     }
 
     AFS::FinalizeResult finalize(const IoCallback& notifyUnbufferedIO /*throw X*/) override //throw FileError, X
     {
+        while (unackedPos_ != unacked_.size())
+            writeUnacked(); //throw FileError
+
         //~OutputStreamSftp() would call this one, too, but we want to propagate errors if any:
         close(); //throw FileError
 
@@ -1470,6 +1475,31 @@ struct OutputStreamSftp : public AFS::OutputStreamImpl
     }
 
 private:
+    void writeUnacked() //throw FileError
+    {
+        assert(unackedPos_ < unacked_.size());
+        ssize_t bytesWritten = 0;
+        try
+        {
+            session_->executeBlocking("libssh2_sftp_write", //throw SysError, SysErrorSftpProtocol
+                                      [&](const SshSession::Details& sd) //noexcept!
+            {
+                //libssh2 skips data that was already sent with previous calls, but not yet acknowledged
+                bytesWritten = ::libssh2_sftp_write(fileHandle_, reinterpret_cast<const char*>(&unacked_[unackedPos_]), unacked_.size() - unackedPos_);
+                /*  "If this function returns zero it should not be considered an error, but simply that there was no error but yet no payload data got sent to the other end."
+                     => sounds like BS, but is it really true!?
+                    From the libssh2_sftp_write code it appears that the function always waits for at least one "ack", unless we give it so much data _libssh2_channel_write() can't sent it all! */
+                assert(bytesWritten != 0);
+                return static_cast<int>(bytesWritten);
+            });
+
+            ASSERT_SYSERROR(makeUnsigned(bytesWritten) <= unacked_.size() - unackedPos_); //better safe than sorry
+        }
+        catch (const SysError& e) { throw FileError(replaceCpy(_("Cannot write file %x."), L"%x", fmtPath(displayPath_)), e.toString()); }
+
+        unackedPos_ += bytesWritten;
+    }
+
     void close() //throw FileError
     {
         if (!fileHandle_)
@@ -1508,6 +1538,9 @@ private:
     LIBSSH2_SFTP_HANDLE* fileHandle_ = nullptr;
     const std::optional<time_t> modTime_;
     std::shared_ptr<SftpSessionManager::SshSessionShared> session_;
+
+    std::vector<std::byte> unacked_; //[unackedPos_, end): sent (or about to be sent), but not yet acknowledged by server
+    size_t unackedPos_ = 0;
 };
 
 //===========================================================================================================================
@@ -1781,14 +1814,16 @@ private:
     //symlink handling: follow
     //already existing: undefined behavior! (e.g. fail/overwrite/auto-rename)
     FileCopyResult copyFileForSameAfsType(const AfsPath& sourcePath, const StreamAttributes& attrSource, //throw FileError, (ErrorFileLocked), X
-                                          const AbstractPath& targetPath, bool copyFilePermissions, const IoCallback& notifyUnbufferedIO /*throw X*/) const override
+                                          const AbstractPath& targetPath, bool copyFilePermissions, const IoCallback& notifyUnbufferedIO /*throw X*/,
+                                          const IoDataCallback& onSourceData /*throw X*/,
+                                          const IoCallback& notifyBytesRead /*throw X*/, const IoCallback& notifyBytesWritten /*throw X*/) const override
     {
         //no native SFTP file copy => use stream-based file copy:
         if (copyFilePermissions)
             throw FileError(replaceCpy(_("Cannot write permissions of %x."), L"%x", fmtPath(AFS::getDisplayPath(targetPath))), _("Operation not supported by device."));
 
         //already existing: undefined behavior! (e.g. fail/overwrite/auto-rename)
-        return copyFileAsStream(sourcePath, attrSource, targetPath, notifyUnbufferedIO); //throw FileError, (ErrorFileLocked), X
+        return copyFileAsStream(sourcePath, attrSource, targetPath, notifyUnbufferedIO, onSourceData, notifyBytesRead, notifyBytesWritten); //throw FileError, (ErrorFileLocked), X
     }
 
     //symlink handling: follow
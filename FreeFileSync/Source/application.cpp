@@ -7,6 +7,7 @@
 #include "application.h"
 #include <memory>
 #include <zen/file_access.h>
+#include <zen/file_io.h>
 #include <zen/perf.h>
 #include <zen/shutdown.h>
 #include <zen/process_exec.h>
@@ -20,8 +21,10 @@
 #include <wx+/image_resources.h>
 #include <wx/msgdlg.h>
 #include "afs/concrete.h"
+#include "afs/native.h"
 #include "base/algorithm.h"
 #include "base/comparison.h"
+#include "base/hash_cache.h"
 #include "base/synchronization.h"
 #include "ui/batch_status_handler.h"
 #include "ui/main_dlg.h"
@@ -75,6 +78,7 @@ void showSyntaxHelp()
                                                  TAB_SPACE + L"[" + _("config files:") + L" *.ffs_gui/*.ffs_batch]" + L'\n' +
                                                  TAB_SPACE + L"[-DirPair " + _("directory") + L' ' + _("directory") + L"]" L"\n" +
                                                  TAB_SPACE + L"[-Edit]" + L'\n' +
+                                                 TAB_SPACE + L"[-ChangeList " + _("file") + L"]" + L'\n' +
                                                  TAB_SPACE + L"[" + _("global config file:") + L" GlobalSettings.xml]" + L"\n\n" +
 
                                                  _("config files:") + L'\n' +
@@ -86,6 +90,9 @@ void showSyntaxHelp()
                                                  L"-Edit" + '\n' +
                                                  _("Open the selected configuration for editing only, without executing it.") + L"\n\n" +
 
+                                                 L"-ChangeList " + _("file") + L'\n' +
+                                                 _("Batch mode: read only the items listed in the file (one path per line) and take all other items from the last synchronization. The list must contain all changes since then.") + L"\n\n" +
+
                                                  _("global config file:") + L'\n' +
                                                  _("Path to an alternate GlobalSettings.xml file.")));
 }
@@ -195,7 +202,9 @@ bool Application::OnInit()
     try { localizationInit(appendPath(getResourceDirPath(), Zstr("Languages.zip"))); } //throw FileError
     catch (const FileError& e) { logExtraError(e.toString()); }
 
-    initAfs({getResourceDirPath(), getConfigDirPath()}); //bonus: using FTP Gdrive implicitly inits OpenSSL (used in runSanityChecks() on Linux) already during globals init
+    const Zstring configDirPath = getConfigDirPath();
+    initAfs({getResourceDirPath(), configDirPath}); //bonus: using FTP Gdrive implicitly inits OpenSSL (used in runSanityChecks() on Linux) already during globals init
+    hashCacheInit(appendPath(configDirPath, Zstr("HashCache"))); //next to the AFS-specific files, e.g. FolderSnapshots
 
 
     auto onSystemShutdown = [](int /*unused*/ = 0)
@@ -269,11 +278,13 @@ void Application::onEnterEventLoop()
         std::vector<std::pair<Zstring, Zstring>> dirPathPhrasePairs;
         std::vector<Zstring> cfgFilePaths;
         Zstring globalConfigFile;
+        Zstring changeListFile;
         bool openForEdit = false;
         {
-            const char* optionEdit    = "-edit";
-            const char* optionDirPair = "-dirpair";
-            const char* optionSendTo  = "-sendto"; //remaining arguments are unspecified number of folder paths; wonky syntax; let's keep it undocumented
+            const char* optionEdit       = "-edit";
+            const char* optionDirPair    = "-dirpair";
+            const char* optionChangeList = "-changelist";
+            const char* optionSendTo     = "-sendto"; //remaining arguments are unspecified number of folder paths; wonky syntax; let's keep it undocumented
 
             auto isHelpRequest = [](const Zstring& arg)
             {
@@ -288,9 +299,10 @@ void Application::onEnterEventLoop()
 
             auto isCommandLineOption = [&](const Zstring& arg)
             {
-                return equalAsciiNoCase(arg, optionEdit   ) ||
-                       equalAsciiNoCase(arg, optionDirPair) ||
-                       equalAsciiNoCase(arg, optionSendTo ) ||
+                return equalAsciiNoCase(arg, optionEdit      ) ||
+                       equalAsciiNoCase(arg, optionDirPair   ) ||
+                       equalAsciiNoCase(arg, optionChangeList) ||
+                       equalAsciiNoCase(arg, optionSendTo    ) ||
                        isHelpRequest(arg);
             };
 
@@ -309,6 +321,12 @@ void Application::onEnterEventLoop()
                         throw FileError(replaceCpy(_("A left and a right directory path are expected after %x."), L"%x", utfTo<std::wstring>(optionDirPair)));
                     dirPathPhrasePairs.back().second = *it;
                 }
+                else if (equalAsciiNoCase(*it, optionChangeList))
+                {
+                    if (++it == commandArgs.end() || isCommandLineOption(*it))
+                        throw FileError(replaceCpy(_("A file path is expected after %x."), L"%x", utfTo<std::wstring>(optionChangeList)));
+                    changeListFile = getResolvedFilePath(*it);
+                }
                 else if (equalAsciiNoCase(*it, optionSendTo))
                 {
                     for (size_t i = 0; ; ++i)
@@ -429,7 +447,25 @@ void Application::onEnterEventLoop()
 
                 replaceDirectories(batchCfg.guiCfg.mainCfg); //throw FileError
 
-                runBatchMode(globalConfigFilePath, batchCfg, filePath);
+                //partial comparison: native paths of all items changed since last sync, one per line (e.g. written by RealTimeSync)
+                std::vector<Zstring> changedItemPaths;
+                if (!changeListFile.empty())
+                {
+                    const std::string stream = getFileContent(changeListFile, nullptr /*notifyUnbufferedIO*/); //throw FileError
+
+                    split(stream, '\n', [&](std::string_view line)
+                    {
+                        if (endsWith(line, '\r'))
+                            line.remove_suffix(1); //don't trim white space: legal in file names
+                        if (!line.empty())
+                            changedItemPaths.push_back(utfTo<Zstring>(line));
+                    });
+
+                    if (changedItemPaths.empty()) //nothing changed? don't silently compare everything instead
+                        throw FileError(replaceCpy(_("File %x does not contain any item paths."), L"%x", fmtPath(changeListFile)));
+                }
+
+                runBatchMode(globalConfigFilePath, batchCfg, filePath, changedItemPaths);
             }
             //GUI mode: single config (ffs_gui *or* ffs_batch)
             else
@@ -480,7 +516,7 @@ void Application::runGuiMode(const Zstring& globalConfigFilePath,
 }
 
 
-void Application::runBatchMode(const Zstring& globalConfigFilePath, const XmlBatchConfig& batchCfg, const Zstring& cfgFilePath)
+void Application::runBatchMode(const Zstring& globalConfigFilePath, const XmlBatchConfig& batchCfg, const Zstring& cfgFilePath, const std::vector<Zstring>& changedItemPaths)
 {
     const bool allowUserInteraction = !batchCfg.batchExCfg.autoCloseSummary ||
                                       (!batchCfg.guiCfg.mainCfg.ignoreErrors && batchCfg.batchExCfg.batchErrorHandling == BatchErrorHandling::showPopup);
@@ -522,6 +558,10 @@ void Application::runBatchMode(const Zstring& globalConfigFilePath, const XmlBat
     }
     catch (const FileError& e) { logExtraError(e.toString()); }
 
+    setNativeTraversalIoUring(globalCfg.ioUringTraversal);
+    setNativeTraversalSnapshot(globalCfg.folderSnapshot);
+    AFS::setDeviceIoLimits(getDeviceIoLimits(globalCfg.deviceIoLimits));
+
     //all settings have been read successfully...
 
     /* regular check for program updates -> disabled for batch
@@ -578,11 +618,14 @@ void Application::runBatchMode(const Zstring& globalConfigFilePath, const XmlBat
 
         FolderComparison cmpResult = compare(globalCfg.warnDlgs,
                                              globalCfg.fileTimeTolerance,
+                                             globalCfg.contentHashCache,
                                              requestPassword,
                                              globalCfg.runWithBackgroundPriority,
                                              globalCfg.createLockFile,
                                              dirLocks,
                                              extractCompareCfg(batchCfg.guiCfg.mainCfg),
+                                             batchCfg.guiCfg.mainCfg.deviceParallelOps,
+                                             changedItemPaths,
                                              statusHandler); //throw CancelProcess
         if (!cmpResult.empty())
             synchronize(syncStartTime,
@@ -593,6 +636,7 @@ void Application::runBatchMode(const Zstring& globalConfigFilePath, const XmlBat
                         globalCfg.runWithBackgroundPriority,
                         extractSyncCfg(batchCfg.guiCfg.mainCfg),
                         cmpResult,
+                        batchCfg.guiCfg.mainCfg.deviceParallelOps,
                         globalCfg.warnDlgs,
                         statusHandler); //throw CancelProcess
     }
@@ -323,6 +323,39 @@ bool stillInSync(const InSyncFolder& dbFolder)
 
 //----------------------------------------------------------------------------------------------
 
+/* find database folder on first use only: InSyncFolder decodes its content on first access (stream format v6)
+    => subtrees without any changes are never decoded     */
+class DbFolderRef
+{
+public:
+    explicit DbFolderRef(const InSyncFolder* dbFolder) : dbFolder_(dbFolder), resolved_(true) {}
+    DbFolderRef(const DbFolderRef& dbParent, const ZstringNorm& folderName) : dbParent_(&dbParent), folderName_(&folderName) {}
+
+    const InSyncFolder* get() const
+    {
+        if (!resolved_)
+        {
+            resolved_ = true;
+            if (const InSyncFolder* dbParent = dbParent_->get())
+                if (const auto it = dbParent->refFolders().find(*folderName_);
+                    it != dbParent->refFolders().end())
+                    dbFolder_ = &it->second;
+        }
+        return dbFolder_;
+    }
+
+private:
+    DbFolderRef           (const DbFolderRef&) = delete;
+    DbFolderRef& operator=(const DbFolderRef&) = delete;
+
+    const DbFolderRef* const dbParent_ = nullptr; //both owned by caller: must outlive this instance
+    const ZstringNorm* const folderName_ = nullptr; //
+    mutable const InSyncFolder* dbFolder_ = nullptr;
+    mutable bool resolved_ = false;
+};
+
+//----------------------------------------------------------------------------------------------
+
 class DetectMovedFiles
 {
 public:
@@ -338,7 +371,8 @@ private:
         fileTimeTolerance_(baseFolder.getFileTimeTolerance()),
         ignoreTimeShiftMinutes_(baseFolder.getIgnoredTimeShift())
     {
-        recurse(baseFolder, &dbFolder, &dbFolder);
+        const DbFolderRef dbRoot(&dbFolder);
+        recurse(baseFolder, dbRoot, dbRoot);
 
         purgeDuplicates<SelectSide::left >(filesL_,  exLeftOnlyById_);
         purgeDuplicates<SelectSide::right>(filesR_, exRightOnlyById_);
@@ -348,7 +382,7 @@ private:
             detectMovePairs(dbFolder);
     }
 
-    void recurse(ContainerObject& conObj, const InSyncFolder* dbFolderL, const InSyncFolder* dbFolderR)
+    void recurse(ContainerObject& conObj, const DbFolderRef& dbFolderL, const DbFolderRef& dbFolderR)
     {
         for (FilePair& file : conObj.refSubFiles())
         {
@@ -360,11 +394,11 @@ private:
             if (filePrintL != 0) filesL_.push_back(&file); //collect *all* prints for uniqueness check!
             if (filePrintR != 0) filesR_.push_back(&file); //
 
-            auto getDbEntry = [](const InSyncFolder* dbFolder, const Zstring& fileName) -> const InSyncFile*
+            auto getDbEntry = [](const DbFolderRef& dbFolderRef, const Zstring& fileName) -> const InSyncFile*
             {
-                if (dbFolder)
-                    if (const auto it = dbFolder->files.find(fileName);
-                        it != dbFolder->files.end())
+                if (const InSyncFolder* dbFolder = dbFolderRef.get())
+                    if (const auto it = dbFolder->refFiles().find(fileName);
+                        it != dbFolder->refFiles().end())
                         return &it->second;
                 return nullptr;
             };
@@ -384,22 +418,14 @@ private:
 
         for (FolderPair& folder : conObj.refSubFolders())
         {
-            auto getDbEntry = [](const InSyncFolder* dbFolder, const ZstringNorm& folderName) -> const InSyncFolder*
-            {
-                if (dbFolder)
-                    if (const auto it = dbFolder->folders.find(folderName);
-                        it != dbFolder->folders.end())
-                        return &it->second;
-                return nullptr;
-            };
             const ZstringNorm itemNameL = folder.getItemName<SelectSide::left >();
             const ZstringNorm itemNameR = folder.getItemName<SelectSide::right>();
 
-            const InSyncFolder* dbEntryL = getDbEntry(dbFolderL, itemNameL);
-            const InSyncFolder* dbEntryR = dbFolderL == dbFolderR && itemNameL == itemNameR ?
-                                           dbEntryL : getDbEntry(dbFolderR, itemNameR);
-
-            recurse(folder, dbEntryL, dbEntryR);
+            const DbFolderRef dbEntryL(dbFolderL, itemNameL);
+            if (&dbFolderL == &dbFolderR && itemNameL == itemNameR)
+                recurse(folder, dbEntryL, dbEntryL);
+            else
+                recurse(folder, dbEntryL, DbFolderRef(dbFolderR, itemNameR));
         }
     }
 
@@ -442,10 +468,10 @@ private:
 
     void detectMovePairs(const InSyncFolder& container) const
     {
-        for (const auto& [fileName, dbAttrib] : container.files)
+        for (const auto& [fileName, dbAttrib] : container.refFiles())
             findAndSetMovePair(dbAttrib);
 
-        for (const auto& [folderName, subFolder] : container.folders)
+        for (const auto& [folderName, subFolder] : container.refFolders())
             detectMovePairs(subFolder);
     }
 
@@ -587,10 +613,10 @@ private:
         //-> considering filter not relevant:
         //  if stricter filter than last time: all ok;
         //  if less strict filter (if file ex on both sides -> conflict, fine; if file ex. on one side: copy to other side: fine)
-        recurse(baseFolder, &dbFolder);
+        recurse(baseFolder, DbFolderRef(&dbFolder));
     }
 
-    void recurse(ContainerObject& conObj, const InSyncFolder* dbFolder) const
+    void recurse(ContainerObject& conObj, const DbFolderRef& dbFolder) const
     {
         for (FilePair& file : conObj.refSubFiles())
             processFile(file, dbFolder);
@@ -600,7 +626,7 @@ private:
             processDir(folder, dbFolder);
     }
 
-    void processFile(FilePair& file, const InSyncFolder* dbFolder) const
+    void processFile(FilePair& file, const DbFolderRef& dbFolder) const
     {
         const CompareFileResult cat = file.getCategory();
         if (cat == FILE_EQUAL)
@@ -616,11 +642,11 @@ private:
         //####################################################################################
 
         //try to find corresponding database entry
-        auto getDbEntry = [dbFolder](const ZstringNorm& fileName) -> const InSyncFile*
+        auto getDbEntry = [&dbFolder](const ZstringNorm& fileName) -> const InSyncFile*
         {
-            if (dbFolder)
-                if (auto it = dbFolder->files.find(fileName);
-                    it != dbFolder->files.end())
+            if (const InSyncFolder* dbFolderPtr = dbFolder.get())
+                if (auto it = dbFolderPtr->refFiles().find(fileName);
+                    it != dbFolderPtr->refFiles().end())
                     return &it->second;
             return nullptr;
         };
@@ -655,7 +681,7 @@ private:
         setSyncDirForChange(file, changeL, changeR);
     }
 
-    void processSymlink(SymlinkPair& symlink, const InSyncFolder* dbFolder) const
+    void processSymlink(SymlinkPair& symlink, const DbFolderRef& dbFolder) const
     {
         const CompareSymlinkResult cat = symlink.getLinkCategory();
         if (cat == SYMLINK_EQUAL)
@@ -664,11 +690,11 @@ private:
             return symlink.setSyncDirConflict(symlink.getCategoryCustomDescription());
 
         //try to find corresponding database entry
-        auto getDbEntry = [dbFolder](const ZstringNorm& linkName) -> const InSyncSymlink*
+        auto getDbEntry = [&dbFolder](const ZstringNorm& linkName) -> const InSyncSymlink*
         {
-            if (dbFolder)
-                if (auto it = dbFolder->symlinks.find(linkName);
-                    it != dbFolder->symlinks.end())
+            if (const InSyncFolder* dbFolderPtr = dbFolder.get())
+                if (auto it = dbFolderPtr->refSymlinks().find(linkName);
+                    it != dbFolderPtr->refSymlinks().end())
                     return &it->second;
             return nullptr;
         };
@@ -692,7 +718,7 @@ private:
         setSyncDirForChange(symlink, changeL, changeR);
     }
 
-    void processDir(FolderPair& folder, const InSyncFolder* dbFolder) const
+    void processDir(FolderPair& folder, const DbFolderRef& dbFolder) const
     {
         const CompareDirResult cat = folder.getDirCategory();
 
@@ -704,20 +730,17 @@ private:
         //#######################################################################################
 
         //try to find corresponding database entry
-        auto getDbEntry = [dbFolder](const ZstringNorm& folderName) -> const InSyncFolder*
-        {
-            if (dbFolder)
-                if (auto it = dbFolder->folders.find(folderName);
-                    it != dbFolder->folders.end())
-                    return &it->second;
-            return nullptr;
-        };
-
         const ZstringNorm itemNameL = folder.getItemName<SelectSide::left >();
         const ZstringNorm itemNameR = folder.getItemName<SelectSide::right>();
 
-        const InSyncFolder* dbEntryL = getDbEntry(itemNameL);
-        const InSyncFolder* dbEntryR = itemNameL == itemNameR ? dbEntryL : getDbEntry(itemNameR);
+        const DbFolderRef dbEntryRefL(dbFolder, itemNameL);
+        const DbFolderRef dbEntryRefR(dbFolder, itemNameR);
+
+        if (cat == DIR_EQUAL && itemNameL == itemNameR) //database entry needed only if child items have changed
+            return recurse(folder, dbEntryRefL);
+
+        const InSyncFolder* dbEntryL = dbEntryRefL.get();
+        const InSyncFolder* dbEntryR = itemNameL == itemNameR ? dbEntryL : dbEntryRefR.get();
 
         if (dbEntryL && dbEntryR && dbEntryL != dbEntryR) //conflict: which db entry to use?
         {
@@ -748,7 +771,7 @@ private:
             }
         }
 
-        recurse(folder, dbEntry);
+        recurse(folder, dbEntryL ? dbEntryRefL : dbEntryRefR);
     }
 
     template <SelectSide side>
@@ -856,16 +879,24 @@ void fff::redetermineSyncDirection(const std::vector<std::pair<BaseFolderPair*,
                 {
                     const DirectionByChange& changeDirs = std::get<DirectionByChange>(dirCfg.dirs);
 
+                    std::wstring dbErrorMsg;
                     auto it = lastSyncStates.find(baseFolder);
                     if (const InSyncFolder* lastSyncState = it != lastSyncStates.end() ? &it->second.ref() : nullptr)
-                    {
-                        //detect moved files (*before* setting sync directions: might combine moved files into single file pairs, wich changes category!)
-                        DetectMovedFiles::execute(*baseFolder, *lastSyncState);                
+                        try
+                        {
+                            //detect moved files (*before* setting sync directions: might combine moved files into single file pairs, wich changes category!)
+                            DetectMovedFiles::execute(*baseFolder, *lastSyncState); //throw FileError: database is decoded on first access
 
-                        SetSyncDirViaChanges::execute(*baseFolder, *lastSyncState, changeDirs);
-                    }
-                    else //fallback:
+                            SetSyncDirViaChanges::execute(*baseFolder, *lastSyncState, changeDirs); //throw FileError
+                            continue;
+                        }
+                        catch (const FileError& e) { dbErrorMsg = e.toString(); } //directions partially set => reset all below
+
+                    //fallback:
                     {
+                        if (!dbErrorMsg.empty())
+                            try { callback.logMessage(dbErrorMsg, PhaseCallback::MsgType::error); /*throw X*/} catch (...) {};
+
                         std::wstring msg = _("Database file is not available: Setting default directions for synchronization.");
                         if (directCfgs.size() > 1)
                             msg += SPACED_DASH + getShortDisplayNameForFolderPair(baseFolder->getAbstractPath<SelectSide::left >(),
@@ -1334,7 +1365,7 @@ void copyToAlternateFolderFrom(const std::vector<const FileSystemObject*>& rowsT
                 {
                     percentReporter.updateDeltaAndStatus(bytesDelta); //throw X
                     callback.requestUiUpdate(); //throw X  => not reliably covered by PercentStatReporter::updateDeltaAndStatus()! e.g. during first few seconds: STATUS_PERCENT_DELAY!
-                });
+                }, nullptr /*onSourceData*/);
 
                 if (result.errorModTime) //log only; no popup
                     callback.logMessage(result.errorModTime->toString(), PhaseCallback::MsgType::warning);
@@ -1877,7 +1908,7 @@ void TempFileBuffer::createTempFiles(const std::set<FileDescriptor>& workLoad, P
             {
                 percentReporter.updateDeltaAndStatus(bytesDelta); //throw X
                 callback.requestUiUpdate(); //throw X  => not reliably covered by PercentStatReporter::updateDeltaAndStatus()! e.g. during first few seconds: STATUS_PERCENT_DELAY!
-            });
+            }, nullptr /*onSourceData*/);
             //result.errorModTime? => irrelevant for temp files!
             statReporter.reportDelta(1, 0);
 
@@ -5,75 +5,223 @@
 // *****************************************************************************
 
 #include "binary.h"
+#include <span>
+#include <zen/thread.h>
 
 using namespace zen;
 using namespace fff;
 using AFS = AbstractFileSystem;
 
 
-bool fff::filesHaveSameContent(const AbstractPath& filePath1, const AbstractPath& filePath2, const IoCallback& notifyUnbufferedIO /*throw X*/) //throw FileError, X
+namespace
 {
-    int64_t totalBytesNotified = 0;
-    IoCallback /*[!] as expected by InputStream::tryRead()*/ notifyIoDiv = IOCallbackDivider(notifyUnbufferedIO, totalBytesNotified);
+/*  read ahead on a worker thread => I/O of both files overlaps instead of adding up (e.g. two local disks)
+    - fixed ring of buffers: memory bounded by READ_AHEAD_BLOCKS * block size
+    - only for streams supporting tryRead() from a different thread, see InputStream::allowReadFromOtherThread()
+    - blocks are read synchronously until one is completely filled: no thread creation for files smaller than the block size
+    - IoCallback may throw => worker only counts bytes, reporting happens on calling thread     */
+class StreamReadAhead
+{
+public:
+    StreamReadAhead(AFS::InputStream& stream, const Zstring& threadName) : //throw FileError
+        stream_(stream),
+        blockSize_(stream.getBlockSize()), //throw FileError
+        threadName_(threadName),
+        readAheadAllowed_(stream.allowReadFromOtherThread())
+    {
+        buffers_.emplace_back(new std::byte[blockSize_]);
+    }
 
-    const std::unique_ptr<AFS::InputStream> stream1 = AFS::getInputStream(filePath1); //throw FileError
-    const std::unique_ptr<AFS::InputStream> stream2 = AFS::getInputStream(filePath2); //
+    //returned block is valid until next call; empty block means EOF
+    std::span<const std::byte> getNextBlock(const IoCallback& notifyUnbufferedIO /*throw X*/) //throw FileError, X
+    {
+        if (eof_)
+            return {};
 
-    const size_t blockSize1 = stream1->getBlockSize(); //throw FileError
-    const size_t blockSize2 = stream2->getBlockSize(); //
+        if (!worker_.joinable())
+        {
+            if (!readAheadAllowed_ || !fullBlockRead_) //small files: avoid thread creation
+            {
+                const size_t bytesRead = stream_.tryRead(&buffers_[0][0], blockSize_, notifyUnbufferedIO); //throw FileError, X; may return short; only 0 means EOF
+                eof_ = bytesRead == 0;
+                fullBlockRead_ = bytesRead == blockSize_; //=> probably not yet at end of file
+                return {&buffers_[0][0], bytesRead};
+            }
+            startWorker();
+        }
 
-    const size_t bufCapacity = blockSize2 - 1 + blockSize1 + blockSize2;
+        FilledBlock block;
+        {
+            std::unique_lock dummy(lockBlocks_);
 
-    const std::unique_ptr<std::byte[]> buf(new std::byte[bufCapacity]);
+            if (blockInUse_) //previous block was consumed by caller => recycle
+            {
+                freeBlocks_.push_back(*blockInUse_);
+                blockInUse_ = std::nullopt;
+                conditionBlockFree_.notify_all();
+            }
 
-    std::byte* const buf1 = buf.get() + blockSize2; //capacity: blockSize2 - 1 + blockSize1
-    std::byte* const buf2 = buf.get();              //capacity: blockSize2
+            interruptibleWait(conditionBlockFilled_, dummy, [this] { return !filledBlocks_.empty(); }); //throw ThreadStopRequest
 
-    size_t buf1PosEnd = 0;
-    for (;;)
+            block = std::move(filledBlocks_.    front());
+            /**/              filledBlocks_.pop_front();
+            blockInUse_ = block.bufIdx;
+        }
+
+        if (const int64_t bytesDelta = bytesReadDelta_.exchange(0);
+            bytesDelta != 0 && notifyUnbufferedIO)
+            notifyUnbufferedIO(bytesDelta); //throw X
+
+        if (block.error)
+            throw *block.error; //throw FileError
+
+        eof_ = block.bytesRead == 0;
+        return {&buffers_[block.bufIdx][0], block.bytesRead};
+    }
+
+private:
+    StreamReadAhead           (const StreamReadAhead&) = delete;
+    StreamReadAhead& operator=(const StreamReadAhead&) = delete;
+
+    void startWorker()
     {
-        const size_t bytesRead1 = stream1->tryRead(buf1 + buf1PosEnd, blockSize1, notifyIoDiv); //throw FileError, X; may return short; only 0 means EOF
+        while (buffers_.size() < READ_AHEAD_BLOCKS)
+            buffers_.emplace_back(new std::byte[blockSize_]);
 
-        if (bytesRead1 == 0) //end of file
+        for (size_t i = 0; i < READ_AHEAD_BLOCKS; ++i)
+            freeBlocks_.push_back(i); //including buffers_[0]: last synchronous block was consumed by caller
+
+        worker_ = InterruptibleThread([this]
         {
-            size_t buf1Pos = 0;
-            while (buf1Pos < buf1PosEnd)
+            setCurrentThreadName(threadName_);
+            for (;;)
             {
-                const size_t bytesRead2 = stream2->tryRead(buf2, blockSize2, notifyIoDiv); //throw FileError, X; may return short; only 0 means EOF
+                size_t bufIdx = 0;
+                {
+                    std::unique_lock dummy(lockBlocks_);
+                    interruptibleWait(conditionBlockFree_, dummy, [this] { return !freeBlocks_.empty(); }); //throw ThreadStopRequest
+
+                    bufIdx = freeBlocks_.front();
+                    /**/     freeBlocks_.pop_front();
+                }
+
+                FilledBlock block{bufIdx};
+                try
+                {
+                    block.bytesRead = stream_.tryRead(&buffers_[bufIdx][0], blockSize_, [this](int64_t bytesDelta) { bytesReadDelta_ += bytesDelta; }); //throw FileError
+                }
+                catch (const FileError& e) { block.error = e; }
+
+                const bool done = block.bytesRead == 0; //EOF or error
+                {
+                    std::lock_guard dummy(lockBlocks_);
+                    filledBlocks_.push_back(std::move(block));
+                }
+                conditionBlockFilled_.notify_all();
+
+                if (done)
+                    return;
+            }
+        });
+    }
+
+    struct FilledBlock
+    {
+        size_t bufIdx = 0;
+        size_t bytesRead = 0;
+        std::optional<FileError> error;
+    };
+
+    static constexpr size_t READ_AHEAD_BLOCKS = 4;
+
+    AFS::InputStream& stream_;
+    const size_t blockSize_;
+    const Zstring threadName_;
+    const bool readAheadAllowed_;
+    std::vector<std::unique_ptr<std::byte[]>> buffers_;
+
+    bool fullBlockRead_ = false; //context of calling thread only
+    bool eof_ = false;           //
+
+    std::mutex lockBlocks_;
+    std::condition_variable conditionBlockFree_;
+    std::condition_variable conditionBlockFilled_;
+    RingBuffer<size_t>      freeBlocks_;   //protected by lockBlocks_
+    RingBuffer<FilledBlock> filledBlocks_; //FIFO: file order
+    std::optional<size_t>   blockInUse_;   //lent to caller
+    std::atomic<int64_t>    bytesReadDelta_{0};
+
+    InterruptibleThread worker_; //declare last: stop + join *before* other members are destroyed!
+};
+}
 
-                if (bytesRead2 == 0 ||//end of file
-                    bytesRead2 > buf1PosEnd - buf1Pos)
-                    return false;
 
-                if (std::memcmp(buf1 + buf1Pos, buf2, bytesRead2) != 0)
+bool fff::filesHaveSameContent(const AbstractPath& filePath1, const AbstractPath& filePath2, const IoCallback& notifyUnbufferedIO /*throw X*/, ContentDigest* contentDigest) //throw FileError, X
+{
+    int64_t totalBytesNotified = 0;
+    IoCallback /*[!] as expected by InputStream::tryRead()*/ notifyIoDiv = IOCallbackDivider(notifyUnbufferedIO, totalBytesNotified);
+
+    const std::unique_ptr<AFS::InputStream> stream1 = AFS::getInputStream(filePath1); //throw FileError
+    const std::unique_ptr<AFS::InputStream> stream2 = AFS::getInputStream(filePath2); //
+
+    StreamReadAhead reader1(*stream1, Zstr("Compare[1]")); //throw FileError
+    StreamReadAhead reader2(*stream2, Zstr("Compare[2]")); //manage life time: destroy *before* streams
+
+    std::optional<HashSha256> hasher;
+    try
+    {
+        if (contentDigest)
+            hasher.emplace(); //throw SysError
+
+        //memcmp(): already SIMD (glibc: SSE2/AVX2/EVEX dispatched at runtime)
+        std::span<const std::byte> block1;
+        std::span<const std::byte> block2;
+        for (;;)
+        {
+            if (block1.empty()) block1 = reader1.getNextBlock(notifyIoDiv); //throw FileError, X
+            if (block2.empty()) block2 = reader2.getNextBlock(notifyIoDiv); //
+
+            if (block1.empty() || block2.empty()) //end of file
+            {
+                if (!block1.empty() || !block2.empty())
                     return false;
 
-                buf1Pos += bytesRead2;
+                if (hasher)
+                    *contentDigest = hasher->finalize(); //throw SysError
+                return true;
             }
-            return stream2->tryRead(buf2, blockSize2, notifyIoDiv) == 0; //throw FileError, X; expect EOF
+
+            const size_t bytesCmp = std::min(block1.size(), block2.size());
+            if (std::memcmp(block1.data(), block2.data(), bytesCmp) != 0)
+                return false;
+
+            if (hasher)
+                hasher->update(block1.data(), bytesCmp); //throw SysError
+
+            block1 = block1.subspan(bytesCmp);
+            block2 = block2.subspan(bytesCmp);
         }
-        else
-        {
-            buf1PosEnd += bytesRead1;
+    }
+    catch (const SysError& e) { throw FileError(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(AFS::getDisplayPath(filePath1))), e.toString()); }
+}
 
-            size_t buf1Pos = 0;
-            while (buf1PosEnd - buf1Pos >= blockSize2)
-            {
-                const size_t bytesRead2 = stream2->tryRead(buf2, blockSize2, notifyIoDiv); //throw FileError, X; may return short; only 0 means EOF
 
-                if (bytesRead2 == 0) //end of file
-                    return false;
+ContentDigest fff::getFileContentDigest(const AbstractPath& filePath, const IoCallback& notifyUnbufferedIO /*throw X*/) //throw FileError, X
+{
+    const std::unique_ptr<AFS::InputStream> stream = AFS::getInputStream(filePath); //throw FileError
 
-                if (std::memcmp(buf1 + buf1Pos, buf2, bytesRead2) != 0)
-                    return false;
+    StreamReadAhead reader(*stream, Zstr("Content Digest")); //throw FileError; manage life time: destroy *before* stream
+    try
+    {
+        HashSha256 hasher; //throw SysError
+        for (;;)
+        {
+            const std::span<const std::byte> block = reader.getNextBlock(notifyUnbufferedIO); //throw FileError, X
+            if (block.empty()) //end of file
+                return hasher.finalize(); //throw SysError
 
-                buf1Pos += bytesRead2;
-            }
-            if (buf1Pos > 0)
-            {
-                buf1PosEnd -= buf1Pos;
-                std::memmove(buf1, buf1 + buf1Pos, buf1PosEnd);
-            }
+            hasher.update(block.data(), block.size()); //throw SysError
         }
     }
+    catch (const SysError& e) { throw FileError(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(AFS::getDisplayPath(filePath))), e.toString()); }
 }
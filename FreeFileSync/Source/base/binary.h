@@ -7,14 +7,21 @@
 #ifndef BINARY_H_3941281398513241134
 #define BINARY_H_3941281398513241134
 
+#include <zen/open_ssl.h>
 #include "../afs/abstract.h"
 
 
 namespace fff
 {
+using ContentDigest = zen::HashSha256::Digest;
+
+//contentDigest (optional): set to digest of the (common) content if files are equal
 bool filesHaveSameContent(const AbstractPath& filePath1,
                           const AbstractPath& filePath2,
-                          const zen::IoCallback& notifyUnbufferedIO  /*throw X*/); //throw FileError, X
+                          const zen::IoCallback& notifyUnbufferedIO  /*throw X*/,
+                          ContentDigest* contentDigest); //throw FileError, X
+
+ContentDigest getFileContentDigest(const AbstractPath& filePath, const zen::IoCallback& notifyUnbufferedIO /*throw X*/); //throw FileError, X
 }
 
 #endif //BINARY_H_3941281398513241134
@@ -5,6 +5,7 @@
 // *****************************************************************************
 
 #include "comparison.h"
+#include <numeric>
 #include <zen/process_priority.h>
 #include <zen/perf.h>
 #include <zen/time.h>
@@ -13,6 +14,7 @@
 #include "dir_exist_async.h"
 #include "db_file.h"
 #include "binary.h"
+#include "hash_cache.h"
 #include "cmp_filetime.h"
 #include "status_handler_impl.h"
 #include "../afs/concrete.h"
@@ -187,10 +189,16 @@ class ComparisonBuffer
 {
 public:
     ComparisonBuffer(const FolderStatus& folderStatus,
+                     const std::map<AfsDevice, size_t>& deviceParallelOps,
                      int fileTimeTolerance,
+                     bool contentHashCache,
+                     const std::vector<Zstring>& changedItemPaths,
                      ProcessCallback& callback) :
         fileTimeTolerance_(fileTimeTolerance),
+        contentHashCache_(contentHashCache),
         folderStatus_(folderStatus),
+        deviceParallelOps_(deviceParallelOps),
+        changedItemPaths_(changedItemPaths),
         cb_(callback) {}
 
     FolderComparison execute(const std::vector<std::pair<ResolvedFolderPair, FolderPairCfg>>& workLoad);
@@ -199,6 +207,8 @@ private:
     ComparisonBuffer           (const ComparisonBuffer&) = delete;
     ComparisonBuffer& operator=(const ComparisonBuffer&) = delete;
 
+    std::map<DirectoryKey, PartialTraversal> preparePartialTraversals(const std::vector<std::pair<ResolvedFolderPair, FolderPairCfg>>& workLoad) const;
+
     //create comparison result table and fill category except for files existing on both sides: undefinedFiles and undefinedSymlinks are appended!
     SharedRef<BaseFolderPair> compareByTimeSize(const ResolvedFolderPair& fp, const FolderPairCfg& fpConfig) const;
     SharedRef<BaseFolderPair> compareBySize    (const ResolvedFolderPair& fp, const FolderPairCfg& fpConfig) const;
@@ -222,12 +232,32 @@ private:
     };
 
     const int fileTimeTolerance_;
+    const bool contentHashCache_;
     const FolderStatus& folderStatus_;
+    const std::map<AfsDevice, size_t>& deviceParallelOps_;
+    const std::vector<Zstring>& changedItemPaths_;
     std::map<DirectoryKey, DirectoryValue> folderBuffer_; //contains entries for *all* scanned folders!
     ProcessCallback& cb_;
 };
 
 
+//partial comparison: folders taken from sync.ffs_db are not updated after sync (see saveLastSynchronousState())
+//=> only valid while all items are in sync: not the case if comparison settings have changed since (e.g. file time tolerance)
+bool checkLastSyncState(ContainerObject& conObj)
+{
+    bool inSync = std::all_of(conObj.refSubFiles().begin(), conObj.refSubFiles().end(), [](const FilePair&    file   ) { return file   .getCategory()     == FILE_EQUAL;    }) &&
+                  std::all_of(conObj.refSubLinks().begin(), conObj.refSubLinks().end(), [](const SymlinkPair& symlink) { return symlink.getLinkCategory() == SYMLINK_EQUAL; });
+
+    for (FolderPair& folder : conObj.refSubFolders())
+        if (!checkLastSyncState(folder) || folder.getDirCategory() != DIR_EQUAL)
+        {
+            folder.clearLastSyncState();
+            inSync = false;
+        }
+    return inSync;
+}
+
+
 FolderComparison ComparisonBuffer::execute(const std::vector<std::pair<ResolvedFolderPair, FolderPairCfg>>& workLoad)
 {
     std::set<DirectoryKey> foldersToRead;
@@ -242,6 +272,8 @@ FolderComparison ComparisonBuffer::execute(const std::vector<std::pair<ResolvedF
                 foldersToRead.emplace(DirectoryKey{folderPair.folderPathRight, fpCfg.filter.nameFilter, fpCfg.handleSymlinks});
         }
 
+    const std::map<DirectoryKey, PartialTraversal> partialTraversals = preparePartialTraversals(workLoad); //throw X
+
     //------------------------------------------------------------------
     const std::chrono::steady_clock::time_point compareStartTime = std::chrono::steady_clock::now();
     int itemsReported = 0;
@@ -255,7 +287,7 @@ FolderComparison ComparisonBuffer::execute(const std::vector<std::pair<ResolvedF
     };
 
     //PERF_START;
-    folderBuffer_ = parallelDeviceTraversal(foldersToRead,
+    folderBuffer_ = parallelDeviceTraversal(foldersToRead, partialTraversals, deviceParallelOps_,
     [&](const PhaseCallback::ErrorInfo& errorInfo) { return cb_.reportError(errorInfo); }, //throw X
     onStatusUpdate, //throw X
     UI_UPDATE_INTERVAL / 2); //every ~50 ms
@@ -295,9 +327,196 @@ FolderComparison ComparisonBuffer::execute(const std::vector<std::pair<ResolvedF
                     output.push_back(*itOByC++);
                 break;
         }
+
+    if (!partialTraversals.empty())
+        for (SharedRef<BaseFolderPair>& baseFolder : output)
+            checkLastSyncState(baseFolder.ref());
+
+    return output;
+}
+
+
+
+//relative paths of folders to read for "changedItemPaths" below "baseFolderPath": see PartialTraversal
+//return false if the base folder must be traversed completely:
+//  - base folder itself (or one of its parents) changed
+//  - not a native path: changes can't be known, e.g. RealTimeSync doesn't monitor SFTP, FTP, Google Drive
+bool addChangedFolders(const AbstractPath& baseFolderPath, const std::vector<Zstring>& changedItemPaths,
+                       std::unordered_set<Zstring>& changedFolders, std::unordered_set<Zstring>& rescanFolders)
+{
+    const Zstring& baseFolderPathNative = getNativeItemPath(baseFolderPath);
+    if (baseFolderPathNative.empty())
+        return false;
+
+    const Zstring baseFolderPathPf = appendSeparator(baseFolderPathNative);
+
+    for (const Zstring& itemPath : changedItemPaths)
+        if (startsWith(itemPath, baseFolderPathPf))
+        {
+            const Zstring relPath(itemPath.begin() + baseFolderPathPf.size(), itemPath.end());
+            if (relPath.empty())
+                return false;
+
+            rescanFolders.insert(relPath); //no-op if item is not a folder
+
+            for (Zstring parentRelPath = relPath; contains(parentRelPath, FILE_NAME_SEPARATOR);)
+            {
+                parentRelPath = beforeLast(parentRelPath, FILE_NAME_SEPARATOR, IfNotFoundReturn::none);
+                if (!changedFolders.insert(parentRelPath).second)
+                    break; //parent folders were already added
+            }
+        }
+        else if (startsWith(baseFolderPathPf, appendSeparator(itemPath))) //base folder itself or one of its parents changed
+            return false;
+    return true;
+}
+
+
+/* partial comparison: folder pair is traversed only where items changed, everything else is taken from sync.ffs_db
+    - sync.ffs_db has in-sync items only: folders with other items (or names not in Unicode normal form) are read from disk
+    - both sides are read alike (same changed relative paths): don't mix items from disk with items from sync.ffs_db
+    - caller guarantees "changedItemPaths" contains all changes since the last synchronization       */
+std::map<DirectoryKey, PartialTraversal> ComparisonBuffer::preparePartialTraversals(const std::vector<std::pair<ResolvedFolderPair, FolderPairCfg>>& workLoad) const
+{
+    if (changedItemPaths_.empty()) //full comparison
+        return {};
+
+    //base folder used by multiple folder pairs: last synchronous states differ => traverse completely
+    std::map<DirectoryKey, size_t> folderKeyCount;
+    for (const auto& [folderPair, fpCfg] : workLoad)
+    {
+        ++folderKeyCount[{folderPair.folderPathLeft,  fpCfg.filter.nameFilter, fpCfg.handleSymlinks}];
+        ++folderKeyCount[{folderPair.folderPathRight, fpCfg.filter.nameFilter, fpCfg.handleSymlinks}];
+    }
+
+    std::vector<std::pair<SharedRef<BaseFolderPair>, const FolderPairCfg*>> baseFolders; //only needed to load sync.ffs_db
+    std::vector<const BaseFolderPair*> baseFoldersToLoad;
+
+    for (const auto& [folderPair, fpCfg] : workLoad)
+        if (fpCfg.compareVar != CompareVariant::content && //files found "in sync" by content have different modification times => would be compared again
+            getBaseFolderStatus(folderPair.folderPathLeft ) == BaseFolderStatus::existing &&
+            getBaseFolderStatus(folderPair.folderPathRight) == BaseFolderStatus::existing &&
+            folderKeyCount[{folderPair.folderPathLeft,  fpCfg.filter.nameFilter, fpCfg.handleSymlinks}] == 1 &&
+            folderKeyCount[{folderPair.folderPathRight, fpCfg.filter.nameFilter, fpCfg.handleSymlinks}] == 1)
+        {
+            baseFolders.emplace_back(makeSharedRef<BaseFolderPair>(folderPair.folderPathLeft,  BaseFolderStatus::existing,
+                                                                   folderPair.folderPathRight, BaseFolderStatus::existing,
+                                                                   fpCfg.filter.nameFilter, fpCfg.compareVar, fileTimeTolerance_, fpCfg.ignoreTimeShiftMinutes), &fpCfg);
+            baseFoldersToLoad.push_back(&baseFolders.back().first.ref());
+        }
+
+    if (baseFoldersToLoad.empty())
+        return {};
+
+    const std::unordered_map<const BaseFolderPair*, SharedRef<const InSyncFolder>> lastSyncStates = loadLastSynchronousState(baseFoldersToLoad, cb_); //throw X
+
+    std::map<DirectoryKey, PartialTraversal> output;
+
+    for (const auto& [baseFolder, fpCfg] : baseFolders)
+        if (auto itDb = lastSyncStates.find(&baseFolder.ref());
+            itDb != lastSyncStates.end()) //else: no sync.ffs_db => traverse completely
+        {
+            std::unordered_set<Zstring> changedFolders;
+            std::unordered_set<Zstring> rescanFolders;
+
+            if (addChangedFolders(baseFolder.ref().getAbstractPath<SelectSide::left >(), changedItemPaths_, changedFolders, rescanFolders) &&
+                addChangedFolders(baseFolder.ref().getAbstractPath<SelectSide::right>(), changedItemPaths_, changedFolders, rescanFolders))
+            {
+                try
+                {
+                    itDb->second.ref().loadAll(); //throw FileError; decoded on first access: NOT thread-safe => decode before handing out to worker threads
+                }
+                catch (const FileError& e) //=> traverse completely
+                {
+                    cb_.reportFatalError(e.toString()); //throw X
+                    continue;
+                }
+
+                for (const SelectSide side : {SelectSide::left, SelectSide::right})
+                {
+                    const AbstractPath& baseFolderPath = side == SelectSide::left ?
+                                                         baseFolder.ref().getAbstractPath<SelectSide::left >() :
+                                                         baseFolder.ref().getAbstractPath<SelectSide::right>();
+
+                    output.emplace(DirectoryKey{baseFolderPath, fpCfg->filter.nameFilter, fpCfg->handleSymlinks},
+                                   PartialTraversal{itDb->second, side, changedFolders, rescanFolders});
+                }
+
+                cb_.logMessage(_("Reading changed items only:") + L' ' +
+                               fmtPath(AFS::getDisplayPath(baseFolder.ref().getAbstractPath<SelectSide::left >())) + L" <-> " +
+                               fmtPath(AFS::getDisplayPath(baseFolder.ref().getAbstractPath<SelectSide::right>())), PhaseCallback::MsgType::info); //throw X
+            }
+        }
+
     return output;
 }
 
+//-----------------------------------------------------------------------------
+
+/* fork-join on worker threads: tasks may schedule further tasks
+    - std::bad_alloc & co: first exception is rethrown on calling thread after all tasks have finished   */
+class ForkJoin
+{
+public:
+    explicit ForkJoin(const Zstring& threadGroupName) : tg_(std::max(std::thread::hardware_concurrency(), 1U), threadGroupName) {}
+
+    //context of calling OR worker thread, non-blocking
+    void run(std::function<void()>&& task)
+    {
+        tg_.run([this, task = std::move(task)]
+        {
+            try
+            {
+                task(); //throw ?
+            }
+            catch (...)
+            {
+                std::lock_guard dummy(lockError_);
+                if (!error_)
+                    error_ = std::current_exception();
+            }
+        });
+    }
+
+    //context of calling thread, blocking
+    void wait() //throw ?
+    {
+        tg_.wait();
+        if (error_)
+            std::rethrow_exception(error_);
+    }
+
+private:
+    ForkJoin           (const ForkJoin&) = delete;
+    ForkJoin& operator=(const ForkJoin&) = delete;
+
+    std::mutex lockError_;
+    std::exception_ptr error_;
+    ThreadGroup<std::function<void()>> tg_; //declare last: stop + join *before* other members are destroyed!
+};
+
+
+//categorize items independently of each other: fun() may only modify the item itself!
+template <class T, class Function>
+void forEachParallel(const std::vector<T*>& items, const Zstring& threadGroupName, Function fun)
+{
+    constexpr size_t CHUNK_SIZE = 10'000; //small folder pairs: don't bother with thread creation
+
+    if (items.size() <= CHUNK_SIZE)
+    {
+        for (T* item : items)
+            fun(*item);
+        return;
+    }
+
+    ForkJoin fj(threadGroupName);
+    for (size_t pos = 0; pos < items.size(); pos += CHUNK_SIZE)
+        fj.run([&items, &fun, pos]
+        {
+            std::for_each(items.begin() + pos, items.begin() + std::min(pos + CHUNK_SIZE, items.size()), [&](T* item) { fun(*item); });
+        });
+    fj.wait(); //throw ?
+}
 
 //--------------------assemble conflict descriptions---------------------------
 
@@ -375,39 +594,38 @@ SharedRef<BaseFolderPair> ComparisonBuffer::compareByTimeSize(const ResolvedFold
     SharedRef<BaseFolderPair> output = performComparison(fp, fpConfig, uncategorizedFiles, uncategorizedLinks);
 
     //finish symlink categorization
-    for (SymlinkPair* symlink : uncategorizedLinks)
-        categorizeSymlinkByTime(*symlink);
+    forEachParallel(uncategorizedLinks, Zstr("Categorize symlinks"), [](SymlinkPair& symlink) { categorizeSymlinkByTime(symlink); });
 
     //categorize files that exist on both sides
-    for (FilePair* file : uncategorizedFiles)
+    forEachParallel(uncategorizedFiles, Zstr("Categorize files"), [&](FilePair& file)
     {
-        switch (compareFileTime(file->getLastWriteTime<SelectSide::left>(),
-                                file->getLastWriteTime<SelectSide::right>(), fileTimeTolerance_, fpConfig.ignoreTimeShiftMinutes))
+        switch (compareFileTime(file.getLastWriteTime<SelectSide::left>(),
+                                file.getLastWriteTime<SelectSide::right>(), fileTimeTolerance_, fpConfig.ignoreTimeShiftMinutes))
         {
             case TimeResult::equal:
-                if (file->getFileSize<SelectSide::left>() == file->getFileSize<SelectSide::right>())
-                    file->setContentCategory(FileContentCategory::equal);
+                if (file.getFileSize<SelectSide::left>() == file.getFileSize<SelectSide::right>())
+                    file.setContentCategory(FileContentCategory::equal);
                 else
-                    file->setCategoryInvalidTime(getConflictSameDateDiffSize(*file));
+                    file.setCategoryInvalidTime(getConflictSameDateDiffSize(file));
                 break;
 
             case TimeResult::leftNewer:
-                file->setContentCategory(FileContentCategory::leftNewer);
+                file.setContentCategory(FileContentCategory::leftNewer);
                 break;
 
             case TimeResult::rightNewer:
-                file->setContentCategory(FileContentCategory::rightNewer);
+                file.setContentCategory(FileContentCategory::rightNewer);
                 break;
 
             case TimeResult::leftInvalid:
-                file->setCategoryInvalidTime(getConflictInvalidDate<SelectSide::left>(*file));
+                file.setCategoryInvalidTime(getConflictInvalidDate<SelectSide::left>(file));
                 break;
 
             case TimeResult::rightInvalid:
-                file->setCategoryInvalidTime(getConflictInvalidDate<SelectSide::right>(*file));
+                file.setCategoryInvalidTime(getConflictInvalidDate<SelectSide::right>(file));
                 break;
         }
-    }
+    });
     return output;
 }
 
@@ -448,17 +666,17 @@ SharedRef<BaseFolderPair> ComparisonBuffer::compareBySize(const ResolvedFolderPa
     //harmonize with algorithm.cpp, stillInSync()!
 
     //categorize files that exist on both sides
-    for (FilePair* file : uncategorizedFiles)
+    forEachParallel(uncategorizedFiles, Zstr("Categorize files"), [](FilePair& file)
     {
         //Caveat:
         //1. FILE_EQUAL may only be set if file names match in case: InSyncFolder's mapping tables use file name as a key! see db_file.cpp
         //2. FILE_EQUAL is expected to mean identical file sizes! See InSyncFile
         //3. harmonize with "bool stillInSync()" in algorithm.cpp, FilePair::setSyncedTo() in file_hierarchy.h
-        if (file->getFileSize<SelectSide::left>() == file->getFileSize<SelectSide::right>())
-            file->setContentCategory(FileContentCategory::equal);
+        if (file.getFileSize<SelectSide::left>() == file.getFileSize<SelectSide::right>())
+            file.setContentCategory(FileContentCategory::equal);
         else
-            file->setContentCategory(FileContentCategory::different);
-    }
+            file.setContentCategory(FileContentCategory::different);
+    });
     return output;
 }
 
@@ -471,14 +689,20 @@ namespace parallel
 inline
 bool filesHaveSameContent(const AbstractPath& filePath1, const AbstractPath& filePath2, //throw FileError, X
                           const IoCallback& notifyUnbufferedIO /*throw X*/,
+                          ContentDigest* contentDigest /*optional, written inside parallel scope*/,
                           std::mutex& singleThread)
-{ return parallelScope([=] { return filesHaveSameContent(filePath1, filePath2, notifyUnbufferedIO); /*throw FileError, X*/ }, singleThread); }
+{ return parallelScope([=] { return filesHaveSameContent(filePath1, filePath2, notifyUnbufferedIO, contentDigest); /*throw FileError, X*/ }, singleThread); }
+
+inline
+ContentDigest getFileContentDigest(const AbstractPath& filePath, const IoCallback& notifyUnbufferedIO /*throw X*/, std::mutex& singleThread) //throw FileError, X
+{ return parallelScope([=] { return getFileContentDigest(filePath, notifyUnbufferedIO); /*throw FileError, X*/ }, singleThread); }
 }
 
 
 namespace
 {
-void categorizeFileByContent(FilePair& file, const std::wstring& txtComparingContentOfFiles, AsyncCallback& acb, std::mutex& singleThread) //throw ThreadStopRequest
+void categorizeFileByContent(FilePair& file, const std::wstring& txtComparingContentOfFiles, AsyncCallback& acb, std::mutex& singleThread, //throw ThreadStopRequest
+                             ContentHashCache* hashCacheL /*optional*/, ContentHashCache* hashCacheR /*optional*/)
 {
     bool haveSameContent = false;
     const std::wstring errMsg = tryReportingError([&]
@@ -498,9 +722,43 @@ void categorizeFileByContent(FilePair& file, const std::wstring& txtComparingCon
             interruptionPoint(); //throw ThreadStopRequest => not reliably covered by PercentStatReporter::updateDeltaAndStatus()!
         };
 
-        haveSameContent = parallel::filesHaveSameContent(file.getAbstractPath<SelectSide::left >(),
-                                                         file.getAbstractPath<SelectSide::right>(), notifyUnbufferedIO, singleThread); //throw FileError, ThreadStopRequest
-        statReporter.reportDelta(1, 0);
+        const FileAttributes attrL = file.getAttributes<SelectSide::left >();
+        const FileAttributes attrR = file.getAttributes<SelectSide::right>();
+
+        //cache access: singleThread lock is held (outside parallel scope)
+        const std::optional<ContentDigest> cachedL = hashCacheL ? hashCacheL->find(file.getRelativePath<SelectSide::left >(), attrL) : std::nullopt;
+        const std::optional<ContentDigest> cachedR = hashCacheR ? hashCacheR->find(file.getRelativePath<SelectSide::right>(), attrR) : std::nullopt;
+
+        if (cachedL && cachedR) //no file I/O at all
+            haveSameContent = *cachedL == *cachedR;
+        else if (cachedL) //only one side changed since last comparison => reading a single file is enough
+        {
+            const ContentDigest digestR = parallel::getFileContentDigest(file.getAbstractPath<SelectSide::right>(), notifyUnbufferedIO, singleThread); //throw FileError, ThreadStopRequest
+            hashCacheR->insert(file.getRelativePath<SelectSide::right>(), attrR, digestR);
+            haveSameContent = *cachedL == digestR;
+        }
+        else if (cachedR)
+        {
+            const ContentDigest digestL = parallel::getFileContentDigest(file.getAbstractPath<SelectSide::left>(), notifyUnbufferedIO, singleThread); //throw FileError, ThreadStopRequest
+            hashCacheL->insert(file.getRelativePath<SelectSide::left>(), attrL, digestL);
+            haveSameContent = digestL == *cachedR;
+        }
+        else
+        {
+            std::optional<ContentDigest> digest; //only set if content is equal
+            if (hashCacheL || hashCacheR)
+                digest.emplace();
+
+            haveSameContent = parallel::filesHaveSameContent(file.getAbstractPath<SelectSide::left >(),
+                                                             file.getAbstractPath<SelectSide::right>(), notifyUnbufferedIO,
+                                                             digest ? &*digest : nullptr, singleThread); //throw FileError, ThreadStopRequest
+            if (haveSameContent && digest)
+            {
+                if (hashCacheL) hashCacheL->insert(file.getRelativePath<SelectSide::left >(), attrL, *digest);
+                if (hashCacheR) hashCacheR->insert(file.getRelativePath<SelectSide::right>(), attrR, *digest);
+            }
+        }
+        statReporter.reportDelta(1, 0); //fewer bytes than expected (cache hit)? => corrected by ~ItemStatReporter()
     }, acb); //throw ThreadStopRequest
 
     if (!errMsg.empty())
@@ -523,15 +781,37 @@ std::vector<SharedRef<BaseFolderPair>> ComparisonBuffer::compareByContent(const
     {
         ParallelOps& parallelOpsL; //
         ParallelOps& parallelOpsR; //consider aliasing!
+        ContentHashCache* hashCacheL; //optional
+        ContentHashCache* hashCacheR; //consider aliasing!
         RingBuffer<FilePair*> filesToCompareBytewise;
     };
     std::vector<BinaryWorkload> fpWorkload;
 
+    std::map<AbstractPath, std::unique_ptr<ContentHashCache>> hashCaches; //one per base folder: shared between folder pairs
+
+    auto getHashCache = [&](const AbstractPath& basePath) -> ContentHashCache*
+    {
+        if (!contentHashCache_)
+            return nullptr;
+
+        std::unique_ptr<ContentHashCache>& hashCache = hashCaches[basePath];
+        if (!hashCache)
+        {
+            hashCache = std::make_unique<ContentHashCache>(basePath);
+            try
+            {
+                hashCache->load(); //throw FileError
+            }
+            catch (const FileError& e) { cb_.logMessage(e.toString(), PhaseCallback::MsgType::warning); } //throw X; continue with empty cache
+        }
+        return hashCache.get();
+    };
+
     auto addToBinaryWorkload = [&](const AbstractPath& basePathL, const AbstractPath& basePathR, RingBuffer<FilePair*>&& filesToCompareBytewise)
     {
         ParallelOps& posL = parallelOpsStatus[basePathL.afsDevice];
         ParallelOps& posR = parallelOpsStatus[basePathR.afsDevice];
-        fpWorkload.push_back({posL, posR, std::move(filesToCompareBytewise)});
+        fpWorkload.push_back({posL, posR, getHashCache(basePathL), getHashCache(basePathR), std::move(filesToCompareBytewise)});
     };
 
     std::vector<SharedRef<BaseFolderPair>> output;
@@ -621,7 +901,7 @@ std::vector<SharedRef<BaseFolderPair>> ComparisonBuffer::compareByContent(const
                                              /**/                --posR.current;
                                              scheduleMoreTasks());
 
-                        categorizeFileByContent(file, txtComparingContentOfFiles, acb, singleThread); //throw ThreadStopRequest
+                        categorizeFileByContent(file, txtComparingContentOfFiles, acb, singleThread, bwl.hashCacheL, bwl.hashCacheR); //throw ThreadStopRequest
                     });
 
                     bwl.filesToCompareBytewise.pop_front();
@@ -639,6 +919,13 @@ std::vector<SharedRef<BaseFolderPair>> ComparisonBuffer::compareByContent(const
         }
 
         acb.waitUntilDone(UI_UPDATE_INTERVAL / 2 /*every ~50 ms*/, cb_); //throw X
+
+        for (const auto& [basePath, hashCache] : hashCaches)
+            try
+            {
+                hashCache->save(); //throw FileError
+            }
+            catch (const FileError& e) { cb_.logMessage(e.toString(), PhaseCallback::MsgType::warning); } //throw X
     }
 
     return output;
@@ -646,6 +933,28 @@ std::vector<SharedRef<BaseFolderPair>> ComparisonBuffer::compareByContent(const
 
 //-----------------------------------------------------------------------------------------------
 
+//result of matching the items of a folder pair by name: indexes into FolderContainer, sequence as reported by matchFolders()
+struct FolderMatch
+{
+    static constexpr size_t NO_ITEM = static_cast<size_t>(-1);
+
+    struct ItemMatch
+    {
+        size_t idxL = NO_ITEM; //NO_ITEM if left side is missing
+        size_t idxR = NO_ITEM; //
+        Zstringc conflictMsg;  //ambiguous item name
+    };
+    std::vector<ItemMatch> files;
+    std::vector<ItemMatch> symlinks;
+    std::vector<ItemMatch> folders;
+    std::vector<FolderMatch> subFolders; //one per folder existing on both sides, same sequence as "folders"
+};
+
+
+/* two phases:
+    1. match item names of all folder pairs: CPU-bound, fork-join on folder level => worker threads
+    2. create hierarchy objects following FolderMatch: calling thread only, ObjectMgr and BaseFolderPair memory pool are not thread-safe
+       => hierarchy is the same as if created single-threaded     */
 class MergeSides
 {
 public:
@@ -654,20 +963,7 @@ public:
                         const std::unordered_map<Zstring, Zstringc>& errorsByRelPathR,
                         ContainerObject& output,
                         std::vector<FilePair*>& undefinedFilesOut,
-                        std::vector<SymlinkPair*>& undefinedSymlinksOut)
-    {
-        MergeSides inst(errorsByRelPathL, errorsByRelPathR, undefinedFilesOut, undefinedSymlinksOut);
-
-        const Zstringc* errorMsg = nullptr;
-        if (auto it = inst.errorsByRelPathL_.find(Zstring()); //empty path if read-error for whole base directory
-            it != inst.errorsByRelPathL_.end())
-            errorMsg = &it->second;
-        else if (auto it2 = inst.errorsByRelPathR_.find(Zstring());
-                 it2 != inst.errorsByRelPathR_.end())
-            errorMsg = &it2->second;
-
-        inst.mergeFolders(lhs, rhs, errorMsg, output);
-    }
+                        std::vector<SymlinkPair*>& undefinedSymlinksOut);
 
 private:
     MergeSides(const std::unordered_map<Zstring, Zstringc>& errorsByRelPathL,
@@ -679,7 +975,7 @@ private:
         undefinedFiles_(undefinedFilesOut),
         undefinedSymlinks_(undefinedSymlinksOut) {}
 
-    void mergeFolders(const FolderContainer& lhs, const FolderContainer& rhs, const Zstringc* errorMsg, ContainerObject& output);
+    void mergeFolders(const FolderContainer& lhs, const FolderContainer& rhs, const FolderMatch& match, const Zstringc* errorMsg, ContainerObject& output);
 
     template <SelectSide side>
     void fillOneSide(const FolderContainer& folderCont, const Zstringc* errorMsg, ContainerObject& output);
@@ -728,193 +1024,414 @@ const Zstringc* MergeSides::checkFailedRead(FileSystemObject& fsObj, const Zstri
 }
 
 
-template <class MapType, class Function>
-void forEachSorted(const MapType& fileMap, Function fun)
+//sort for natural default sequence on UI file grid: same order as compareNoCase(), but without memory allocation for ASCII names
+template <class ItemList>
+std::vector<size_t> getIndexesSortedNoCase(const ItemList& items)
 {
-    using FileRef = const typename MapType::value_type*;
-
-    std::vector<FileRef> fileList;
-    fileList.reserve(fileMap.size());
+    std::vector<std::optional<Zstring>> upperCaseOther(items.size()); //non-ASCII: getUpperCase(itemName)
+    for (size_t i = 0; i < items.size(); ++i)
+        if (!isAsciiString(items.getName(i)))
+            upperCaseOther[i] = getUpperCase(Zstring(items.getName(i)));
 
-    for (const auto& item : fileMap)
-        fileList.push_back(&item);
+    auto getLen  = [&](size_t idx) { return upperCaseOther[idx] ? upperCaseOther[idx]->size() : items.getName(idx).size(); };
+    auto getChar = [&](size_t idx, size_t pos) { return upperCaseOther[idx] ? (*upperCaseOther[idx])[pos] : asciiToUpper(items.getName(idx)[pos]); };
 
-    //sort for natural default sequence on UI file grid:
-    std::sort(fileList.begin(), fileList.end(), [](const FileRef& lhs, const FileRef& rhs) { return compareNoCase(lhs->first /*item name*/, rhs->first) < 0; });
+    std::vector<size_t> output(items.size());
+    std::iota(output.begin(), output.end(), 0);
 
-    for (const auto& item : fileList)
-        fun(item->first, item->second);
+    std::stable_sort(output.begin(), output.end(), [&](size_t lhs, size_t rhs) //stable: keep sequence of names differing in case only
+    {
+        const size_t lenL = getLen(lhs);
+        const size_t lenR = getLen(rhs);
+
+        for (size_t pos = 0; pos < std::min(lenL, lenR); ++pos)
+            if (const Zchar cL = getChar(lhs, pos),
+                cR = getChar(rhs, pos);
+                cL != cR)
+                return static_cast<std::make_unsigned_t<Zchar>>(cL) < static_cast<std::make_unsigned_t<Zchar>>(cR);
+        return lenL < lenR;
+    });
+    return output;
 }
 
 
 template <SelectSide side>
 void MergeSides::fillOneSide(const FolderContainer& folderCont, const Zstringc* errorMsg, ContainerObject& output)
 {
-    forEachSorted(folderCont.files, [&](const Zstring& fileName, const FileAttributes& attrib)
+    for (const size_t idx : getIndexesSortedNoCase(folderCont.refFiles()))
     {
-        FilePair& newItem = output.addFile<side>(fileName, attrib);
+        FilePair& newItem = output.addFile<side>(Zstring(folderCont.refFiles().getName(idx)), folderCont.refFiles().getAttr(idx));
         checkFailedRead<side>(newItem, errorMsg);
-    });
+    }
 
-    forEachSorted(folderCont.symlinks, [&](const Zstring& linkName, const LinkAttributes& attrib)
+    for (const size_t idx : getIndexesSortedNoCase(folderCont.refSymlinks()))
     {
-        SymlinkPair& newItem = output.addLink<side>(linkName, attrib);
+        SymlinkPair& newItem = output.addLink<side>(Zstring(folderCont.refSymlinks().getName(idx)), folderCont.refSymlinks().getAttr(idx));
         checkFailedRead<side>(newItem, errorMsg);
-    });
+    }
 
-    forEachSorted(folderCont.folders, [&](const Zstring& folderName, const std::pair<FolderAttributes, FolderContainer>& attrib)
+    for (const size_t idx : getIndexesSortedNoCase(folderCont.refFolders()))
     {
-        FolderPair& newFolder = output.addFolder<side>(folderName, attrib.first);
+        FolderPair& newFolder = output.addFolder<side>(Zstring(folderCont.refFolders().getName(idx)), folderCont.refFolders().getAttr(idx));
         const Zstringc* errorMsgNew = checkFailedRead<side>(newFolder, errorMsg);
-        fillOneSide<side>(attrib.second, errorMsgNew, newFolder); //recurse
-    });
+        fillOneSide<side>(folderCont.getSubFolder(idx), errorMsgNew, newFolder); //recurse
+    }
 }
 
 
-template <class MapType, class ProcessLeftOnly, class ProcessRightOnly, class ProcessBoth> inline
-void matchFolders(const MapType& mapLeft, const MapType& mapRight, ProcessLeftOnly lo, ProcessRightOnly ro, ProcessBoth bo)
+/*  match items of both sides by name: ignore upper/lower case, leading/trailing space, Unicode normal form
+    - hash join instead of sorting all items: only one item per canonical name needs sorting => items are reported sorted by canonical name
+      (natural default sequence on UI file grid; sequence of sync and log is the same as before)
+    - sorting stays here instead of moving to FileView: sync and log follow this sequence, too, also in batch mode without UI;
+      FileView serializes unsorted on the main thread (see FileView::serializeHierarchy()), while this runs per folder on worker threads
+    - ASCII fast path: canonical name is derived on the fly => no memory allocation
+    - Unicode normal form is needed for ambiguous names only: calculate once per item, not per comparison      */
+template <class ItemList, class ProcessLeftOnly, class ProcessRightOnly, class ProcessBoth> inline
+void matchFolders(const ItemList& itemsLeft, const ItemList& itemsRight, ProcessLeftOnly lo, ProcessRightOnly ro, ProcessBoth bo)
 {
     struct FileRef
     {
-        Zstring canonicalName; //perf: buffer instead of compareNoCase()/equalNoCase()? => makes no (significant) difference!
-        const typename MapType::value_type* ref;
-        SelectSide side;
+        ZstringView itemName;
+        ZstringView canonicalAscii;            //ASCII:     trimmed item name, upper case is applied on the fly
+        std::optional<Zstring> canonicalOther; //non-ASCII: trimCpy(getUpperCase(itemName))
+        size_t hash = 0;
+        size_t idx = 0;
+        SelectSide side = SelectSide::left;
+        bool groupHead = false;
+        size_t nextEq = 0; //next item with same canonical name
+        size_t lastEq = 0; //valid for group head only
     };
     std::vector<FileRef> fileList;
-    fileList.reserve(mapLeft.size() + mapRight.size()); //perf: ~5% shorter runtime
+    fileList.reserve(itemsLeft.size() + itemsRight.size());
 
-    auto getCanonicalName = [](const Zstring& name){ return trimCpy(getUpperCase(name)); };
-    
-    for (const auto& item : mapLeft ) fileList.push_back({getCanonicalName(item.first), &item, SelectSide::left});
-    for (const auto& item : mapRight) fileList.push_back({getCanonicalName(item.first), &item, SelectSide::right});
+    auto forEachCanonicalChar = [](const FileRef& fr, auto fun)
+    {
+        if (fr.canonicalOther)
+            for (const Zchar c : *fr.canonicalOther)
+                fun(c);
+        else
+            for (const Zchar c : fr.canonicalAscii)
+                fun(asciiToUpper(c));
+    };
 
-    //primary sort: ignore upper/lower case, leading/trailing space, Unicode normal form
-    //bonus: natural default sequence on UI file grid
-    std::sort(fileList.begin(), fileList.end(), [](const FileRef& lhs, const FileRef& rhs) { return lhs.canonicalName < rhs.canonicalName; });
+    auto getCanonicalLen = [](const FileRef& fr) { return fr.canonicalOther ? fr.canonicalOther->size() : fr.canonicalAscii.size(); };
 
-    using ItType = typename std::vector<FileRef>::iterator;
-    auto tryMatchRange = [&](ItType it, ItType itLast) //auto parameters? compiler error on VS 17.2...
+    auto getCanonicalChar = [](const FileRef& fr, size_t pos) { return fr.canonicalOther ? (*fr.canonicalOther)[pos] : asciiToUpper(fr.canonicalAscii[pos]); };
+
+    auto addFileRef = [&](ZstringView itemName, size_t idx, SelectSide side)
     {
-        const size_t equalCountL = std::count_if(it, itLast, [](const FileRef& fr) { return fr.side == SelectSide::left; });
-        const size_t equalCountR = itLast - it - equalCountL;
+        FileRef& fr = fileList.emplace_back();
+        fr.itemName = itemName;
+        fr.idx = idx;
+        fr.side = side;
 
-        if (equalCountL == 1 && equalCountR == 1) //we have a match
+        if (isAsciiString(itemName))
         {
-            if (it->side == SelectSide::left)
-                bo(*it[0].ref, *it[1].ref);
-            else
-                bo(*it[1].ref, *it[0].ref);
+            auto itFirst = itemName.begin();
+            auto itLast  = itemName.end();
+            while (itFirst != itLast && isWhiteSpace(*itFirst))      ++itFirst;
+            while (itFirst != itLast && isWhiteSpace(*(itLast - 1))) --itLast;
+            fr.canonicalAscii = makeStringView(itFirst, itLast);
         }
+        else
+            fr.canonicalOther = trimCpy(getUpperCase(Zstring(itemName)));
+
+        FNV1aHash<size_t> hash;
+        forEachCanonicalChar(fr, [&](Zchar c) { hash.add(static_cast<std::make_unsigned_t<Zchar>>(c)); });
+        fr.hash = hash.get();
+    };
+    for (size_t i = 0; i < itemsLeft .size(); ++i) addFileRef(itemsLeft .getName(i), i, SelectSide::left);
+    for (size_t i = 0; i < itemsRight.size(); ++i) addFileRef(itemsRight.getName(i), i, SelectSide::right);
+
+    auto equalCanonical = [&](const FileRef& lhs, const FileRef& rhs)
+    {
+        if (lhs.hash != rhs.hash)
+            return false;
+
+        const size_t len = getCanonicalLen(lhs);
+        if (len != getCanonicalLen(rhs))
+            return false;
+
+        if (lhs.canonicalOther && rhs.canonicalOther)
+            return *lhs.canonicalOther == *rhs.canonicalOther;
+
+        //at least one side is ASCII: e.g. "I" vs non-ASCII U+0131 (upper case is "I")
+        for (size_t pos = 0; pos < len; ++pos)
+            if (getCanonicalChar(lhs, pos) != getCanonicalChar(rhs, pos))
+                return false;
+        return true;
+    };
+
+    //same order as comparing trimCpy(getUpperCase(itemName)) strings
+    auto lessCanonical = [&](const FileRef& lhs, const FileRef& rhs)
+    {
+        const size_t lenL = getCanonicalLen(lhs);
+        const size_t lenR = getCanonicalLen(rhs);
+
+        for (size_t pos = 0; pos < std::min(lenL, lenR); ++pos)
+            if (const Zchar cL = getCanonicalChar(lhs, pos),
+                cR = getCanonicalChar(rhs, pos);
+                cL != cR)
+                return static_cast<std::make_unsigned_t<Zchar>>(cL) < static_cast<std::make_unsigned_t<Zchar>>(cR);
+        return lenL < lenR;
+    };
+
+    //group items by canonical name: open addressing, first item of each group is its head
+    {
+        size_t bucketCount = 16;
+        while (bucketCount < 2 * fileList.size())
+            bucketCount *= 2;
+        constexpr size_t noItem = static_cast<size_t>(-1);
+        std::vector<size_t> buckets(bucketCount, noItem);
+
+        for (size_t i = 0; i < fileList.size(); ++i)
+        {
+            FileRef& fr = fileList[i];
+            fr.nextEq = noItem;
+
+            for (size_t pos = fr.hash & (bucketCount - 1);; pos = (pos + 1) & (bucketCount - 1))
+                if (const size_t headIdx = buckets[pos];
+                    headIdx == noItem)
+                {
+                    buckets[pos] = i;
+                    fr.groupHead = true;
+                    fr.lastEq = i;
+                    break;
+                }
+                else if (FileRef& head = fileList[headIdx];
+                         equalCanonical(head, fr))
+                {
+                    fileList[head.lastEq].nextEq = i; //keep input order within group
+                    head.lastEq = i;
+                    break;
+                }
+        }
+    }
+
+    auto tryMatchGroup = [&](std::span<const size_t> group)
+    {
+        const size_t equalCountL = std::count_if(group.begin(), group.end(), [&](size_t i) { return fileList[i].side == SelectSide::left; });
+        const size_t equalCountR = group.size() - equalCountL;
+
+        if (equalCountL == 1 && equalCountR == 1) //we have a match
+            bo(fileList[group[0]].idx, fileList[group[1]].idx); //left items precede right ones in "fileList"
         else if (equalCountL == 1 && equalCountR == 0)
-            lo(*it->ref, nullptr);
+            lo(fileList[group[0]].idx, nullptr);
         else if (equalCountL == 0 && equalCountR == 1)
-            ro(*it->ref, nullptr);
+            ro(fileList[group[0]].idx, nullptr);
         else //ambiguous (yes, even if one side only, e.g. different Unicode normalization forms)
             return false;
         return true;
     };
 
-    for (auto it = fileList.begin(); it != fileList.end();)
+    //sort group heads only: canonical names are distinct => sequence is deterministic
+    std::vector<size_t> groupHeads;
+    for (size_t i = 0; i < fileList.size(); ++i)
+        if (fileList[i].groupHead)
+            groupHeads.push_back(i);
+
+    std::sort(groupHeads.begin(), groupHeads.end(), [&](size_t lhs, size_t rhs) { return lessCanonical(fileList[lhs], fileList[rhs]); });
+
+    std::vector<size_t> group;
+    std::vector<std::pair<Zstring, size_t>> groupNorm; //cache Unicode normal form: expensive!
+    std::vector<size_t> groupCase;
+
+    for (const size_t i : groupHeads)
     {
-        //find equal range: ignore upper/lower case, leading/trailing space, Unicode normal form
-        auto itEndEq = std::find_if(it + 1, fileList.end(), [&](const FileRef& fr) { return fr.canonicalName != it->canonicalName; });
-        if (!tryMatchRange(it, itEndEq))
+        group.clear();
+        for (size_t j = i; j != static_cast<size_t>(-1); j = fileList[j].nextEq)
+            group.push_back(j);
+
+        if (!tryMatchGroup(group))
         {
-            //secondary sort: respect case, ignore Unicode normal forms
-            std::sort(it, itEndEq, [](const FileRef& lhs, const FileRef& rhs) { return getUnicodeNormalForm(lhs.ref->first) < getUnicodeNormalForm(rhs.ref->first); });
+            //secondary grouping: respect case, ignore Unicode normal forms
+            groupNorm.clear();
+            for (const size_t j : group)
+                groupNorm.emplace_back(getUnicodeNormalForm(Zstring(fileList[j].itemName)), j);
 
-            for (auto itCase = it; itCase != itEndEq;)
+            std::stable_sort(groupNorm.begin(), groupNorm.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+            for (auto itCase = groupNorm.begin(); itCase != groupNorm.end();)
             {
-                //find equal range: respect case, ignore Unicode normal forms
-                auto itEndCase = std::find_if(itCase + 1, itEndEq, [&](const FileRef& fr) { return getUnicodeNormalForm(fr.ref->first) != getUnicodeNormalForm(itCase->ref->first); });
-                if (!tryMatchRange(itCase, itEndCase))
+                auto itEndCase = std::find_if(itCase + 1, groupNorm.end(), [&](const auto& item) { return item.first != itCase->first; });
+
+                groupCase.clear();
+                std::for_each(itCase, itEndCase, [&](const auto& item) { groupCase.push_back(item.second); });
+
+                if (!tryMatchGroup(groupCase))
                 {
-                    const Zstringc& conflictMsg = getConflictAmbiguousItemName(itCase->ref->first);
-                    std::for_each(itCase, itEndCase, [&](const FileRef& fr)
+                    const Zstringc& conflictMsg = getConflictAmbiguousItemName(Zstring(fileList[groupCase[0]].itemName));
+                    for (const size_t j : groupCase)
                     {
+                        const FileRef& fr = fileList[j];
                         if (fr.side == SelectSide::left)
-                            lo(*fr.ref, &conflictMsg);
+                            lo(fr.idx, &conflictMsg);
                         else
-                            ro(*fr.ref, &conflictMsg);
-                    });
+                            ro(fr.idx, &conflictMsg);
+                    }
                 }
                 itCase = itEndCase;
             }
         }
-        it = itEndEq;
     }
 }
 
 
-void MergeSides::mergeFolders(const FolderContainer& lhs, const FolderContainer& rhs, const Zstringc* errorMsg, ContainerObject& output)
+//context of worker thread
+void matchFolderPair(const FolderContainer& lhs, const FolderContainer& rhs, FolderMatch& match, ForkJoin& fj) //throw ?
 {
-    using FileData = FolderContainer::FileList::value_type;
-
-    matchFolders(lhs.files, rhs.files, [&](const FileData& fileLeft, const Zstringc* conflictMsg)
-    {
-        FilePair& newItem = output.addFile<SelectSide::left>(fileLeft.first, fileLeft.second);
-        checkFailedRead(newItem, conflictMsg ? conflictMsg : errorMsg);
-    },
-    [&](const FileData& fileRight, const Zstringc* conflictMsg)
+    auto matchItems = [](const auto& itemsL, const auto& itemsR, std::vector<FolderMatch::ItemMatch>& output)
     {
-        FilePair& newItem = output.addFile<SelectSide::right>(fileRight.first, fileRight.second);
-        checkFailedRead(newItem, conflictMsg ? conflictMsg : errorMsg);
-    },
-    [&](const FileData& fileLeft, const FileData& fileRight)
-    {
-        FilePair& newItem = output.addFile(fileLeft.first,
-                                           fileLeft.second,
-                                           fileRight.first,
-                                           fileRight.second);
-        if (!checkFailedRead(newItem, errorMsg))
-            undefinedFiles_.push_back(&newItem);
-        static_assert(std::is_same_v<ContainerObject::FileList, std::list<FilePair>>); //ContainerObject::addFile() must NOT invalidate references used in "undefinedFiles"!
-    });
+        output.reserve(std::max(itemsL.size(), itemsR.size()));
 
-    //-----------------------------------------------------------------------------------------------
-    using SymlinkData = FolderContainer::SymlinkList::value_type;
+        matchFolders(itemsL, itemsR,
+        [&](size_t idxL, const Zstringc* conflictMsg) { output.push_back({idxL, FolderMatch::NO_ITEM, conflictMsg ? *conflictMsg : Zstringc()}); },
+        [&](size_t idxR, const Zstringc* conflictMsg) { output.push_back({FolderMatch::NO_ITEM, idxR, conflictMsg ? *conflictMsg : Zstringc()}); },
+        [&](size_t idxL, size_t idxR)                 { output.push_back({idxL, idxR}); });
+    };
+    matchItems(lhs.refFiles   (), rhs.refFiles   (), match.files);
+    matchItems(lhs.refSymlinks(), rhs.refSymlinks(), match.symlinks);
+    matchItems(lhs.refFolders (), rhs.refFolders (), match.folders);
 
-    matchFolders(lhs.symlinks, rhs.symlinks, [&](const SymlinkData& symlinkLeft, const Zstringc* conflictMsg)
-    {
-        SymlinkPair& newItem = output.addLink<SelectSide::left>(symlinkLeft.first, symlinkLeft.second);
-        checkFailedRead(newItem, conflictMsg ? conflictMsg : errorMsg);
-    },
-    [&](const SymlinkData& symlinkRight, const Zstringc* conflictMsg)
+    //create all sub-results before scheduling: must not reallocate while worker threads are writing!
+    match.subFolders.resize(std::count_if(match.folders.begin(), match.folders.end(), [](const FolderMatch::ItemMatch& im)
+    { return im.idxL != FolderMatch::NO_ITEM && im.idxR != FolderMatch::NO_ITEM; }));
+
+    //small folders: task overhead exceeds matching time => bundle into tasks of at least TASK_ITEMS_MIN items
+    constexpr size_t TASK_ITEMS_MIN = 1000;
+    struct SubTask
     {
-        SymlinkPair& newItem = output.addLink<SelectSide::right>(symlinkRight.first, symlinkRight.second);
-        checkFailedRead(newItem, conflictMsg ? conflictMsg : errorMsg);
-    },
-    [&](const SymlinkData& symlinkLeft, const SymlinkData& symlinkRight) //both sides
+        const FolderContainer* lhs;
+        const FolderContainer* rhs;
+        FolderMatch* match;
+    };
+    std::vector<SubTask> batch;
+    size_t batchItems = 0;
+
+    auto itSub = match.subFolders.begin();
+    for (const FolderMatch::ItemMatch& im : match.folders)
+        if (im.idxL != FolderMatch::NO_ITEM && im.idxR != FolderMatch::NO_ITEM)
+        {
+            const FolderContainer& subL = lhs.getSubFolder(im.idxL);
+            const FolderContainer& subR = rhs.getSubFolder(im.idxR);
+            batch.push_back({&subL, &subR, &*itSub++});
+            batchItems += subL.refFiles().size() + subL.refSymlinks().size() + subL.refFolders().size() +
+                          subR.refFiles().size() + subR.refSymlinks().size() + subR.refFolders().size();
+
+            if (batchItems >= TASK_ITEMS_MIN)
+            {
+                fj.run([&fj, batch = std::move(batch)]
+                {
+                    for (const SubTask& st : batch)
+                        matchFolderPair(*st.lhs, *st.rhs, *st.match, fj); //throw ?
+                });
+                batch.clear();
+                batchItems = 0;
+            }
+        }
+
+    for (const SubTask& st : batch) //remainder: not worth a task => e.g. no thread creation for small folder trees
+        matchFolderPair(*st.lhs, *st.rhs, *st.match, fj); //recurse; throw ?
+}
+
+
+void MergeSides::execute(const FolderContainer& lhs, const FolderContainer& rhs,
+                         const std::unordered_map<Zstring, Zstringc>& errorsByRelPathL,
+                         const std::unordered_map<Zstring, Zstringc>& errorsByRelPathR,
+                         ContainerObject& output,
+                         std::vector<FilePair*>& undefinedFilesOut,
+                         std::vector<SymlinkPair*>& undefinedSymlinksOut)
+{
+    FolderMatch match;
     {
-        SymlinkPair& newItem = output.addLink(symlinkLeft.first,
-                                              symlinkLeft.second,
-                                              symlinkRight.first,
-                                              symlinkRight.second);
-        if (!checkFailedRead(newItem, errorMsg))
-            undefinedSymlinks_.push_back(&newItem);
-    });
+        ForkJoin fj(Zstr("Match folders")); //manage life time: destroy *before* "match"!
+        matchFolderPair(lhs, rhs, match, fj); //throw ?
+        fj.wait();                            //
+    }
+
+    MergeSides inst(errorsByRelPathL, errorsByRelPathR, undefinedFilesOut, undefinedSymlinksOut);
+
+    const Zstringc* errorMsg = nullptr;
+    if (auto it = inst.errorsByRelPathL_.find(Zstring()); //empty path if read-error for whole base directory
+        it != inst.errorsByRelPathL_.end())
+        errorMsg = &it->second;
+    else if (auto it2 = inst.errorsByRelPathR_.find(Zstring());
+             it2 != inst.errorsByRelPathR_.end())
+        errorMsg = &it2->second;
+
+    inst.mergeFolders(lhs, rhs, match, errorMsg, output);
+}
+
+
+void MergeSides::mergeFolders(const FolderContainer& lhs, const FolderContainer& rhs, const FolderMatch& match, const Zstringc* errorMsg, ContainerObject& output)
+{
+    for (const FolderMatch::ItemMatch& im : match.files)
+        if (im.idxR == FolderMatch::NO_ITEM)
+        {
+            FilePair& newItem = output.addFile<SelectSide::left>(Zstring(lhs.refFiles().getName(im.idxL)), lhs.refFiles().getAttr(im.idxL));
+            checkFailedRead(newItem, !im.conflictMsg.empty() ? &im.conflictMsg : errorMsg);
+        }
+        else if (im.idxL == FolderMatch::NO_ITEM)
+        {
+            FilePair& newItem = output.addFile<SelectSide::right>(Zstring(rhs.refFiles().getName(im.idxR)), rhs.refFiles().getAttr(im.idxR));
+            checkFailedRead(newItem, !im.conflictMsg.empty() ? &im.conflictMsg : errorMsg);
+        }
+        else
+        {
+            FilePair& newItem = output.addFile(Zstring(lhs.refFiles().getName(im.idxL)),
+                                               lhs.refFiles().getAttr(im.idxL),
+                                               Zstring(rhs.refFiles().getName(im.idxR)),
+                                               rhs.refFiles().getAttr(im.idxR));
+            if (!checkFailedRead(newItem, errorMsg))
+                undefinedFiles_.push_back(&newItem);
+            static_assert(std::is_same_v<ContainerObject::FileList, std::pmr::list<FilePair>>); //ContainerObject::addFile() must NOT invalidate references used in "undefinedFiles"!
+        }
 
     //-----------------------------------------------------------------------------------------------
-    using FolderData = FolderContainer::FolderList::value_type;
+    for (const FolderMatch::ItemMatch& im : match.symlinks)
+        if (im.idxR == FolderMatch::NO_ITEM)
+        {
+            SymlinkPair& newItem = output.addLink<SelectSide::left>(Zstring(lhs.refSymlinks().getName(im.idxL)), lhs.refSymlinks().getAttr(im.idxL));
+            checkFailedRead(newItem, !im.conflictMsg.empty() ? &im.conflictMsg : errorMsg);
+        }
+        else if (im.idxL == FolderMatch::NO_ITEM)
+        {
+            SymlinkPair& newItem = output.addLink<SelectSide::right>(Zstring(rhs.refSymlinks().getName(im.idxR)), rhs.refSymlinks().getAttr(im.idxR));
+            checkFailedRead(newItem, !im.conflictMsg.empty() ? &im.conflictMsg : errorMsg);
+        }
+        else
+        {
+            SymlinkPair& newItem = output.addLink(Zstring(lhs.refSymlinks().getName(im.idxL)),
+                                                  lhs.refSymlinks().getAttr(im.idxL),
+                                                  Zstring(rhs.refSymlinks().getName(im.idxR)),
+                                                  rhs.refSymlinks().getAttr(im.idxR));
+            if (!checkFailedRead(newItem, errorMsg))
+                undefinedSymlinks_.push_back(&newItem);
+        }
 
-    matchFolders(lhs.folders, rhs.folders, [&](const FolderData& dirLeft, const Zstringc* conflictMsg)
-    {
-        FolderPair& newFolder = output.addFolder<SelectSide::left>(dirLeft.first, dirLeft.second.first);
-        const Zstringc* errorMsgNew = checkFailedRead(newFolder, conflictMsg ? conflictMsg : errorMsg);
-        this->fillOneSide<SelectSide::left>(dirLeft.second.second, errorMsgNew, newFolder); //recurse
-    },
-    [&](const FolderData& dirRight, const Zstringc* conflictMsg)
-    {
-        FolderPair& newFolder = output.addFolder<SelectSide::right>(dirRight.first, dirRight.second.first);
-        const Zstringc* errorMsgNew = checkFailedRead(newFolder, conflictMsg ? conflictMsg : errorMsg);
-        this->fillOneSide<SelectSide::right>(dirRight.second.second, errorMsgNew, newFolder); //recurse
-    },
-    [&](const FolderData& dirLeft, const FolderData& dirRight)
-    {
-        FolderPair& newFolder = output.addFolder(dirLeft.first, dirLeft.second.first, dirRight.first, dirRight.second.first);
-        const Zstringc* errorMsgNew = checkFailedRead(newFolder, errorMsg);
-        mergeFolders(dirLeft.second.second, dirRight.second.second, errorMsgNew, newFolder); //recurse
-    });
+    //-----------------------------------------------------------------------------------------------
+    auto itSub = match.subFolders.begin();
+    for (const FolderMatch::ItemMatch& im : match.folders)
+        if (im.idxR == FolderMatch::NO_ITEM)
+        {
+            FolderPair& newFolder = output.addFolder<SelectSide::left>(Zstring(lhs.refFolders().getName(im.idxL)), lhs.refFolders().getAttr(im.idxL));
+            const Zstringc* errorMsgNew = checkFailedRead(newFolder, !im.conflictMsg.empty() ? &im.conflictMsg : errorMsg);
+            fillOneSide<SelectSide::left>(lhs.getSubFolder(im.idxL), errorMsgNew, newFolder); //recurse
+        }
+        else if (im.idxL == FolderMatch::NO_ITEM)
+        {
+            FolderPair& newFolder = output.addFolder<SelectSide::right>(Zstring(rhs.refFolders().getName(im.idxR)), rhs.refFolders().getAttr(im.idxR));
+            const Zstringc* errorMsgNew = checkFailedRead(newFolder, !im.conflictMsg.empty() ? &im.conflictMsg : errorMsg);
+            fillOneSide<SelectSide::right>(rhs.getSubFolder(im.idxR), errorMsgNew, newFolder); //recurse
+        }
+        else
+        {
+            FolderPair& newFolder = output.addFolder(Zstring(lhs.refFolders().getName(im.idxL)), lhs.refFolders().getAttr(im.idxL),
+                                                     Zstring(rhs.refFolders().getName(im.idxR)), rhs.refFolders().getAttr(im.idxR));
+            const Zstringc* errorMsgNew = checkFailedRead(newFolder, errorMsg);
+            mergeFolders(lhs.getSubFolder(im.idxL), rhs.getSubFolder(im.idxR), *itSub++, errorMsgNew, newFolder); //recurse
+        }
+    assert(itSub == match.subFolders.end());
 }
 
 //-----------------------------------------------------------------------------------------------
@@ -928,7 +1445,7 @@ void stripExcludedDirectories(ContainerObject& conObj, const PathFilter& filter)
     /*  remove superfluous directories:
             this does not invalidate "std::vector<FilePair*>& undefinedFiles", since we delete folders only
             and there is no side-effect for memory positions of FilePair and SymlinkPair thanks to std::list!     */
-    static_assert(std::is_same_v<std::list<FolderPair>, ContainerObject::FolderList>);
+    static_assert(std::is_same_v<std::pmr::list<FolderPair>, ContainerObject::FolderList>);
 
     conObj.refSubFolders().remove_if([&](FolderPair& folder)
     {
@@ -1056,11 +1573,14 @@ SharedRef<BaseFolderPair> ComparisonBuffer::performComparison(const ResolvedFold
 
 FolderComparison fff::compare(WarningDialogs& warnings,
                               int fileTimeTolerance,
+                              bool contentHashCache,
                               const AFS::RequestPasswordFun& requestPassword /*throw X*/,
                               bool runWithBackgroundPriority,
                               bool createDirLocks,
                               std::unique_ptr<LockHolder>& dirLocks,
                               const std::vector<FolderPairCfg>& fpCfgList,
+                              const std::map<AfsDevice, size_t>& deviceParallelOps,
+                              const std::vector<Zstring>& changedItemPaths,
                               ProcessCallback& callback /*throw X*/) //throw X
 {
     //indicator at the very beginning of the log to make sense of "total time"
@@ -1163,8 +1683,8 @@ FolderComparison fff::compare(WarningDialogs& warnings,
         //reduce peak memory by restricting lifetime of ComparisonBuffer to have ended when loading potentially huge InSyncFolder instance in redetermineSyncDirection()
         {
             //------------------- fill directory buffer: traverse/read folders --------------------------
-            ComparisonBuffer cmpBuf(resInfo.baseFolderStatus,
-                                    fileTimeTolerance, callback);
+            ComparisonBuffer cmpBuf(resInfo.baseFolderStatus, deviceParallelOps,
+                                    fileTimeTolerance, contentHashCache, changedItemPaths, callback);
             //PERF_START;
             output = cmpBuf.execute(workLoad);
             //PERF_STOP;
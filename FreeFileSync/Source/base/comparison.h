@@ -49,11 +49,14 @@ std::vector<FolderPairCfg> extractCompareCfg(const MainConfiguration& mainCfg);
 //FFS core routine:     output.size() == fpCfgList.size() or 0 on fatal error
 FolderComparison compare(WarningDialogs& warnings,
                          int fileTimeTolerance,
+                         bool contentHashCache, //persistent digests for "compare by content", see hash_cache.h
                          const AFS::RequestPasswordFun& requestPassword /*throw X*/,
                          bool runWithBackgroundPriority,
                          bool createDirLocks,
                          std::unique_ptr<LockHolder>& dirLocks, //out
                          const std::vector<FolderPairCfg>& fpCfgList,
+                         const std::map<AfsDevice, size_t>& deviceParallelOps,
+                         const std::vector<Zstring>& changedItemPaths, //optional: partial comparison based on sync.ffs_db; native paths of *all* items changed since last sync
                          ProcessCallback& callback /*throw X*/); //throw X
 }
 
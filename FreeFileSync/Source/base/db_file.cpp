@@ -6,10 +6,13 @@
 
 #include "db_file.h"
 #include <bit> //std::endian
+#include <deque>
 #include <zen/guid.h>
 #include <zen/crc.h>
 #include <zen/build_info.h>
 #include <zen/zlib_wrap.h>
+#include <zen/zstd_wrap.h>
+#include <zen/thread.h>
 #include "../afs/concrete.h"
 #include "../afs/native.h"
 #include "status_handler_impl.h"
@@ -24,7 +27,7 @@ namespace
 //-------------------------------------------------------------------------------------------------------------------------------
 const char DB_FILE_DESCR[] = "FreeFileSync";
 const int DB_FILE_VERSION   = 11; //2020-02-07
-const int DB_STREAM_VERSION =  5; //2023-07-29
+const int DB_STREAM_VERSION =  6; //2026-10-16
 //-------------------------------------------------------------------------------------------------------------------------------
 
 struct SessionData
@@ -197,132 +200,791 @@ DbStreams loadStreams(const AbstractPath& dbPath, const IoCallback& notifyUnbuff
 
 //#######################################################################################################################################
 
+/* stream format v6: random access to folder records => decode only the subtrees actually visited (see InSyncFolder::refFiles())
+    - folder records written in post-order: child record positions are known when writing the parent
+    - records are packed into blocks of DB_BLOCK_SIZE_RAW (each compressed separately) + block table for direct access
+    - append-only journal => small changes don't require re-encoding the whole database
+    - journal chunk: changes of one sync (compressed); applied in order on top of the folder records while loading
+    - compaction once the journal grows beyond DB_JOURNAL_MAX_RATIO of the folder records: re-encode decoded folders only,
+      undecoded sub trees keep their blocks (same block index, compressed data copied), unused blocks are left empty
+      => full rewrite once most blocks are empty: DB_EMPTY_BLOCKS_MAX_RATIO
+    - blocks and journal chunks are compressed independently => (de-)compressed in parallel, codec stated in stream header
+
+    stream layout:  uint8 codec | uint32 blockCount | uint32 journalCount | uint32 compressed size (per block, then per journal chunk) |
+                    root record position | compressed blocks | compressed journal chunks
+    folder record:  item counts | item names (sorted) | file attributes | symlink attributes | child record positions + first block of sub tree + complete flags
+    journal entry:  operation | parent folder names | item name | attributes (if any)                                  */
+const size_t DB_BLOCK_SIZE_RAW = 128 * 1024; //granularity of lazy loading <-> compression ratio <-> parallelism
+const double DB_JOURNAL_MAX_RATIO = 0.5;
+const double DB_EMPTY_BLOCKS_MAX_RATIO = 0.5;
+const uint32_t DB_BLOCK_IDX_NONE = std::numeric_limits<uint32_t>::max();
+
+enum class DbBlockCodec : uint8_t //all blocks and journal chunks of a stream
+{
+    zstd,
+};
+const DbBlockCodec DB_BLOCK_CODEC = DbBlockCodec::zstd; //for writing
+
+struct DbRecordPos
+{
+    uint32_t blockIdx = 0;
+    uint32_t offset   = 0;
+};
+
+//post-order => records of a sub tree written in one go are adjacent: no other blocks needed to decode it
+struct DbSubTreePos
+{
+    DbRecordPos pos; //record of sub tree root (= last record)
+    uint32_t firstBlockIdx = DB_BLOCK_IDX_NONE; //sub tree records in blocks [firstBlockIdx, pos.blockIdx] (if known)
+};
+
+
+struct DbStreamLayout
+{
+    std::string buf; //combined stream of left and right database file
+    DbBlockCodec codec = DB_BLOCK_CODEC;
+    std::vector<std::pair<size_t /*offset*/, size_t /*size*/>> blocks;
+    std::vector<std::pair<size_t /*offset*/, size_t /*size*/>> journal;
+    DbRecordPos rootPos;
+
+    std::string_view getData(const std::pair<size_t, size_t>& part) const { return std::string_view(buf).substr(part.first, part.second); }
+};
+
+
+DbStreamLayout parseStreamLayout(std::string&& buf) //throw SysError
+{
+    DbStreamLayout layout{.buf = std::move(buf)};
+    MemoryStreamIn streamIn(layout.buf);
+
+    const auto codec = readNumber<uint8_t>(streamIn); //throw SysErrorUnexpectedEos
+    if (codec != static_cast<uint8_t>(DbBlockCodec::zstd))
+        throw SysError(_("Unsupported data format.") + L" (codec " + numberTo<std::wstring>(codec) + L')');
+    layout.codec = static_cast<DbBlockCodec>(codec);
+
+    const size_t blockCount   = readNumber<uint32_t>(streamIn); //throw SysErrorUnexpectedEos
+    const size_t journalCount = readNumber<uint32_t>(streamIn); //
+
+    if (blockCount + journalCount > layout.buf.size() / sizeof(uint32_t)) //catch data corruption before std::bad_alloc
+        throw SysError(_("File content is corrupted.") + L" (invalid block count)");
+
+    std::vector<uint32_t> partSizes(blockCount + journalCount);
+    for (uint32_t& partSize : partSizes)
+        partSize = readNumber<uint32_t>(streamIn); //throw SysErrorUnexpectedEos
+
+    layout.rootPos.blockIdx = readNumber<uint32_t>(streamIn); //throw SysErrorUnexpectedEos
+    layout.rootPos.offset   = readNumber<uint32_t>(streamIn); //
+
+    size_t partOffset = streamIn.pos();
+    for (size_t i = 0; i < partSizes.size(); ++i)
+    {
+        (i < blockCount ? layout.blocks : layout.journal).emplace_back(partOffset, partSizes[i]);
+        partOffset += partSizes[i];
+    }
+    if (partOffset != layout.buf.size())
+        throw SysError(_("File content is corrupted.") + L" (invalid block table)");
+
+    return layout;
+}
+
+
+std::string serializeStreamLayout(const std::vector<std::string_view>& blocks, const std::vector<std::string_view>& journal, const DbRecordPos& rootPos)
+{
+    MemoryStreamOut streamOut;
+    writeNumber(streamOut, static_cast<uint8_t>(DB_BLOCK_CODEC));
+    writeNumber(streamOut, static_cast<uint32_t>(blocks .size()));
+    writeNumber(streamOut, static_cast<uint32_t>(journal.size()));
+
+    for (const std::string_view& block : blocks)
+        writeNumber(streamOut, static_cast<uint32_t>(block.size()));
+    for (const std::string_view& chunk : journal)
+        writeNumber(streamOut, static_cast<uint32_t>(chunk.size()));
+
+    writeNumber<uint32_t>(streamOut, rootPos.blockIdx);
+    writeNumber<uint32_t>(streamOut, rootPos.offset);
+
+    for (const std::string_view& block : blocks)
+        writeArray(streamOut, block.data(), block.size());
+    for (const std::string_view& chunk : journal)
+        writeArray(streamOut, chunk.data(), chunk.size());
+
+    return std::move(streamOut.ref());
+}
+
+
+//distribute combined stream over lead and non-lead stream
+void splitCombinedStream(const std::string& buf, bool leadStreamLeft, std::string& streamL, std::string& streamR)
+{
+    MemoryStreamOut outL;
+    MemoryStreamOut outR;
+    //save format version
+    writeNumber<int32_t>(outL, DB_STREAM_VERSION);
+    writeNumber<int32_t>(outR, DB_STREAM_VERSION);
+
+    MemoryStreamOut& outPart1 = leadStreamLeft ? outL : outR;
+    MemoryStreamOut& outPart2 = leadStreamLeft ? outR : outL;
+
+    const size_t sizePart1 = buf.size() / 2;
+    const size_t sizePart2 = buf.size() - sizePart1;
+
+    writeNumber<uint64_t>(outPart1, sizePart1);
+    writeNumber<uint64_t>(outPart2, sizePart2);
+
+    if (sizePart1 > 0) writeArray(outPart1, buf.c_str(), sizePart1);
+    if (sizePart2 > 0) writeArray(outPart2, buf.c_str() + sizePart1, sizePart2);
+
+    streamL = std::move(outL.ref());
+    streamR = std::move(outR.ref());
+}
+
+
+std::string readCombinedStream(bool leadStreamLeft, MemoryStreamIn& streamInL, MemoryStreamIn& streamInR) //throw SysErrorUnexpectedEos
+{
+    MemoryStreamIn& streamInPart1 = leadStreamLeft ? streamInL : streamInR;
+    MemoryStreamIn& streamInPart2 = leadStreamLeft ? streamInR : streamInL;
+
+    const size_t sizePart1 = static_cast<size_t>(readNumber<uint64_t>(streamInPart1));
+    const size_t sizePart2 = static_cast<size_t>(readNumber<uint64_t>(streamInPart2));
+
+    std::string buf(sizePart1 + sizePart2, '\0');
+    if (sizePart1 > 0) readArray(streamInPart1, buf.data(),             sizePart1); //throw SysErrorUnexpectedEos
+    if (sizePart2 > 0) readArray(streamInPart2, buf.data() + sizePart1, sizePart2); //
+    return buf;
+}
+
+
+std::string compressDbBlock(const std::string_view& buf) //throw SysError
+{
+    static_assert(DB_BLOCK_CODEC == DbBlockCodec::zstd);
+    return compressZstd(buf, 3 /*level: zstd default*/); //throw SysError
+}
+
+
+std::string decompressDbBlock(DbBlockCodec codec, const std::string_view& buf) //throw SysError
+{
+    switch (codec)
+    {
+        case DbBlockCodec::zstd:
+            return decompressZstd(buf); //throw SysError
+    }
+    throw SysError(_("Unsupported data format.") + L" (codec " + numberTo<std::wstring>(static_cast<int>(codec)) + L')');
+}
+
+
+void writeFileDescr(MemoryStreamOut& streamOut, const InSyncDescrFile& descr)
+{
+    writeNumber<int64_t         >(streamOut, descr.modTime);
+    writeNumber<AFS::FingerPrint>(streamOut, descr.filePrint);
+    static_assert(sizeof(descr.modTime) <= sizeof(int64_t)); //ensure cross-platform compatibility!
+}
+
+
+InSyncDescrFile readFileDescr(MemoryStreamIn& streamIn) //throw SysErrorUnexpectedEos
+{
+    const auto modTime = static_cast<time_t>(readNumber<int64_t>(streamIn)); //throw SysErrorUnexpectedEos
+    const auto filePrint = readNumber<AFS::FingerPrint>(streamIn);           //
+    return {modTime, filePrint};
+}
+
+
+void writeItemName(MemoryStreamOut& streamOut, const Zstring& itemName) { writeContainer(streamOut, utfTo<std::string>(itemName)); }
+
+Zstring readItemName(MemoryStreamIn& streamIn) { return utfTo<Zstring>(readContainer<std::string>(streamIn)); } //throw SysErrorUnexpectedEos
+
+
+enum class DbJournalOp : uint8_t
+{
+    setFile,
+    removeFile,
+    setSymlink,
+    removeSymlink,
+    addFolder,
+    removeFolder,
+    setFolderComplete,
+};
+
+//record changes of LastSynchronousStateUpdater
+class DbJournal
+{
+public:
+    explicit DbJournal(bool leadStreamLeft) : leadStreamLeft_(leadStreamLeft) {}
+
+    void setFile(const Zstring& parentRelPath, const Zstring& fileName, const InSyncFile& file)
+    {
+        writeOp(DbJournalOp::setFile, parentRelPath, fileName);
+        writeNumber(streamOut_, static_cast<int32_t>(file.cmpVar));
+        writeNumber<uint64_t>(streamOut_, file.fileSize);
+        writeFileDescr(streamOut_, leadStreamLeft_ ? file.left  : file.right);
+        writeFileDescr(streamOut_, leadStreamLeft_ ? file.right : file.left);
+    }
+
+    void setSymlink(const Zstring& parentRelPath, const Zstring& linkName, const InSyncSymlink& symlink)
+    {
+        writeOp(DbJournalOp::setSymlink, parentRelPath, linkName);
+        writeNumber(streamOut_, static_cast<int32_t>(symlink.cmpVar));
+        writeNumber<int64_t>(streamOut_, (leadStreamLeft_ ? symlink.left  : symlink.right).modTime);
+        writeNumber<int64_t>(streamOut_, (leadStreamLeft_ ? symlink.right : symlink.left ).modTime);
+    }
+
+    void removeFile   (const Zstring& parentRelPath, const Zstring& itemName) { writeOp(DbJournalOp::removeFile,    parentRelPath, itemName); }
+    void removeSymlink(const Zstring& parentRelPath, const Zstring& itemName) { writeOp(DbJournalOp::removeSymlink, parentRelPath, itemName); }
+    void addFolder    (const Zstring& parentRelPath, const Zstring& itemName) { writeOp(DbJournalOp::addFolder,     parentRelPath, itemName); }
+    void removeFolder (const Zstring& parentRelPath, const Zstring& itemName) { writeOp(DbJournalOp::removeFolder,  parentRelPath, itemName); }
+
+    void setFolderComplete(const Zstring& parentRelPath, const Zstring& folderName, bool complete)
+    {
+        writeOp(DbJournalOp::setFolderComplete, parentRelPath, folderName);
+        writeNumber<uint8_t>(streamOut_, complete);
+    }
+
+    const std::string& ref() const { return streamOut_.ref(); }
+
+private:
+    void writeOp(DbJournalOp op, const Zstring& parentRelPath, const Zstring& itemName)
+    {
+        //store path components: don't depend on FILE_NAME_SEPARATOR of the current platform
+        const std::vector<Zstring> parentNames = splitCpy(parentRelPath, FILE_NAME_SEPARATOR, SplitOnEmpty::skip);
+
+        writeNumber(streamOut_, static_cast<uint8_t>(op));
+        writeNumber(streamOut_, static_cast<uint32_t>(parentNames.size()));
+        for (const Zstring& folderName : parentNames)
+            writeItemName(streamOut_, folderName);
+        writeItemName(streamOut_, itemName);
+    }
+
+    const bool leadStreamLeft_;
+    MemoryStreamOut streamOut_;
+};
+
+//undecoded folder of "layout" with known sub tree blocks: content unchanged => copy blocks instead of re-encoding
+std::optional<DbSubTreePos> getUnchangedSubTree(const InSyncFolder& folder, const DbStreamLayout& layout); //see InSyncFolderLoader
+
+//#######################################################################################################################################
+
 class StreamGenerator
 {
 public:
+    //oldLayout: stream "dbFolder" was loaded from => copy blocks of undecoded sub trees (keep lead stream!); nullptr: full rewrite
     static void execute(const InSyncFolder& dbFolder, //throw FileError
+                        const DbStreamLayout* oldLayout, bool leadStreamLeft,
                         const std::wstring& displayFilePathL, //used for diagnostics only
                         const std::wstring& displayFilePathR,
                         std::string& streamL,
                         std::string& streamR)
     {
-        MemoryStreamOut outL;
-        MemoryStreamOut outR;
-        //save format version
-        writeNumber<int32_t>(outL, DB_STREAM_VERSION);
-        writeNumber<int32_t>(outR, DB_STREAM_VERSION);
+        StreamGenerator generator(oldLayout, leadStreamLeft);
+        std::vector<std::string_view> blocks;
+        DbRecordPos rootPos;
+        try
+        {
+            //PERF_START
+            rootPos = generator.recurse(dbFolder).pos;
+            generator.flushBlock();
+            generator.compressGroup_.wait();
+            //PERF_STOP
+
+            if (oldLayout) //same block index for copied records: leave unused blocks empty
+                for (size_t i = 0; i < oldLayout->blocks.size(); ++i)
+                    blocks.push_back(generator.copiedBlocks_[i] ? oldLayout->getData(oldLayout->blocks[i]) : std::string_view());
 
-        auto compStream = [&](const std::string& stream) //throw FileError
+            for (const DbBlock& block : generator.blocks_)
+            {
+                if (block.error)
+                    throw *block.error; //throw SysError
+                blocks.push_back(block.buf);
+            }
+        }
+        catch (const SysError& e)
         {
+            throw FileError(replaceCpy(_("Cannot write file %x."), L"%x", fmtPath(displayFilePathL + L"/" + displayFilePathR)), e.toString());
+        }
+
+        splitCombinedStream(serializeStreamLayout(blocks, {} /*journal*/, rootPos),
+                            leadStreamLeft, streamL, streamR);
+    }
+
+    //keep the existing folder records and journal: only compress the new changes
+    //returns false if compaction is due: => execute()
+    static bool appendJournal(const DbStreamLayout& layout, bool leadStreamLeft, const DbJournal& journal, //throw FileError
+                              const std::wstring& displayFilePathL, //used for diagnostics only
+                              const std::wstring& displayFilePathR,
+                              std::string& streamL,
+                              std::string& streamR)
+    {
+        if (layout.codec != DB_BLOCK_CODEC) //blocks of a stream share the same codec
+            return false;
+
+        std::vector<std::string_view> blocks;
+        std::vector<std::string_view> journalChunks;
+
+        for (const auto& block : layout.blocks)
+            blocks.push_back(layout.getData(block));
+        for (const auto& chunk : layout.journal)
+            journalChunks.push_back(layout.getData(chunk));
+
+        std::string newChunk;
+        if (!journal.ref().empty()) //no changes: reproduce old stream
             try
             {
-                /* Zlib: optimal level - test case 1 million files
-                level|size [MB]|time [ms]
-                  0    49.54      272 (uncompressed)
-                  1    14.53     1013
-                  2    14.13     1106
-                  3    13.76     1288 - best compromise between speed and compression
-                  4    13.20     1526
-                  5    12.73     1916
-                  6    12.58     2765
-                  7    12.54     3633
-                  8    12.51     9032
-                  9    12.50    19698 (maximal compression) */
-                return compress(stream, 3 /*level*/); //throw SysError
+                newChunk = compressDbBlock(journal.ref()); //throw SysError
+                journalChunks.push_back(newChunk);
             }
             catch (const SysError& e)
             {
                 throw FileError(replaceCpy(_("Cannot write file %x."), L"%x", fmtPath(displayFilePathL + L"/" + displayFilePathR)), e.toString());
             }
+
+        const auto sumSize = [](const std::vector<std::string_view>& parts)
+        {
+            size_t total = 0;
+            for (const std::string_view& part : parts)
+                total += part.size();
+            return total;
+        };
+        if (sumSize(journalChunks) > sumSize(blocks) * DB_JOURNAL_MAX_RATIO)
+            return false;
+
+        splitCombinedStream(serializeStreamLayout(blocks, journalChunks, layout.rootPos),
+                            leadStreamLeft, streamL, streamR);
+        return true;
+    }
+
+private:
+    StreamGenerator(const DbStreamLayout* oldLayout, bool leadStreamLeft) :
+        oldLayout_(oldLayout),
+        leadStreamLeft_(leadStreamLeft),
+        blockIdxBase_(oldLayout ? static_cast<uint32_t>(oldLayout->blocks.size()) : 0),
+        copiedBlocks_(blockIdxBase_),
+        compressGroup_(std::max(std::thread::hardware_concurrency(), 1U), Zstr("Compress sync.ffs_db")) {}
+
+    DbSubTreePos recurse(const InSyncFolder& container)
+    {
+        if (oldLayout_)
+            if (const std::optional<DbSubTreePos> oldPos = getUnchangedSubTree(container, *oldLayout_))
+            {
+                std::fill(copiedBlocks_.begin() + oldPos->firstBlockIdx, copiedBlocks_.begin() + oldPos->pos.blockIdx + 1, true);
+                return *oldPos;
+            }
+
+        //sort by name: stream content independent from hash table order
+        auto getSortedItems = [](const auto& itemList)
+        {
+            std::vector<const typename std::decay_t<decltype(itemList)>::value_type*> items;
+            items.reserve(itemList.size());
+            for (const auto& item : itemList)
+                items.push_back(&item);
+
+            std::sort(items.begin(), items.end(), [](const auto* lhs, const auto* rhs) { return lhs->first.normStr < rhs->first.normStr; });
+            return items;
         };
+        const auto files    = getSortedItems(container.refFiles   ());
+        const auto symlinks = getSortedItems(container.refSymlinks());
+        const auto folders  = getSortedItems(container.refFolders ());
+
+        std::vector<DbSubTreePos> childPos;
+        childPos.reserve(folders.size());
+        for (const auto& item : folders)
+            childPos.push_back(recurse(item->second));
 
-        StreamGenerator generator;
-        //PERF_START
-        generator.recurse(dbFolder);
-        //PERF_STOP
+        if (blockOut_.ref().size() >= DB_BLOCK_SIZE_RAW)
+            flushBlock();
 
-        const std::string bufText     = compStream(generator.streamOutText_    .ref());
-        const std::string bufSmallNum = compStream(generator.streamOutSmallNum_.ref());
-        const std::string bufBigNum   = compStream(generator.streamOutBigNum_  .ref());
+        const DbRecordPos pos{blockIdxBase_ + static_cast<uint32_t>(blocks_.size()), static_cast<uint32_t>(blockOut_.ref().size())};
 
-        MemoryStreamOut streamOut;
-        writeContainer(streamOut, bufText);
-        writeContainer(streamOut, bufSmallNum);
-        writeContainer(streamOut, bufBigNum);
+        //sub tree records adjacent only if all written now
+        const bool subTreeWrittenNow = std::all_of(childPos.begin(), childPos.end(), [&](const DbSubTreePos& cp)
+        {
+            return cp.firstBlockIdx != DB_BLOCK_IDX_NONE && cp.firstBlockIdx >= blockIdxBase_;
+        });
+        const uint32_t firstBlockIdx = !subTreeWrittenNow ? DB_BLOCK_IDX_NONE : childPos.empty() ? pos.blockIdx : childPos[0].firstBlockIdx;
+
+        writeNumber(blockOut_, static_cast<uint32_t>(files   .size()));
+        writeNumber(blockOut_, static_cast<uint32_t>(symlinks.size()));
+        writeNumber(blockOut_, static_cast<uint32_t>(folders .size()));
 
-        const std::string& buf = streamOut.ref();
+        //group similar data => better compression
+        for (const auto& item : files   ) writeItemName(blockOut_, item->first.normStr);
+        for (const auto& item : symlinks) writeItemName(blockOut_, item->first.normStr);
+        for (const auto& item : folders ) writeItemName(blockOut_, item->first.normStr);
+
+        for (const auto& item : files)
+        {
+            const InSyncFile& inSyncData = item->second;
+            writeNumber(blockOut_, static_cast<int32_t>(inSyncData.cmpVar));
+            writeNumber<uint64_t>(blockOut_, inSyncData.fileSize);
 
-        //distribute "outputBoth" over left and right streams:
-        const size_t size1stPart = buf.size() / 2;
-        const size_t size2ndPart = buf.size() - size1stPart;
+            writeFileDescr(blockOut_, leadStreamLeft_ ? inSyncData.left  : inSyncData.right);
+            writeFileDescr(blockOut_, leadStreamLeft_ ? inSyncData.right : inSyncData.left);
+        }
 
-        writeNumber<uint64_t>(outL, size1stPart);
-        writeNumber<uint64_t>(outR, size2ndPart);
+        for (const auto& item : symlinks)
+        {
+            const InSyncSymlink& inSyncData = item->second;
+            writeNumber(blockOut_, static_cast<int32_t>(inSyncData.cmpVar));
 
-        if (size1stPart > 0) writeArray(outL, buf.c_str(), size1stPart);
-        if (size2ndPart > 0) writeArray(outR, buf.c_str() + size1stPart, size2ndPart);
+            writeNumber<int64_t>(blockOut_, (leadStreamLeft_ ? inSyncData.left  : inSyncData.right).modTime);
+            writeNumber<int64_t>(blockOut_, (leadStreamLeft_ ? inSyncData.right : inSyncData.left ).modTime);
+        }
 
-        streamL = std::move(outL.ref());
-        streamR = std::move(outR.ref());
+        for (size_t i = 0; i < folders.size(); ++i)
+        {
+            writeNumber<uint32_t>(blockOut_, childPos[i].pos.blockIdx);
+            writeNumber<uint32_t>(blockOut_, childPos[i].pos.offset);
+            writeNumber<uint32_t>(blockOut_, childPos[i].firstBlockIdx);
+            writeNumber<uint8_t >(blockOut_, folders[i]->second.isComplete());
+        }
+        return {pos, firstBlockIdx};
     }
 
-private:
-    void recurse(const InSyncFolder& container)
+    //compress on worker thread while the next block is being filled
+    void flushBlock()
     {
-        writeNumber<uint32_t>(streamOutSmallNum_, static_cast<uint32_t>(container.files.size()));
-        for (const auto& [itemName, inSyncData] : container.files)
+        blocks_.push_back({std::move(blockOut_.ref())});
+        blockOut_.ref().clear();
+
+        DbBlock& block = blocks_.back();
+        compressGroup_.run([&block]
         {
-            writeItemName(itemName.normStr);
-            writeNumber(streamOutSmallNum_, static_cast<int32_t>(inSyncData.cmpVar));
-            writeNumber<uint64_t>(streamOutSmallNum_, inSyncData.fileSize);
+            try
+            {
+                block.buf = compressDbBlock(block.buf); //throw SysError
+            }
+            catch (const SysError& e) { block.error = e; }
+        });
+    }
+
+    struct DbBlock
+    {
+        std::string buf; //raw until compressed by worker thread
+        std::optional<SysError> error;
+    };
 
-            writeFileDescr(inSyncData.left);
-            writeFileDescr(inSyncData.right);
+    const DbStreamLayout* const oldLayout_; //optional
+    const bool leadStreamLeft_;
+    const uint32_t blockIdxBase_; //new blocks are appended to the old ones
+    std::vector<bool> copiedBlocks_; //old blocks still needed
+
+    MemoryStreamOut blockOut_; //data with bias to lead side
+    std::deque<DbBlock> blocks_; //std::deque: no reallocation => references stay valid for worker threads
+
+    ThreadGroup<std::function<void()>> compressGroup_; //declare last: stop + join *before* blocks_ is destroyed!
+};
+}
+
+//#######################################################################################################################################
+
+//decode folder records of stream format v6 on demand
+class fff::InSyncFolderLoader : public std::enable_shared_from_this<InSyncFolderLoader>
+{
+public:
+    InSyncFolderLoader(DbStreamLayout&& layout, bool leadStreamLeft,
+                       const std::wstring& displayFilePathL, //for diagnostics only
+                       const std::wstring& displayFilePathR) :
+        layout_(std::move(layout)),
+        leadStreamLeft_(leadStreamLeft),
+        displayFilePathL_(displayFilePathL),
+        displayFilePathR_(displayFilePathR) {}
+
+    void initRoot(InSyncFolder& root) //throw SysError, FileError
+    {
+        setRecordPos(root, layout_.rootPos);
+        root.loader_ = shared_from_this();
+
+        for (const auto& chunk : layout_.journal)
+        {
+            const std::string journalBuf = decompressDbBlock(layout_.codec, layout_.getData(chunk)); //throw SysError
+            MemoryStreamIn streamIn(journalBuf);
+
+            while (streamIn.pos() < journalBuf.size())
+                if (leadStreamLeft_)
+                    applyJournalEntry<SelectSide::left>(root, streamIn); //throw SysError, FileError
+                else
+                    applyJournalEntry<SelectSide::right>(root, streamIn); //throw SysError, FileError
         }
+    }
+
+    void decodeFolder(const InSyncFolder& folder) //throw SysError
+    {
+        if (leadStreamLeft_)
+            decodeFolder<SelectSide::left>(folder); //throw SysError
+        else
+            decodeFolder<SelectSide::right>(folder); //throw SysError
+    }
 
-        writeNumber<uint32_t>(streamOutSmallNum_, static_cast<uint32_t>(container.symlinks.size()));
-        for (const auto& [itemName, inSyncData] : container.symlinks)
+    //all blocks will be needed anyway => decompress in parallel; serve getBlock() until releaseAllBlocks()
+    void decompressAllBlocks() //throw SysError
+    {
+        std::vector<std::shared_ptr<const std::string>> blocks(layout_.blocks.size());
+        std::vector<std::optional<SysError>> errors(layout_.blocks.size());
         {
-            writeItemName(itemName.normStr);
-            writeNumber(streamOutSmallNum_, static_cast<int32_t>(inSyncData.cmpVar));
+            ThreadGroup<std::function<void()>> tg(std::max(std::thread::hardware_concurrency(), 1U), Zstr("Decompress sync.ffs_db"));
+
+            for (size_t i = 0; i < layout_.blocks.size(); ++i)
+                tg.run([this, &block = blocks[i], &error = errors[i], i]
+                {
+                    try
+                    {
+                        block = std::make_shared<const std::string>(decompressDbBlock(layout_.codec, layout_.getData(layout_.blocks[i]))); //throw SysError
+                    }
+                    catch (const SysError& e) { error = e; }
+                });
+            tg.wait();
+        }
+
+        for (const std::optional<SysError>& error : errors)
+            if (error)
+                throw *error; //throw SysError
+
+        decompressedBlocks_ = std::move(blocks);
+    }
+
+    void releaseAllBlocks() { decompressedBlocks_.clear(); }
+
+    static void loadRecursively(const InSyncFolder& folder) //throw FileError
+    {
+        for (const auto& [folderName, subFolder] : folder.refFolders()) //throw FileError
+            loadRecursively(subFolder); //throw FileError
+    }
+
+    static std::optional<DbSubTreePos> getUnchangedSubTree(const InSyncFolder& folder, const DbStreamLayout& layout)
+    {
+        if (folder.loader_ && &folder.loader_->layout_ == &layout &&
+            folder.subTreeFirstBlockIdx_ != DB_BLOCK_IDX_NONE && folder.recordBlockIdx_ < layout.blocks.size())
+            return DbSubTreePos{{folder.recordBlockIdx_, folder.recordOffset_}, folder.subTreeFirstBlockIdx_};
+        return {};
+    }
+
+    //any undecoded folder within "folder": all share the same loader
+    static std::shared_ptr<InSyncFolderLoader> findLoader(const InSyncFolder& folder)
+    {
+        if (folder.loader_)
+            return folder.loader_;
+
+        for (const auto& [folderName, subFolder] : folder.folders_)
+            if (std::shared_ptr<InSyncFolderLoader> loader = findLoader(subFolder))
+                return loader;
+        return nullptr;
+    }
+
+    const DbStreamLayout& getLayout() const { return layout_; }
+    bool isLeadStreamLeft() const { return leadStreamLeft_; }
+    std::thread::id getOwnerThreadId() const { return ownerThreadId_; }
+
+    std::wstring getErrorMessage() const
+    {
+        return replaceCpy(_("Cannot read database file %x."), L"%x", fmtPath(displayFilePathL_) + L", " + fmtPath(displayFilePathR_));
+    }
+
+private:
+    InSyncFolderLoader           (const InSyncFolderLoader&) = delete;
+    InSyncFolderLoader& operator=(const InSyncFolderLoader&) = delete;
+
+    static void setRecordPos(InSyncFolder& folder, const DbRecordPos& pos)
+    {
+        folder.recordBlockIdx_ = pos.blockIdx;
+        folder.recordOffset_   = pos.offset;
+    }
 
-            writeNumber<int64_t>(streamOutBigNum_, inSyncData.left .modTime);
-            writeNumber<int64_t>(streamOutBigNum_, inSyncData.right.modTime);
+    template <SelectSide leadSide>
+    void decodeFolder(const InSyncFolder& folder) //throw SysError
+    {
+        const std::shared_ptr<const std::string> block = getBlock(folder.recordBlockIdx_); //throw SysError
+        if (folder.recordOffset_ > block->size())
+            throw SysError(_("File content is corrupted.") + L" (invalid record position)");
+
+        MemoryStreamIn streamIn(std::string_view(*block).substr(folder.recordOffset_));
+
+        const size_t fileCount   = readNumber<uint32_t>(streamIn); //
+        const size_t linkCount   = readNumber<uint32_t>(streamIn); //throw SysErrorUnexpectedEos
+        const size_t folderCount = readNumber<uint32_t>(streamIn); //
+
+        if (fileCount + linkCount + folderCount > block->size()) //catch data corruption before std::bad_alloc
+            throw SysError(_("File content is corrupted.") + L" (invalid item count)");
+
+        std::vector<Zstring> itemNames(fileCount + linkCount + folderCount);
+        for (Zstring& itemName : itemNames)
+            itemName = readItemName(streamIn); //throw SysErrorUnexpectedEos
+
+        auto itName = itemNames.begin();
+
+        folder.files_.reserve(fileCount);
+        for (size_t i = 0; i < fileCount; ++i)
+            folder.files_.try_emplace(*itName++, readFile<leadSide>(streamIn)); //throw SysErrorUnexpectedEos
+
+        folder.symlinks_.reserve(linkCount);
+        for (size_t i = 0; i < linkCount; ++i)
+            folder.symlinks_.try_emplace(*itName++, readSymlink<leadSide>(streamIn)); //throw SysErrorUnexpectedEos
+
+        folder.folders_.reserve(folderCount);
+        for (size_t i = 0; i < folderCount; ++i)
+        {
+            DbRecordPos pos;
+            pos.blockIdx = readNumber<uint32_t>(streamIn); //throw SysErrorUnexpectedEos
+            pos.offset   = readNumber<uint32_t>(streamIn); //
+            const uint32_t firstBlockIdx = readNumber<uint32_t>(streamIn); //
+            const bool complete = readNumber<uint8_t>(streamIn) != 0;   //
+
+            if (firstBlockIdx != DB_BLOCK_IDX_NONE && firstBlockIdx > pos.blockIdx)
+                throw SysError(_("File content is corrupted.") + L" (invalid block range)");
+
+            InSyncFolder& subFolder = folder.folders_.try_emplace(*itName++).first->second;
+            setRecordPos(subFolder, pos);
+            subFolder.subTreeFirstBlockIdx_ = firstBlockIdx;
+            subFolder.complete_ = complete;
+            subFolder.loader_ = shared_from_this();
         }
+    }
+
+    template <SelectSide leadSide>
+    void applyJournalEntry(InSyncFolder& root, MemoryStreamIn& streamIn) //throw SysError, FileError
+    {
+        const auto op = static_cast<DbJournalOp>(readNumber<uint8_t>(streamIn)); //throw SysErrorUnexpectedEos
 
-        writeNumber<uint32_t>(streamOutSmallNum_, static_cast<uint32_t>(container.folders.size()));
-        for (const auto& [itemName, inSyncData] : container.folders)
+        InSyncFolder* parent = &root;
+        for (size_t depth = readNumber<uint32_t>(streamIn); depth-- != 0;) //throw SysErrorUnexpectedEos
         {
-            writeItemName(itemName.normStr);
+            auto it = parent->refFolders().find(readItemName(streamIn)); //throw SysErrorUnexpectedEos
+            if (it == parent->refFolders().end())
+                throw SysError(_("File content is corrupted.") + L" (invalid journal path)");
+            parent = &it->second;
+        }
+        const Zstring itemName = readItemName(streamIn); //throw SysErrorUnexpectedEos
 
-            recurse(inSyncData);
+        switch (op)
+        {
+            //*INDENT-OFF*
+            case DbJournalOp::setFile:       parent->refFiles   ().insert_or_assign(itemName, readFile   <leadSide>(streamIn)); return; //throw SysErrorUnexpectedEos
+            case DbJournalOp::setSymlink:    parent->refSymlinks().insert_or_assign(itemName, readSymlink<leadSide>(streamIn)); return; //
+            case DbJournalOp::removeFile:    parent->refFiles   ().erase(itemName); return;
+            case DbJournalOp::removeSymlink: parent->refSymlinks().erase(itemName); return;
+            case DbJournalOp::addFolder:     parent->refFolders ().try_emplace(itemName); return;
+            case DbJournalOp::removeFolder:  parent->refFolders ().erase(itemName); return;
+            //*INDENT-ON*
+            case DbJournalOp::setFolderComplete:
+                if (auto it = parent->refFolders().find(itemName);
+                    it != parent->refFolders().end())
+                {
+                    it->second.setComplete(readNumber<uint8_t>(streamIn) != 0); //throw SysErrorUnexpectedEos
+                    return;
+                }
+                break;
         }
+        throw SysError(_("File content is corrupted.") + L" (invalid journal entry)");
     }
 
-    void writeItemName(const Zstring& str) { writeContainer(streamOutText_, utfTo<std::string>(str)); }
+    template <SelectSide leadSide>
+    static InSyncFile readFile(MemoryStreamIn& streamIn) //throw SysErrorUnexpectedEos
+    {
+        const auto cmpVar = static_cast<CompareVariant>(readNumber<int32_t>(streamIn)); //
+        const uint64_t fileSize = readNumber<uint64_t>(streamIn);                        //throw SysErrorUnexpectedEos
+        const InSyncDescrFile descrL = readFileDescr(streamIn);                          //
+        const InSyncDescrFile descrT = readFileDescr(streamIn);                          //
+        return
+        {
+            .left     = selectParam<leadSide>(descrL, descrT),
+            .right    = selectParam<leadSide>(descrT, descrL),
+            .cmpVar   = cmpVar,
+            .fileSize = fileSize,
+        };
+    }
 
-    void writeFileDescr(const InSyncDescrFile& descr)
+    template <SelectSide leadSide>
+    static InSyncSymlink readSymlink(MemoryStreamIn& streamIn) //throw SysErrorUnexpectedEos
     {
-        writeNumber<int64_t         >(streamOutBigNum_, descr.modTime);
-        writeNumber<AFS::FingerPrint>(streamOutBigNum_, descr.filePrint);
-        static_assert(sizeof(descr.modTime) <= sizeof(int64_t)); //ensure cross-platform compatibility!
+        const auto cmpVar = static_cast<CompareVariant>(readNumber<int32_t>(streamIn)); //
+        const InSyncDescrLink descrL{static_cast<time_t>(readNumber<int64_t>(streamIn))}; //throw SysErrorUnexpectedEos
+        const InSyncDescrLink descrT{static_cast<time_t>(readNumber<int64_t>(streamIn))}; //
+        return
+        {
+            .left   = selectParam<leadSide>(descrL, descrT),
+            .right  = selectParam<leadSide>(descrT, descrL),
+            .cmpVar = cmpVar,
+        };
     }
 
-    /* maximize zlib compression by grouping similar data (=> 20% size reduction!)
-         -> further ~5% reduction possible by having one container per data type
-
-       other ideas: - avoid left/right side interleaving in writeFileDescr()              => pessimization!
-                    - convert CompareVariant/InSyncStatus to "enum : unsigned char"       => only 0,4% size reduction!
-                    - split up writeItemName() to use streamOutSmallNum_ + streamOutText_ => pessimization!
-                    - use null-termination in writeItemName()                             => 5% size reduction (embedded zeros impossible?)
-                    - use empty item name as sentinel                                     => only 0,17% size reduction!
-                    - save fileSize using instreamOutBigNum_                              => pessimization!        */
-    MemoryStreamOut streamOutText_;     //
-    MemoryStreamOut streamOutSmallNum_; //data with bias to lead side (= always left in this context)
-    MemoryStreamOut streamOutBigNum_;   //
+    std::shared_ptr<const std::string> getBlock(uint32_t blockIdx) //throw SysError
+    {
+        if (blockIdx >= layout_.blocks.size())
+            throw SysError(_("File content is corrupted.") + L" (invalid block index)");
+
+        if (!decompressedBlocks_.empty())
+            return decompressedBlocks_[blockIdx];
+
+        //most recently used first: consecutive records of a subtree are stored in the same block
+        if (auto it = std::find_if(blockCache_.begin(), blockCache_.end(), [blockIdx](const auto& item) { return item.first == blockIdx; });
+            it != blockCache_.end())
+        {
+            std::rotate(blockCache_.begin(), it, it + 1);
+            return blockCache_.front().second;
+        }
+
+        auto block = std::make_shared<const std::string>(decompressDbBlock(layout_.codec, layout_.getData(layout_.blocks[blockIdx]))); //throw SysError
+
+        if (blockCache_.size() >= BLOCK_CACHE_SIZE)
+            blockCache_.pop_back();
+        blockCache_.emplace(blockCache_.begin(), blockIdx, block);
+        return block;
+    }
+
+    static constexpr size_t BLOCK_CACHE_SIZE = 8;
+
+    const DbStreamLayout layout_; //compressed stream: needed until all folders are decoded
+    const bool leadStreamLeft_;
+    const std::thread::id ownerThreadId_ = std::this_thread::get_id(); //lazy decoding: single-threaded only!
+    const std::wstring displayFilePathL_;
+    const std::wstring displayFilePathR_;
+
+    std::vector<std::pair<uint32_t /*blockIdx*/, std::shared_ptr<const std::string>>> blockCache_; //LRU
+    std::vector<std::shared_ptr<const std::string>> decompressedBlocks_; //InSyncFolder::loadAll() only
 };
 
 
+void fff::InSyncFolder::load() const //throw FileError
+{
+    assert(loader_);
+    if (loader_->getOwnerThreadId() != std::this_thread::get_id()) //lazy decoding is NOT thread-safe: fail in release builds, too!
+        throw std::logic_error(std::string(__FILE__) + '[' + numberTo<std::string>(__LINE__) + "] Contract violation!");
+    try
+    {
+        loader_->decodeFolder(*this); //throw SysError
+        loader_.reset();
+    }
+    catch (const SysError& e)
+    {
+        folders_ .clear(); //keep loader_: don't pretend the folder is empty on next access
+        files_   .clear();
+        symlinks_.clear();
+        throw FileError(loader_->getErrorMessage(), e.toString());
+    }
+}
+
+
+void fff::InSyncFolder::loadAll() const //throw FileError
+{
+    const std::shared_ptr<InSyncFolderLoader> loader = InSyncFolderLoader::findLoader(*this);
+    if (!loader) //already decoded
+        return;
+
+    if (loader->getOwnerThreadId() != std::this_thread::get_id())
+        throw std::logic_error(std::string(__FILE__) + '[' + numberTo<std::string>(__LINE__) + "] Contract violation!");
+    try
+    {
+        loader->decompressAllBlocks(); //throw SysError
+    }
+    catch (const SysError& e) { throw FileError(loader->getErrorMessage(), e.toString()); }
+    ZEN_ON_SCOPE_EXIT(loader->releaseAllBlocks());
+
+    InSyncFolderLoader::loadRecursively(*this); //throw FileError
+}
+
+
+namespace
+{
+std::optional<DbSubTreePos> getUnchangedSubTree(const InSyncFolder& folder, const DbStreamLayout& layout)
+{
+    return InSyncFolderLoader::getUnchangedSubTree(folder, layout);
+}
+
+
 class StreamParser
 {
 public:
@@ -330,7 +992,8 @@ public:
                                            const std::string& streamL,
                                            const std::string& streamR,
                                            const std::wstring& displayFilePathL, //for diagnostics only
-                                           const std::wstring& displayFilePathR)
+                                           const std::wstring& displayFilePathR,
+                                           std::shared_ptr<const InSyncFolderLoader>* loaderOut = nullptr) //stream format v6 and later
     {
         try
         {
@@ -374,19 +1037,21 @@ public:
                 parser.recurse(output.ref()); //throw SysError
                 return output;
             }
+            else if (streamVersion == DB_STREAM_VERSION)
+            {
+                auto loader = std::make_shared<InSyncFolderLoader>(parseStreamLayout(readCombinedStream(leadStreamLeft, streamInL, streamInR)),
+                                                                   leadStreamLeft, displayFilePathL, displayFilePathR); //throw SysError, SysErrorUnexpectedEos
+                auto output = makeSharedRef<InSyncFolder>();
+                loader->initRoot(output.ref()); //throw SysError, FileError
+                if (loaderOut)
+                    *loaderOut = loader;
+                return output;
+            }
             else if (streamVersion == 3 || //TODO: remove migration code at some time! 2021-02-14
                      streamVersion == 4 || //TODO: remove migration code at some time! 2023-07-29
-                     streamVersion == DB_STREAM_VERSION)
+                     streamVersion == 5)   //TODO: remove migration code at some time! 2026-10-16
             {
-                MemoryStreamIn& streamInPart1 = leadStreamLeft ? streamInL : streamInR;
-                MemoryStreamIn& streamInPart2 = leadStreamLeft ? streamInR : streamInL;
-
-                const size_t sizePart1 = static_cast<size_t>(readNumber<uint64_t>(streamInPart1));
-                const size_t sizePart2 = static_cast<size_t>(readNumber<uint64_t>(streamInPart2));
-
-                std::string buf(sizePart1 + sizePart2, '\0');
-                if (sizePart1 > 0) readArray(streamInPart1, buf.data(),             sizePart1); //throw SysErrorUnexpectedEos
-                if (sizePart2 > 0) readArray(streamInPart2, buf.data() + sizePart1, sizePart2); //
+                const std::string buf = readCombinedStream(leadStreamLeft, streamInL, streamInR); //throw SysErrorUnexpectedEos
 
                 MemoryStreamIn streamIn(buf);
                 const std::string bufText     = readContainer<std::string>(streamIn); //
@@ -566,27 +1231,31 @@ class LastSynchronousStateUpdater
        2. Symlink handling *does* create a new (asymmetric) hierarchy during comparison
           => update all database entries!                                           */
 public:
-    static void execute(const BaseFolderPair& baseFolder, InSyncFolder& dbFolder)
+    static void execute(const BaseFolderPair& baseFolder, InSyncFolder& dbFolder, DbJournal& journal) //throw FileError
     {
-        LastSynchronousStateUpdater updater(baseFolder.getCompVariant(), baseFolder.getFilter());
-        updater.recurse(baseFolder, Zstring(), dbFolder);
+        LastSynchronousStateUpdater updater(baseFolder.getCompVariant(), baseFolder.getFilter(), journal);
+        updater.recurse(baseFolder, Zstring(), dbFolder); //throw FileError
     }
 
 private:
-    LastSynchronousStateUpdater(CompareVariant activeCmpVar, const PathFilter& filter) :
+    LastSynchronousStateUpdater(CompareVariant activeCmpVar, const PathFilter& filter, DbJournal& journal) :
         filter_(filter),
-        activeCmpVar_(activeCmpVar) {}
+        activeCmpVar_(activeCmpVar),
+        journal_(journal) {}
 
-    void recurse(const ContainerObject& conObj, const Zstring& relPath, InSyncFolder& dbFolder)
+    //returns true if the database has all items of "conObj" (recursively): see InSyncFolder::isComplete()
+    bool recurse(const ContainerObject& conObj, const Zstring& relPath, InSyncFolder& dbFolder)
     {
-        process(conObj.refSubFiles  (), relPath, dbFolder.files);
-        process(conObj.refSubLinks  (), relPath, dbFolder.symlinks);
-        process(conObj.refSubFolders(), relPath, dbFolder.folders);
+        const bool filesComplete   = process(conObj.refSubFiles  (), relPath, dbFolder.refFiles   ());
+        const bool linksComplete   = process(conObj.refSubLinks  (), relPath, dbFolder.refSymlinks());
+        const bool foldersComplete = process(conObj.refSubFolders(), relPath, dbFolder.refFolders ());
+        return filesComplete && linksComplete && foldersComplete;
     }
 
-    void process(const ContainerObject::FileList& currentFiles, const Zstring& parentRelPath, InSyncFolder::FileList& dbFiles)
+    bool process(const ContainerObject::FileList& currentFiles, const Zstring& parentRelPath, InSyncFolder::FileList& dbFiles)
     {
         std::unordered_set<ZstringNorm> toPreserve;
+        bool complete = true;
 
         for (const FilePair& file : currentFiles)
             if (!file.isPairEmpty())
@@ -600,19 +1269,31 @@ private:
                     assert(file.getFileSize<SelectSide::left>() == file.getFileSize<SelectSide::right>());
 
                     //create or update new "in-sync" state
-                    dbFiles.insert_or_assign(fileName, InSyncFile
+                    const InSyncFile inSyncFile
                     {
                         .left     = InSyncDescrFile{file.getLastWriteTime<SelectSide::left >(), file.getFilePrint<SelectSide::left >()},
                         .right    = InSyncDescrFile{file.getLastWriteTime<SelectSide::right>(), file.getFilePrint<SelectSide::right>()},
                         .cmpVar   = activeCmpVar_,
                         .fileSize = file.getFileSize<SelectSide::left>(),
-                    });
+                    };
+                    const auto [it, inserted] = dbFiles.try_emplace(fileName, inSyncFile);
+                    if (inserted || it->second != inSyncFile)
+                    {
+                        it->second = inSyncFile;
+                        journal_.setFile(parentRelPath, fileName, inSyncFile);
+                    }
+
+                    if (it->first.normStr != fileName || //database stores Unicode normal form only: partial comparison can't restore the name
+                        file.isFollowedSymlink<SelectSide::left>() || file.isFollowedSymlink<SelectSide::right>())
+                        complete = false;
+
                     toPreserve.insert(fileName);
                 }
                 else //not in sync: preserve last synchronous state
                 {
                     toPreserve.insert(file.getItemName<SelectSide::left >()); //left/right may differ in case!
                     toPreserve.insert(file.getItemName<SelectSide::right>()); //
+                    complete = false;
                 }
             }
 
@@ -623,14 +1304,22 @@ private:
                 return false;
             //all items not existing in "currentFiles" have either been deleted meanwhile or been excluded via filter:
             const Zstring& itemRelPath = appendPath(parentRelPath, v.first.normStr);
-            return filter_.passFileFilter(itemRelPath);
+            if (!filter_.passFileFilter(itemRelPath))
+            {
+                complete = false; //database entry possibly outdated, e.g. after read error
+                return false;
+            }
             //note: items subject to traveral errors are also excluded by this file filter here! see comparison.cpp, modified file filter for read errors
+            journal_.removeFile(parentRelPath, v.first.normStr);
+            return true;
         });
+        return complete;
     }
 
-    void process(const ContainerObject::SymlinkList& currentSymlinks, const Zstring& parentRelPath, InSyncFolder::SymlinkList& dbSymlinks)
+    bool process(const ContainerObject::SymlinkList& currentSymlinks, const Zstring& parentRelPath, InSyncFolder::SymlinkList& dbSymlinks)
     {
         std::unordered_set<ZstringNorm> toPreserve;
+        bool complete = true;
 
         for (const SymlinkPair& symlink : currentSymlinks)
             if (!symlink.isPairEmpty())
@@ -641,18 +1330,28 @@ private:
                     const Zstring& linkName = symlink.getItemName<SelectSide::left>();
 
                     //create or update new "in-sync" state
-                    dbSymlinks.insert_or_assign(linkName, InSyncSymlink
+                    const InSyncSymlink inSyncSymlink
                     {
                         .left   = InSyncDescrLink{symlink.getLastWriteTime<SelectSide::left >()},
                         .right  = InSyncDescrLink{symlink.getLastWriteTime<SelectSide::right>()},
                         .cmpVar = activeCmpVar_,
-                    });
+                    };
+                    const auto [it, inserted] = dbSymlinks.try_emplace(linkName, inSyncSymlink);
+                    if (inserted || it->second != inSyncSymlink)
+                    {
+                        it->second = inSyncSymlink;
+                        journal_.setSymlink(parentRelPath, linkName, inSyncSymlink);
+                    }
+                    if (it->first.normStr != linkName)
+                        complete = false;
+
                     toPreserve.insert(linkName);
                 }
                 else //not in sync: preserve last synchronous state
                 {
                     toPreserve.insert(symlink.getItemName<SelectSide::left >()); //left/right may differ in case!
                     toPreserve.insert(symlink.getItemName<SelectSide::right>()); //
+                    complete = false;
                 }
             }
 
@@ -663,13 +1362,22 @@ private:
                 return false;
             //all items not existing in "currentSymlinks" have either been deleted meanwhile or been excluded via filter:
             const Zstring& itemRelPath = appendPath(parentRelPath, v.first.normStr);
-            return filter_.passFileFilter(itemRelPath);
+            if (!filter_.passFileFilter(itemRelPath))
+            {
+                complete = false;
+                return false;
+            }
+
+            journal_.removeSymlink(parentRelPath, v.first.normStr);
+            return true;
         });
+        return complete;
     }
 
-    void process(const ContainerObject::FolderList& currentFolders, const Zstring& parentRelPath, InSyncFolder::FolderList& dbFolders)
+    bool process(const ContainerObject::FolderList& currentFolders, const Zstring& parentRelPath, InSyncFolder::FolderList& dbFolders)
     {
         std::unordered_map<ZstringNorm, const FolderPair*> toPreserve;
+        bool complete = true;
 
         for (const FolderPair& folder : currentFolders)
             if (!folder.isPairEmpty())
@@ -680,7 +1388,8 @@ private:
                     const Zstring& folderName = folder.getItemName<SelectSide::left>();
 
                     //create directory entry if not existing (but do *not touch* existing child elements!!!)
-                    dbFolders.try_emplace(folderName);
+                    if (dbFolders.try_emplace(folderName).second)
+                        journal_.addFolder(parentRelPath, folderName);
 
                     toPreserve.emplace(folderName, &folder);
                 }
@@ -689,6 +1398,7 @@ private:
                     toPreserve.emplace(folder.getItemName<SelectSide::left >(), &folder); //names differing (in case)? => treat like any other folder rename
                     toPreserve.emplace(folder.getItemName<SelectSide::right>(), &folder); //=> no *new* database entries even if child items are in sync
                     //BUT: update existing one: there should be only *one* DB entry after a folder rename (matching either folder name on left or right)
+                    complete = false;
                 }
             }
 
@@ -699,8 +1409,29 @@ private:
 
             if (auto it = toPreserve.find(v.first); it != toPreserve.end())
             {
-                recurse(*(it->second), itemRelPath, v.second); //required even if e.g. DIR_LEFT_ONLY:
+                const FolderPair& folder = *(it->second);
+
+                //partial comparison: sub tree was taken from sync.ffs_db and all items are still in sync => nothing to update
+                //=> don't decode: unchanged blocks are copied when compacting (see StreamGenerator)
+                if (folder.isLastSyncState() && v.second.isComplete())
+                {
+                    assert(folder.getDirCategory() == DIR_EQUAL && v.first.normStr == folder.getItemName<SelectSide::left>());
+                    return false;
+                }
+
+                //visit *all* folders, even if everything was in sync before synchronization: e.g. new items equal on both sides have no record yet
+                const bool childItemsComplete = recurse(folder, itemRelPath, v.second); //required even if e.g. DIR_LEFT_ONLY:
                 //existing child-items may not be in sync, but items deleted on both sides *are* in-sync!!!
+
+                const bool folderComplete = childItemsComplete && folder.getDirCategory() == DIR_EQUAL &&
+                                            v.first.normStr == folder.getItemName<SelectSide::left>() &&
+                                            !folder.isFollowedSymlink<SelectSide::left>() && !folder.isFollowedSymlink<SelectSide::right>();
+                if (v.second.isComplete() != folderComplete)
+                {
+                    v.second.setComplete(folderComplete);
+                    journal_.setFolderComplete(parentRelPath, v.first.normStr, folderComplete);
+                }
+                complete = complete && folderComplete;
                 return false;
             }
 
@@ -710,17 +1441,36 @@ private:
             const bool passFilter = filter_.passDirFilter(itemRelPath, &childItemMightMatch);
             if (!passFilter && childItemMightMatch)
                 dbSetEmptyState(v.second, appendSeparator(itemRelPath)); //child items might match, e.g. *.txt include filter!
+            if (passFilter)
+                journal_.removeFolder(parentRelPath, v.first.normStr);
+            else
+                complete = false;
             return passFilter;
         });
+        return complete;
     }
 
     //delete all entries for removed folder (= "in-sync") from database
     void dbSetEmptyState(InSyncFolder& dbFolder, const Zstring& parentRelPathPf)
     {
-        std::erase_if(dbFolder.files,    [&](const InSyncFolder::FileList   ::value_type& v) { return filter_.passFileFilter(parentRelPathPf + v.first.normStr); });
-        std::erase_if(dbFolder.symlinks, [&](const InSyncFolder::SymlinkList::value_type& v) { return filter_.passFileFilter(parentRelPathPf + v.first.normStr); });
+        std::erase_if(dbFolder.refFiles(), [&](const InSyncFolder::FileList::value_type& v)
+        {
+            if (!filter_.passFileFilter(parentRelPathPf + v.first.normStr))
+                return false;
+
+            journal_.removeFile(parentRelPathPf, v.first.normStr);
+            return true;
+        });
+        std::erase_if(dbFolder.refSymlinks(), [&](const InSyncFolder::SymlinkList::value_type& v)
+        {
+            if (!filter_.passFileFilter(parentRelPathPf + v.first.normStr))
+                return false;
 
-        eraseIf(dbFolder.folders, [&](InSyncFolder::FolderList::value_type& v)
+            journal_.removeSymlink(parentRelPathPf, v.first.normStr);
+            return true;
+        });
+
+        eraseIf(dbFolder.refFolders(), [&](InSyncFolder::FolderList::value_type& v)
         {
             const Zstring& itemRelPath = parentRelPathPf + v.first.normStr;
 
@@ -728,12 +1478,15 @@ private:
             const bool passFilter = filter_.passDirFilter(itemRelPath, &childItemMightMatch);
             if (!passFilter && childItemMightMatch)
                 dbSetEmptyState(v.second, appendSeparator(itemRelPath));
+            if (passFilter)
+                journal_.removeFolder(parentRelPathPf, v.first.normStr);
             return passFilter;
         });
     }
 
     const PathFilter& filter_; //filter used while scanning directory: generates view on actual files!
     const CompareVariant activeCmpVar_;
+    DbJournal& journal_; //record changes
 };
 
 
@@ -831,7 +1584,7 @@ std::unordered_map<const BaseFolderPair*, SharedRef<const InSyncFolder>> fff::lo
             }, ctx.acb);
         });
 
-        massParallelExecute(parallelWorkload,
+        massParallelExecute(parallelWorkload, {} /*deviceParallelOps*/,
                             Zstr("Load sync.ffs_db"), callback /*throw X*/); //throw X
     }
     //----------------------------------------------------------------
@@ -910,7 +1663,7 @@ void fff::saveLastSynchronousState(const BaseFolderPair& baseFolder, bool transa
             loadSuccess = errMsg.empty();
         });
 
-        massParallelExecute(parallelWorkload,
+        massParallelExecute(parallelWorkload, {} /*deviceParallelOps*/,
                             Zstr("Load sync.ffs_db"), callback /*throw X*/); //throw X
 
         if (!loadSuccessL || !loadSuccessR)
@@ -924,7 +1677,8 @@ void fff::saveLastSynchronousState(const BaseFolderPair& baseFolder, bool transa
     //load last synchrounous state
     auto itStreamOldL = streamsL.cend();
     auto itStreamOldR = streamsR.cend();
-    InSyncFolder lastSyncState;
+    SharedRef<InSyncFolder> lastSyncState = makeSharedRef<InSyncFolder>();
+    std::shared_ptr<const InSyncFolderLoader> dbLoader; //stream format v6 and later: keep existing folder records + journal
     try
     {
         //find associated session: there can be at most one session within intersection of left and right IDs
@@ -932,33 +1686,83 @@ void fff::saveLastSynchronousState(const BaseFolderPair& baseFolder, bool transa
                                                                  AFS::getDisplayPath(dbPathL),
                                                                  AFS::getDisplayPath(dbPathR)); //throw FileError
         if (itStreamOldL != streamsL.end())
-            lastSyncState = std::move(StreamParser::execute(itStreamOldL->second.isLeadStream /*leadStreamLeft*/,
-                                                            itStreamOldL->second.rawStream,
-                                                            itStreamOldR->second.rawStream,
-                                                            AFS::getDisplayPath(dbPathL),
-                                                            AFS::getDisplayPath(dbPathR)).ref()); //throw FileError
+            lastSyncState = StreamParser::execute(itStreamOldL->second.isLeadStream /*leadStreamLeft*/,
+                                                  itStreamOldL->second.rawStream,
+                                                  itStreamOldR->second.rawStream,
+                                                  AFS::getDisplayPath(dbPathL),
+                                                  AFS::getDisplayPath(dbPathR), &dbLoader); //throw FileError
     }
     catch (const FileError& e) { callback.reportFatalError(e.toString()); } //throw X
     //if database files are corrupted: just overwrite! User is already informed about errors right after comparing!
 
-    //update last synchrounous state
-    LastSynchronousStateUpdater::execute(baseFolder, lastSyncState);
+    //update last synchrounous state: folder records are decoded while visited, the journal records the differences only
+    DbJournal journal(dbLoader ? dbLoader->isLeadStreamLeft() : true);
+    try
+    {
+        LastSynchronousStateUpdater::execute(baseFolder, lastSyncState.ref(), journal); //throw FileError
+    }
+    catch (const FileError& e) //corrupted folder record: just overwrite!
+    {
+        callback.reportFatalError(e.toString()); //throw X
+        lastSyncState = makeSharedRef<InSyncFolder>();
+        dbLoader = nullptr;
+
+        DbJournal journalFull(true /*leadStreamLeft*/); //discarded: stream is rewritten
+        LastSynchronousStateUpdater::execute(baseFolder, lastSyncState.ref(), journalFull); //nothing to decode => no FileError
+    }
 
-    //serialize again
+    //serialize again: append changes to the journal (keep lead stream) or compact
     SessionData sessionDataL = {};
     SessionData sessionDataR = {};
-    sessionDataL.isLeadStream = true;
-    sessionDataR.isLeadStream = false;
+    bool journalAppended = false;
 
-    if (const std::wstring errMsg = tryReportingError([&] //throw X
-{
-    StreamGenerator::execute(lastSyncState, //throw FileError
-                             AFS::getDisplayPath(dbPathL),
-                             AFS::getDisplayPath(dbPathR),
-                             sessionDataL.rawStream,
-                             sessionDataR.rawStream);
-    }, callback /*throw X*/); !errMsg.empty())
-    return;
+    if (dbLoader)
+    {
+        const std::wstring errMsg = tryReportingError([&] //throw X
+        {
+            journalAppended = StreamGenerator::appendJournal(dbLoader->getLayout(), dbLoader->isLeadStreamLeft(), journal, //throw FileError
+                                                             AFS::getDisplayPath(dbPathL),
+                                                             AFS::getDisplayPath(dbPathR),
+                                                             sessionDataL.rawStream,
+                                                             sessionDataR.rawStream);
+        }, callback /*throw X*/);
+        if (!errMsg.empty())
+            return;
+    }
+
+    if (journalAppended)
+        sessionDataL.isLeadStream = dbLoader->isLeadStreamLeft();
+    else //no stream v6 or later yet, or compaction due
+    {
+        //compaction: copy blocks of folders not decoded (= not changed) instead of re-encoding
+        //=> full rewrite once most old blocks are empty (= no longer referenced), or if there's nothing to copy
+        const DbStreamLayout* oldLayout = nullptr;
+        if (dbLoader && dbLoader->getLayout().codec == DB_BLOCK_CODEC && InSyncFolderLoader::findLoader(lastSyncState.ref()))
+        {
+            const auto& oldBlocks = dbLoader->getLayout().blocks;
+            const size_t emptyCount = std::count_if(oldBlocks.begin(), oldBlocks.end(), [](const auto& block) { return block.second == 0; });
+            if (emptyCount <= oldBlocks.size() * DB_EMPTY_BLOCKS_MAX_RATIO)
+                oldLayout = &dbLoader->getLayout();
+        }
+        const bool leadStreamLeft = oldLayout ? dbLoader->isLeadStreamLeft() : true; //copied blocks: keep lead stream
+
+        const std::wstring errMsg = tryReportingError([&] //throw X
+        {
+            if (!oldLayout)
+                lastSyncState.ref().loadAll(); //throw FileError; decompress in parallel
+
+            StreamGenerator::execute(lastSyncState.ref(), oldLayout, leadStreamLeft, //throw FileError
+                                     AFS::getDisplayPath(dbPathL),
+                                     AFS::getDisplayPath(dbPathR),
+                                     sessionDataL.rawStream,
+                                     sessionDataR.rawStream);
+        }, callback /*throw X*/);
+        if (!errMsg.empty())
+            return;
+
+        sessionDataL.isLeadStream = leadStreamLeft;
+    }
+    sessionDataR.isLeadStream = !sessionDataL.isLeadStream;
 
     //check if there is some work to do at all
     if (itStreamOldL != streamsL.end() && itStreamOldL->second == sessionDataL &&
@@ -1041,10 +1845,10 @@ void fff::saveLastSynchronousState(const BaseFolderPair& baseFolder, bool transa
         });
     }
 
-    massParallelExecute(parallelWorkloadSave,
+    massParallelExecute(parallelWorkloadSave, {} /*deviceParallelOps*/,
                         Zstr("Save sync.ffs_db"), callback /*throw X*/); //throw X
     //----------------------------------------------------------------
     if (saveSuccessL && saveSuccessR)
-        massParallelExecute(parallelWorkloadMove,
+        massParallelExecute(parallelWorkloadMove, {} /*deviceParallelOps*/,
                             Zstr("Move sync.ffs_db"), callback /*throw X*/); //throw X
 }
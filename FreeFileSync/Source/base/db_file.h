@@ -21,11 +21,15 @@ struct InSyncDescrFile //subset of FileAttributes
 {
     time_t modTime = 0;
     AFS::FingerPrint filePrint = 0; //optional!
+
+    bool operator==(const InSyncDescrFile&) const = default;
 };
 
 struct InSyncDescrLink
 {
     time_t modTime = 0;
+
+    bool operator==(const InSyncDescrLink&) const = default;
 };
 
 
@@ -36,6 +40,8 @@ struct InSyncFile
     InSyncDescrFile right; //
     CompareVariant cmpVar = CompareVariant::timeSize; //the one active while finding "file in sync"
     uint64_t fileSize = 0; //file size must be identical on both sides!
+
+    bool operator==(const InSyncFile&) const = default;
 };
 
 struct InSyncSymlink
@@ -43,39 +49,77 @@ struct InSyncSymlink
     InSyncDescrLink left;
     InSyncDescrLink right;
     CompareVariant cmpVar = CompareVariant::timeSize;
+
+    bool operator==(const InSyncSymlink&) const = default;
 };
 
-struct InSyncFolder
+class InSyncFolderLoader; //see db_file.cpp
+
+class InSyncFolder
 {
+public:
     //------------------------------------------------------------------
     using FolderList  = std::unordered_map<ZstringNorm, InSyncFolder >; //
     using FileList    = std::unordered_map<ZstringNorm, InSyncFile   >; // key: file name (ignoring Unicode normal forms)
     using SymlinkList = std::unordered_map<ZstringNorm, InSyncSymlink>; //
     //------------------------------------------------------------------
 
-    FolderList  folders;
-    FileList    files;
-    SymlinkList symlinks; //non-followed symlinks
+    InSyncFolder() {}
+
+    /* stream format v6 and later: folder content is decoded on first access => only subtrees actually visited are loaded
+        - NOT thread-safe, not even for const access: use on the thread that called loadLastSynchronousState() only! (else: std::logic_error)
+          => decode subtrees completely before handing them out to worker threads: loadAll()
+        - decoding error: throw FileError; folder remains undecoded => every access fails the same way  */
+    const FolderList&  refFolders () const { loadIfNeeded(); return folders_; } //
+    /**/  FolderList&  refFolders ()       { loadIfNeeded(); return folders_; } //
+    const FileList&    refFiles   () const { loadIfNeeded(); return files_; }   //throw FileError
+    /**/  FileList&    refFiles   ()       { loadIfNeeded(); return files_; }   //
+    const SymlinkList& refSymlinks() const { loadIfNeeded(); return symlinks_; } //
+    /**/  SymlinkList& refSymlinks()       { loadIfNeeded(); return symlinks_; } //
+
+    bool isDecoded() const { return !loader_; } //content available without decoding (this folder only)
+    void loadAll() const; //throw FileError; decode complete sub tree: blocks are decompressed in parallel
+
+    //partial comparison: sub tree may be taken from sync.ffs_db instead of traversing it (see PartialTraversal)
+    //=> all items were in sync during last synchronization + item names in Unicode normal form (= names on disk)
+    bool isComplete() const { return complete_; } //stored with the parent folder: no decoding needed
+    void setComplete(bool complete) { complete_ = complete; }
 
     //convenience
     InSyncFolder& addFolder(const Zstring& folderName)
     {
-        const auto [it, inserted] = folders.try_emplace(folderName);
+        const auto [it, inserted] = refFolders().try_emplace(folderName);
         assert(inserted);
         return it->second;
     }
 
     void addFile(const Zstring& fileName, const InSyncDescrFile& descrL, const InSyncDescrFile& descrR, CompareVariant cmpVar, uint64_t fileSize)
     {
-            files.emplace(fileName, InSyncFile {descrL, descrR, cmpVar, fileSize});
+        [[maybe_unused]] const auto [it, inserted] = refFiles().emplace(fileName, InSyncFile {descrL, descrR, cmpVar, fileSize});
         assert(inserted);
     }
 
     void addSymlink(const Zstring& linkName, const InSyncDescrLink& descrL, const InSyncDescrLink& descrR, CompareVariant cmpVar)
     {
-            symlinks.emplace(linkName, InSyncSymlink {descrL, descrR, cmpVar});
+        [[maybe_unused]] const auto [it, inserted] = refSymlinks().emplace(linkName, InSyncSymlink {descrL, descrR, cmpVar});
         assert(inserted);
     }
+
+private:
+    friend class InSyncFolderLoader;
+
+    void loadIfNeeded() const { if (loader_) load(); } //throw FileError
+    void load() const; //throw FileError
+
+    mutable FolderList  folders_;
+    mutable FileList    files_;
+    mutable SymlinkList symlinks_; //non-followed symlinks
+
+    mutable std::shared_ptr<InSyncFolderLoader> loader_; //set while content is not yet decoded
+    uint32_t recordBlockIdx_ = 0; //location of folder record within loader's stream
+    uint32_t recordOffset_   = 0; //
+    uint32_t subTreeFirstBlockIdx_ = std::numeric_limits<uint32_t>::max(); //records of sub tree in blocks [subTreeFirstBlockIdx_, recordBlockIdx_] only (if known)
+    bool complete_ = false; //streams before v6: unknown
 };
 
 
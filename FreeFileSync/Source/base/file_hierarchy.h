@@ -10,6 +10,8 @@
 #include <string>
 #include <memory>
 #include <list>
+#include <deque>
+#include <memory_resource>
 #include <functional>
 #include <unordered_set>
 #include <unordered_map>
@@ -42,45 +44,181 @@ struct LinkAttributes
 struct FolderAttributes
 {
     bool isFollowedSymlink = false;
+    bool isLastSyncState = false; //partial comparison: content taken from sync.ffs_db instead of reading it (see PartialTraversal)
 };
 
 
-struct FolderContainer
+class ScanArena;
+
+/* scan result of one folder: filled by parallelDeviceTraversal(), read by MergeSides
+    - struct of arrays: item names and attributes in contiguous memory, same index => same item
+    - item names and sub folders are allocated from the ScanArena of the whole folder tree
+      => no hash node and no heap-allocated Zstring per item: millions of files!        */
+class FolderContainer
 {
-    //------------------------------------------------------------------
-    //key: raw file name, without any (Unicode) normalization, preserving original upper-/lower-case
-    //"Changing data [...] to NFC would cause interoperability problems. Always leave data as it is."
-    using FolderList  = std::unordered_map<Zstring, std::pair<FolderAttributes, FolderContainer>>;
-    using FileList    = std::unordered_map<Zstring, FileAttributes>;
-    using SymlinkList = std::unordered_map<Zstring, LinkAttributes>;
-    //------------------------------------------------------------------
+public:
+    template <class Attributes>
+    class ItemList
+    {
+    public:
+        size_t size() const { return names_.size(); }
+        bool empty() const { return names_.empty(); }
+
+        //raw file name, without any (Unicode) normalization, preserving original upper-/lower-case
+        //"Changing data [...] to NFC would cause interoperability problems. Always leave data as it is."
+        ZstringView getName(size_t idx) const { return names_[idx]; }
+        const Attributes& getAttr(size_t idx) const { return attribs_[idx]; }
+
+    private:
+        friend class FolderContainer;
+        std::vector<ZstringView> names_; //owned by ScanArena
+        std::vector<Attributes> attribs_;
+    };
+
+    FolderContainer() {} //empty container: no ScanArena needed
+    explicit FolderContainer(ScanArena& arena) : arena_(&arena) {}
 
-    FolderContainer() = default;
     FolderContainer           (const FolderContainer&) = delete; //catch accidental (and unnecessary) copying
     FolderContainer& operator=(const FolderContainer&) = delete; //
 
-    FileList    files;
-    SymlinkList symlinks; //non-followed symlinks
-    FolderList  folders;
+    const ItemList<FileAttributes  >& refFiles   () const { return files_; }
+    const ItemList<LinkAttributes  >& refSymlinks() const { return symlinks_; } //non-followed symlinks
+    const ItemList<FolderAttributes>& refFolders () const { return folders_; }
+    const FolderContainer& getSubFolder(size_t idx) const { return *subFolders_[idx]; } //same index as refFolders()
 
     void addFile(const Zstring& itemName, const FileAttributes& attr)
     {
-        files.insert_or_assign(itemName, attr); //update entry if already existing (e.g. during folder traverser "retry")
+        addItem(files_, nameIndex_ ? &nameIndex_->files : nullptr, itemName, attr);
     }
 
     void addLink(const Zstring& itemName, const LinkAttributes& attr)
     {
-        symlinks.insert_or_assign(itemName, attr);
+        addItem(symlinks_, nameIndex_ ? &nameIndex_->symlinks : nullptr, itemName, attr);
     }
 
-    FolderContainer& addFolder(const Zstring& itemName, const FolderAttributes& attr)
+    FolderContainer& addFolder(const Zstring& itemName, const FolderAttributes& attr);
+
+    //folder traverser "retry" reports items a second time => update existing entries instead of adding duplicates
+    void expectDuplicates();
+
+private:
+    using NameIndex = std::unordered_map<ZstringView, size_t /*item index*/>;
+
+    template <class Attributes>
+    size_t addItem(ItemList<Attributes>& items, NameIndex* nameIndex, const Zstring& itemName, const Attributes& attr);
+
+    template <class Attributes>
+    static void buildIndex(NameIndex& nameIndex, const ItemList<Attributes>& items)
     {
-        auto& p = folders[itemName]; //value default-construction is okay here
-        p.first = attr;
-        return p.second;
+        for (size_t i = 0; i < items.size(); ++i)
+            nameIndex.emplace(items.getName(i), i);
     }
+
+    ScanArena* arena_ = nullptr;
+
+    ItemList<FileAttributes  > files_;
+    ItemList<LinkAttributes  > symlinks_;
+    ItemList<FolderAttributes> folders_;
+    std::vector<FolderContainer*> subFolders_; //owned by ScanArena
+
+    struct NameIndices
+    {
+        NameIndex files;
+        NameIndex symlinks;
+        NameIndex folders;
+    };
+    std::unique_ptr<NameIndices> nameIndex_; //only after "retry" (rare!): don't pay for hash tables otherwise
 };
 
+
+//bump allocation for the scan results of one base folder: NOT thread-safe! (all TraverserCallback calls happen on the same thread)
+class ScanArena
+{
+public:
+    ScanArena() {}
+
+    ZstringView storeName(const Zstring& itemName)
+    {
+        if (itemName.size() > chunkAvail_)
+        {
+            const size_t chunkSize = std::max(itemName.size(), NAME_CHUNK_SIZE);
+            nameChunks_.emplace_back(new Zchar[chunkSize]);
+            chunkPos_   = nameChunks_.back().get();
+            chunkAvail_ = chunkSize;
+        }
+        std::copy(itemName.begin(), itemName.end(), chunkPos_);
+        const ZstringView name(chunkPos_, itemName.size());
+
+        chunkPos_   += itemName.size();
+        chunkAvail_ -= itemName.size();
+        return name;
+    }
+
+    FolderContainer& newFolder() { return folders_.emplace_back(*this); }
+
+private:
+    ScanArena           (const ScanArena&) = delete; //FolderContainer references arena by pointer
+    ScanArena& operator=(const ScanArena&) = delete; //
+
+    static constexpr size_t NAME_CHUNK_SIZE = 64 * 1024; //number of Zchar
+
+    std::vector<std::unique_ptr<Zchar[]>> nameChunks_;
+    Zchar* chunkPos_ = nullptr;
+    size_t chunkAvail_ = 0;
+
+    std::deque<FolderContainer> folders_; //std::deque: no reallocation => references stay valid
+};
+
+
+template <class Attributes> inline
+size_t FolderContainer::addItem(ItemList<Attributes>& items, NameIndex* nameIndex, const Zstring& itemName, const Attributes& attr)
+{
+    if (nameIndex)
+        if (auto it = nameIndex->find(itemName);
+            it != nameIndex->end())
+        {
+            items.attribs_[it->second] = attr; //update entry if already existing (e.g. during folder traverser "retry")
+            return it->second;
+        }
+
+    assert(arena_);
+    const size_t idx = items.names_.size();
+    items.names_  .push_back(arena_->storeName(itemName));
+    items.attribs_.push_back(attr);
+
+    if (nameIndex)
+        nameIndex->emplace(items.names_.back(), idx);
+    return idx;
+}
+
+
+inline
+FolderContainer& FolderContainer::addFolder(const Zstring& itemName, const FolderAttributes& attr)
+{
+    const size_t idx = addItem(folders_, nameIndex_ ? &nameIndex_->folders : nullptr, itemName, attr);
+    if (idx < subFolders_.size()) //folder is traversed a second time
+    {
+        subFolders_[idx]->expectDuplicates();
+        return *subFolders_[idx];
+    }
+
+    subFolders_.push_back(&arena_->newFolder());
+    return *subFolders_.back();
+}
+
+
+inline
+void FolderContainer::expectDuplicates()
+{
+    if (!nameIndex_)
+    {
+        nameIndex_ = std::make_unique<NameIndices>();
+        buildIndex(nameIndex_->files,    files_);
+        buildIndex(nameIndex_->symlinks, symlinks_);
+        buildIndex(nameIndex_->folders,  folders_);
+    }
+}
+
 //------------------------------------------------------------------
 
 enum class SelectSide
@@ -198,9 +336,9 @@ class ContainerObject : public virtual PathInformation
     friend class FileSystemObject; //access to updateRelPathsRecursion()
 
 public:
-    using FileList    = std::list<FilePair>;    //MergeSides::execute() requires a structure that doesn't invalidate pointers after push_back()
-    using SymlinkList = std::list<SymlinkPair>; //
-    using FolderList  = std::list<FolderPair>;
+    using FileList    = std::pmr::list<FilePair>;    //MergeSides::execute() requires a structure that doesn't invalidate pointers after push_back()
+    using SymlinkList = std::pmr::list<SymlinkPair>; //
+    using FolderList  = std::pmr::list<FolderPair>;  //list nodes: allocated from the BaseFolderPair's FsObjectPool
 
     FolderPair& addFolder(const Zstring&          itemNameL, //file exists on both sides
                           const FolderAttributes& left,
@@ -246,7 +384,10 @@ public:
     virtual void flip();
 
 protected:
-    explicit ContainerObject(BaseFolderPair& baseFolder) : //used during BaseFolderPair constructor
+    ContainerObject(BaseFolderPair& baseFolder, std::pmr::memory_resource& fsObjPool) : //used during BaseFolderPair constructor
+        subFiles_  (&fsObjPool),
+        subLinks_  (&fsObjPool),
+        subFolders_(&fsObjPool),
         base_(baseFolder) //take reference only: baseFolder *not yet* fully constructed at this point!
     { assert(relPathL_.c_str() == relPathR_.c_str()); } //expected by the following contructor!
 
@@ -284,7 +425,20 @@ enum class BaseFolderStatus
     failure,
 };
 
-class BaseFolderPair : public ContainerObject
+//all FilePair, SymlinkPair and FolderPair of one BaseFolderPair share the same pool: no malloc()/free() per item
+//=> base class of BaseFolderPair: constructed *before* and destroyed *after* ContainerObject's lists
+class FsObjectPool
+{
+protected:
+    FsObjectPool() {}
+    ~FsObjectPool() {}
+
+    //not thread-safe: same as ObjectMgr<FileSystemObject>
+    std::pmr::unsynchronized_pool_resource fsObjPool_;
+};
+
+
+class BaseFolderPair : private FsObjectPool, public ContainerObject
 {
 public:
     BaseFolderPair(const AbstractPath& folderPathLeft,
@@ -295,7 +449,7 @@ public:
                    CompareVariant cmpVar,
                    int fileTimeTolerance,
                    const std::vector<unsigned int>& ignoreTimeShiftMinutes) :
-        ContainerObject(*this), //trust that ContainerObject knows that *this is not yet fully constructed!
+        ContainerObject(*this, fsObjPool_), //trust that ContainerObject knows that *this is not yet fully constructed!
         filter_(filter), cmpVar_(cmpVar), fileTimeTolerance_(fileTimeTolerance), ignoreTimeShiftMinutes_(ignoreTimeShiftMinutes),
         folderStatusLeft_ (folderStatusLeft),
         folderStatusRight_(folderStatusRight),
@@ -376,35 +530,96 @@ struct FSObjectVisitor
 };
 
 
+template <class T> class ObjectMgr;
+
+//weak reference to an ObjectMgr<T> object: slot index + generation => detects destroyed objects, even if the slot is reused
+template <class T, bool isConst>
+class ObjectMgrId
+{
+public:
+    ObjectMgrId() {}
+    ObjectMgrId(std::nullptr_t) {}
+    template <bool isConstOther> requires (isConst && !isConstOther) //ObjectId => ObjectIdConst
+    ObjectMgrId(const ObjectMgrId<T, isConstOther>& id) : slot_(id.slot_), generation_(id.generation_) {}
+
+    explicit operator bool() const { return generation_ != 0; }
+    bool operator==(const ObjectMgrId&) const = default;
+
+    size_t hash() const { return std::hash<uint64_t>()((static_cast<uint64_t>(generation_) << 32) | slot_); }
+
+private:
+    ObjectMgrId(uint32_t slot, uint32_t generation) : slot_(slot), generation_(generation) {}
+
+    friend class ObjectMgr<T>;
+    friend class ObjectMgrId<T, !isConst>;
+
+    uint32_t slot_       = 0;
+    uint32_t generation_ = 0; //0: nullptr
+};
+
+
 //inherit from this class to allow safe random access by id instead of unsafe raw pointer
 //allow for similar semantics like std::weak_ptr without having to use std::shared_ptr
 template <class T>
 class ObjectMgr
 {
 public:
-    using ObjectId      =       ObjectMgr*;
-    using ObjectIdConst = const ObjectMgr*;
+    using ObjectId      = ObjectMgrId<T, false>;
+    using ObjectIdConst = ObjectMgrId<T, true>;
 
-    ObjectIdConst  getId() const { return this; }
-    /**/  ObjectId getId()       { return this; }
+    ObjectIdConst  getId() const { return ObjectId(slot_, slots_[slot_].generation); }
+    /**/  ObjectId getId()       { return ObjectId(slot_, slots_[slot_].generation); }
 
     static const T* retrieve(ObjectIdConst id) //returns nullptr if object is not valid anymore
     {
-        return static_cast<const T*>(activeObjects_.contains(id) ? id : nullptr);
+        if (id.slot_ < slots_.size() && slots_[id.slot_].generation == id.generation_)
+            return static_cast<const T*>(slots_[id.slot_].obj);
+        return nullptr;
     }
     static T* retrieve(ObjectId id) { return const_cast<T*>(retrieve(static_cast<ObjectIdConst>(id))); }
 
 protected:
-    ObjectMgr () { activeObjects_.insert(this); }
-    ~ObjectMgr() { activeObjects_.erase (this); }
+    ObjectMgr()
+    {
+        if (freeSlots_.empty())
+        {
+            slot_ = static_cast<uint32_t>(slots_.size());
+            slots_.push_back({this, 1 /*generation*/});
+        }
+        else
+        {
+            slot_ = freeSlots_.back();
+            /**/    freeSlots_.pop_back();
+            slots_[slot_].obj = this;
+        }
+    }
+
+    ~ObjectMgr()
+    {
+        Slot& slot = slots_[slot_];
+        slot.obj = nullptr;
+        if (++slot.generation == 0) //invalidate all ids referencing this object
+            slot.generation = 1;
+        freeSlots_.push_back(slot_);
+    }
 
 private:
     ObjectMgr           (const ObjectMgr& rhs) = delete;
     ObjectMgr& operator=(const ObjectMgr& rhs) = delete; //it's not well-defined what copying an objects means regarding object-identity in this context
 
+    struct Slot
+    {
+        const ObjectMgr* obj = nullptr;
+        uint32_t generation = 0;
+    };
+
+    uint32_t slot_ = 0;
+
     //our global ObjectMgr is not thread-safe (and currently does not need to be!)
     //assert(runningOnMainThread()); -> still, may be accessed by synchronization worker threads, one thread at a time
-    static inline std::unordered_set<const ObjectMgr*> activeObjects_; //external linkage!
+    //slots are never released: a reused slot gets the next generation => stale ids don't find the new object
+    static inline std::vector<Slot>     slots_;     //external linkage!
+    static inline std::vector<uint32_t> freeSlots_; //LIFO: reuse memory that is still hot in cache
 };
 
 //------------------------------------------------------------------
@@ -521,6 +736,9 @@ public:
 
     template <SelectSide side> bool isFollowedSymlink() const;
 
+    bool isLastSyncState() const { return attrL_.isLastSyncState && attrR_.isLastSyncState; } //content unchanged since last sync: see FolderAttributes
+    void clearLastSyncState() { attrL_.isLastSyncState = attrR_.isLastSyncState = false; }
+
     SyncOperation getSyncOperation() const override;
 
     template <SelectSide sideTrg>
@@ -994,6 +1212,9 @@ void ContainerObject::updateRelPathsRecursion(const FileSystemObject& fsAlias)
 
 inline
 ContainerObject::ContainerObject(const FileSystemObject& fsAlias) :
+    subFiles_  (fsAlias.parent().subFiles_  .get_allocator()), //same FsObjectPool as parent
+    subLinks_  (fsAlias.parent().subLinks_  .get_allocator()), //
+    subFolders_(fsAlias.parent().subFolders_.get_allocator()), //
     relPathL_(appendPath(fsAlias.parent().relPathL_, fsAlias.getItemName<SelectSide::left>())),
     relPathR_(fsAlias.parent().relPathL_.c_str() ==               //
               fsAlias.parent().relPathR_.c_str() &&               //take advantage of FileSystemObject's Zstring reuse:
@@ -1555,4 +1776,8 @@ time_t SymlinkPair::getLastWriteTime() const
 }
 }
 
+
+template <class T, bool isConst>
+struct std::hash<fff::ObjectMgrId<T, isConst>> { size_t operator()(const fff::ObjectMgrId<T, isConst>& id) const { return id.hash(); } };
+
 #endif //FILE_HIERARCHY_H_257235289645296
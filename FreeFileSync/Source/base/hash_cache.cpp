@@ -0,0 +1,223 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "hash_cache.h"
+#include <zen/crc.h>
+#include <zen/file_access.h>
+#include <zen/file_io.h>
+#include <zen/zlib_wrap.h>
+#include <zen/globals.h>
+
+using namespace zen;
+using namespace fff;
+
+
+namespace
+{
+//-------------------------------------------------------------------------------------------------------------------------------
+const char HASH_CACHE_FILE_DESCR[] = "FreeFileSync";
+const int HASH_CACHE_FILE_VERSION = 1; //2026-10-16
+//-------------------------------------------------------------------------------------------------------------------------------
+
+constinit Global<Zstring> globalCacheDirPath; //see hashCacheInit()
+
+//same rule as for the folder snapshot (afs/native.cpp): changes within the same file time tick would go unnoticed
+bool isRacyEntry(time_t modTime, time_t hashTime)
+{
+    return modTime + 2 >= hashTime;
+}
+
+Zstring getCacheFilePath(const Zstring& baseFolderPathPhrase)
+{
+    const std::shared_ptr<Zstring> cacheDirPath = globalCacheDirPath.get();
+    if (!cacheDirPath)
+    {
+        assert(false); //hashCacheInit() missing
+        return Zstring(); //=> no caching
+    }
+    //CRC collision? => no problem: full base folder path is checked during load()
+    return appendPath(*cacheDirPath, printNumber<Zstring>(Zstr("%08x"), static_cast<unsigned int>(getCrc32(utfTo<std::string>(baseFolderPathPhrase)))) + Zstr(".ffs_hash"));
+}
+}
+
+
+void fff::hashCacheInit(const Zstring& cacheDirPath)
+{
+    globalCacheDirPath.set(std::make_unique<Zstring>(cacheDirPath));
+}
+
+
+ContentHashCache::ContentHashCache(const AbstractPath& baseFolderPath) :
+    baseFolderPathPhrase_(AFS::getInitPathPhrase(baseFolderPath)),
+    cacheFilePath_(getCacheFilePath(baseFolderPathPhrase_)) {}
+
+
+ContentHashCache::CacheEntries ContentHashCache::readCacheFile() const //throw FileError
+{
+    if (cacheFilePath_.empty() || !itemExists(cacheFilePath_)) //throw FileError
+        return {};
+
+    const std::string byteStream = getFileContent(cacheFilePath_, nullptr /*notifyUnbufferedIO*/); //throw FileError
+    try
+    {
+        MemoryStreamIn memStreamIn(byteStream);
+
+        char formatDescr[sizeof(HASH_CACHE_FILE_DESCR)] = {};
+        readArray(memStreamIn, formatDescr, sizeof(formatDescr)); //throw SysErrorUnexpectedEos
+
+        if (!std::equal(HASH_CACHE_FILE_DESCR, HASH_CACHE_FILE_DESCR + sizeof(HASH_CACHE_FILE_DESCR), formatDescr))
+            throw SysError(_("File content is corrupted.") + L" (invalid header)");
+
+        const int version = readNumber<int32_t>(memStreamIn); //throw SysErrorUnexpectedEos
+        if (version != HASH_CACHE_FILE_VERSION)
+            throw SysError(_("Unsupported data format.") + L' ' + replaceCpy(_("Version: %x"), L"%x", numberTo<std::wstring>(version)));
+
+        assert(byteStream.size() >= sizeof(uint32_t));
+        MemoryStreamOut crcStreamOut;
+        writeNumber<uint32_t>(crcStreamOut, getCrc32(byteStream.begin(), byteStream.end() - sizeof(uint32_t)));
+
+        if (!endsWith(byteStream, crcStreamOut.ref()))
+            throw SysError(_("File content is corrupted.") + L" (invalid checksum)");
+
+        if (utfTo<Zstring>(readContainer<std::string>(memStreamIn)) != baseFolderPathPhrase_) //throw SysErrorUnexpectedEos
+            return {}; //cache belongs to a different base folder (CRC collision)
+
+        const std::string rawStream = decompress(readContainer<std::string>(memStreamIn)); //throw SysError, SysErrorUnexpectedEos
+        MemoryStreamIn rawStreamIn(rawStream);
+
+        CacheEntries entries;
+        size_t entryCount = readNumber<uint32_t>(rawStreamIn); //throw SysErrorUnexpectedEos
+        while (entryCount-- != 0)
+        {
+            const Zstring relPath = utfTo<Zstring>(readContainer<std::string>(rawStreamIn)); //throw SysErrorUnexpectedEos
+
+            CacheEntry entry;
+            entry.fileSize  = readNumber<uint64_t>(rawStreamIn); //
+            entry.modTime   = readNumber<int64_t >(rawStreamIn); //throw SysErrorUnexpectedEos
+            entry.filePrint = readNumber<uint64_t>(rawStreamIn); //
+            entry.hashTime  = readNumber<int64_t >(rawStreamIn); //
+            readArray(rawStreamIn, entry.digest.data(), entry.digest.size()); //
+
+            entries.emplace(relPath, entry);
+        }
+        return entries;
+    }
+    catch (const SysError& e) { throw FileError(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(cacheFilePath_)), e.toString()); }
+}
+
+
+void ContentHashCache::load() //throw FileError
+{
+    entries_.clear();
+    entriesInserted_.clear();
+    entriesRemoved_ .clear();
+
+    entries_ = readCacheFile(); //throw FileError
+}
+
+
+void ContentHashCache::save() //throw FileError
+{
+    if (cacheFilePath_.empty() ||
+        (entriesInserted_.empty() && entriesRemoved_.empty())) //nothing changed since load()
+        return;
+
+    //merge: another instance may have saved the same cache file since load()
+    CacheEntries entries = [&]
+    {
+        try { return readCacheFile(); } //throw FileError
+        catch (FileError&) { return entries_; } //corrupted => overwrite, but don't lose what we loaded
+    }();
+
+    for (const Zstring& relPath : entriesRemoved_)
+        entries.erase(relPath);
+
+    for (const auto& [relPath, entry] : entriesInserted_)
+        entries.insert_or_assign(relPath, entry);
+    try
+    {
+        MemoryStreamOut rawStreamOut;
+        writeNumber(rawStreamOut, static_cast<uint32_t>(entries.size()));
+
+        for (const auto& [relPath, entry] : entries)
+        {
+            writeContainer(rawStreamOut, utfTo<std::string>(relPath));
+            writeNumber<uint64_t>(rawStreamOut, entry.fileSize);
+            writeNumber<int64_t >(rawStreamOut, entry.modTime);
+            writeNumber<uint64_t>(rawStreamOut, entry.filePrint);
+            writeNumber<int64_t >(rawStreamOut, entry.hashTime);
+            writeArray(rawStreamOut, entry.digest.data(), entry.digest.size());
+        }
+
+        MemoryStreamOut memStreamOut;
+        writeArray(memStreamOut, HASH_CACHE_FILE_DESCR, sizeof(HASH_CACHE_FILE_DESCR));
+        writeNumber<int32_t>(memStreamOut, HASH_CACHE_FILE_VERSION);
+        writeContainer(memStreamOut, utfTo<std::string>(baseFolderPathPhrase_));
+        writeContainer(memStreamOut, compress(rawStreamOut.ref(), 3 /*level: fast*/)); //throw SysError
+        writeNumber<uint32_t>(memStreamOut, getCrc32(memStreamOut.ref()));
+
+        if (const std::optional<Zstring> parentPath = getParentFolderPath(cacheFilePath_))
+            createDirectoryIfMissingRecursion(*parentPath); //throw FileError
+
+        //crash while writing? => old cache file stays intact
+        const Zstring tmpFilePath = getPathWithTempName(cacheFilePath_);
+
+        FileOutputBuffered tmpFile(tmpFilePath, nullptr /*notifyUnbufferedIO*/); //throw FileError, (ErrorTargetExisting)
+        tmpFile.write(memStreamOut.ref().data(), memStreamOut.ref().size()); //throw FileError
+        tmpFile.finalize(); //throw FileError
+        //take over ownership:
+        ZEN_ON_SCOPE_FAIL( try { removeFilePlain(tmpFilePath); }
+        catch (FileError&) {});
+
+        moveAndRenameItem(tmpFilePath, cacheFilePath_, true /*replaceExisting*/); //throw FileError, (ErrorMoveUnsupported), (ErrorTargetExisting)
+    }
+    catch (const SysError& e) { throw FileError(replaceCpy(_("Cannot write file %x."), L"%x", fmtPath(cacheFilePath_)), e.toString()); }
+
+    entries_ = std::move(entries);
+    entriesInserted_.clear();
+    entriesRemoved_ .clear();
+}
+
+
+std::optional<ContentDigest> ContentHashCache::find(const Zstring& relPath, const FileAttributes& attr)
+{
+    if (attr.filePrint == 0) //no file print => no caching
+        return {};
+
+    auto it = entries_.find(relPath);
+    if (it == entries_.end())
+        return {};
+
+    const CacheEntry& entry = it->second;
+    if (entry.fileSize  != attr.fileSize ||
+        entry.modTime   != attr.modTime  ||
+        entry.filePrint != attr.filePrint ||
+        isRacyEntry(entry.modTime, entry.hashTime)) //e.g. modification time in the future
+    {
+        //file changed: entry is outdated for good
+        entries_.erase(it);
+        entriesInserted_.erase(relPath);
+        entriesRemoved_ .insert(relPath);
+        return {};
+    }
+    return entry.digest;
+}
+
+
+void ContentHashCache::insert(const Zstring& relPath, const FileAttributes& attr, const ContentDigest& digest)
+{
+    if (attr.filePrint == 0) //no file print => no caching
+        return;
+
+    const time_t hashTime = std::time(nullptr); //*after* reading the file content
+    if (isRacyEntry(attr.modTime, hashTime)) //digest is fine for this comparison, but a change within the same file time tick would go unnoticed next time
+        return;
+
+    const CacheEntry entry{attr.fileSize, attr.modTime, attr.filePrint, hashTime, digest};
+    entries_        .insert_or_assign(relPath, entry);
+    entriesInserted_.insert_or_assign(relPath, entry);
+    entriesRemoved_ .erase(relPath);
+}
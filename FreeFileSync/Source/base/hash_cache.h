@@ -0,0 +1,67 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#ifndef HASH_CACHE_H_4390857234908572340895
+#define HASH_CACHE_H_4390857234908572340895
+
+#include <unordered_map>
+#include <unordered_set>
+#include "binary.h"
+#include "file_hierarchy.h"
+
+
+namespace fff
+{
+void hashCacheInit(const Zstring& cacheDirPath); //directory to store the cache files: local config folder
+
+/* Persistent content digests for "compare by content": skip reading files that did not change since the last comparison
+    - one cache file per base folder, stored in the local config folder: don't write to the base folders during comparison!
+    - entry is valid as long as file size, modification time and file print are unchanged
+      => only files with a file print are cached, e.g. native file system: inode
+    - "racy" entry: modification time within 2 seconds of the hash time => a later change within the same file time tick
+      (FileAttributes::modTime: whole seconds, FAT: 2 seconds) would go unnoticed => not cached, not trusted
+    - save(): entries not looked up are kept (files outside of the comparison), entries found outdated are removed
+      => merged with the cache file as stored by then (other instance), written to a temp file first, then renamed
+    - NOT thread-safe!          */
+class ContentHashCache
+{
+public:
+    explicit ContentHashCache(const AbstractPath& baseFolderPath);
+
+    void load(); //throw FileError; not existing: no error
+    void save(); //throw FileError
+
+    std::optional<ContentDigest> find(const Zstring& relPath, const FileAttributes& attr);
+    void insert(const Zstring& relPath, const FileAttributes& attr, const ContentDigest& digest);
+
+private:
+    ContentHashCache           (const ContentHashCache&) = delete;
+    ContentHashCache& operator=(const ContentHashCache&) = delete;
+
+    struct CacheEntry
+    {
+        uint64_t fileSize = 0;
+        time_t modTime = 0;
+        AFS::FingerPrint filePrint = 0;
+        time_t hashTime = 0; //when digest was calculated
+        ContentDigest digest{};
+    };
+
+    using CacheEntries = std::unordered_map<Zstring, CacheEntry>;
+
+    CacheEntries readCacheFile() const; //throw FileError
+
+    const Zstring baseFolderPathPhrase_;
+    const Zstring cacheFilePath_;
+
+    CacheEntries entries_; //loaded + inserted
+    //changes since load(): apply on top of the cache file when saving
+    CacheEntries entriesInserted_;
+    std::unordered_set<Zstring> entriesRemoved_; //outdated
+};
+}
+
+#endif //HASH_CACHE_H_4390857234908572340895
@@ -171,7 +171,8 @@ private:
         std::wstring filePath;
         {
             std::lock_guard dummy(lockCurrentStatus_);
-            parallelOpsTotal = activeThreadIdxs_.size();
+            for (const auto& [threadIdx, parallelOps] : activeThreadIdxs_)
+                parallelOpsTotal += parallelOps;
             filePath = currentFile_;
         }
         if (parallelOpsTotal >= 2)
@@ -209,6 +210,7 @@ struct TraverserConfig
     const AbstractPath baseFolderPath;  //thread-safe like an int! :)
     const FilterRef filter;
     const SymLinkHandling handleSymlinks;
+    const PartialTraversal* const partial; //optional
 
     std::unordered_map<Zstring, Zstringc>& failedDirReads;
     std::unordered_map<Zstring, Zstringc>& failedItemReads;
@@ -225,11 +227,13 @@ public:
     DirCallback(TraverserConfig& cfg,
                 Zstring&& parentRelPathPf, //postfixed with FILE_NAME_SEPARATOR (or empty!)
                 FolderContainer& output,
-                int level) :
+                int level,
+                const InSyncFolder* lastSyncFolder) : //optional: partial traversal
         cfg_(cfg),
         parentRelPathPf_(std::move(parentRelPathPf)),
         output_(output),
-        level_(level) {} //MUST NOT use cfg_ during construction! see BaseDirCallback()
+        level_(level),
+        lastSyncFolder_(lastSyncFolder) {} //MUST NOT use cfg_ during construction! see BaseDirCallback()
 
     virtual void                               onFile   (const AFS::FileInfo&    fi) override; //
     virtual std::shared_ptr<TraverserCallback> onFolder (const AFS::FolderInfo&  fi) override; //throw ThreadStopRequest
@@ -241,24 +245,28 @@ public:
 private:
     HandleError reportError(const ErrorInfo& errorInfo, const Zstring& itemName /*optional*/); //throw ThreadStopRequest
 
+    void addLastSyncState(const InSyncFolder& lastSyncFolder, const Zstring& relPathPf, FolderContainer& output); //throw ThreadStopRequest
+
     TraverserConfig& cfg_;
     const Zstring parentRelPathPf_;
     FolderContainer& output_;
     const int level_;
+    const InSyncFolder* const lastSyncFolder_;
 };
 
 
 class BaseDirCallback : public DirCallback
 {
 public:
-    BaseDirCallback(const DirectoryKey& baseFolderKey, DirectoryValue& output,
+    BaseDirCallback(const DirectoryKey& baseFolderKey, const PartialTraversal* partial, DirectoryValue& output,
                     AsyncCallback& acb, int threadIdx, std::chrono::steady_clock::time_point& lastReportTime) :
-        DirCallback(travCfg_ /*not yet constructed!!!*/, Zstring(), output.folderCont, 0 /*level*/),
+        DirCallback(travCfg_ /*not yet constructed!!!*/, Zstring(), output.folderCont, 0 /*level*/, partial ? &partial->lastSyncState.ref() : nullptr),
         travCfg_
     {
         baseFolderKey.folderPath,
         baseFolderKey.filter,
         baseFolderKey.handleSymlinks,
+        partial,
         output.failedFolderReads,
         output.failedItemReads,
         acb,
@@ -270,6 +278,10 @@ public:
             acb.reportCurrentFile(AFS::getDisplayPath(baseFolderKey.folderPath)); //just in case first directory access is blocking
     }
 
+    //listings are replayed via DirCallback => filter is applied as usual
+    //partial traversal: don't replace the snapshot of the full folder tree with the few folders read
+    bool allowFolderSnapshot() const override { return !travCfg_.partial; }
+
 private:
     TraverserConfig travCfg_;
 };
@@ -321,7 +333,19 @@ std::shared_ptr<AFS::TraverserCallback> DirCallback::onFolder(const AFS::FolderI
         return nullptr; //do NOT traverse subdirs
     //else: ensure directory filtering is applied later to exclude actually filtered directories!!!
 
-    FolderContainer& subFolder = output_.addFolder(fi.itemName, {.isFollowedSymlink = fi.isFollowedSymlink});
+    //partial traversal: unchanged sub folders are taken from last synchronous state, unknown ones are traversed completely
+    //incomplete sub folders (e.g. items not in sync) are listed, their sub folders decided alike
+    const InSyncFolder* lastSyncSubFolder = nullptr;
+    bool useLastSyncState = false;
+    if (lastSyncFolder_ && !cfg_.partial->rescanFolders.contains(relPath))
+        if (auto it = lastSyncFolder_->refFolders().find(fi.itemName);
+            it != lastSyncFolder_->refFolders().end())
+        {
+            lastSyncSubFolder = &it->second;
+            useLastSyncState = !cfg_.partial->changedFolders.contains(relPath) && lastSyncSubFolder->isComplete();
+        }
+
+    FolderContainer& subFolder = output_.addFolder(fi.itemName, {.isFollowedSymlink = fi.isFollowedSymlink, .isLastSyncState = useLastSyncState});
     if (passFilter)
         cfg_.acb.incItemsScanned(); //add 1 element to the progress indicator
 
@@ -338,7 +362,61 @@ std::shared_ptr<AFS::TraverserCallback> DirCallback::onFolder(const AFS::FolderI
                     return nullptr;
             }
 
-    return std::make_shared<DirCallback>(cfg_, std::move(relPath += FILE_NAME_SEPARATOR), subFolder, level_ + 1);
+    if (useLastSyncState)
+    {
+        addLastSyncState(*lastSyncSubFolder, relPath + FILE_NAME_SEPARATOR, subFolder); //throw ThreadStopRequest
+        return nullptr;
+    }
+
+    return std::make_shared<DirCallback>(cfg_, std::move(relPath += FILE_NAME_SEPARATOR), subFolder, level_ + 1, lastSyncSubFolder);
+}
+
+
+//items are known to exist on both sides with the attributes stored in sync.ffs_db => same filtering as for items read from disk
+//sync.ffs_db stores item names in Unicode normal form: equal to names on disk for complete folders only
+void DirCallback::addLastSyncState(const InSyncFolder& lastSyncFolder, const Zstring& relPathPf, FolderContainer& output) //throw ThreadStopRequest
+{
+    assert(lastSyncFolder.isComplete()); //=> sub folders, too
+    interruptionPoint(); //throw ThreadStopRequest
+
+    const bool leftSide = cfg_.partial->side == SelectSide::left;
+
+    for (const auto& [fileName, file] : lastSyncFolder.refFiles())
+        if (cfg_.filter.ref().passFileFilter(relPathPf + fileName.normStr))
+        {
+            const InSyncDescrFile& descr = leftSide ? file.left : file.right;
+            output.addFile(fileName.normStr,
+            {
+                .modTime = descr.modTime,
+                .fileSize = file.fileSize,
+                .filePrint = descr.filePrint,
+            });
+            cfg_.acb.incItemsScanned(); //add 1 element to the progress indicator
+        }
+
+    if (cfg_.handleSymlinks == SymLinkHandling::asLink)
+        for (const auto& [linkName, symlink] : lastSyncFolder.refSymlinks())
+            if (cfg_.filter.ref().passFileFilter(relPathPf + linkName.normStr))
+            {
+                output.addLink(linkName.normStr, {.modTime = (leftSide ? symlink.left : symlink.right).modTime});
+                cfg_.acb.incItemsScanned();
+            }
+
+    for (const auto& [folderName, folder] : lastSyncFolder.refFolders())
+    {
+        const Zstring& relPath = relPathPf + folderName.normStr;
+
+        bool childItemMightMatch = true;
+        const bool passFilter = cfg_.filter.ref().passDirFilter(relPath, &childItemMightMatch);
+        if (!passFilter && !childItemMightMatch)
+            continue;
+
+        FolderContainer& subFolder = output.addFolder(folderName.normStr, {.isLastSyncState = true});
+        if (passFilter)
+            cfg_.acb.incItemsScanned();
+
+        addLastSyncState(folder, relPath + FILE_NAME_SEPARATOR, subFolder); //throw ThreadStopRequest
+    }
 }
 
 
@@ -396,6 +474,7 @@ DirCallback::HandleError DirCallback::reportError(const ErrorInfo& errorInfo, co
             break;
 
         case HandleError::retry:
+            output_.expectDuplicates(); //items already added will be reported again
             break;
     }
     return handleErr;
@@ -404,6 +483,8 @@ DirCallback::HandleError DirCallback::reportError(const ErrorInfo& errorInfo, co
 
 
 std::map<DirectoryKey, DirectoryValue> fff::parallelDeviceTraversal(const std::set<DirectoryKey>& foldersToRead,
+                                                                    const std::map<DirectoryKey, PartialTraversal>& partialTraversals,
+                                                                    const std::map<AfsDevice, size_t>& deviceParallelOps,
                                                                     const TravErrorCb& onError, const TravStatusCb& onStatusUpdate,
                                                                     std::chrono::milliseconds cbInterval)
 {
@@ -432,11 +513,14 @@ std::map<DirectoryKey, DirectoryValue> fff::parallelDeviceTraversal(const std::s
         Zstring threadName = Zstr("Compare[") + numberTo<Zstring>(threadIdx + 1) + Zstr('/') + numberTo<Zstring>(perDeviceFolders.size()) + Zstr("] ") +
                              utfTo<Zstring>(AFS::getDisplayPath({afsDevice, AfsPath()}));
 
-        const size_t parallelOps = 1;
-        std::map<DirectoryKey, DirectoryValue*> workload;
+        const size_t parallelOps = getDeviceParallelOps(deviceParallelOps, afsDevice);
+        std::map<DirectoryKey, std::pair<DirectoryValue*, const PartialTraversal*>> workload;
 
         for (const DirectoryKey& key : dirKeys)
-            workload.emplace(key, &output[key]); //=> DirectoryValue* unshared for lock-free worker-thread access
+        {
+            auto itP = partialTraversals.find(key);
+            workload.emplace(key, std::pair(&output[key], itP != partialTraversals.end() ? &itP->second : nullptr)); //=> DirectoryValue* unshared for lock-free worker-thread access
+        }
 
         worker.emplace_back([afsDevice /*clang bug*/= afsDevice, workload, threadIdx, &acb, parallelOps, threadName = std::move(threadName)]() mutable
         {
@@ -452,7 +536,8 @@ std::map<DirectoryKey, DirectoryValue> fff::parallelDeviceTraversal(const std::s
             for (auto& [folderKey, folderVal] : workload)
             {
                 assert(folderKey.folderPath.afsDevice == afsDevice);
-                travWorkload.emplace_back(folderKey.folderPath.afsPath, std::make_shared<BaseDirCallback>(folderKey, *folderVal, acb, threadIdx, lastReportTime));
+                const auto& [dirVal, partial] = folderVal;
+                travWorkload.emplace_back(folderKey.folderPath.afsPath, std::make_shared<BaseDirCallback>(folderKey, partial, *dirVal, acb, threadIdx, lastReportTime));
             }
             AFS::traverseFolderRecursive(afsDevice, travWorkload, parallelOps); //throw ThreadStopRequest
         });
@@ -10,10 +10,12 @@
 #include <map>
 #include <set>
 #include <chrono>
+#include <unordered_set>
 #include "path_filter.h"
 #include "structures.h"
 #include "file_hierarchy.h"
 #include "process_callback.h"
+#include "db_file.h"
 
 
 namespace fff
@@ -30,7 +32,8 @@ struct DirectoryKey
 
 struct DirectoryValue
 {
-    FolderContainer folderCont;
+    ScanArena arena; //memory for folderCont: declare first!
+    FolderContainer folderCont{arena};
 
     //relative paths (or empty string for root) for directories that could not be read (completely), e.g. access denied, or temporary network drop
     std::unordered_map<Zstring, Zstringc /*error message*/> failedFolderReads;
@@ -40,6 +43,20 @@ struct DirectoryValue
 };
 
 
+/* partial traversal: read only folders affected by known changes, take everything else from the last synchronous state
+    - base folder and "changedFolders" are listed, their sub folders are taken from "lastSyncState" if possible
+    - folders not complete in "lastSyncState" (see InSyncFolder::isComplete()) are listed, too
+    - "rescanFolders" (and folders missing in "lastSyncState") are traversed completely
+    - lastSyncState must be fully decoded: accessed by worker threads!       */
+struct PartialTraversal
+{
+    zen::SharedRef<const InSyncFolder> lastSyncState;
+    SelectSide side = SelectSide::left;
+    std::unordered_set<Zstring> changedFolders; //relative paths (never empty)
+    std::unordered_set<Zstring> rescanFolders;  //
+};
+
+
 //Attention: 1. ensure directory filtering is applied later to exclude filtered folders which have been kept as parent folders
 //           2. remove folder aliases (e.g. case differences) *before* calling this function!!!
 
@@ -47,6 +64,8 @@ using TravErrorCb  = std::function<PhaseCallback::Response(const PhaseCallback::
 using TravStatusCb = std::function<void(const std::wstring& statusLine, int itemsTotal)>;
 
 std::map<DirectoryKey, DirectoryValue> parallelDeviceTraversal(const std::set<DirectoryKey>& foldersToRead,
+                                                               const std::map<DirectoryKey, PartialTraversal>& partialTraversals, //optional
+                                                               const std::map<AfsDevice, size_t>& deviceParallelOps,
                                                                const TravErrorCb& onError, const TravStatusCb& onStatusUpdate, //NOT optional
                                                                std::chrono::milliseconds cbInterval);
 }
@@ -6,6 +6,9 @@
 
 #include "path_filter.h"
 #include <typeindex>
+#include <array>
+#include <map>
+#include <unordered_map>
 #include <zen/file_path.h>
 
 using namespace zen;
@@ -88,6 +91,9 @@ void NameFilter::parseFilterPhrase(const Zstring& filterPhrase, FilterSet& filte
             }
         }
     });
+
+    filter.fileMasks  .compile();
+    filter.folderMasks.compile();
 }
 
 
@@ -105,6 +111,8 @@ void NameFilter::MaskMatcher::insert(const Zstring& mask)
         relPaths_   .insert(mask);
         relPathsCmp_.insert(mask); //little memory wasted thanks to COW string!
     }
+    dfaMatches_.reset(); //outdated: recompile!
+    dfaBegin_  .reset(); //
 }
 
 
@@ -200,12 +208,272 @@ bool matchesMaskBegin<false /*haveWildcards*/>(const ZstringView relPath, const
 }
 
 
+/*  all masks of a MaskMatcher compiled into a single DFA: matching time is linear in path length, independent of the number of masks
+    - subset construction over the char positions of all masks; alphabet reduced to equivalence classes of chars
+    - built eagerly: NameFilter is used by multiple threads during traversal => no lazy state!
+    - two flavors, same semantics as matchesMask() and matchesMaskBegin():
+        fullMatch:   path or any parent path matches a mask
+        prefixMatch: path matches (only!) the beginning of a mask      */
+class NameFilter::MaskDfa
+{
+public:
+    enum class Mode
+    {
+        fullMatch,
+        prefixMatch,
+    };
+
+    //nullptr if too many states: e.g. many masks with multiple '*' => fall back to matching mask by mask
+    static std::shared_ptr<const MaskDfa> compile(const std::vector<Zstring>& masks, Mode mode)
+    {
+        auto dfa = std::make_shared<MaskDfa>(mode);
+
+        //NFA: masks concatenated, each followed by 0 (= end position)
+        std::vector<Zchar> nfa;
+        std::vector<uint32_t> startSet;
+        for (const Zstring& mask : masks)
+        {
+            startSet.push_back(static_cast<uint32_t>(nfa.size()));
+            for (const Zchar c : mask)
+                if (c != Zstr('*') || nfa.empty() || nfa.back() != Zstr('*')) //"**" is the same as "*"
+                    nfa.push_back(c);
+            nfa.push_back(0);
+        }
+
+        /*  positions with the same remaining mask behave the same => use first one only
+            avoids state explosion, e.g. "ABC*.TMP" + "XYZ*.TMP" + "*.EXT": "*.TMP" would otherwise multiply the states of "*.EXT"   */
+        std::vector<uint32_t> canonicalPos(nfa.size());
+        {
+            std::unordered_map<ZstringView, uint32_t> posBySuffix;
+            for (uint32_t pos = 0, posEnd = 0; pos < nfa.size(); ++pos)
+            {
+                if (pos == 0 || nfa[pos - 1] == 0) //start of mask
+                    posEnd = static_cast<uint32_t>(std::find(nfa.begin() + pos, nfa.end(), 0) - nfa.begin());
+
+                canonicalPos[pos] = posBySuffix.emplace(ZstringView(&nfa[pos], posEnd - pos), pos).first->second;
+            }
+        }
+        for (uint32_t& pos : startSet)
+            pos = canonicalPos[pos];
+
+        //alphabet: chars used by masks + FILE_NAME_SEPARATOR + class 0 for all other chars (at most 254 classes: no 0, '*', '?')
+        std::vector<Zchar> classRep{0};
+        auto addCharClass = [&](Zchar c)
+        {
+            uint8_t& cls = dfa->charClass_[static_cast<unsigned char>(c)];
+            if (cls == 0)
+            {
+                cls = static_cast<uint8_t>(classRep.size());
+                classRep.push_back(c);
+            }
+        };
+        addCharClass(FILE_NAME_SEPARATOR);
+        for (const Zchar c : nfa)
+            if (c != 0 && c != Zstr('*') && c != Zstr('?'))
+                addCharClass(c);
+
+        for (unsigned int c = 1; c < 256; ++c) //representative of class 0: any char not used by masks, e.g. '*'
+            if (dfa->charClass_[c] == 0)
+            {
+                classRep[0] = static_cast<Zchar>(c);
+                break;
+            }
+        dfa->classCount_ = classRep.size();
+
+        auto closure = [&](std::vector<uint32_t>& posSet)
+        {
+            if (mode == Mode::fullMatch) //'*' may match an empty string; no "**" => single step suffices
+                for (size_t i = 0, count = posSet.size(); i < count; ++i)
+                    if (nfa[posSet[i]] == Zstr('*'))
+                        posSet.push_back(canonicalPos[posSet[i] + 1]);
+
+            std::sort(posSet.begin(), posSet.end());
+            posSet.erase(std::unique(posSet.begin(), posSet.end()), posSet.end());
+        };
+
+        auto step = [&](const std::vector<uint32_t>& posSet, Zchar c, std::vector<uint32_t>& posSetNext)
+        {
+            for (const uint32_t pos : posSet)
+            {
+                const Zchar m = nfa[pos];
+                if (m == Zstr('*'))
+                {
+                    if (mode == Mode::fullMatch) //'*' also matches FILE_NAME_SEPARATOR
+                        posSetNext.push_back(pos);
+                }
+                else if (m == Zstr('?') ? c != FILE_NAME_SEPARATOR : (m != 0 && m == c))
+                    posSetNext.push_back(canonicalPos[pos + 1]);
+            }
+        };
+
+        //fullMatch: a leading '*' stays active forever => part of every state: don't store with each state, e.g. 300 x "*.EXT"
+        std::vector<uint32_t> alwaysSet;
+        if (mode == Mode::fullMatch)
+            for (const uint32_t pos : startSet)
+                if (nfa[pos] == Zstr('*'))
+                    alwaysSet.push_back(pos);
+        closure(alwaysSet);
+
+        auto removeAlwaysSet = [&](std::vector<uint32_t>& posSet)
+        {
+            std::erase_if(posSet, [&](uint32_t pos) { return std::binary_search(alwaysSet.begin(), alwaysSet.end(), pos); });
+        };
+
+        auto getFlags = [&](const std::vector<uint32_t>& posSet)
+        {
+            uint8_t flags = 0;
+            for (const uint32_t pos : posSet)
+                if (mode == Mode::fullMatch)
+                {
+                    if (nfa[pos] == 0)
+                        flags |= FLAG_END;
+                    else if (nfa[pos] == Zstr('*') && nfa[pos + 1] == 0)
+                        flags |= FLAG_MATCH_ANY;
+                }
+                else
+                {
+                    if (nfa[pos] == Zstr('*'))
+                        flags |= FLAG_MATCH_ANY;
+                    else if (nfa[pos] == FILE_NAME_SEPARATOR && nfa[pos + 1] != 0) //require strict sub match
+                        flags |= FLAG_END;
+                }
+            return flags;
+        };
+        const uint8_t alwaysFlags = getFlags(alwaysSet);
+
+        std::map<std::vector<uint32_t>, uint32_t> stateIds;
+        std::vector<std::pair<uint32_t, const std::vector<uint32_t>*>> pendingStates;
+
+        auto getStateId = [&](const std::vector<uint32_t>& posSet /*without alwaysSet*/) -> std::optional<uint32_t>
+        {
+            if (posSet.empty() && alwaysSet.empty())
+                return STATE_DEAD;
+
+            if (auto it = stateIds.find(posSet);
+                it != stateIds.end())
+                return it->second;
+
+            if ((dfa->flags_.size() + 1) * dfa->classCount_ > DFA_TABLE_SIZE_MAX)
+                return std::nullopt;
+
+            const auto it = stateIds.emplace(posSet, static_cast<uint32_t>(dfa->flags_.size())).first;
+            dfa->flags_.push_back(getFlags(posSet) | alwaysFlags);
+            dfa->next_.resize(dfa->flags_.size() * dfa->classCount_, STATE_DEAD);
+            pendingStates.emplace_back(it->second, &it->first); //std::map: stable references
+            return it->second;
+        };
+
+        dfa->flags_.push_back(0);                           //STATE_DEAD
+        dfa->next_.resize(dfa->classCount_, STATE_DEAD); //
+
+        closure(startSet);
+        removeAlwaysSet(startSet);
+        if (!getStateId(startSet)) //STATE_START
+            return nullptr;
+
+        std::vector<std::vector<uint32_t>> alwaysSetNext(dfa->classCount_); //same for all states
+        for (size_t cls = 0; cls < dfa->classCount_; ++cls)
+        {
+            step(alwaysSet, classRep[cls], alwaysSetNext[cls]);
+            closure        (alwaysSetNext[cls]);
+            removeAlwaysSet(alwaysSetNext[cls]);
+        }
+
+        std::vector<uint32_t> posSetNext;
+        while (!pendingStates.empty())
+        {
+            const auto [stateId, posSetPtr] = pendingStates.back();
+            /**/                              pendingStates.pop_back();
+            const std::vector<uint32_t>& posSet = *posSetPtr;
+
+            if (dfa->flags_[stateId] & FLAG_MATCH_ANY) //matching stops here: no transitions needed
+                continue;
+
+            for (size_t cls = 0; cls < dfa->classCount_; ++cls)
+            {
+                posSetNext = alwaysSetNext[cls];
+                step(posSet, classRep[cls], posSetNext);
+                closure(posSetNext);
+                removeAlwaysSet(posSetNext);
+
+                const std::optional<uint32_t> stateIdNext = getStateId(posSetNext);
+                if (!stateIdNext)
+                    return nullptr;
+                dfa->next_[stateId * dfa->classCount_ + cls] = *stateIdNext;
+            }
+        }
+        return dfa;
+    }
+
+    explicit MaskDfa(Mode mode) : mode_(mode) {}
+
+    bool matches(const ZstringView relPath) const
+    {
+        uint32_t stateId = STATE_START;
+        if (flags_[stateId] & FLAG_MATCH_ANY)
+            return true;
+
+        for (const Zchar c : relPath)
+        {
+            if (mode_ == Mode::fullMatch && c == FILE_NAME_SEPARATOR && (flags_[stateId] & FLAG_END)) //parent path match
+                return true;
+
+            stateId = next_[stateId * classCount_ + charClass_[static_cast<unsigned char>(c)]];
+            if (stateId == STATE_DEAD)
+                return false;
+
+            if (flags_[stateId] & FLAG_MATCH_ANY)
+                return true;
+        }
+        return flags_[stateId] & FLAG_END;
+    }
+
+private:
+    MaskDfa           (const MaskDfa&) = delete;
+    MaskDfa& operator=(const MaskDfa&) = delete;
+
+    static constexpr uint32_t STATE_DEAD  = 0;
+    static constexpr uint32_t STATE_START = 1;
+
+    static constexpr uint8_t FLAG_END       = 1; //fullMatch: end of a mask; prefixMatch: path end would be a strict sub match
+    static constexpr uint8_t FLAG_MATCH_ANY = 2; //any continuation matches: trailing '*' (fullMatch), '*' reached (prefixMatch)
+
+    static constexpr size_t DFA_TABLE_SIZE_MAX = 1024 * 1024; //4 MB per DFA at most
+
+    const Mode mode_;
+    std::array<uint8_t, 256> charClass_{}; //Zchar -> equivalence class
+    static_assert(sizeof(Zchar) == 1);
+    size_t classCount_ = 0;
+    std::vector<uint32_t> next_; //state x char class -> state
+    std::vector<uint8_t> flags_;
+};
+
+
+void NameFilter::MaskMatcher::compile()
+{
+    if (!realMasks_.empty())
+        dfaMatches_ = MaskDfa::compile({realMasks_.begin(), realMasks_.end()}, MaskDfa::Mode::fullMatch);
+
+    if (!realMasks_.empty() || !relPaths_.empty())
+    {
+        std::vector<Zstring> masks(realMasks_.begin(), realMasks_.end());
+        masks.insert(masks.end(), relPaths_.begin(), relPaths_.end());
+        dfaBegin_ = MaskDfa::compile(masks, MaskDfa::Mode::prefixMatch);
+    }
+}
+
+
 bool NameFilter::MaskMatcher::matches(const ZstringView relPath) const
 {
     assert(!relPath.empty());
 
-    if (std::any_of(realMasks_.begin(), realMasks_.end(), [&](const Zstring& mask) { return matchesMask(relPath.data(), relPath.data() + relPath.size(), mask.c_str()); }))
-    /**/return true;
+    if (dfaMatches_)
+    {
+        if (dfaMatches_->matches(relPath))
+            return true;
+    }
+    else if (std::any_of(realMasks_.begin(), realMasks_.end(), [&](const Zstring& mask) { return matchesMask(relPath.data(), relPath.data() + relPath.size(), mask.c_str()); }))
+        return true;
 
     //perf: for relPaths_ we can go from linear to *constant* time!!! => annihilates https://freefilesync.org/forum/viewtopic.php?t=7768#p26519
 
@@ -224,6 +492,9 @@ bool NameFilter::MaskMatcher::matches(const ZstringView relPath) const
 
 bool NameFilter::MaskMatcher::matchesBegin(const ZstringView relPath) const
 {
+    if (dfaBegin_)
+        return dfaBegin_->matches(relPath);
+
     return std::any_of(realMasks_.begin(), realMasks_.end(), [&](const Zstring& mask) { return matchesMaskBegin<true  /*haveWildcards*/>(relPath, mask); }) ||
     /**/   std::any_of(relPaths_ .begin(), relPaths_ .end(), [&](const Zstring& mask) { return matchesMaskBegin<false /*haveWildcards*/>(relPath, mask); });
 }
@@ -248,7 +519,8 @@ bool NameFilter::passFileFilter(const Zstring& relFilePath) const
     assert(!startsWith(relFilePath, FILE_NAME_SEPARATOR));
 
     //normalize input: 1. ignore Unicode normalization form 2. ignore case
-    const Zstring& pathFmt = getUpperCase(relFilePath);
+    const ZstringUpperCase pathUpper(relFilePath); //perf: no memory allocation for short ASCII paths
+    const ZstringView pathFmt = pathUpper.view();
 
     const ZstringView parentPath = beforeLast<ZstringView>(pathFmt, FILE_NAME_SEPARATOR, IfNotFoundReturn::none);
 
@@ -267,7 +539,8 @@ bool NameFilter::passDirFilter(const Zstring& relDirPath, bool* childItemMightMa
     assert(!childItemMightMatch || *childItemMightMatch); //check correct usage
 
     //normalize input: 1. ignore Unicode normalization form 2. ignore case
-    const Zstring& pathFmt = getUpperCase(relDirPath);
+    const ZstringUpperCase pathUpper(relDirPath); //perf: no memory allocation for short ASCII paths
+    const ZstringView pathFmt = pathUpper.view();
 
     if (excludeFilter.folderMasks.matches(pathFmt))
     {
@@ -88,10 +88,13 @@ private:
     friend class CombinedFilter;
     std::strong_ordering compareSameType(const PathFilter& other) const override;
 
+    class MaskDfa;
+
     class MaskMatcher
     {
     public:
         void insert(const Zstring& mask); //expected: upper-case + Unicode-normalized!
+        void compile(); //optional, after last insert(): speed up matching
         bool matches(const ZstringView relPath) const;
         bool matchesBegin(const ZstringView relPath) const;
 
@@ -111,6 +114,9 @@ private:
         std::set<Zstring> realMasks_; //always containing ? or *       (use std::set<> to scrap duplicates!)
         std::unordered_set<Zstring, zen::StringHash, zen::StringEqual> relPaths_; //never containing ? or *
         std::set<Zstring>                                              relPathsCmp_; //req. for operator<=> only :(
+
+        std::shared_ptr<const MaskDfa> dfaMatches_; //all realMasks_             nullptr: not compiled or too many states
+        std::shared_ptr<const MaskDfa> dfaBegin_;   //all realMasks_ + relPaths_ => match mask by mask
     };
 
     struct FilterSet
@@ -12,6 +12,7 @@
 #include <zen/thread.h>
 #include "process_callback.h"
 #include "speed_test.h"
+#include "structures.h"
 
 
 namespace fff
@@ -275,7 +276,7 @@ private:
             std::lock_guard dummy(lockCurrentStatus_);
 
             for (const auto& sbp : statusByPriority_)
-                parallelOpsTotal += sbp.empty() ? 0 : 1;
+                parallelOpsTotal += sbp.size();
             statusMsg = [&]
             {
                 for (const std::vector<ThreadStatus>& sbp : statusByPriority_)
@@ -516,6 +517,7 @@ using ParallelWorkItem = std::function<void(ParallelContext& ctx)> /*throw Threa
 namespace
 {
 void massParallelExecute(const std::vector<std::pair<AbstractPath, ParallelWorkItem>>& workload,
+                         const std::map<AfsDevice, size_t>& deviceParallelOps,
                          const Zstring& threadGroupName,
                          PhaseCallback& callback /*throw X*/) //throw X
 {
@@ -540,7 +542,7 @@ void massParallelExecute(const std::vector<std::pair<AbstractPath, ParallelWorkI
         const size_t statusPrio = deviceThreadGroups.size();
 
         const Zstring& deviceGroupName = threadGroupName + Zstr(' ') + utfTo<Zstring>(AFS::getDisplayPath(AbstractPath(afsDevice, AfsPath())));
-        deviceThreadGroups.emplace_back(1, deviceGroupName);
+        deviceThreadGroups.emplace_back(getDeviceParallelOps(deviceParallelOps, afsDevice), deviceGroupName);
         auto& threadGroup = deviceThreadGroups.back();
 
         for (const std::pair<AbstractPath, ParallelWorkItem>* item : wl)
@@ -566,11 +568,23 @@ void massParallelExecute(const std::vector<std::pair<AbstractPath, ParallelWorkI
 
 //=====================================================================================================================
 
+//time the current thread spent waiting for "singleThread" in parallelScope() (cumulative): e.g. worker thread utilization
+inline thread_local std::chrono::nanoseconds singleThreadWaitTime{};
+
+inline
+void lockSingleThread(std::mutex& singleThread)
+{
+    const auto waitStartTime = std::chrono::steady_clock::now();
+    singleThread.lock();
+    singleThreadWaitTime += std::chrono::steady_clock::now() - waitStartTime;
+}
+
+
 template <class Function> inline
 auto parallelScope(Function&& fun, std::mutex& singleThread) //throw X
 {
     singleThread.unlock();
-    ZEN_ON_SCOPE_EXIT(singleThread.lock());
+    ZEN_ON_SCOPE_EXIT(lockSingleThread(singleThread));
 
     return fun(); //throw X
 }
@@ -226,6 +226,17 @@ void fff::setDeviceParallelOps(std::map<AfsDevice, size_t>& deviceParallelOps, c
 }
 
 
+std::map<AfsDevice, AFS::IoLimits> fff::getDeviceIoLimits(const std::vector<DeviceIoLimits>& deviceIoLimits)
+{
+    std::map<AfsDevice, AFS::IoLimits> output;
+    for (const DeviceIoLimits& dil : deviceIoLimits)
+        if (const AfsDevice afsDevice = createAbstractPath(dil.folderPathPhrase).afsDevice;
+            !AFS::isNullDevice(afsDevice))
+            output[afsDevice] = dil.limits; //multiple entries for the same device: last one wins
+    return output;
+}
+
+
 std::wstring fff::getSymbol(CompareFileResult cmpRes)
 {
     switch (cmpRes)
@@ -372,6 +372,16 @@ size_t getDeviceParallelOps(const std::map<AfsDevice, size_t>& deviceParallelOps
 void   setDeviceParallelOps(      std::map<AfsDevice, size_t>& deviceParallelOps, const Zstring& folderPathPhrase, size_t parallelOps);
 
 
+struct DeviceIoLimits
+{
+    Zstring folderPathPhrase; //any folder on the device
+    AFS::IoLimits limits;
+
+    bool operator==(const DeviceIoLimits&) const = default;
+};
+std::map<AfsDevice, AFS::IoLimits> getDeviceIoLimits(const std::vector<DeviceIoLimits>& deviceIoLimits);
+
+
 std::optional<CompareVariant> getCommonCompVariant(const MainConfiguration& mainCfg);
 std::optional<SyncVariant>    getCommonSyncVariant(const MainConfiguration& mainCfg);
 
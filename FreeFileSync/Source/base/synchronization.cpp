@@ -522,12 +522,7 @@ private:
 
     static void hashAdd(FNV1aHash<uint64_t>& hash, const Zstring& itemName)
     {
-        if (isAsciiString(itemName)) //fast path: no need for extra memory allocation!
-            for (const Zchar c : itemName)
-                hash.add(asciiToUpper(c));
-        else
-            for (const Zchar c : getUpperCase(itemName))
-                hash.add(c);
+        forEachUpperCaseChar(itemName, [&](Zchar c) { hash.add(c); }); //no memory allocation for ASCII
     }
 
     static uint64_t getPathHash(const FileSystemObject& fsObj, uint64_t parentPathHash)
@@ -651,7 +646,8 @@ void checkPathRaceCondition(const BaseFolderPair& baseFolderP, const BaseFolderP
 //#################################################################################################################
 
 //--------------------- data verification -------------------------
-void flushFileBuffers(const Zstring& nativeFilePath) //throw FileError
+//write target to disk and evict it from the page cache => verification reads what is stored on the device, not what was just written to RAM
+void flushAndDropFileBuffers(const Zstring& nativeFilePath) //throw FileError
 {
     const int fdFile = ::open(nativeFilePath.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
     if (fdFile == -1)
@@ -660,20 +656,26 @@ void flushFileBuffers(const Zstring& nativeFilePath) //throw FileError
 
     if (::fsync(fdFile) != 0)
         THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(nativeFilePath)), "fsync");
+
+    //only clean pages are dropped => requires fsync() first; advisory only => ignore errors
+    [[maybe_unused]] const int rv = ::posix_fadvise(fdFile, 0 /*offset*/, 0 /*len: until EOF*/, POSIX_FADV_DONTNEED);
 }
 
 
-void verifyFiles(const AbstractPath& sourcePath, const AbstractPath& targetPath, const IoCallback& notifyUnbufferedIO /*throw X*/) //throw FileError, X
+//sourceDigest: computed while copying => only the target needs to be read again
+//no sourceDigest: source data not seen while copying (in-kernel/server-side copy, reflink) => read source again
+void verifyFiles(const AbstractPath& sourcePath, const std::optional<ContentDigest>& sourceDigest, const AbstractPath& targetPath, const IoCallback& notifyUnbufferedIO /*throw X*/) //throw FileError, X
 {
     try
     {
-        //do like "copy /v": 1. flush target file buffers, 2. read again as usual (using OS buffers)
-        // => it seems OS buffers are not invalidated by this: snake oil???
+        //unlike "copy /v" (flush + read again from OS buffers: snake oil) make sure the target is read back from the device:
         if (const Zstring& targetPathNative = getNativeItemPath(targetPath);
             !targetPathNative.empty())
-            flushFileBuffers(targetPathNative); //throw FileError
+            flushAndDropFileBuffers(targetPathNative); //throw FileError
 
-        if (!filesHaveSameContent(sourcePath, targetPath, notifyUnbufferedIO)) //throw FileError, X
+        const ContentDigest digestSource = sourceDigest ? *sourceDigest : getFileContentDigest(sourcePath, notifyUnbufferedIO); //throw FileError, X
+
+        if (getFileContentDigest(targetPath, notifyUnbufferedIO) != digestSource) //throw FileError, X
             throw FileError(replaceCpy(replaceCpy(_("%x and %y have different content."),
                                                   L"%x", L'\n' + fmtPath(AFS::getDisplayPath(sourcePath))),
                                        L"%y", L'\n' + fmtPath(AFS::getDisplayPath(targetPath))));
@@ -752,11 +754,12 @@ AFS::FileCopyResult copyFileTransactional(const AbstractPath& sourcePath, const
                                           bool transactionalCopy,
                                           const std::function<void()>& onDeleteTargetFile /*throw X*/,
                                           const IoCallback& notifyUnbufferedIO /*throw X*/,
+                                          const IoDataCallback& onSourceData /*throw X*/,
                                           std::mutex& singleThread)
 {
     return parallelScope([=]
     {
-        return AFS::copyFileTransactional(sourcePath, attrSource, targetPath, copyFilePermissions, transactionalCopy, onDeleteTargetFile, notifyUnbufferedIO); //throw FileError, ErrorFileLocked, X
+        return AFS::copyFileTransactional(sourcePath, attrSource, targetPath, copyFilePermissions, transactionalCopy, onDeleteTargetFile, notifyUnbufferedIO, onSourceData); //throw FileError, ErrorFileLocked, X
     }, singleThread);
 }
 
@@ -782,8 +785,8 @@ void revisionFolder(FileVersioner& versioner,
 { parallelScope([=, &versioner] { versioner.revisionFolder(folderPath, relativePath, onBeforeFileMove, onBeforeFolderMove, notifyUnbufferedIO); /*throw FileError, X*/ }, singleThread); }
 
 inline
-void verifyFiles(const AbstractPath& sourcePath, const AbstractPath& targetPath, const IoCallback& notifyUnbufferedIO /*throw X*/, std::mutex& singleThread) //throw FileError, X
-{ parallelScope([=] { ::verifyFiles(sourcePath, targetPath, notifyUnbufferedIO); /*throw FileError, X*/ }, singleThread); }
+void verifyFiles(const AbstractPath& sourcePath, const std::optional<ContentDigest>& sourceDigest, const AbstractPath& targetPath, const IoCallback& notifyUnbufferedIO /*throw X*/, std::mutex& singleThread) //throw FileError, X
+{ parallelScope([=] { ::verifyFiles(sourcePath, sourceDigest, targetPath, notifyUnbufferedIO); /*throw FileError, X*/ }, singleThread); }
 
 }
 
@@ -1108,12 +1111,60 @@ void DeletionHandler::removeDirWithCallback(const AbstractPath& folderPath, cons
 //===================================================================================================
 //===================================================================================================
 
+//limit work items running at the same time per device: worker threads are shared by both sides, but "deviceParallelOps" may differ
+class DeviceBudget
+{
+public:
+    DeviceBudget(const AfsDevice& deviceL, size_t parallelOpsL,
+                 const AfsDevice& deviceR, size_t parallelOpsR) : deviceL_(deviceL), deviceR_(deviceR)
+    {
+        available_.emplace(deviceL, parallelOpsL);
+        available_.emplace(deviceR, parallelOpsR); //same device on both sides: shared budget
+    }
+
+    //blocking call: context of worker thread, "singleThread" NOT locked!
+    void acquire(SelectSide side) //throw ThreadStopRequest
+    {
+        std::unique_lock dummy(lockBudget_);
+        size_t& available = getAvailable(side);
+        interruptibleWait(conditionBudget_, dummy, [&] { return available > 0; }); //throw ThreadStopRequest
+        --available;
+    }
+
+    void release(SelectSide side)
+    {
+        {
+            std::lock_guard dummy(lockBudget_);
+            ++getAvailable(side);
+        }
+        conditionBudget_.notify_all();
+    }
+
+private:
+    DeviceBudget           (const DeviceBudget&) = delete;
+    DeviceBudget& operator=(const DeviceBudget&) = delete;
+
+    size_t& getAvailable(SelectSide side) { return available_.find(side == SelectSide::left ? deviceL_ : deviceR_)->second; }
+
+    const AfsDevice deviceL_;
+    const AfsDevice deviceR_;
+
+    std::mutex lockBudget_;
+    std::condition_variable conditionBudget_;
+    std::map<AfsDevice, size_t> available_;
+};
+
+
 class Workload
 {
 public:
     Workload(size_t threadCount, AsyncCallback& acb) : acb_(acb), workload_(threadCount) { assert(threadCount > 0); }
 
-    using WorkItem  = std::function<void() /*throw ThreadStopRequest*/>;
+    struct WorkItem
+    {
+        std::function<void() /*throw ThreadStopRequest*/> fun;
+        std::optional<SelectSide> targetSide; //charge DeviceBudget of this side (if any)
+    };
     using WorkItems = RingBuffer<WorkItem>; //FIFO!
 
     //blocking call: context of worker thread
@@ -1200,8 +1251,9 @@ private:
 template <SelectSide side, class List> inline
 bool haveNameClash(const FileSystemObject& fsObj, const List& m)
 {
-    return std::any_of(m.begin(), m.end(), [itemName = fsObj.getItemName<side>()](const FileSystemObject& sibling)
-    { return equalNoCase(sibling.getItemName<side>(), itemName); }); //equalNoCase: when in doubt => assume name clash!
+    const ZstringUpperCase itemNameUpper(fsObj.getItemName<side>()); //upper-case once, not per sibling
+    return std::any_of(m.begin(), m.end(), [&](const FileSystemObject& sibling)
+    { return equalUpperCase(itemNameUpper.view(), sibling.getItemName<side>()); }); //ignore case: when in doubt => assume name clash!
 }
 
 
@@ -1215,13 +1267,35 @@ public:
         bool failSafeFileCopy;
         DeletionHandler& delHandlerLeft;
         DeletionHandler& delHandlerRight;
+        const std::map<AfsDevice, size_t>& deviceParallelOps;
     };
 
     static void runSync(SyncCtx& syncCtx, BaseFolderPair& baseFolder, PhaseCallback& cb)
     {
-        runPass(PassNo::zero, syncCtx, baseFolder, cb); //prepare file moves
-        runPass(PassNo::one,  syncCtx, baseFolder, cb); //delete files (or overwrite big ones with smaller ones)
-        runPass(PassNo::two,  syncCtx, baseFolder, cb); //copy rest
+        const AfsDevice& deviceL = baseFolder.getAbstractPath<SelectSide::left >().afsDevice;
+        const AfsDevice& deviceR = baseFolder.getAbstractPath<SelectSide::right>().afsDevice;
+        const size_t parallelOpsL = getDeviceParallelOps(syncCtx.deviceParallelOps, deviceL);
+        const size_t parallelOpsR = getDeviceParallelOps(syncCtx.deviceParallelOps, deviceR);
+
+        //single worker pool per folder pair, work items are limited per target device:
+        //different devices => one thread per slot on either side: threads waiting for a busy device should not starve the other one
+        const size_t threadCount = deviceL == deviceR ? parallelOpsL : parallelOpsL + parallelOpsR;
+        DeviceBudget budget(deviceL, parallelOpsL, deviceR, parallelOpsR);
+
+        WorkerStats stats{.threadBusyTime = std::vector<std::chrono::nanoseconds>(threadCount)};
+
+        runPass(PassNo::zero, threadCount, budget, stats, syncCtx, baseFolder, cb); //prepare file moves
+        runPass(PassNo::one,  threadCount, budget, stats, syncCtx, baseFolder, cb); //delete files (or overwrite big ones with smaller ones)
+        runPass(PassNo::two,  threadCount, budget, stats, syncCtx, baseFolder, cb); //copy rest
+
+        if (threadCount > 1 && stats.totalTime.count() > 0) //help finding the right number of parallel operations
+        {
+            std::wstring msg = _("Worker thread utilization:");
+            for (const std::chrono::nanoseconds busyTime : stats.threadBusyTime)
+                msg += L' ' + numberTo<std::wstring>(numeric::intDivRound(100 * busyTime.count(), stats.totalTime.count())) + L'%';
+
+            cb.logMessage(msg, PhaseCallback::MsgType::info); //throw X
+        }
     }
 
 private:
@@ -1250,7 +1324,14 @@ private:
     static bool needZeroPass(const FilePair& file);
     static bool needZeroPass(const FolderPair& folder);
 
-    static void runPass(PassNo pass, SyncCtx& syncCtx, BaseFolderPair& baseFolder, PhaseCallback& cb); //throw X
+    struct WorkerStats
+    {
+        std::vector<std::chrono::nanoseconds> threadBusyTime; //time spent processing work items, excluding waiting for "singleThread"
+        std::chrono::nanoseconds totalTime{};
+    };
+    static void runPass(PassNo pass, size_t threadCount, DeviceBudget& budget, WorkerStats& stats, SyncCtx& syncCtx, BaseFolderPair& baseFolder, PhaseCallback& cb); //throw X
+
+    static std::optional<SelectSide> getTargetSide(const FileSystemObject& fsObj);
 
     RingBuffer<Workload::WorkItems> getFolderLevelWorkItems(PassNo pass, ContainerObject& parentFolder, Workload& workload);
 
@@ -1325,43 +1406,82 @@ Callback     =============       --------------------
                                  --------------------
 
 Notes: - All threads share a single mutex, unlocked only during file I/O => do NOT require file_hierarchy.cpp classes to be thread-safe (i.e. internally synchronized)!
+       - Worker thread count: sum of "deviceParallelOps" of left/right base folder devices (same device: counted once)
+       - Work items running at the same time per target device: at most its "deviceParallelOps" (DeviceBudget), e.g. fast local disk => slow NAS
        - Workload holds (folder-level-) items in buckets associated with each worker thread (FTP scenario: avoid CWDs)
        - If a worker is idle, its Workload bucket is empty and no more pending buckets available: steal from other threads (=> take half of largest bucket)
        - Maximize opportunity for parallelization ASAP: Workload buckets serve folder-items *before* files/symlinks => reduce risk of work-stealing
        - Memory consumption: work items may grow indefinitely; however: test case "C:\" ~80MB per 1 million work items
 */
 
-void FolderPairSyncer::runPass(PassNo pass, SyncCtx& syncCtx, BaseFolderPair& baseFolder, PhaseCallback& cb) //throw X
+void FolderPairSyncer::runPass(PassNo pass, size_t threadCount, DeviceBudget& budget, WorkerStats& stats, SyncCtx& syncCtx, BaseFolderPair& baseFolder, PhaseCallback& cb) //throw X
 {
+    const auto passStartTime = std::chrono::steady_clock::now();
+    ZEN_ON_SCOPE_SUCCESS(stats.totalTime += std::chrono::steady_clock::now() - passStartTime);
+
     std::mutex singleThread; //only a single worker thread may run at a time, except for parallel file I/O
 
     AsyncCallback acb;                                //
     FolderPairSyncer fps(syncCtx, singleThread, acb); //manage life time: enclose InterruptibleThread's!!!
-    Workload workload(1, acb);
+    Workload workload(threadCount, acb);
     workload.addWorkItems(fps.getFolderLevelWorkItems(pass, baseFolder, workload)); //initial workload: set *before* threads get access!
 
     std::vector<InterruptibleThread> worker;
     ZEN_ON_SCOPE_EXIT( for (InterruptibleThread& wt : worker) wt.requestStop(); ); //stop *all* at the same time before join!
 
-    size_t threadIdx = 0;
-    Zstring threadName = Zstr("Sync");
-        worker.emplace_back([threadIdx, &singleThread, &acb, &workload, threadName = std::move(threadName)]
+    for (size_t threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+    {
+        Zstring threadName = Zstr("Sync");
+        if (threadCount > 1)
+            threadName += Zstr('[') + numberTo<Zstring>(threadIdx + 1) + Zstr(']');
+
+        //"busyTime": written by worker thread only; read after join
+        worker.emplace_back([threadIdx, &singleThread, &acb, &workload, &budget, &busyTime = stats.threadBusyTime[threadIdx], threadName = std::move(threadName)]
         {
             setCurrentThreadName(threadName);
 
-            while (/*blocking call:*/ std::function<void()> workItem = workload.getNext(threadIdx)) //throw ThreadStopRequest
+            for (;;)
             {
+                const Workload::WorkItem workItem = workload.getNext(threadIdx); //throw ThreadStopRequest; blocking call
+
+                if (workItem.targetSide) //wait *before* locking "singleThread": slots are released by work items that need it to finish
+                    budget.acquire(*workItem.targetSide); //throw ThreadStopRequest
+                ZEN_ON_SCOPE_EXIT(if (workItem.targetSide) budget.release(*workItem.targetSide));
+
                 acb.notifyTaskBegin(0 /*prio*/); //same prio, while processing only one folder pair at a time
                 ZEN_ON_SCOPE_EXIT(acb.notifyTaskEnd());
 
                 std::lock_guard dummy(singleThread); //protect ALL accesses to "fps" and workItem execution!
-                workItem(); //throw ThreadStopRequest
+
+                //busy: "singleThread" held or file I/O in parallelScope() => don't count waiting for the lock
+                const auto workStartTime = std::chrono::steady_clock::now();
+                const std::chrono::nanoseconds waitTimeStart = singleThreadWaitTime;
+                ZEN_ON_SCOPE_EXIT(busyTime += std::chrono::steady_clock::now() - workStartTime - (singleThreadWaitTime - waitTimeStart));
+
+                workItem.fun(); //throw ThreadStopRequest
             }
         });
+    }
     acb.waitUntilDone(UI_UPDATE_INTERVAL / 2 /*every ~50 ms*/, cb); //throw X
 }
 
 
+//DeviceBudget: the side that is written to
+std::optional<SelectSide> FolderPairSyncer::getTargetSide(const FileSystemObject& fsObj)
+{
+    switch (getEffectiveSyncDir(fsObj.getSyncOperation()))
+    {
+        case SyncDirection::left:
+            return SelectSide::left;
+        case SyncDirection::right:
+            return SelectSide::right;
+        case SyncDirection::none:
+            break;
+    }
+    return {};
+}
+
+
 //thread-safe thanks to std::mutex singleThread
 RingBuffer<Workload::WorkItems> FolderPairSyncer::getFolderLevelWorkItems(PassNo pass, ContainerObject& parentFolder, Workload& workload)
 {
@@ -1375,55 +1495,55 @@ RingBuffer<Workload::WorkItems> FolderPairSyncer::getFolderLevelWorkItems(PassNo
         ContainerObject& conObj = *foldersToInspect.    front();
         /**/                        foldersToInspect.pop_front();
 
-        RingBuffer<std::function<void()>> workItems;
+        Workload::WorkItems workItems;
 
         if (pass == PassNo::zero)
         {
             //create folders as required by file move targets:
             for (FolderPair& folder : conObj.refSubFolders())
                 if (needZeroPass(folder))
-                    workItems.push_back([this, &folder, &workload, pass]
+                    workItems.push_back(Workload::WorkItem{[this, &folder, &workload, pass]
                 {
                     tryReportingError([&] { synchronizeFolder(folder); }, acb_); //throw ThreadStopRequest
                     //error? => still process move targets (for delete + copy fall back!)
                     workload.addWorkItems(getFolderLevelWorkItems(pass, folder, workload));
-                });
+                }, getTargetSide(folder)});
             else
                 foldersToInspect.push_back(&folder);
 
             for (FilePair& file : conObj.refSubFiles())
                 if (needZeroPass(file))
-                    workItems.push_back([this, &file] { executeFileMove(file); /*throw ThreadStopRequest*/ });
+                    workItems.push_back(Workload::WorkItem{[this, &file] { executeFileMove(file); /*throw ThreadStopRequest*/ }, getTargetSide(file)});
         }
         else
         {
             //synchronize folders *first* (see comment above "Multithreaded File Copy")
             for (FolderPair& folder : conObj.refSubFolders())
                 if (pass == getPass(folder))
-                    workItems.push_back([this, &folder, &workload, pass]
+                    workItems.push_back(Workload::WorkItem{[this, &folder, &workload, pass]
                 {
                     tryReportingError([&]{ synchronizeFolder(folder); }, acb_); //throw ThreadStopRequest
 
                     workload.addWorkItems(getFolderLevelWorkItems(pass, folder, workload));
-                });
+                }, getTargetSide(folder)});
             else
                 foldersToInspect.push_back(&folder);
 
             //synchronize files:
             for (FilePair& file : conObj.refSubFiles())
                 if (pass == getPass(file))
-                    workItems.push_back([this, &file]
+                    workItems.push_back(Workload::WorkItem{[this, &file]
                 {
                     tryReportingError([&]{ synchronizeFile(file); }, acb_); //throw ThreadStopRequest
-                });
+                }, getTargetSide(file)});
 
             //synchronize symbolic links:
             for (SymlinkPair& symlink : conObj.refSubLinks())
                 if (pass == getPass(symlink))
-                    workItems.push_back([this, &symlink]
+                    workItems.push_back(Workload::WorkItem{[this, &symlink]
                 {
                     tryReportingError([&] { synchronizeLink(symlink); }, acb_); //throw ThreadStopRequest
-                });
+                }, getTargetSide(symlink)});
         }
 
         if (!workItems.empty())
@@ -2285,6 +2405,12 @@ AFS::FileCopyResult FolderPairSyncer::copyFileWithCallback(const FileDescriptor&
     {
         PercentStatReporter percentReporter(statusMsg, sourceDescr.attr.fileSize, statReporter);
 
+        //verification: hash source while copying (via user space buffers) => no need to read it a second time
+        std::optional<HashSha256> sourceHasher;
+        if (verifyCopiedFiles_)
+            try { sourceHasher.emplace(); /*throw SysError*/ }
+            catch (const SysError& e) { throw FileError(_("Data verification error:"), e.toString()); }
+
         //already existing + no onDeleteTargetFile: undefined behavior! (e.g. fail/overwrite/auto-rename)
         const AFS::FileCopyResult result = parallel::copyFileTransactional(sourcePathTmp, sourceAttr, //throw FileError, ErrorFileLocked, ThreadStopRequest, X
                                                                            targetPath,
@@ -2302,10 +2428,15 @@ AFS::FileCopyResult FolderPairSyncer::copyFileWithCallback(const FileDescriptor&
             percentReporter.updateDeltaAndStatus(bytesDelta); //throw ThreadStopRequest
             interruptionPoint(); //throw ThreadStopRequest => not reliably covered by PercentStatReporter::updateDeltaAndStatus()!
         },
+        sourceHasher ? IoDataCallback([&](const void* buffer, size_t bytes) //callback runs *outside* singleThread_ lock! => fine
+        {
+            try { sourceHasher->update(buffer, bytes); /*throw SysError*/ }
+            catch (const SysError& e) { throw FileError(_("Data verification error:"), e.toString()); }
+        }) : nullptr,
         singleThread_);
 
         //#################### Verification #############################
-        if (verifyCopiedFiles_)
+        if (verifyCopiedFiles_) //reflink, too: read back what the file system actually stores
         {
             reportItemInfo(txtVerifyingFile_, targetPath); //throw ThreadStopRequest
 
@@ -2316,7 +2447,12 @@ AFS::FileCopyResult FolderPairSyncer::copyFileWithCallback(const FileDescriptor&
             //callback runs *outside* singleThread_ lock! => fine
             auto verifyCallback = [&](int64_t bytesDelta) { interruptionPoint(); }; //throw ThreadStopRequest
 
-            parallel::verifyFiles(sourcePathTmp, targetPath, verifyCallback, singleThread_); //throw FileError, ThreadStopRequest
+            std::optional<ContentDigest> sourceDigest; //in-kernel/server-side copy, reflink: source data not seen => verifyFiles() reads it again
+            if (result.copyMethod == AFS::FileCopyMethod::stream)
+                try { sourceDigest = sourceHasher->finalize(); /*throw SysError*/ }
+                catch (const SysError& e) { throw FileError(_("Data verification error:"), e.toString()); }
+
+            parallel::verifyFiles(sourcePathTmp, sourceDigest, targetPath, verifyCallback, singleThread_); //throw FileError, ThreadStopRequest
         }
         //#################### /Verification #############################
 
@@ -2431,6 +2567,7 @@ void fff::synchronize(const std::chrono::system_clock::time_point& syncStartTime
                       bool runWithBackgroundPriority,
                       const std::vector<FolderPairSyncCfg>& syncConfig,
                       FolderComparison& folderCmp,
+                      const std::map<AfsDevice, size_t>& deviceParallelOps,
                       WarningDialogs& warnings,
                       ProcessCallback& callback /*throw X*/) //throw X
 {
@@ -2941,6 +3078,7 @@ break2:
             {
                 verifyCopiedFiles, copyPermissionsFp, failSafeFileCopy,
                 delHandlerL, delHandlerR,
+                deviceParallelOps,
             };
             FolderPairSyncer::runSync(syncCtx, baseFolder, callback);
 
@@ -2970,6 +3108,7 @@ break2:
         //-----------------------------------------------------------------------------------------------------
 
         applyVersioningLimit(versionLimitFolders,
+                             deviceParallelOps,
                              callback /*throw X*/); //throw X
     }
     catch (const std::exception& e)
@@ -233,7 +233,7 @@ void FileVersioner::revisionFileImpl(const FileDescriptor& fileDescr, const Zstr
         /*const AFS::FileCopyResult result =*/ AFS::copyFileTransactional(filePath, fileAttr, targetPath, //throw FileError, ErrorFileLocked, X
                                                                           false, //copyFilePermissions
                                                                           false,  //transactionalCopy: not needed for versioning! partial copy will be overwritten next time
-                                                                          nullptr /*onDeleteTargetFile*/, notifyUnbufferedIO);
+                                                                          nullptr /*onDeleteTargetFile*/, notifyUnbufferedIO, nullptr /*onSourceData*/);
         //result.errorModTime? => irrelevant for versioning!
     });
 }
@@ -370,21 +370,22 @@ void findFileVersions(VersionInfoMap& versions,
         }
     };
 
-    for (const auto& [fileName, attr] : folderCont.files)
-        extractFileVersion(fileName, false /*isSymlink*/);
+    for (size_t i = 0; i < folderCont.refFiles().size(); ++i)
+        extractFileVersion(Zstring(folderCont.refFiles().getName(i)), false /*isSymlink*/);
 
-    for (const auto& [linkName, attr] : folderCont.symlinks)
-        extractFileVersion(linkName, true /*isSymlink*/);
+    for (size_t i = 0; i < folderCont.refSymlinks().size(); ++i)
+        extractFileVersion(Zstring(folderCont.refSymlinks().getName(i)), true /*isSymlink*/);
 
-    for (const auto& [folderName, attrAndSub] : folderCont.folders)
+    for (size_t i = 0; i < folderCont.refFolders().size(); ++i)
     {
+        const Zstring folderName(folderCont.refFolders().getName(i));
         if (relPathOrigParent.empty() && !versionTimeParent) //VersioningStyle::timestampFolder?
         {
             assert(!versionTimeParent);
             const time_t versionTime = fff::impl::parseVersionedFolderName(folderName);
             if (versionTime != 0)
             {
-                findFileVersions(versions, attrAndSub.second,
+                findFileVersions(versions, folderCont.getSubFolder(i),
                                  AFS::appendRelPath(parentFolderPath, folderName),
                                  Zstring(), //[!] skip time-stamped folder
                                  &versionTime);
@@ -392,7 +393,7 @@ void findFileVersions(VersionInfoMap& versions,
             }
         }
 
-        findFileVersions(versions, attrAndSub.second,
+        findFileVersions(versions, folderCont.getSubFolder(i),
                          AFS::appendRelPath(parentFolderPath, folderName),
                          appendPath(relPathOrigParent, folderName),
                          versionTimeParent);
@@ -403,12 +404,12 @@ void findFileVersions(VersionInfoMap& versions,
 void getFolderItemCount(std::map<AbstractPath, size_t>& folderItemCount, const FolderContainer& folderCont, const AbstractPath& parentFolderPath)
 {
     size_t& itemCount = folderItemCount[parentFolderPath];
-    itemCount = std::max(itemCount, folderCont.files.size() + folderCont.symlinks.size() + folderCont.folders.size());
+    itemCount = std::max(itemCount, folderCont.refFiles().size() + folderCont.refSymlinks().size() + folderCont.refFolders().size());
     //theoretically possible that the same folder is found in one case with items, in another case empty (due to an error)
     //e.g. "subfolder" for versioning folders c:\folder and c:\folder\subfolder
 
-    for (const auto& [folderName, attrAndSub] : folderCont.folders)
-        getFolderItemCount(folderItemCount, attrAndSub.second, AFS::appendRelPath(parentFolderPath, folderName));
+    for (size_t i = 0; i < folderCont.refFolders().size(); ++i)
+        getFolderItemCount(folderItemCount, folderCont.getSubFolder(i), AFS::appendRelPath(parentFolderPath, Zstring(folderCont.refFolders().getName(i))));
 }
 }
 
@@ -429,6 +430,7 @@ std::weak_ordering fff::operator<=>(const VersioningLimitFolder& lhs, const Vers
 
 
 void fff::applyVersioningLimit(const std::set<VersioningLimitFolder>& folderLimits,
+                               const std::map<AfsDevice, size_t>& deviceParallelOps,
                                PhaseCallback& callback /*throw X*/) //throw X
 {
     //--------- determine existing folder paths for traversal ---------
@@ -479,7 +481,7 @@ void fff::applyVersioningLimit(const std::set<VersioningLimitFolder>& folderLimi
         callback.updateStatus(textScanning + statusLine); //throw X
     };
 
-    const std::map<DirectoryKey, DirectoryValue> folderBuf = parallelDeviceTraversal(foldersToRead,
+    const std::map<DirectoryKey, DirectoryValue> folderBuf = parallelDeviceTraversal(foldersToRead, {} /*partialTraversals*/, deviceParallelOps,
     [&](const PhaseCallback::ErrorInfo& errorInfo) { return callback.reportError(errorInfo); } /*throw X*/,
     onStatusUpdate /*throw X*/, UI_UPDATE_INTERVAL / 2); //every ~50 ms
 
@@ -610,6 +612,6 @@ void fff::applyVersioningLimit(const std::set<VersioningLimitFolder>& folderLimi
             }
     });
 
-    massParallelExecute(parallelWorkload,
+    massParallelExecute(parallelWorkload, deviceParallelOps,
                         Zstr("Versioning Limit"), callback /*throw X*/); //throw X
 }
@@ -101,6 +101,7 @@ std::weak_ordering operator<=>(const VersioningLimitFolder& lhs, const Versionin
 
 
 void applyVersioningLimit(const std::set<VersioningLimitFolder>& folderLimits,
+                          const std::map<AfsDevice, size_t>& deviceParallelOps,
                           PhaseCallback& callback /*throw X*/);
 
 
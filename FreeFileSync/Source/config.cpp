@@ -424,6 +424,39 @@ bool readText(const std::string& input, GridViewType& value)
 }
 
 
+template <> inline
+void writeText(const FolderSnapshotMode& value, std::string& output)
+{
+    switch (value)
+    {
+        case FolderSnapshotMode::off:
+            output = "Off";
+            break;
+        case FolderSnapshotMode::statFiles:
+            output = "StatFiles";
+            break;
+        case FolderSnapshotMode::trustFolderTime:
+            output = "TrustFolderTime";
+            break;
+    }
+}
+
+template <> inline
+bool readText(const std::string& input, FolderSnapshotMode& value)
+{
+    const std::string tmp = trimCpy(input);
+    if (tmp == "Off")
+        value = FolderSnapshotMode::off;
+    else if (tmp == "StatFiles")
+        value = FolderSnapshotMode::statFiles;
+    else if (tmp == "TrustFolderTime")
+        value = FolderSnapshotMode::trustFolderTime;
+    else
+        return false;
+    return true;
+}
+
+
 template <> inline
 void writeText(const ColumnTypeRim& value, std::string& output)
 {
@@ -780,6 +813,25 @@ bool readStruc(const XmlElement& input, ExternalApp& value)
 }
 
 
+template <> inline
+void writeStruc(const DeviceIoLimits& value, XmlElement& output)
+{
+    output.setAttribute("Path",        value.folderPathPhrase);
+    output.setAttribute("BytesPerSec", value.limits.bytesPerSec);
+    output.setAttribute("FilesPerSec", value.limits.filesPerSec);
+}
+
+template <> inline
+bool readStruc(const XmlElement& input, DeviceIoLimits& value)
+{
+    bool success = true;
+    success = input.getAttribute("Path",        value.folderPathPhrase)   && success;
+    success = input.getAttribute("BytesPerSec", value.limits.bytesPerSec) && success;
+    success = input.getAttribute("FilesPerSec", value.limits.filesPerSec) && success;
+    return success; //[!] avoid short-circuit evaluation
+}
+
+
 template <> inline
 void writeText(const TaskResult& value, std::string& output)
 {
@@ -1359,6 +1411,18 @@ void readConfig(const XmlIn& in, XmlGlobalSettings& cfg, int formatVer)
     in2["LogFiles"                 ].attribute("MaxAge",  cfg.logfilesMaxAgeDays);
     in2["LogFiles"                 ].attribute("Format",  cfg.logFormat);
 
+    if (in2["IoUringTraversal"]) //hidden setting: optional
+        in2["IoUringTraversal"].attribute("Enabled", cfg.ioUringTraversal);
+
+    if (in2["ContentHashCache"]) //hidden setting: optional
+        in2["ContentHashCache"].attribute("Enabled", cfg.contentHashCache);
+
+    if (in2["FolderSnapshot"]) //hidden setting: optional
+        in2["FolderSnapshot"].attribute("Mode", cfg.folderSnapshot);
+
+    if (in2["IoLimits"]) //hidden setting: optional
+        in2["IoLimits"](cfg.deviceIoLimits);
+
     //TODO: remove old parameter after migration! 2021-03-06
     if (formatVer < 21)
     {
@@ -2130,6 +2194,18 @@ void writeConfig(const XmlGlobalSettings& cfg, XmlOut& out)
     out["LogFiles"                 ].attribute("MaxAge",  cfg.logfilesMaxAgeDays);
     out["LogFiles"                 ].attribute("Format",  cfg.logFormat);
 
+    if (cfg.ioUringTraversal)
+        out["IoUringTraversal"].attribute("Enabled", cfg.ioUringTraversal);
+
+    if (cfg.contentHashCache)
+        out["ContentHashCache"].attribute("Enabled", cfg.contentHashCache);
+
+    if (cfg.folderSnapshot != FolderSnapshotMode::off)
+        out["FolderSnapshot"].attribute("Mode", cfg.folderSnapshot);
+
+    if (!cfg.deviceIoLimits.empty())
+        out["IoLimits"](cfg.deviceIoLimits);
+
     out["ProgressDialog"].attribute("AutoClose", cfg.progressDlgAutoClose);
 
     XmlOut outOpt = out["OptionalDialogs"];
@@ -14,6 +14,7 @@
 #include "ui/file_grid_attr.h"
 #include "ui/tree_grid_attr.h" //RTS: avoid tree grid's "file_hierarchy.h" dependency!
 #include "ui/cfg_grid.h"
+#include "afs/native.h"
 #include "log_file.h"
 #include "version/version.h"
 
@@ -156,6 +157,10 @@ struct XmlGlobalSettings
     bool verifyFileCopy = false;
     int logfilesMaxAgeDays = 30; //<= 0 := no limit; for log files under %AppData%\FreeFileSync\Logs
     LogFileFormat logFormat = LogFileFormat::html;
+    bool ioUringTraversal = false; //hidden setting: Linux-only, see setNativeTraversalIoUring()
+    bool contentHashCache = false; //hidden setting: remember file digests of "compare by content", see hash_cache.h
+    FolderSnapshotMode folderSnapshot = FolderSnapshotMode::off; //hidden setting: Linux-only, see setNativeTraversalSnapshot()
+    std::vector<DeviceIoLimits> deviceIoLimits; //hidden setting: bandwidth/IOPS throttling, see AFS::setDeviceIoLimits()
 
     Zstring soundFileCompareFinished;
     Zstring soundFileSyncFinished;
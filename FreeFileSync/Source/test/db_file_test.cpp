@@ -0,0 +1,515 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../base/db_file.cpp" //StreamGenerator, StreamParser, DbJournal
+#include "../afs/native.h"
+#include <iostream>
+#include <random>
+#include <thread>
+#include <zen/perf.h>
+#include "test_tools.h"
+
+using namespace zen;
+using namespace fff;
+
+/*  sync.ffs_db stream format v6: folder records (zstd blocks) + append-only journal
+    - round trip: generate => parse (lazy, or complete via loadAll()) => same content
+    - unknown block codec in the stream header: FileError
+    - lazy decoding on a thread other than the owner thread fails with std::logic_error (release builds, too)
+    - journal: append changes => parse => changes applied on top of the folder records, for either lead stream
+    - compaction: appendJournal() refuses once the journal outgrows DB_JOURNAL_MAX_RATIO
+    - compaction: only decoded folders are re-encoded, blocks of undecoded sub trees are copied
+    - database update after sync: all folders are updated, only the differences are journaled
+    - folder complete (all items in sync): partial comparison may take it from the database      */
+namespace
+{
+const std::wstring displayPathL = L"left/sync.ffs_db";
+const std::wstring displayPathR = L"right/sync.ffs_db";
+
+
+bool equalFolders(const InSyncFolder& lhs, const InSyncFolder& rhs) //throw FileError
+{
+    auto equalItems = [](const auto& itemsL, const auto& itemsR)
+    {
+        return itemsL.size() == itemsR.size() &&
+               std::all_of(itemsL.begin(), itemsL.end(), [&](const auto& item)
+        {
+            auto it = itemsR.find(item.first);
+            return it != itemsR.end() && it->second == item.second;
+        });
+    };
+    if (!equalItems(lhs.refFiles(), rhs.refFiles()) || !equalItems(lhs.refSymlinks(), rhs.refSymlinks()) ||
+        lhs.refFolders().size() != rhs.refFolders().size())
+        return false;
+
+    return std::all_of(lhs.refFolders().begin(), lhs.refFolders().end(), [&](const auto& item)
+    {
+        auto it = rhs.refFolders().find(item.first);
+        return it != rhs.refFolders().end() && item.second.isComplete() == it->second.isComplete() && equalFolders(item.second, it->second);
+    });
+}
+
+
+//swap left and right: content as seen when parsing with the other lead stream
+InSyncFolder flipFolder(const InSyncFolder& folder)
+{
+    InSyncFolder output;
+    for (const auto& [fileName, file] : folder.refFiles())
+        output.addFile(fileName.normStr, file.right, file.left, file.cmpVar, file.fileSize);
+    for (const auto& [linkName, symlink] : folder.refSymlinks())
+        output.addSymlink(linkName.normStr, symlink.right, symlink.left, symlink.cmpVar);
+    for (const auto& [folderName, subFolder] : folder.refFolders())
+        output.refFolders().emplace(folderName, flipFolder(subFolder)).first->second.setComplete(subFolder.isComplete());
+    return output;
+}
+
+
+void addRandomItems(std::mt19937& rng, InSyncFolder& folder, int depth, size_t& itemCount)
+{
+    const size_t fileCount = rng() % 200;
+    for (size_t i = 0; i < fileCount; ++i)
+        folder.addFile(Zstr("File ") + numberTo<Zstring>(i) + (i % 3 == 0 ? Zstr(".txt") : Zstr(".Dat")),
+                       InSyncDescrFile{static_cast<time_t>(rng()), rng()},
+                       InSyncDescrFile{static_cast<time_t>(rng()), rng() % 2 ? rng() : 0},
+                       i % 5 == 0 ? CompareVariant::content : CompareVariant::timeSize, rng() * uint64_t(rng() % 4));
+
+    const size_t linkCount = rng() % 5;
+    for (size_t i = 0; i < linkCount; ++i)
+        folder.addSymlink(Zstr("Link ") + numberTo<Zstring>(i),
+                          InSyncDescrLink{static_cast<time_t>(rng())},
+                          InSyncDescrLink{static_cast<time_t>(rng())}, CompareVariant::timeSize);
+
+    itemCount += fileCount + linkCount;
+
+    if (depth > 0)
+        for (size_t i = rng() % 8; i > 0; --i)
+        {
+            ++itemCount;
+            InSyncFolder& subFolder = folder.addFolder(Zstr("Folder ") + numberTo<Zstring>(i));
+            subFolder.setComplete(rng() % 2 == 0);
+            addRandomItems(rng, subFolder, depth - 1, itemCount);
+        }
+}
+
+
+SharedRef<InSyncFolder> parseStreams(bool leadStreamLeft, bool loadAll, const std::string& streamL, const std::string& streamR,
+                                     std::shared_ptr<const InSyncFolderLoader>* loaderOut = nullptr) //throw FileError
+{
+    SharedRef<InSyncFolder> output = StreamParser::execute(leadStreamLeft, streamL, streamR, displayPathL, displayPathR, loaderOut); //throw FileError
+    if (loadAll)
+        output.ref().loadAll(); //throw FileError
+    return output;
+}
+
+
+bool isDecodedAll(const InSyncFolder& folder)
+{
+    return folder.isDecoded() &&
+           std::all_of(folder.refFolders().begin(), folder.refFolders().end(), [](const auto& item) { return isDecodedAll(item.second); });
+}
+
+
+//record the same changes in the journal and in the expected folder content
+class JournalRecorder
+{
+public:
+    JournalRecorder(InSyncFolder& expected, DbJournal& journal) : expected_(expected), journal_(journal) {}
+
+    void setFile(const Zstring& parentRelPath, const Zstring& fileName, const InSyncFile& file)
+    {
+        getFolder(parentRelPath).refFiles().insert_or_assign(fileName, file);
+        journal_.setFile(parentRelPath, fileName, file);
+    }
+
+    void setSymlink(const Zstring& parentRelPath, const Zstring& linkName, const InSyncSymlink& symlink)
+    {
+        getFolder(parentRelPath).refSymlinks().insert_or_assign(linkName, symlink);
+        journal_.setSymlink(parentRelPath, linkName, symlink);
+    }
+
+    void removeFile(const Zstring& parentRelPath, const Zstring& fileName)
+    {
+        getFolder(parentRelPath).refFiles().erase(fileName);
+        journal_.removeFile(parentRelPath, fileName);
+    }
+
+    void removeSymlink(const Zstring& parentRelPath, const Zstring& linkName)
+    {
+        getFolder(parentRelPath).refSymlinks().erase(linkName);
+        journal_.removeSymlink(parentRelPath, linkName);
+    }
+
+    void addFolder(const Zstring& parentRelPath, const Zstring& folderName)
+    {
+        getFolder(parentRelPath).refFolders().try_emplace(folderName);
+        journal_.addFolder(parentRelPath, folderName);
+    }
+
+    void removeFolder(const Zstring& parentRelPath, const Zstring& folderName)
+    {
+        getFolder(parentRelPath).refFolders().erase(folderName);
+        journal_.removeFolder(parentRelPath, folderName);
+    }
+
+    void setFolderComplete(const Zstring& parentRelPath, const Zstring& folderName, bool complete)
+    {
+        getFolder(parentRelPath).refFolders().at(folderName).setComplete(complete);
+        journal_.setFolderComplete(parentRelPath, folderName, complete);
+    }
+
+private:
+    InSyncFolder& getFolder(const Zstring& relPath)
+    {
+        InSyncFolder* folder = &expected_;
+        for (const Zstring& folderName : splitCpy(relPath, FILE_NAME_SEPARATOR, SplitOnEmpty::skip))
+            folder = &folder->refFolders().at(folderName);
+        return *folder;
+    }
+
+    InSyncFolder& expected_;
+    DbJournal& journal_;
+};
+
+
+void getFolderPaths(const InSyncFolder& folder, const Zstring& relPath, std::vector<Zstring>& folderPaths)
+{
+    for (const auto& [folderName, subFolder] : folder.refFolders())
+    {
+        const Zstring subPath = appendPath(relPath, folderName.normStr);
+        folderPaths.push_back(subPath);
+        getFolderPaths(subFolder, subPath, folderPaths);
+    }
+}
+
+
+//random changes in folders that exist in "expected"
+void recordRandomChanges(std::mt19937& rng, JournalRecorder& recorder, const InSyncFolder& expected, size_t changeCount)
+{
+    std::vector<Zstring> folderPaths{Zstring()};
+    getFolderPaths(expected, Zstring(), folderPaths);
+
+    for (size_t i = 0; i < changeCount; ++i)
+    {
+        const Zstring& parentRelPath = folderPaths[rng() % folderPaths.size()];
+        const Zstring itemNo = numberTo<Zstring>(rng() % 250); //existing and new items
+
+        switch (rng() % 6)
+        {
+            case 0:
+            case 1:
+                recorder.setFile(parentRelPath, Zstr("File ") + itemNo + Zstr(".txt"),
+                                 InSyncFile{{static_cast<time_t>(rng()), rng()}, {static_cast<time_t>(rng()), rng()}, CompareVariant::timeSize, rng()});
+                break;
+            case 2:
+                recorder.removeFile(parentRelPath, Zstr("File ") + itemNo + Zstr(".Dat"));
+                break;
+            case 3:
+                recorder.setSymlink(parentRelPath, Zstr("Link ") + itemNo,
+                                    InSyncSymlink{{static_cast<time_t>(rng())}, {static_cast<time_t>(rng())}, CompareVariant::content});
+                break;
+            case 4:
+                recorder.removeSymlink(parentRelPath, Zstr("Link ") + itemNo);
+                break;
+            case 5: //new folder + content: journal path must resolve folders added by the same journal
+            {
+                const Zstring folderName = Zstr("New ") + itemNo;
+                recorder.addFolder(parentRelPath, folderName);
+                recorder.setFile(appendPath(parentRelPath, folderName), Zstr("Nested.bin"), InSyncFile{{1, 2}, {3, 4}, CompareVariant::size, 5});
+                recorder.setFolderComplete(parentRelPath, folderName, rng() % 2 == 0);
+
+                const Zstring tmpFolderName = Zstr("Tmp ") + itemNo; //never a parent of later changes
+                recorder.addFolder(parentRelPath, tmpFolderName);
+                recorder.setFile(appendPath(parentRelPath, tmpFolderName), Zstr("Nested.bin"), InSyncFile{{1, 2}, {3, 4}, CompareVariant::size, 5});
+                recorder.removeFolder(parentRelPath, tmpFolderName);
+            }
+            break;
+        }
+    }
+}
+
+
+int testRoundTrip(std::mt19937& rng)
+{
+    TestCheck check;
+
+    InSyncFolder original;
+    size_t itemCount = 0;
+    addRandomItems(rng, original, 4, itemCount);
+
+    std::string streamL, streamR;
+    StopWatch watchGen;
+    StreamGenerator::execute(original, nullptr /*oldLayout*/, true /*leadStreamLeft*/, displayPathL, displayPathR, streamL, streamR); //throw FileError
+    const auto elapsedGen = watchGen.elapsed();
+
+    StopWatch watchParse;
+    std::shared_ptr<const InSyncFolderLoader> loader;
+    const SharedRef<InSyncFolder> parsed = parseStreams(true /*leadStreamLeft*/, true /*loadAll*/, streamL, streamR, &loader); //throw FileError
+    const auto elapsedParse = watchParse.elapsed();
+
+    std::cout << "Round trip: " << itemCount << " items, " << loader->getLayout().blocks.size() << " blocks, " << streamL.size() + streamR.size() << " bytes\n" <<
+              "  generate: " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsedGen  ).count() << " ms\n" <<
+              "  parse:    " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsedParse).count() << " ms\n";
+
+    check(loader->getLayout().blocks.size() > 1, "multiple folder record blocks");
+    check(isDecodedAll(parsed.ref()), "load all: decoded on owner thread => available to worker threads");
+    check(equalFolders(parsed.ref(), original), "load all");
+    check(equalFolders(parseStreams(true, false /*loadAll*/, streamL, streamR).ref(), original), "lazy load");
+    check(equalFolders(parseStreams(false /*leadStreamLeft*/, true, streamR, streamL).ref(), flipFolder(original)), "load with lead stream right");
+
+    //lazy decoding on a different thread: contract violation, also in release builds
+    {
+        const SharedRef<InSyncFolder> lazy = parseStreams(true, false /*loadAll*/, streamL, streamR); //throw FileError
+        const InSyncFolder& subFolder = lazy.ref().refFolders().begin()->second; //throw FileError
+        bool contractViolation = false;
+        std::thread([&]
+        {
+            try { subFolder.refFiles(); } //throw FileError
+            catch (std::logic_error&) { contractViolation = true; }
+        }).join();
+        check(!subFolder.isDecoded() && contractViolation, "lazy decoding on wrong thread");
+    }
+
+    //same byte stream for same content, independent from hash table order
+    {
+        std::string streamL2, streamR2;
+        StreamGenerator::execute(parsed.ref(), nullptr /*oldLayout*/, true /*leadStreamLeft*/, displayPathL, displayPathR, streamL2, streamR2); //throw FileError
+        check(streamL2 == streamL && streamR2 == streamR, "deterministic stream");
+    }
+
+    //compaction: only decoded folders are re-encoded, blocks of undecoded sub trees are copied
+    for (const bool leadStreamLeft : {true, false})
+    {
+        std::shared_ptr<const InSyncFolderLoader> oldLoader;
+        SharedRef<InSyncFolder> lazy = parseStreams(leadStreamLeft, false /*loadAll*/, //throw FileError
+                                                    leadStreamLeft ? streamL : streamR,
+                                                    leadStreamLeft ? streamR : streamL, &oldLoader);
+        InSyncFolder expected = leadStreamLeft ? original : flipFolder(original);
+
+        //change a leaf folder: only the folders on its path are decoded
+        InSyncFolder* folder    = &lazy.ref();
+        InSyncFolder* expFolder = &expected;
+        while (!folder->refFolders().empty()) //throw FileError
+        {
+            auto it = folder->refFolders().begin();
+            expFolder = &expFolder->refFolders().find(it->first)->second;
+            folder    = &it->second;
+        }
+        folder   ->addFile(Zstr("New file"), {}, {}, CompareVariant::timeSize, 0);
+        expFolder->addFile(Zstr("New file"), {}, {}, CompareVariant::timeSize, 0);
+
+        std::string newStreamL, newStreamR;
+        StreamGenerator::execute(lazy.ref(), &oldLoader->getLayout(), oldLoader->isLeadStreamLeft(), displayPathL, displayPathR, newStreamL, newStreamR); //throw FileError
+
+        std::shared_ptr<const InSyncFolderLoader> newLoader;
+        check(equalFolders(parseStreams(leadStreamLeft, true /*loadAll*/, newStreamL, newStreamR, &newLoader).ref(), expected), "compaction: copy blocks (load all)"); //throw FileError
+        check(equalFolders(parseStreams(leadStreamLeft, false,            newStreamL, newStreamR).ref(), expected), "compaction: copy blocks (lazy load)");
+
+        const DbStreamLayout& oldLayout = oldLoader->getLayout();
+        const DbStreamLayout& newLayout = newLoader->getLayout();
+        size_t copiedBlocks = 0;
+        for (size_t i = 0; i < oldLayout.blocks.size(); ++i)
+            if (newLayout.blocks[i].second != 0)
+            {
+                check(newLayout.getData(newLayout.blocks[i]) == oldLayout.getData(oldLayout.blocks[i]), "compaction: same block index");
+                ++copiedBlocks;
+            }
+        check(copiedBlocks > 0 && newLayout.blocks.size() - oldLayout.blocks.size() < oldLayout.blocks.size(), "compaction: unchanged blocks copied");
+    }
+
+    for (const bool leadStreamLeft : {true, false})
+    {
+        //lead stream right: same database files, but base folders swapped
+        std::string curStreamL = leadStreamLeft ? streamL : streamR;
+        std::string curStreamR = leadStreamLeft ? streamR : streamL;
+        InSyncFolder expected = leadStreamLeft ? original : flipFolder(original);
+
+        for (int session = 0; session < 3; ++session) //multiple journal chunks
+        {
+            std::shared_ptr<const InSyncFolderLoader> curLoader;
+            parseStreams(leadStreamLeft, false /*loadAll*/, curStreamL, curStreamR, &curLoader); //throw FileError
+            check(curLoader->isLeadStreamLeft() == leadStreamLeft, "lead stream");
+            check(curLoader->getLayout().journal.size() == static_cast<size_t>(session), "journal chunk count");
+
+            DbJournal journal(curLoader->isLeadStreamLeft());
+            JournalRecorder recorder(expected, journal);
+            recordRandomChanges(rng, recorder, expected, 100);
+
+            std::string newStreamL, newStreamR;
+            const bool appended = StreamGenerator::appendJournal(curLoader->getLayout(), curLoader->isLeadStreamLeft(), journal, //throw FileError
+                                                                 displayPathL, displayPathR, newStreamL, newStreamR);
+            check(appended, "journal appended");
+            if (!appended)
+                break;
+            check(newStreamL.size() + newStreamR.size() < curStreamL.size() + curStreamR.size() + journal.ref().size(), "journal only");
+
+            curStreamL = std::move(newStreamL);
+            curStreamR = std::move(newStreamR);
+
+            check(equalFolders(parseStreams(leadStreamLeft, true,  curStreamL, curStreamR).ref(), expected), "journal applied (load all)");
+            check(equalFolders(parseStreams(leadStreamLeft, false, curStreamL, curStreamR).ref(), expected), "journal applied (lazy load)");
+        }
+
+        //empty journal: reproduce old stream
+        {
+            std::shared_ptr<const InSyncFolderLoader> curLoader;
+            parseStreams(leadStreamLeft, false, curStreamL, curStreamR, &curLoader); //throw FileError
+
+            std::string newStreamL, newStreamR;
+            check(StreamGenerator::appendJournal(curLoader->getLayout(), leadStreamLeft, DbJournal(leadStreamLeft), //throw FileError
+                                                 displayPathL, displayPathR, newStreamL, newStreamR) &&
+                  newStreamL == curStreamL && newStreamR == curStreamR, "empty journal");
+        }
+
+        //compaction due: full rewrite needed
+        {
+            std::shared_ptr<const InSyncFolderLoader> curLoader;
+            parseStreams(leadStreamLeft, false, curStreamL, curStreamR, &curLoader); //throw FileError
+
+            DbJournal journal(leadStreamLeft);
+            JournalRecorder recorder(expected, journal);
+            recordRandomChanges(rng, recorder, expected, itemCount);
+
+            std::string newStreamL, newStreamR;
+            check(!StreamGenerator::appendJournal(curLoader->getLayout(), leadStreamLeft, journal, //throw FileError
+                                                  displayPathL, displayPathR, newStreamL, newStreamR), "compaction due");
+        }
+    }
+    return check.getErrorCount();
+}
+
+
+int testIncrementalUpdate()
+{
+    TestCheck check;
+
+    //database: a.txt in "A" is outdated (changed on both sides outside of sync), b.txt in "B" is synced below
+    InSyncFolder original;
+    InSyncFolder& dbFolderA = original.addFolder(Zstr("A"));
+    dbFolderA.addFile(Zstr("a.txt"), {100, 1}, {100, 2}, CompareVariant::timeSize, 10);
+    for (int i = 0; i < 100; ++i) //keep journal small compared to database: no compaction
+        dbFolderA.addFile(Zstr("file") + numberTo<Zstring>(i), {100, 5}, {100, 6}, CompareVariant::timeSize, 10);
+    original.addFolder(Zstr("B")).addFile(Zstr("b.txt"), {100, 3}, {100, 4}, CompareVariant::timeSize, 10);
+    InSyncFolder& dbFolderD = original.addFolder(Zstr("D"));
+    dbFolderD.addFile(Zstr("d.txt"), {100, 5}, {100, 6}, CompareVariant::timeSize, 10);
+    dbFolderD.setComplete(true);
+
+    std::string streamL, streamR;
+    StreamGenerator::execute(original, nullptr /*oldLayout*/, true /*leadStreamLeft*/, displayPathL, displayPathR, streamL, streamR); //throw FileError
+
+    //comparison: everything in "A" is equal, including new.txt which was created identically on both sides => no sync needed in "A"
+    auto baseFolder = makeSharedRef<BaseFolderPair>(createItemPathNative(Zstr("/left")),  BaseFolderStatus::existing,
+                                                    createItemPathNative(Zstr("/right")), BaseFolderStatus::existing,
+                                                    makeSharedRef<NullFilter>(), CompareVariant::timeSize, 2, std::vector<unsigned int>());
+    FolderPair& folderA = baseFolder.ref().addFolder(Zstr("A"), FolderAttributes(), Zstr("A"), FolderAttributes());
+    FolderPair& folderB = baseFolder.ref().addFolder(Zstr("B"), FolderAttributes(), Zstr("B"), FolderAttributes());
+    folderA.addFile(Zstr("a.txt"),   FileAttributes{200, 10, 1, false}, Zstr("a.txt"),   FileAttributes{200, 10, 2, false}).setContentCategory(FileContentCategory::equal);
+    folderA.addFile(Zstr("new.txt"), FileAttributes{400, 20, 7, false}, Zstr("new.txt"), FileAttributes{400, 20, 8, false}).setContentCategory(FileContentCategory::equal);
+    for (int i = 0; i < 100; ++i)
+        folderA.addFile(Zstr("file") + numberTo<Zstring>(i), FileAttributes{100, 10, 5, false},
+                        Zstr("file") + numberTo<Zstring>(i), FileAttributes{100, 10, 6, false}).setContentCategory(FileContentCategory::equal);
+    FilePair& fileB = folderB.addFile(Zstr("b.txt"), FileAttributes{300, 10, 3, false}, Zstr("b.txt"), FileAttributes{100, 10, 4, false});
+    fileB.setContentCategory(FileContentCategory::leftNewer);
+
+    fileB.setSyncedTo<SelectSide::right>(10, 300, 300, 4, 3, false, false);
+
+    //"C" is new and has an item not in sync => not complete: partial comparison must read it from disk
+    FolderPair& folderC = baseFolder.ref().addFolder(Zstr("C"), FolderAttributes(), Zstr("C"), FolderAttributes());
+    folderC.addFile<SelectSide::left>(Zstr("c.txt"), FileAttributes{500, 10, 9, false});
+
+    //"D" was taken from the database by partial comparison and is still in sync => not decoded when updating the database
+    FolderPair& folderD = baseFolder.ref().addFolder(Zstr("D"), FolderAttributes{.isLastSyncState = true}, Zstr("D"), FolderAttributes{.isLastSyncState = true});
+    folderD.addFile(Zstr("d.txt"), FileAttributes{100, 10, 5, false}, Zstr("d.txt"), FileAttributes{100, 10, 6, false}).setContentCategory(FileContentCategory::equal);
+
+    std::shared_ptr<const InSyncFolderLoader> loader;
+    SharedRef<InSyncFolder> lastSyncState = parseStreams(true /*leadStreamLeft*/, false /*loadAll*/, streamL, streamR, &loader); //throw FileError
+    DbJournal journal(loader->isLeadStreamLeft());
+    LastSynchronousStateUpdater::execute(baseFolder.ref(), lastSyncState.ref(), journal); //throw FileError
+    check(!lastSyncState.ref().refFolders().at(Zstring(Zstr("D"))).isDecoded(), "folder taken from database is not decoded");
+
+    std::string newStreamL, newStreamR;
+    check(StreamGenerator::appendJournal(loader->getLayout(), loader->isLeadStreamLeft(), journal, //throw FileError
+                                         displayPathL, displayPathR, newStreamL, newStreamR), "journal appended");
+
+    InSyncFolder expected = original;
+    InSyncFolder::FileList& expectedFilesA = expected.refFolders().at(Zstring(Zstr("A"))).refFiles();
+    expectedFilesA.insert_or_assign(Zstring(Zstr("a.txt")),   InSyncFile{{200, 1}, {200, 2}, CompareVariant::timeSize, 10});
+    expectedFilesA.insert_or_assign(Zstring(Zstr("new.txt")), InSyncFile{{400, 7}, {400, 8}, CompareVariant::timeSize, 20});
+    expected.refFolders().at(Zstring(Zstr("B"))).refFiles().insert_or_assign(Zstring(Zstr("b.txt")), InSyncFile{{300, 3}, {300, 4}, CompareVariant::timeSize, 10});
+    expected.refFolders().at(Zstring(Zstr("A"))).setComplete(true);
+    expected.refFolders().at(Zstring(Zstr("B"))).setComplete(true);
+    expected.addFolder(Zstr("C"));
+
+    const SharedRef<InSyncFolder> savedState = parseStreams(true, false, newStreamL, newStreamR); //throw FileError
+    check(equalFolders(savedState.ref(), expected), "folders without items to sync are updated, too");
+    check(!savedState.ref().refFolders().at(Zstring(Zstr("C"))).isComplete(), "folder with items not in sync is incomplete");
+
+    //next comparison: new.txt deleted on the left => the database must know it was in sync, else two-way sync copies it back from the right
+    const InSyncFolder::FileList& savedFilesA = savedState.ref().refFolders().at(Zstring(Zstr("A"))).refFiles();
+    const auto itNew = savedFilesA.find(Zstring(Zstr("new.txt")));
+    check(itNew != savedFilesA.end() && itNew->second.right == InSyncDescrFile{400, 8} && itNew->second.fileSize == 20,
+          "file that became equal without sync is known after deletion on one side");
+
+    return check.getErrorCount();
+}
+
+
+int testCorruption(std::mt19937& rng)
+{
+    InSyncFolder original;
+    size_t itemCount = 0;
+    addRandomItems(rng, original, 2, itemCount);
+
+    std::string streamL, streamR;
+    StreamGenerator::execute(original, nullptr /*oldLayout*/, true /*leadStreamLeft*/, displayPathL, displayPathR, streamL, streamR); //throw FileError
+
+    //truncated or modified stream: FileError, no crash (bit flips in compressed data may go unnoticed: content not checked)
+    TestCheck check;
+    for (int i = 0; i < 200; ++i)
+    {
+        std::string badStreamL = streamL;
+        if (i % 2 == 0)
+            badStreamL.resize(rng() % badStreamL.size());
+        else
+            badStreamL[12 + rng() % (badStreamL.size() - 12)] ^= static_cast<char>(1 << (rng() % 8)); //skip stream version + size: std::bad_alloc instead of FileError
+        try
+        {
+            equalFolders(parseStreams(true, i % 4 < 2 /*loadAll*/, badStreamL, streamR).ref(), original); //throw FileError
+            check(i % 2 != 0, "truncated stream not detected");
+        }
+        catch (FileError&) {}
+    }
+
+    //codec stated in stream header: unknown codec => "Unsupported data format" instead of garbage
+    {
+        std::string badStreamL = streamL;
+        badStreamL[sizeof(int32_t) + sizeof(uint64_t)] = 0x7f; //after stream version + size
+        try
+        {
+            parseStreams(true, false, badStreamL, streamR); //throw FileError
+            check(false, "unknown codec not detected");
+        }
+        catch (const FileError& e) { check(contains(e.toString(), _("Unsupported data format.")), "unknown codec"); }
+    }
+    return check.getErrorCount();
+}
+}
+
+
+int main()
+{
+    std::mt19937 rng(42); //deterministic
+    try
+    {
+        const int errorCount = testRoundTrip(rng) + testIncrementalUpdate() + testCorruption(rng);
+        std::cout << "sync.ffs_db stream + journal round trip: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+        return errorCount == 0 ? 0 : 1;
+    }
+    catch (const FileError& e)
+    {
+        std::cerr << utfTo<std::string>(e.toString()) << '\n';
+        return 1;
+    }
+}
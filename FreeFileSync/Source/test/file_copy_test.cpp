@@ -0,0 +1,78 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../afs/native.h"
+#include <iostream>
+#include <zen/file_access.h>
+#include <zen/file_io.h>
+#include <zen/guid.h>
+#include "test_tools.h"
+
+using namespace zen;
+using namespace fff;
+using AFS = AbstractFileSystem;
+
+/*  AFS::copyFileTransactional() with onSourceData (hash source while copying for "verify copied files"):
+    - copy method is still chosen by copyNewFile(): reflink, copy_file_range or user space buffers, depending on the file system
+    - onSourceData receives all source data in file order for FileCopyMethod::stream, nothing otherwise
+    - target content equals source content for every copy method          */
+namespace
+{
+const size_t FILE_SIZE = 4 * 1024 * 1024 + 123; //not a multiple of the block size
+
+
+int runTest(const Zstring& folderPath) //throw FileError
+{
+    TestCheck check;
+
+    const std::string content = generateGUID() + std::string(FILE_SIZE - generateGUID().size(), 'x');
+    const Zstring sourcePath = appendPath(folderPath, Zstr("source"));
+    const Zstring targetPath = appendPath(folderPath, Zstr("target"));
+    setFileContent(sourcePath, content, nullptr /*notifyUnbufferedIO*/); //throw FileError
+
+    std::string sourceData;
+    const AFS::FileCopyResult result = AFS::copyFileTransactional(createItemPathNative(sourcePath), AFS::StreamAttributes(), //throw FileError, ErrorFileLocked
+                                                                  createItemPathNative(targetPath), false /*copyFilePermissions*/, false /*transactionalCopy*/,
+                                                                  nullptr /*onDeleteTargetFile*/, nullptr /*notifyUnbufferedIO*/,
+                                                                  [&](const void* buffer, size_t bytes) { sourceData.append(static_cast<const char*>(buffer), bytes); });
+    switch (result.copyMethod)
+    {
+        case AFS::FileCopyMethod::stream:
+            std::cout << "  copy method: user space buffers\n";
+            check(sourceData == content, "onSourceData received all source data");
+            break;
+        case AFS::FileCopyMethod::offloaded:
+            std::cout << "  copy method: in-kernel copy\n";
+            check(sourceData.empty(), "onSourceData not called");
+            break;
+        case AFS::FileCopyMethod::sharedExtents:
+            std::cout << "  copy method: reflink\n";
+            check(sourceData.empty(), "onSourceData not called");
+            break;
+    }
+    check(result.fileSize == FILE_SIZE, "file size");
+    check(getFileContent(targetPath, nullptr /*notifyUnbufferedIO*/) == content, "target content"); //throw FileError
+    return check.getErrorCount();
+}
+}
+
+
+int main()
+{
+    try
+    {
+        const TestFolder testFolder; //throw FileError
+
+        const int errorCount = runTest(testFolder.getPath()); //throw FileError
+        std::cout << "File copy with onSourceData: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+        return errorCount == 0 ? 0 : 1;
+    }
+    catch (const FileError& e)
+    {
+        std::cerr << utfTo<std::string>(e.toString()) << '\n';
+        return 1;
+    }
+}
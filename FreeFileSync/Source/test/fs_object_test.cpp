@@ -0,0 +1,196 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../base/file_hierarchy.h"
+#include "../afs/native.h"
+#include <iostream>
+#include <unordered_set>
+#include <malloc.h> //mallinfo2()
+#include <zen/perf.h>
+#include "test_tools.h"
+
+using namespace zen;
+using namespace fff;
+
+/*  FileSystemObject hierarchy: list nodes from the BaseFolderPair's FsObjectPool, ObjectMgr ids = slot + generation
+    - benchmark: construction, id lookup and teardown of a comparison result
+    - weak references: ids of destroyed objects return nullptr, even after their slot was reused
+
+    usage: fs_object_test [file count]
+           default: 1M files; 10M files: fs_object_test 10000000      */
+namespace
+{
+const size_t FILES_PER_FOLDER = 1000;
+
+
+SharedRef<BaseFolderPair> createBaseFolder()
+{
+    return makeSharedRef<BaseFolderPair>(createItemPathNative(Zstr("/left")),  BaseFolderStatus::existing,
+                                         createItemPathNative(Zstr("/right")), BaseFolderStatus::existing,
+                                         makeSharedRef<NullFilter>(), CompareVariant::timeSize, 2, std::vector<unsigned int>());
+}
+
+
+//same item order as MergeSides: files existing on both sides, a few on one side only
+void fillBaseFolder(BaseFolderPair& baseFolder, size_t fileCount)
+{
+    for (size_t i = 0; i * FILES_PER_FOLDER < fileCount; ++i)
+    {
+        const Zstring folderName = Zstr("Camera Upload ") + numberTo<Zstring>(i);
+        FolderPair& folder = baseFolder.addFolder(folderName, FolderAttributes(), folderName, FolderAttributes());
+
+        for (size_t k = i * FILES_PER_FOLDER; k < std::min((i + 1) * FILES_PER_FOLDER, fileCount); ++k)
+        {
+            const Zstring fileName = Zstr("IMG_20240101_") + numberTo<Zstring>(100000 + k) + Zstr(".jpg");
+            const FileAttributes attr{static_cast<time_t>(1'700'000'000 + k), 1'000'000 + k, k, false};
+
+            if (k % 10 == 0)
+                folder.addFile<SelectSide::left>(fileName, attr);
+            else
+                folder.addFile(fileName, attr, fileName, attr);
+        }
+        folder.addLink<SelectSide::right>(Zstr("latest.jpg"), LinkAttributes{static_cast<time_t>(1'700'000'000 + i)});
+    }
+}
+
+
+void getIds(ContainerObject& conObj, std::vector<FileSystemObject::ObjectId>& ids)
+{
+    for (FilePair& file : conObj.refSubFiles())
+        ids.push_back(file.getId());
+    for (SymlinkPair& symlink : conObj.refSubLinks())
+        ids.push_back(symlink.getId());
+    for (FolderPair& folder : conObj.refSubFolders())
+    {
+        ids.push_back(folder.getId());
+        getIds(folder, ids);
+    }
+}
+
+
+size_t getHeapUsage()
+{
+    const struct mallinfo2 info = ::mallinfo2();
+    return info.uordblks + info.hblkhd; //allocated via brk() + mmap()
+}
+
+
+int64_t toMs(std::chrono::nanoseconds elapsed) { return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(); }
+
+
+void benchmark(size_t fileCount)
+{
+    ::malloc_trim(0);
+    const size_t heapBefore = getHeapUsage();
+
+    StopWatch watchBuild;
+    std::shared_ptr<BaseFolderPair> baseFolder = createBaseFolder().ptr();
+    fillBaseFolder(*baseFolder, fileCount);
+    const auto elapsedBuild = watchBuild.elapsed();
+    const size_t heapUsed = getHeapUsage() - heapBefore;
+
+    std::vector<FileSystemObject::ObjectId> ids;
+    getIds(*baseFolder, ids);
+
+    size_t foundCount = 0;
+    StopWatch watchRetrieve;
+    for (const FileSystemObject::ObjectId id : ids)
+        foundCount += FileSystemObject::retrieve(id) != nullptr;
+    const auto elapsedRetrieve = watchRetrieve.elapsed();
+
+    StopWatch watchTeardown;
+    baseFolder.reset();
+    const auto elapsedTeardown = watchTeardown.elapsed();
+
+    //previous ObjectMgr: hash set of all live objects
+    std::unordered_set<const void*> activeObjects;
+    size_t foundCountHashSet = 0;
+    StopWatch watchHashSet;
+    for (const FileSystemObject::ObjectId& id : ids)
+        activeObjects.insert(&id);
+    for (const FileSystemObject::ObjectId& id : ids)
+        foundCountHashSet += activeObjects.contains(&id);
+    for (const FileSystemObject::ObjectId& id : ids)
+        activeObjects.erase(&id);
+    const auto elapsedHashSet = watchHashSet.elapsed();
+
+    std::cout << "FileSystemObject hierarchy: " << ids.size() << " items, " << foundCount << '/' << foundCountHashSet << " found, " <<
+              heapUsed / (1024 * 1024) << " MB, " << heapUsed / ids.size() << " bytes/item\n" <<
+              "  build:    " << toMs(elapsedBuild   ) << " ms\n" <<
+              "  retrieve: " << toMs(elapsedRetrieve) << " ms\n" <<
+              "  teardown: " << toMs(elapsedTeardown) << " ms\n" <<
+              "  hash set register + lookup + unregister (previous ObjectMgr): " << toMs(elapsedHashSet) << " ms\n";
+}
+
+
+int testWeakRefs()
+{
+    TestCheck check;
+
+    SharedRef<BaseFolderPair> baseFolder = createBaseFolder();
+    fillBaseFolder(baseFolder.ref(), 10 * FILES_PER_FOLDER);
+
+    std::vector<FileSystemObject::ObjectId> idsAll;
+    getIds(baseFolder.ref(), idsAll);
+    check(std::all_of(idsAll.begin(), idsAll.end(), [](FileSystemObject::ObjectId id) { return id && FileSystemObject::retrieve(id); }), "live ids");
+    check(std::unordered_set<FileSystemObject::ObjectIdConst>(idsAll.begin(), idsAll.end()).size() == idsAll.size(), "unique ids");
+    check(!FileSystemObject::retrieve(FileSystemObject::ObjectId()), "null id");
+
+    //delete left-only files
+    std::vector<FileSystemObject::ObjectId> idsRemoved;
+    std::vector<std::pair<FileSystemObject::ObjectId, const FilePair*>> idsKept;
+    for (FolderPair& folder : baseFolder.ref().refSubFolders())
+        for (FilePair& file : folder.refSubFiles())
+            if (file.isEmpty<SelectSide::right>())
+            {
+                idsRemoved.push_back(file.getId());
+                file.removeItem<SelectSide::left>();
+            }
+            else
+                idsKept.emplace_back(file.getId(), &file);
+
+    baseFolder.ref().removeDoubleEmpty();
+
+    auto allRemoved = [&] { return std::all_of(idsRemoved.begin(), idsRemoved.end(), [](FileSystemObject::ObjectId id) { return !FileSystemObject::retrieve(id); }); };
+    auto allKept    = [&] { return std::all_of(idsKept.begin(), idsKept.end(), [](const auto& item) { return FileSystemObject::retrieve(item.first) == item.second; }); };
+
+    check(!idsRemoved.empty() && allRemoved(), "removed ids");
+    check(allKept(), "kept ids");
+
+    //new objects reuse the free slots: stale ids must not find them
+    std::vector<FileSystemObject::ObjectId> idsNew;
+    FolderPair& folderNew = baseFolder.ref().addFolder<SelectSide::left>(Zstr("New"), FolderAttributes());
+    for (size_t i = 0; i < idsRemoved.size(); ++i)
+        idsNew.push_back(folderNew.addFile<SelectSide::left>(Zstr("New ") + numberTo<Zstring>(i), FileAttributes()).getId());
+
+    check(allRemoved(), "removed ids after slot reuse");
+    check(allKept(), "kept ids after slot reuse");
+    check(std::all_of(idsNew.begin(), idsNew.end(), [](FileSystemObject::ObjectId id) { return FileSystemObject::retrieve(id); }), "new ids");
+    check(std::none_of(idsNew.begin(), idsNew.end(), [&](FileSystemObject::ObjectId id) { return std::find(idsRemoved.begin(), idsRemoved.end(), id) != idsRemoved.end(); }), "new ids differ from removed ids");
+
+    //const id: same object
+    const FileSystemObject::ObjectIdConst idConst = idsKept[0].first;
+    check(idConst == static_cast<const FileSystemObject*>(idsKept[0].second)->getId() && FileSystemObject::retrieve(idConst) == idsKept[0].second, "const id");
+
+    //destroy whole hierarchy
+    baseFolder = createBaseFolder();
+    check(std::none_of(idsAll.begin(), idsAll.end(), [](FileSystemObject::ObjectId id) { return FileSystemObject::retrieve(id); }) &&
+          std::none_of(idsNew.begin(), idsNew.end(), [](FileSystemObject::ObjectId id) { return FileSystemObject::retrieve(id); }), "ids after teardown");
+    return check.getErrorCount();
+}
+}
+
+
+int main(int argc, char* argv[])
+{
+    const size_t fileCount = argc > 1 ? stringTo<size_t>(argv[1]) : 1'000'000;
+
+    const int errorCount = testWeakRefs();
+    std::cout << "ObjectMgr weak references: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+
+    benchmark(fileCount);
+    return errorCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,352 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../afs/ftp.h"
+#include "../base/structures.h"
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <fcntl.h> //zen/socket.h: setNonBlocking()
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <zen/perf.h>
+#include <zen/socket.h>
+
+using namespace zen;
+using namespace fff;
+
+/*  FTP traversal lists folders in parallel over up to "parallelOps" control connections: measure folders/sec against an in-process FTP responder
+    - synthetic folder tree, MLSD listings, simulated network latency per server reply
+    - same content for all parallelOps
+
+    usage: ftp_traversal_test [latency ms] [tree depth] [sub folders per folder]
+           default: 1 ms (minimum), depth 3, 8 sub folders (585 folders)      */
+namespace
+{
+//minimal FTP server: just enough for libcurl + FtpSession: login, FEAT, passive mode, MLSD
+class FtpResponder
+{
+public:
+    FtpResponder(std::chrono::milliseconds latency, int treeDepth, size_t subFolderCount, size_t fileCount) : //throw SysError
+        latency_(latency), treeDepth_(treeDepth), subFolderCount_(subFolderCount), fileCount_(fileCount)
+    {
+        std::tie(listenSocket_, port_) = createListenSocket(); //throw SysError
+
+        acceptThread_ = std::thread([this]
+        {
+            for (;;)
+            {
+                const SocketType clientSocket = ::accept4(listenSocket_, nullptr, nullptr, SOCK_CLOEXEC);
+                if (clientSocket == invalidSocket)
+                    return; //shutdown()
+
+                setNoDelay(clientSocket);
+
+                std::lock_guard dummy(lockClients_);
+                clientSockets_.push_back(clientSocket);
+                clientThreads_.emplace_back([this, clientSocket] { serveClient(clientSocket); });
+            }
+        });
+    }
+
+    ~FtpResponder()
+    {
+        ::shutdown(listenSocket_, SHUT_RDWR); //unblock accept()
+        acceptThread_.join();
+        closeSocket(listenSocket_);
+
+        for (SocketType clientSocket : clientSockets_)
+            ::shutdown(clientSocket, SHUT_RDWR);
+        for (std::thread& t : clientThreads_)
+            t.join();
+        for (SocketType clientSocket : clientSockets_)
+            closeSocket(clientSocket);
+    }
+
+    int getPort() const { return port_; }
+
+    size_t getListingCount() const { return listingCount_; }
+
+private:
+    FtpResponder           (const FtpResponder&) = delete;
+    FtpResponder& operator=(const FtpResponder&) = delete;
+
+    static std::pair<SocketType, int> createListenSocket() //throw SysError
+    {
+        const SocketType listenSocket = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (listenSocket == invalidSocket)
+            THROW_LAST_SYS_ERROR_WSA("socket");
+        ZEN_ON_SCOPE_FAIL(closeSocket(listenSocket));
+
+        sockaddr_in addr{.sin_family = AF_INET, .sin_port = 0 /*any*/, .sin_addr{.s_addr = htonl(INADDR_LOOPBACK)}};
+        if (::bind(listenSocket, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+            THROW_LAST_SYS_ERROR_WSA("bind");
+
+        if (::listen(listenSocket, SOMAXCONN) != 0)
+            THROW_LAST_SYS_ERROR_WSA("listen");
+
+        socklen_t addrLen = sizeof(addr);
+        if (::getsockname(listenSocket, reinterpret_cast<sockaddr*>(&addr), &addrLen) != 0)
+            THROW_LAST_SYS_ERROR_WSA("getsockname");
+
+        return {listenSocket, ntohs(addr.sin_port)};
+    }
+
+    static void setNoDelay(SocketType socket) //no Nagle: don't measure delayed ACKs instead of latency
+    {
+        const int noDelay = 1;
+        ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+
+    static void writeAll(SocketType socket, const std::string& buf) //throw SysError
+    {
+        for (size_t bytesWritten = 0; bytesWritten < buf.size();)
+            bytesWritten += tryWriteSocket(socket, buf.data() + bytesWritten, buf.size() - bytesWritten); //throw SysError
+    }
+
+    //folder tree is defined by the path depth
+    std::string getListing(const std::string& dirPath) const
+    {
+        const size_t depth = splitCpy(dirPath, '/', SplitOnEmpty::skip).size();
+
+        std::string listing = "type=cdir;modify=20240101000000; .\r\n"
+                              "type=pdir;modify=20240101000000; ..\r\n";
+        if (depth < static_cast<size_t>(treeDepth_))
+            for (size_t i = 0; i < subFolderCount_; ++i)
+                listing += "type=dir;modify=20240101000000; Folder " + numberTo<std::string>(i) + "\r\n";
+
+        for (size_t i = 0; i < fileCount_; ++i)
+            listing += "type=file;size=" + numberTo<std::string>(i * 100 + depth) + ";modify=2024010100" + printNumber<std::string>("%04d", static_cast<int>(i)) +
+                       "; File " + numberTo<std::string>(i) + ".txt\r\n";
+        return listing;
+    }
+
+    void serveClient(SocketType clientSocket)
+    {
+        try
+        {
+            std::string cwd = "/";
+            SocketType dataListenSocket = invalidSocket;
+            ZEN_ON_SCOPE_EXIT(if (dataListenSocket != invalidSocket) closeSocket(dataListenSocket));
+
+            auto reply = [&](const std::string& response) //throw SysError
+            {
+                std::this_thread::sleep_for(latency_); //simulate network round trip
+                writeAll(clientSocket, response + "\r\n"); //throw SysError
+            };
+
+            reply("220 FreeFileSync test responder"); //throw SysError
+
+            std::string buf;
+            for (;;)
+            {
+                size_t pos = buf.find("\r\n");
+                while (pos == std::string::npos)
+                {
+                    char chunk[1024];
+                    const size_t bytesRead = tryReadSocket(clientSocket, chunk, sizeof(chunk)); //throw SysError
+                    if (bytesRead == 0) //EOF
+                        return;
+                    buf.append(chunk, bytesRead);
+                    pos = buf.find("\r\n");
+                }
+                const std::string line = buf.substr(0, pos);
+                buf.erase(0, pos + 2);
+
+                std::string cmd = beforeFirst(line, ' ', IfNotFoundReturn::all);
+                std::for_each(cmd.begin(), cmd.end(), [](char& c) { c = asciiToUpper(c); });
+                const std::string arg = afterFirst(line, ' ', IfNotFoundReturn::none);
+
+                if (cmd == "USER")
+                    reply("331 Password required");
+                else if (cmd == "PASS")
+                    reply("230 Logged in");
+                else if (cmd == "FEAT")
+                    reply("211-Features:\r\n MLST type*;size*;modify*;\r\n UTF8\r\n211 End");
+                else if (cmd == "OPTS")
+                    reply("200 UTF8 set to on");
+                else if (cmd == "PWD")
+                    reply("257 \"" + cwd + "\" is the current directory");
+                else if (cmd == "CWD")
+                {
+                    cwd = startsWith(arg, '/') ? arg : cwd + '/' + arg;
+                    reply("250 Directory changed");
+                }
+                else if (cmd == "TYPE" || cmd == "NOOP")
+                    reply("200 OK");
+                else if (cmd == "SYST")
+                    reply("215 UNIX Type: L8");
+                else if (cmd == "EPSV")
+                {
+                    if (dataListenSocket != invalidSocket)
+                        closeSocket(dataListenSocket);
+                    int dataPort = 0;
+                    std::tie(dataListenSocket, dataPort) = createListenSocket(); //throw SysError
+                    reply("229 Entering Extended Passive Mode (|||" + numberTo<std::string>(dataPort) + "|)");
+                }
+                else if (cmd == "MLSD")
+                {
+                    if (dataListenSocket == invalidSocket)
+                    {
+                        reply("425 Use EPSV first");
+                        continue;
+                    }
+                    reply("150 Opening data connection");
+
+                    const SocketType dataSocket = ::accept4(dataListenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+                    if (dataSocket == invalidSocket)
+                        THROW_LAST_SYS_ERROR_WSA("accept");
+                    setNoDelay(dataSocket);
+                    closeSocket(dataListenSocket);
+                    dataListenSocket = invalidSocket;
+                    {
+                        ZEN_ON_SCOPE_EXIT(closeSocket(dataSocket));
+                        writeAll(dataSocket, getListing(arg.empty() ? cwd : arg)); //throw SysError
+                    }
+                    ++listingCount_;
+                    reply("226 Transfer complete");
+                }
+                else if (cmd == "QUIT")
+                {
+                    reply("221 Goodbye");
+                    return;
+                }
+                else
+                    reply("502 Command not implemented");
+            }
+        }
+        catch (SysError&) {} //connection closed by client or shutdown()
+    }
+
+    const std::chrono::milliseconds latency_;
+    const int treeDepth_;
+    const size_t subFolderCount_;
+    const size_t fileCount_;
+
+    SocketType listenSocket_ = invalidSocket;
+    int port_ = 0;
+    std::thread acceptThread_;
+
+    std::mutex lockClients_;
+    std::vector<SocketType>  clientSockets_;
+    std::vector<std::thread> clientThreads_;
+
+    std::atomic<size_t> listingCount_{0};
+};
+
+
+struct TraversalResult
+{
+    size_t folderCount = 0;
+    size_t fileCount   = 0;
+    uint64_t totalBytes = 0;
+    size_t errorCount  = 0;
+
+    bool operator==(const TraversalResult&) const = default;
+};
+
+
+//called by the traverser thread only: no synchronization needed
+class CountingCallback : public AFS::TraverserCallback
+{
+public:
+    explicit CountingCallback(TraversalResult& result) : result_(result) {}
+
+    void onFile(const AFS::FileInfo& fi) override
+    {
+        ++result_.fileCount;
+        result_.totalBytes += fi.fileSize;
+    }
+
+    HandleLink onSymlink(const AFS::SymlinkInfo& si) override { return HandleLink::skip; }
+
+    std::shared_ptr<TraverserCallback> onFolder(const AFS::FolderInfo& fi) override
+    {
+        ++result_.folderCount;
+        return std::make_shared<CountingCallback>(result_);
+    }
+
+    HandleError reportDirError(const ErrorInfo& errorInfo) override
+    {
+        if (++result_.errorCount <= 10)
+            std::cerr << utfTo<std::string>(errorInfo.msg) << '\n';
+        return HandleError::ignore;
+    }
+
+    HandleError reportItemError(const ErrorInfo& errorInfo, const Zstring& itemName) override { return reportDirError(errorInfo); }
+
+private:
+    TraversalResult& result_;
+};
+
+
+int runTest(std::chrono::milliseconds latency, int treeDepth, size_t subFolderCount) //throw SysError
+{
+    const size_t filesPerFolder = 20;
+    FtpResponder responder(latency, treeDepth, subFolderCount, filesPerFolder); //throw SysError
+
+    ftpInit();
+    ZEN_ON_SCOPE_EXIT(ftpTeardown()); //close FTP sessions before the responder
+
+    TraversalResult expected;
+    for (size_t d = 0, levelCount = 1; d <= static_cast<size_t>(treeDepth); ++d, levelCount *= subFolderCount)
+    {
+        if (d > 0)
+            expected.folderCount += levelCount;
+        expected.fileCount += levelCount * filesPerFolder;
+        for (size_t i = 0; i < filesPerFolder; ++i)
+            expected.totalBytes += levelCount * (i * 100 + d);
+    }
+
+    const AfsDevice device = condenseToFtpDevice({.server = Zstr("127.0.0.1"), .portCfg = responder.getPort(), .username = Zstr("test"), .password = Zstr("secret")});
+
+    std::cout << "FTP traversal: " << expected.folderCount + 1 << " folders, " << expected.fileCount << " files, " << latency.count() << " ms latency per reply\n";
+
+    int errorCount = 0;
+    for (const size_t parallelOps : {1, 2, 4, 8, 16})
+    {
+        TraversalResult result;
+        const size_t listingCountBefore = responder.getListingCount();
+
+        StopWatch watch;
+        AFS::traverseFolderRecursive(device, {{AfsPath(), std::make_shared<CountingCallback>(result)}}, parallelOps);
+        const auto elapsed = watch.elapsed();
+
+        const size_t listingCount = responder.getListingCount() - listingCountBefore;
+        std::cout << "  parallelOps " << parallelOps << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms, " <<
+                  static_cast<int>(listingCount / std::chrono::duration<double>(elapsed).count()) << " folders/sec\n";
+
+        if (result != expected || listingCount != expected.folderCount + 1)
+        {
+            ++errorCount;
+            std::cerr << "FAILED: parallelOps " << parallelOps << ": " << result.folderCount << " folders, " << result.fileCount << " files, " <<
+                      result.totalBytes << " bytes, " << result.errorCount << " errors, " << listingCount << " listings\n";
+        }
+    }
+    return errorCount;
+}
+}
+
+
+int main(int argc, char* argv[])
+{
+    //0 ms: libcurl (7.88) frequently stalls 1 sec before using the passive data connection
+    const std::chrono::milliseconds latency(std::max(argc > 1 ? stringTo<int>(argv[1]) : 1, 1));
+    const int    treeDepth     = argc > 2 ? stringTo<int>   (argv[2]) : 3;
+    const size_t subFolderCount = argc > 3 ? stringTo<size_t>(argv[3]) : 8;
+
+    try
+    {
+        const int errorCount = runTest(latency, treeDepth, subFolderCount); //throw SysError
+        std::cout << "Parallel FTP traversal: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+        return errorCount == 0 ? 0 : 1;
+    }
+    catch (const SysError& e)
+    {
+        std::cerr << utfTo<std::string>(e.toString()) << '\n';
+        return 1;
+    }
+}
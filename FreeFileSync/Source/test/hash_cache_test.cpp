@@ -0,0 +1,137 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../base/hash_cache.h"
+#include "../afs/native.h"
+#include <iostream>
+#include <zen/file_io.h>
+#include <zen/file_traverser.h>
+#include "test_tools.h"
+
+using namespace zen;
+using namespace fff;
+
+/*  content digest cache: save() merges, load() sees the result
+    - entries not looked up are kept, entries found outdated are removed
+    - two instances on the same cache file: entries inserted by either are kept
+    - cache file corrupted since load(): overwritten, loaded entries are kept
+    - no temp files left behind         */
+namespace
+{
+FileAttributes getAttr(uint64_t fileSize)
+{
+    return {.modTime = std::time(nullptr) - 100 /*not racy*/, .fileSize = fileSize, .filePrint = 1000 + fileSize};
+}
+
+
+ContentDigest getDigest(char c)
+{
+    ContentDigest digest{};
+    digest.fill(static_cast<unsigned char>(c));
+    return digest;
+}
+
+
+int runTest(const Zstring& testFolderPath) //throw FileError
+{
+    TestCheck check;
+
+    const Zstring cacheDirPath = appendPath(testFolderPath, Zstr("HashCache"));
+    hashCacheInit(cacheDirPath);
+
+    const AbstractPath basePath = createItemPathNative(appendPath(testFolderPath, Zstr("base"))); //no need to exist
+
+    auto loadCache = [&]
+    {
+        auto hashCache = std::make_unique<ContentHashCache>(basePath);
+        hashCache->load(); //throw FileError
+        return hashCache;
+    };
+    auto isCached = [&](ContentHashCache& hashCache, const Zstring& relPath, uint64_t fileSize, char c)
+    {
+        return hashCache.find(relPath, getAttr(fileSize)) == getDigest(c);
+    };
+
+    {
+        std::unique_ptr<ContentHashCache> hashCache = loadCache();
+        hashCache->insert(Zstr("a"), getAttr(1), getDigest('a'));
+        hashCache->insert(Zstr("b"), getAttr(2), getDigest('b'));
+        hashCache->insert(Zstr("c"), getAttr(3), getDigest('c'));
+        hashCache->save(); //throw FileError
+    }
+    {
+        std::unique_ptr<ContentHashCache> hashCache = loadCache();
+        check(isCached(*hashCache, Zstr("a"), 1, 'a'), "entry found");
+        check(!hashCache->find(Zstr("b"), getAttr(22)), "file changed: entry outdated");
+        hashCache->insert(Zstr("d"), getAttr(4), getDigest('d'));
+        hashCache->save(); //throw FileError
+    }
+    {
+        std::unique_ptr<ContentHashCache> hashCache = loadCache();
+        check(isCached(*hashCache, Zstr("a"), 1, 'a'), "looked up: kept");
+        check(!isCached(*hashCache, Zstr("b"), 2, 'b'), "outdated: removed");
+        check(isCached(*hashCache, Zstr("c"), 3, 'c'), "not looked up: kept");
+        check(isCached(*hashCache, Zstr("d"), 4, 'd'), "inserted: saved");
+    }
+
+    //two instances:
+    {
+        std::unique_ptr<ContentHashCache> hashCache1 = loadCache();
+        std::unique_ptr<ContentHashCache> hashCache2 = loadCache();
+        hashCache1->insert(Zstr("e"), getAttr(5), getDigest('e'));
+        hashCache2->insert(Zstr("f"), getAttr(6), getDigest('f'));
+        hashCache1->save(); //throw FileError
+        hashCache2->save(); //throw FileError
+
+        std::unique_ptr<ContentHashCache> hashCache = loadCache();
+        check(isCached(*hashCache, Zstr("e"), 5, 'e'), "two instances: first kept");
+        check(isCached(*hashCache, Zstr("f"), 6, 'f'), "two instances: second kept");
+    }
+
+    std::vector<Zstring> cacheFilePaths;
+    traverseFolder(cacheDirPath, [&](const FileInfo& fi) { cacheFilePaths.push_back(fi.fullPath); }, nullptr, nullptr); //throw FileError
+    check(cacheFilePaths.size() == 1 && endsWith(cacheFilePaths[0], Zstr(".ffs_hash")), "no temp files left");
+
+    //corrupted since load():
+    if (cacheFilePaths.size() == 1)
+    {
+        std::unique_ptr<ContentHashCache> hashCache = loadCache();
+        setFileContent(cacheFilePaths[0], "garbage", nullptr /*notifyUnbufferedIO*/); //throw FileError
+        try
+        {
+            loadCache();
+            check(false, "corrupted: FileError expected");
+        }
+        catch (FileError&) {}
+
+        hashCache->insert(Zstr("g"), getAttr(7), getDigest('g'));
+        hashCache->save(); //throw FileError
+
+        hashCache = loadCache();
+        check(isCached(*hashCache, Zstr("g"), 7, 'g'), "corrupted: overwritten");
+        check(isCached(*hashCache, Zstr("a"), 1, 'a'), "corrupted: loaded entries kept");
+    }
+    return check.getErrorCount();
+}
+}
+
+
+int main()
+{
+    try
+    {
+        const TestFolder testFolder; //throw FileError
+
+        const int errorCount = runTest(testFolder.getPath()); //throw FileError
+        std::cout << "Content digest cache: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+        return errorCount == 0 ? 0 : 1;
+    }
+    catch (const FileError& e)
+    {
+        std::cerr << utfTo<std::string>(e.toString()) << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,339 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../afs/init_curl_libssh2.h"
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <fcntl.h> //zen/socket.h: setNonBlocking()
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <libcurl/curl_wrap.h>
+#include <zen/perf.h>
+#include <zen/socket.h>
+
+using namespace zen;
+
+/*  HttpMultiplexer (Google Drive metadata requests): run many small requests of many threads over one curl multi handle
+    - in-process mock of the Drive REST API: plain HTTP/1.1 with keep-alive, simulated latency per response
+      => HTTP/2 requires TLS (CURL_HTTP_VERSION_2TLS): tests the HTTP/1.1 fallback with up to MAX_CONNECTIONS connections
+    - every caller gets its own response: files.get, files.update (PATCH: setModTime, move), files.delete, 404
+    - benchmark: sequential HttpSession requests vs. parallel callers sharing the HttpMultiplexer
+
+    usage: http_multiplexer_test [latency ms] [request count]
+           default: 5 ms, 1000 requests      */
+namespace
+{
+constinit Global<UniSessionCounter> httpSessionCount;
+GLOBAL_RUN_ONCE(httpSessionCount.set(createUniSessionCounter()));
+UniInitializer globalInitHttp(*httpSessionCount.get());
+
+
+//minimal Drive REST server: just enough for libcurl: Content-Length bodies, no chunked encoding
+class DriveResponder
+{
+public:
+    explicit DriveResponder(std::chrono::milliseconds latency) : latency_(latency) //throw SysError
+    {
+        listenSocket_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (listenSocket_ == invalidSocket)
+            THROW_LAST_SYS_ERROR_WSA("socket");
+        ZEN_ON_SCOPE_FAIL(closeSocket(listenSocket_));
+
+        sockaddr_in addr{.sin_family = AF_INET, .sin_port = 0 /*any*/, .sin_addr{.s_addr = htonl(INADDR_LOOPBACK)}};
+        if (::bind(listenSocket_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+            THROW_LAST_SYS_ERROR_WSA("bind");
+
+        if (::listen(listenSocket_, SOMAXCONN) != 0)
+            THROW_LAST_SYS_ERROR_WSA("listen");
+
+        socklen_t addrLen = sizeof(addr);
+        if (::getsockname(listenSocket_, reinterpret_cast<sockaddr*>(&addr), &addrLen) != 0)
+            THROW_LAST_SYS_ERROR_WSA("getsockname");
+        port_ = ntohs(addr.sin_port);
+
+        acceptThread_ = std::thread([this]
+        {
+            for (;;)
+            {
+                const SocketType clientSocket = ::accept4(listenSocket_, nullptr, nullptr, SOCK_CLOEXEC);
+                if (clientSocket == invalidSocket)
+                    return; //shutdown()
+
+                const int noDelay = 1; //no Nagle: don't measure delayed ACKs instead of latency
+                ::setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+                std::lock_guard dummy(lockClients_);
+                clientSockets_.push_back(clientSocket);
+                clientThreads_.emplace_back([this, clientSocket] { serveClient(clientSocket); });
+            }
+        });
+    }
+
+    ~DriveResponder()
+    {
+        ::shutdown(listenSocket_, SHUT_RDWR); //unblock accept()
+        acceptThread_.join();
+        closeSocket(listenSocket_);
+
+        for (SocketType clientSocket : clientSockets_)
+            ::shutdown(clientSocket, SHUT_RDWR);
+        for (std::thread& t : clientThreads_)
+            t.join();
+        for (SocketType clientSocket : clientSockets_)
+            closeSocket(clientSocket);
+    }
+
+    int getPort() const { return port_; }
+
+    size_t getConnectionCount() { std::lock_guard dummy(lockClients_); return clientSockets_.size(); }
+
+private:
+    DriveResponder           (const DriveResponder&) = delete;
+    DriveResponder& operator=(const DriveResponder&) = delete;
+
+    //=> statusCode + response body
+    static std::pair<int, std::string> getResponse(const std::string& method, const std::string& path, const std::string& body)
+    {
+        const std::string_view filePath = beforeFirst<std::string_view>(path, '?', IfNotFoundReturn::all);
+
+        if (!startsWith(filePath, "/drive/v3/files/"))
+            return {404, R"({ "error": { "code": 404, "message": "Not Found" } })"};
+
+        const std::string itemId(afterLast(filePath, '/', IfNotFoundReturn::none));
+        if (method == "GET")
+            return {200, R"({ "id": ")" + itemId + R"(", "name": "File )" + itemId + R"(.txt" })"};
+        if (method == "PATCH")
+            return {200, R"({ "id": ")" + itemId + R"(", "request": )" + body + " }"};
+        if (method == "DELETE")
+            return {204, ""};
+        return {405, ""};
+    }
+
+    void serveClient(SocketType clientSocket)
+    {
+        try
+        {
+            std::string buf;
+            auto readMore = [&] //throw SysError
+            {
+                char chunk[4096];
+                const size_t bytesRead = tryReadSocket(clientSocket, chunk, sizeof(chunk)); //throw SysError
+                buf.append(chunk, bytesRead);
+                return bytesRead != 0;
+            };
+
+            for (;;) //keep-alive: one request after the other
+            {
+                size_t headerEnd = buf.find("\r\n\r\n");
+                while (headerEnd == std::string::npos)
+                {
+                    if (!readMore()) //throw SysError
+                        return; //EOF
+                    headerEnd = buf.find("\r\n\r\n");
+                }
+                const std::string header = buf.substr(0, headerEnd);
+                buf.erase(0, headerEnd + 4);
+
+                size_t contentLength = 0;
+                for (const std::string_view& line : splitCpy<std::string_view>(header, '\n', SplitOnEmpty::skip))
+                    if (startsWithAsciiNoCase(line, "Content-Length:"))
+                        contentLength = stringTo<size_t>(afterFirst(line, ':', IfNotFoundReturn::none));
+
+                while (buf.size() < contentLength)
+                    if (!readMore()) //throw SysError
+                        return;
+                const std::string body = buf.substr(0, contentLength);
+                buf.erase(0, contentLength);
+
+                const std::string_view requestLine = beforeFirst<std::string_view>(header, "\r\n", IfNotFoundReturn::all);
+                const std::string method(beforeFirst(requestLine, ' ', IfNotFoundReturn::all));
+                const std::string path(beforeFirst(afterFirst(requestLine, ' ', IfNotFoundReturn::none), ' ', IfNotFoundReturn::all));
+
+                const auto& [statusCode, responseBody] = getResponse(method, path, body);
+
+                std::this_thread::sleep_for(latency_); //simulate network round trip + server processing
+
+                const std::string response = "HTTP/1.1 " + numberTo<std::string>(statusCode) + (statusCode < 400 ? " OK" : " Error") + "\r\n"
+                                             "Content-Type: application/json; charset=UTF-8\r\n"
+                                             "Content-Length: " + numberTo<std::string>(responseBody.size()) + "\r\n\r\n" + responseBody;
+                for (size_t bytesWritten = 0; bytesWritten < response.size();)
+                    bytesWritten += tryWriteSocket(clientSocket, response.data() + bytesWritten, response.size() - bytesWritten); //throw SysError
+            }
+        }
+        catch (SysError&) {} //connection closed by client or shutdown()
+    }
+
+    const std::chrono::milliseconds latency_;
+
+    SocketType listenSocket_ = invalidSocket;
+    int port_ = 0;
+    std::thread acceptThread_;
+
+    std::mutex lockClients_;
+    std::vector<SocketType>  clientSockets_;
+    std::vector<std::thread> clientThreads_;
+};
+
+
+struct DriveRequest
+{
+    std::string path;
+    std::vector<CurlOption> options;
+    std::string postBuf; //CURLOPT_POSTFIELDS: must remain valid until perform() returns
+    int expectedStatus = 0;
+    std::string expectedResponse;
+};
+
+
+//same request types as gdrive.cpp: getItemDetails(), gdriveUpdateItem() (mod time, move), gdriveDeleteItem()
+DriveRequest makeRequest(size_t i)
+{
+    const std::string itemId = "item" + numberTo<std::string>(i);
+    DriveRequest req;
+    req.path = "/drive/v3/files/" + itemId + "?supportsAllDrives=true";
+
+    switch (i % 4)
+    {
+        case 0:
+            req.expectedStatus = 200;
+            req.expectedResponse = R"({ "id": ")" + itemId + R"(", "name": "File )" + itemId + R"(.txt" })";
+            break;
+        case 1:
+            req.postBuf = R"({ "modifiedTime": "2024-01-01T00:00:)" + numberTo<std::string>(10 + i % 50) + R"(.000Z" })";
+            req.expectedStatus = 200;
+            req.expectedResponse = R"({ "id": ")" + itemId + R"(", "request": )" + req.postBuf + " }";
+            break;
+        case 2:
+            req.options.emplace_back(CURLOPT_CUSTOMREQUEST, "DELETE");
+            req.expectedStatus = 204;
+            break;
+        case 3:
+            req.path = "/drive/v3/unknown/" + itemId;
+            req.expectedStatus = 404;
+            req.expectedResponse = R"({ "error": { "code": 404, "message": "Not Found" } })";
+            break;
+    }
+    if (!req.postBuf.empty())
+    {
+        req.options.emplace_back(CURLOPT_CUSTOMREQUEST, "PATCH");
+        req.options.emplace_back(CURLOPT_POSTFIELDS, req.postBuf.c_str());
+    }
+    return req;
+}
+
+
+const int timeoutSec = 10;
+
+
+int runTest(std::chrono::milliseconds latency, size_t requestCount) //throw SysError
+{
+    DriveResponder responder(latency); //throw SysError
+    const Zstring server = Zstr("127.0.0.1:") + numberTo<Zstring>(responder.getPort());
+
+    const std::shared_ptr<UniCounterCookie> cookie = getLibsshCurlUnifiedInitCookie(httpSessionCount); //throw SysError
+
+    std::vector<DriveRequest> requests;
+    for (size_t i = 0; i < requestCount; ++i)
+        requests.push_back(makeRequest(i));
+
+    std::cout << "Drive REST mock: " << requestCount << " requests, " << latency.count() << " ms latency per response\n";
+
+    //old: one blocking HttpSession
+    std::chrono::nanoseconds elapsedSession{};
+    {
+        HttpSession session(server, false /*useTls*/, Zstring()); //throw SysError
+        StopWatch watch;
+        for (const DriveRequest& req : requests)
+            session.perform(req.path, {"Content-Type: application/json; charset=UTF-8"}, req.options, //throw SysError
+                            [](std::span<const char> buf) {}, nullptr /*readRequest*/, nullptr /*receiveHeader*/, timeoutSec);
+        elapsedSession = watch.elapsed();
+    }
+    std::cout << "  HttpSession, 1 thread:       " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsedSession).count() << " ms, " <<
+              static_cast<int>(requestCount / std::chrono::duration<double>(elapsedSession).count()) << " requests/sec\n";
+
+    int errorCount = 0;
+    std::mutex lockErrors;
+
+    for (const size_t threadCount : {1, 4, 16, 64})
+    {
+        const size_t connectionCountBefore = responder.getConnectionCount();
+        HttpMultiplexer mux(server, false /*useTls*/, Zstring()); //throw SysError
+
+        std::atomic<size_t> nextRequest{0};
+        StopWatch watch;
+        std::vector<std::thread> callers;
+        for (size_t t = 0; t < threadCount; ++t)
+            callers.emplace_back([&]
+            {
+                for (size_t i = nextRequest++; i < requests.size(); i = nextRequest++)
+                {
+                    const DriveRequest& req = requests[i];
+                    std::wstring failure;
+                    try
+                    {
+                        const HttpMultiplexer::Result result = mux.perform(req.path, {"Content-Type: application/json; charset=UTF-8"}, req.options, timeoutSec); //throw SysError
+                        if (result.statusCode != req.expectedStatus || result.response != req.expectedResponse)
+                            failure = L"Unexpected response: " + numberTo<std::wstring>(result.statusCode) + L' ' + utfTo<std::wstring>(result.response);
+                    }
+                    catch (const SysError& e) { failure = e.toString(); }
+
+                    if (!failure.empty())
+                    {
+                        std::lock_guard dummy(lockErrors);
+                        if (++errorCount <= 10)
+                            std::cerr << "FAILED: " << req.path << ": " << utfTo<std::string>(failure) << '\n';
+                    }
+                }
+            });
+        for (std::thread& t : callers)
+            t.join();
+        const auto elapsed = watch.elapsed();
+
+        const size_t connectionCount = responder.getConnectionCount() - connectionCountBefore;
+        std::cout << "  HttpMultiplexer, " << threadCount << " threads:" << std::string(threadCount < 10 ? 2 : 1, ' ') <<
+                  std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms, " <<
+                  static_cast<int>(requestCount / std::chrono::duration<double>(elapsed).count()) << " requests/sec, " << connectionCount << " connections\n";
+
+        if (connectionCount > std::min<size_t>(threadCount, 8 /*HttpMultiplexer::MAX_CONNECTIONS*/))
+        {
+            ++errorCount;
+            std::cerr << "FAILED: too many connections: " << connectionCount << '\n';
+        }
+    }
+
+    //server not reachable: SysError, no hang
+    {
+        HttpMultiplexer mux(Zstr("127.0.0.1:1"), false /*useTls*/, Zstring()); //throw SysError
+        try
+        {
+            mux.perform("/drive/v3/files/item0", {}, {}, timeoutSec); //throw SysError
+            ++errorCount;
+            std::cerr << "FAILED: connection refused not reported\n";
+        }
+        catch (SysError&) {}
+    }
+    return errorCount;
+}
+}
+
+
+int main(int argc, char* argv[])
+{
+    const std::chrono::milliseconds latency(argc > 1 ? stringTo<int>(argv[1]) : 5);
+    const size_t requestCount = argc > 2 ? stringTo<size_t>(argv[2]) : 1000;
+    try
+    {
+        const int errorCount = runTest(latency, requestCount); //throw SysError
+        std::cout << "HttpMultiplexer vs. Drive REST mock: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+        return errorCount == 0 ? 0 : 1;
+    }
+    catch (const SysError& e)
+    {
+        std::cerr << utfTo<std::string>(e.toString()) << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,77 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include <cmath>
+#include <iostream>
+#include <zen/rate_limiter.h>
+#include <zen/string_tools.h>
+#include "test_tools.h"
+
+using namespace zen;
+using namespace fff;
+
+/*  token bucket used for device throttling: fake clock => no dependency on machine load
+    - bucket starts full: the first second is free
+    - consume() beyond the available tokens: debt => wait time = debt / rate; later callers queue up behind
+    - refill: proportional to elapsed time, capped at one second worth of tokens
+    - time going backwards (time point taken on another thread before locking): no refill, no negative refill  */
+namespace
+{
+const double RATE_PER_SEC = 1000;
+
+bool equalWait(std::chrono::steady_clock::duration wait, double expectedSec)
+{
+    return std::abs(std::chrono::duration<double>(wait).count() - expectedSec) < 1e-6;
+}
+
+
+int testTokenBucket()
+{
+    TestCheck check;
+    const auto t0 = std::chrono::steady_clock::time_point() + std::chrono::hours(1);
+    const auto sec = [&](double s) { return t0 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(s)); };
+
+    {
+        TokenBucket bucket(RATE_PER_SEC, t0);
+        check(equalWait(bucket.consume(RATE_PER_SEC, t0), 0), "initial burst is free");
+        check(equalWait(bucket.consume(RATE_PER_SEC / 2, t0), 0.5), "debt: wait for refill");
+        check(equalWait(bucket.consume(RATE_PER_SEC, t0), 1.5), "waiting callers are served in order");
+        check(equalWait(bucket.consume(0, sec(1.5)), 0), "debt paid after waiting");
+        check(equalWait(bucket.consume(RATE_PER_SEC / 4, sec(1.5)), 0.25), "no tokens left after paying debt");
+    }
+    {
+        TokenBucket bucket(RATE_PER_SEC, t0);
+        check(equalWait(bucket.consume(RATE_PER_SEC, t0), 0), "empty bucket");
+        check(equalWait(bucket.consume(RATE_PER_SEC / 2, sec(0.5)), 0), "partial refill");
+        check(equalWait(bucket.consume(RATE_PER_SEC, sec(10)), 0), "refill capped at bucket size");
+        check(equalWait(bucket.consume(RATE_PER_SEC / 10, sec(10)), 0.1), "no burst beyond bucket size");
+    }
+    {
+        TokenBucket bucket(RATE_PER_SEC, t0);
+        check(equalWait(bucket.consume(RATE_PER_SEC * 2, sec(1)), 1), "debt");
+        check(equalWait(bucket.consume(0, sec(0.5)), 1), "older time point: no (negative) refill");
+        check(equalWait(bucket.consume(0, sec(2)), 0), "refill after older time point");
+    }
+
+    //throttling at the configured rate: sum of the wait times
+    {
+        TokenBucket bucket(RATE_PER_SEC, t0);
+        auto now = t0;
+        for (int i = 0; i < 100; ++i)
+            now += bucket.consume(RATE_PER_SEC / 10, now); //caller sleeps for the returned time
+        check(equalWait(now - t0, 100 * 0.1 - 1 /*initial burst*/), "average rate");
+    }
+    return check.getErrorCount();
+}
+}
+
+
+int main()
+{
+    const int errorCount = testTokenBucket();
+    std::cout << "Device throttling token bucket: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+    return errorCount == 0 ? 0 : 1;
+}
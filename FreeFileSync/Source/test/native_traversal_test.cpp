@@ -0,0 +1,238 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../afs/native.h"
+#include <iostream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <zen/file_access.h>
+#include <zen/perf.h>
+#include "test_tools.h"
+
+using namespace zen;
+using namespace fff;
+using AFS = AbstractFileSystem;
+
+/*  native traverser reads folders via getdents64() + fstatat() (or io_uring statx): verify AFS::traverseFolder() gives same results as readdir() + lstat(full path)
+    - benchmark: all folders of a synthetic tree, single thread, warm and cold cache
+      cold cache: drop dentries, inodes and page cache (requires root), else best effort: evict folder blocks via posix_fadvise(DONTNEED)
+    - io_uring not available (kernel < 5.1, kernel.io_uring_disabled, seccomp): io_uring run is skipped
+
+    usage: native_traversal_test [folder count] [files per folder]
+           default: 100 x 1000; 1M-item tree: native_traversal_test 1000 1000      */
+namespace
+{
+struct RefItem
+{
+    Zstring itemName;
+    ItemType type = ItemType::file;
+    time_t   modTime = 0;
+    uint64_t fileSize = 0;
+    AFS::FingerPrint filePrint = 0;
+
+    bool operator==(const RefItem&) const = default;
+};
+
+
+//old implementation: one path resolution per item
+std::vector<RefItem> readFolderReference(const Zstring& dirPath) //throw FileError
+{
+    DIR* folder = ::opendir(dirPath.c_str());
+    if (!folder)
+        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot open directory %x."), L"%x", fmtPath(dirPath)), "opendir");
+    ZEN_ON_SCOPE_EXIT(::closedir(folder));
+
+    std::vector<RefItem> output;
+    for (;;)
+    {
+        errno = 0;
+        const dirent* dirEntry = ::readdir(folder);
+        if (!dirEntry)
+        {
+            if (errno == 0)
+                return output;
+            THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot read directory %x."), L"%x", fmtPath(dirPath)), "readdir");
+        }
+
+        const char* itemNameRaw = dirEntry->d_name;
+        if (itemNameRaw[0] == '.' &&
+            (itemNameRaw[1] == 0 || (itemNameRaw[1] == '.' && itemNameRaw[2] == 0)))
+            continue;
+
+        const Zstring itemPath = appendPath(dirPath, itemNameRaw);
+        struct stat itemInfo = {};
+        if (::lstat(itemPath.c_str(), &itemInfo) != 0)
+            THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot read file attributes of %x."), L"%x", fmtPath(itemPath)), "lstat");
+
+        if (S_ISDIR(itemInfo.st_mode)) //FolderInfo has no details
+            output.push_back({itemNameRaw, ItemType::folder});
+        else if (S_ISLNK(itemInfo.st_mode)) //SymlinkInfo: modification time only
+            output.push_back({itemNameRaw, ItemType::symlink, itemInfo.st_mtime});
+        else
+            output.push_back({itemNameRaw, ItemType::file, itemInfo.st_mtime, makeUnsigned(itemInfo.st_size), itemInfo.st_ino});
+    }
+}
+
+
+std::vector<RefItem> readFolderNew(const Zstring& dirPath) //throw FileError
+{
+    std::vector<RefItem> output;
+    AFS::traverseFolder(createItemPathNative(dirPath), //throw FileError
+    [&](const AFS::FileInfo&    fi) { output.push_back({fi.itemName, ItemType::file, fi.modTime, fi.fileSize, fi.filePrint}); },
+    [&](const AFS::FolderInfo&  fi) { output.push_back({fi.itemName, ItemType::folder}); },
+    [&](const AFS::SymlinkInfo& si) { output.push_back({si.itemName, ItemType::symlink, si.modTime}); });
+    return output;
+}
+
+
+void createTestTree(const Zstring& baseFolderPath, size_t folderCount, size_t filesPerFolder) //throw FileError
+{
+    for (size_t i = 0; i < folderCount; ++i)
+    {
+        const Zstring folderPath = appendPath(baseFolderPath, Zstr("Folder ") + numberTo<Zstring>(i));
+        createDirectory(folderPath); //throw FileError, ErrorTargetExisting
+        createDirectory(appendPath(folderPath, Zstr("Sub"))); //
+
+        for (size_t j = 0; j < filesPerFolder; ++j)
+        {
+            const Zstring filePath = appendPath(folderPath, Zstr("File ") + numberTo<Zstring>(j) + Zstr(".dat"));
+
+            const int fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+            if (fd == -1)
+                THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot write file %x."), L"%x", fmtPath(filePath)), "open");
+            ZEN_ON_SCOPE_EXIT(::close(fd));
+
+            if (::ftruncate(fd, j * 1000) != 0) //sparse file: cheap
+                THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot write file %x."), L"%x", fmtPath(filePath)), "ftruncate");
+
+            const timespec newTimes[2] = {{.tv_sec = 0, .tv_nsec = UTIME_OMIT}, {.tv_sec = static_cast<time_t>(1'000'000'000 + i * filesPerFolder + j)}};
+            if (::futimens(fd, newTimes) != 0)
+                THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot write modification time of %x."), L"%x", fmtPath(filePath)), "futimens");
+        }
+
+        const Zstring linkPath = appendPath(folderPath, Zstr("Link"));
+        if (::symlink("File 0.dat", linkPath.c_str()) != 0)
+            THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot create symbolic link %x."), L"%x", fmtPath(linkPath)), "symlink");
+    }
+}
+
+
+//returns false if only folder blocks could be evicted (inodes still cached)
+bool dropCaches(const std::vector<Zstring>& folderPaths)
+{
+    ::sync();
+    if (const int fd = ::open("/proc/sys/vm/drop_caches", O_WRONLY | O_CLOEXEC);
+        fd != -1)
+    {
+        ZEN_ON_SCOPE_EXIT(::close(fd));
+        if (::write(fd, "3", 1) == 1) //page cache + dentries + inodes
+            return true;
+    }
+
+    for (const Zstring& folderPath : folderPaths)
+        if (const int fd = ::open(folderPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            fd != -1)
+        {
+            [[maybe_unused]] const int rv = ::posix_fadvise(fd, 0 /*offset*/, 0 /*len: until EOF*/, POSIX_FADV_DONTNEED); //advisory only
+            ::close(fd);
+        }
+    return false;
+}
+
+
+template <class Function>
+std::pair<std::vector<std::vector<RefItem>>, std::chrono::nanoseconds> readAllFolders(const std::vector<Zstring>& folderPaths, Function readFolder) //throw FileError
+{
+    std::vector<std::vector<RefItem>> output;
+    StopWatch watch;
+    for (const Zstring& folderPath : folderPaths)
+        output.push_back(readFolder(folderPath)); //throw FileError
+    const auto elapsed = watch.elapsed();
+
+    for (std::vector<RefItem>& items : output)
+        std::sort(items.begin(), items.end(), [](const RefItem& lhs, const RefItem& rhs) { return lhs.itemName < rhs.itemName; });
+
+    return {std::move(output), elapsed};
+}
+
+
+int runTest(size_t folderCount, size_t filesPerFolder) //throw FileError
+{
+    const TestFolder testFolder; //throw FileError
+    const Zstring& baseFolderPath = testFolder.getPath();
+
+    StopWatch watchCreate;
+    createTestTree(baseFolderPath, folderCount, filesPerFolder); //throw FileError
+    std::cout << "Created " << folderCount << " x " << filesPerFolder << " files in " <<
+              std::chrono::duration_cast<std::chrono::milliseconds>(watchCreate.elapsed()).count() << " ms\n";
+
+    std::vector<Zstring> folderPaths{baseFolderPath};
+    for (size_t i = 0; i < folderCount; ++i)
+        folderPaths.push_back(appendPath(baseFolderPath, Zstr("Folder ") + numberTo<Zstring>(i)));
+
+    const bool haveIoUring = nativeTraversalIoUringSupported();
+
+    int errorCount = 0;
+    for (const bool coldCache : {false, true})
+    {
+        if (coldCache)
+            std::cout << (dropCaches(folderPaths) ? "Cold cache (drop_caches):\n" : "Cold cache (best effort: posix_fadvise; run as root for drop_caches):\n");
+        else
+        {
+            readAllFolders(folderPaths, readFolderReference); //warm up cache
+            std::cout << "Warm cache:\n";
+        }
+
+        const auto& [itemsRef, elapsedRef] = readAllFolders(folderPaths, readFolderReference); //throw FileError
+        std::cout << "  readdir + lstat(full path):   " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsedRef).count() << " ms\n";
+
+        for (const bool ioUring : {false, true})
+        {
+            const char* methodName = ioUring ? "  getdents64 + io_uring statx:  " : "  getdents64 + fstatat(dir fd): ";
+            if (ioUring && !haveIoUring)
+            {
+                std::cout << methodName << "skipped (io_uring not available)\n";
+                continue;
+            }
+            if (coldCache)
+                dropCaches(folderPaths);
+
+            setNativeTraversalIoUring(ioUring);
+            const auto& [items, elapsed] = readAllFolders(folderPaths, readFolderNew); //throw FileError
+
+            std::cout << methodName << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms\n";
+
+            for (size_t i = 0; i < folderPaths.size(); ++i)
+                if (items[i] != itemsRef[i])
+                {
+                    ++errorCount;
+                    std::cerr << "Mismatch: " << utfTo<std::string>(folderPaths[i]) << '\n';
+                }
+        }
+    }
+    setNativeTraversalIoUring(false);
+    return errorCount;
+}
+}
+
+
+int main(int argc, char* argv[])
+{
+    const size_t folderCount    = argc > 1 ? stringTo<size_t>(argv[1]) : 100;
+    const size_t filesPerFolder = argc > 2 ? stringTo<size_t>(argv[2]) : 1000;
+    try
+    {
+        const int errorCount = runTest(folderCount, filesPerFolder); //throw FileError
+        std::cout << "getdents64 + fstatat vs. readdir + lstat: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+        return errorCount == 0 ? 0 : 1;
+    }
+    catch (const FileError& e)
+    {
+        std::cerr << utfTo<std::string>(e.toString()) << '\n';
+        return 1;
+    }
+}
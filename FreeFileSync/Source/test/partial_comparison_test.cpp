@@ -0,0 +1,63 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../base/comparison.cpp" //addChangedFolders()
+#include "../afs/sftp.h"
+#include <iostream>
+#include "test_tools.h"
+
+using namespace zen;
+using namespace fff;
+
+/*  partial comparison (FreeFileSync -ChangeList): which folders of a base folder are read from disk
+    - changed items: parent folders are listed, the items themselves are rescanned (if folders)
+    - base folder or one of its parents in the change list: traverse completely
+    - not a native base folder (e.g. SFTP): changes can't be known => traverse completely, never take the content from sync.ffs_db  */
+namespace
+{
+int runTest()
+{
+    TestCheck check;
+
+    const Zstring baseFolderPath = Zstr("/tmp/FreeFileSync_Test/left");
+    const AbstractPath baseFolder = createItemPathNative(baseFolderPath);
+
+    {
+        std::unordered_set<Zstring> changedFolders;
+        std::unordered_set<Zstring> rescanFolders;
+        check(addChangedFolders(baseFolder, {appendPath(baseFolderPath, Zstr("a/b/file.txt")),
+                                             appendPath(baseFolderPath, Zstr("c")),
+                                             Zstr("/tmp/FreeFileSync_Test/right/d/file.txt")},
+                                changedFolders, rescanFolders), "partial traversal");
+
+        check(changedFolders == std::unordered_set<Zstring>{Zstr("a"), Zstr("a/b")}, "changed folders");
+        check(rescanFolders == std::unordered_set<Zstring>{Zstr("a/b/file.txt"), Zstr("c")}, "rescan folders");
+    }
+    {
+        std::unordered_set<Zstring> changedFolders;
+        std::unordered_set<Zstring> rescanFolders;
+        check(!addChangedFolders(baseFolder, {baseFolderPath}, changedFolders, rescanFolders), "base folder changed");
+        check(!addChangedFolders(baseFolder, {Zstr("/tmp/FreeFileSync_Test")}, changedFolders, rescanFolders), "parent of base folder changed");
+    }
+    {
+        //folder pair with one non-native side: no change list for SFTP => sync.ffs_db must not hide remote changes
+        const AbstractPath sftpFolder = createItemPathSftp(Zstr("sftp://user@server/folder"));
+        std::unordered_set<Zstring> changedFolders;
+        std::unordered_set<Zstring> rescanFolders;
+        check(addChangedFolders(baseFolder, {appendPath(baseFolderPath, Zstr("file.txt"))}, changedFolders, rescanFolders) &&
+              !addChangedFolders(sftpFolder, {appendPath(baseFolderPath, Zstr("file.txt"))}, changedFolders, rescanFolders), "non-native side: full traversal");
+    }
+    return check.getErrorCount();
+}
+}
+
+
+int main()
+{
+    const int errorCount = runTest();
+    std::cout << "Partial comparison change list: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+    return errorCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../base/path_filter.cpp" //matchesMask(), matchesMaskBegin(): reference implementation
+#include <iostream>
+#include <random>
+#include <zen/perf.h>
+
+using namespace zen;
+using namespace fff;
+
+/*  NameFilter compiles its masks into a DFA (NameFilter::MaskDfa): verify same results as matching mask by mask
+    - random masks and paths over a small alphabet: hit all corner cases of '*', '?' and FILE_NAME_SEPARATOR
+    - benchmark: realistic filter with many masks    */
+namespace
+{
+bool haveWildcards(const Zstring& mask) { return contains(mask, Zstr('?')) || contains(mask, Zstr('*')); }
+
+//same semantics as NameFilter::MaskMatcher::matches() without DFA
+bool refMatches(const std::vector<Zstring>& masks, const Zstring& pathUpper)
+{
+    return std::any_of(masks.begin(), masks.end(), [&](const Zstring& mask)
+    {
+        if (haveWildcards(mask))
+            return matchesMask(pathUpper.c_str(), pathUpper.c_str() + pathUpper.size(), mask.c_str());
+        return pathUpper == mask || startsWith(pathUpper, mask + FILE_NAME_SEPARATOR); //path or any parent path
+    });
+}
+
+//same semantics as NameFilter::MaskMatcher::matchesBegin() without DFA
+bool refMatchesBegin(const std::vector<Zstring>& masks, const Zstring& pathUpper)
+{
+    return std::any_of(masks.begin(), masks.end(), [&](const Zstring& mask)
+    {
+        return haveWildcards(mask) ?
+               matchesMaskBegin<true  /*haveWildcards*/>(pathUpper, mask) :
+               matchesMaskBegin<false /*haveWildcards*/>(pathUpper, mask);
+    });
+}
+
+
+Zstring joinMasks(const std::vector<Zstring>& masks)
+{
+    Zstring phrase;
+    for (const Zstring& mask : masks)
+    {
+        if (!phrase.empty())
+            phrase += FILTER_ITEM_SEPARATOR;
+        phrase += mask;
+    }
+    return phrase;
+}
+
+
+int testEquivalence(std::mt19937& rng, size_t iterations)
+{
+    auto randomString = [&](const Zstring& alphabet, size_t lenMin, size_t lenMax)
+    {
+        Zstring str(std::uniform_int_distribution<size_t>(lenMin, lenMax)(rng), Zstr(' '));
+        for (Zchar& c : str)
+            c = alphabet[std::uniform_int_distribution<size_t>(0, alphabet.size() - 1)(rng)];
+        return str;
+    };
+
+    auto randomMask = [&]
+    {
+        for (;;)
+        {
+            const Zstring mask = randomString(Zstr("AB.?*/"), 1, 7);
+            //same as file and folder mask: no special meaning for parseFilterPhrase()
+            if (!startsWith(mask, Zstr('/')) && !startsWith(mask, Zstr("*/")) &&
+                !endsWith  (mask, Zstr('/')) && !endsWith  (mask, Zstr("/*")) && !contains(mask, Zstr("//")))
+                return mask;
+        }
+    };
+
+    auto randomPath = [&]
+    {
+        Zstring path;
+        for (size_t i = std::uniform_int_distribution<size_t>(1, 4)(rng); i > 0; --i)
+        {
+            if (!path.empty())
+                path += FILE_NAME_SEPARATOR;
+            path += randomString(Zstr("aAbB."), 1, 3); //lower case: NameFilter ignores case
+        }
+        return path;
+    };
+
+    int errorCount = 0;
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        std::vector<Zstring> masks;
+        for (size_t j = std::uniform_int_distribution<size_t>(1, 4)(rng); j > 0; --j)
+            masks.push_back(randomMask());
+
+        const NameFilter filter(joinMasks(masks), Zstr(""));
+
+        for (size_t j = 0; j < 50; ++j)
+        {
+            const Zstring path = randomPath();
+            const Zstring pathUpper = getUpperCase(path);
+
+            const bool expectMatch      = refMatches     (masks, pathUpper);
+            const bool expectChildMatch = refMatchesBegin(masks, pathUpper);
+
+            const bool passFile = filter.passFileFilter(path);
+            bool childItemMightMatch = true;
+            const bool passDir = filter.passDirFilter(path, &childItemMightMatch);
+
+            if (passFile != expectMatch ||
+                passDir  != expectMatch ||
+                (!passDir && childItemMightMatch != expectChildMatch))
+            {
+                if (++errorCount <= 10)
+                    std::cerr << "Mismatch: masks \"" << utfTo<std::string>(joinMasks(masks)) << "\" path \"" << utfTo<std::string>(path) << '"' <<
+                              " file: " << passFile << " dir: " << passDir << " child: " << childItemMightMatch <<
+                              " expected: " << expectMatch << " child: " << expectChildMatch << '\n';
+            }
+        }
+    }
+    return errorCount;
+}
+
+
+void benchmark(std::mt19937& rng)
+{
+    std::vector<Zstring> masks;
+    for (const Zchar* ext : {Zstr("TMP"), Zstr("BAK"), Zstr("LOG"), Zstr("O"), Zstr("OBJ"), Zstr("PCH"), Zstr("CACHE"), Zstr("SWP"), Zstr("PYC"), Zstr("CLASS")})
+    {
+        masks.push_back(Zstr("*.") + Zstring(ext));
+        masks.push_back(Zstr("*/") + Zstring(ext) + Zstr("_FILES/*"));
+        masks.push_back(Zstr("BUILD/*/*.") + Zstring(ext));
+        masks.push_back(Zstr("*~") + Zstring(ext) + Zstr("?"));
+    }
+    for (int i = 0; i < 60; ++i)
+        masks.push_back(Zstr("PROJECT") + numberTo<Zstring>(i) + Zstr("/OUT/*"));
+
+    std::vector<Zstring> paths;
+    std::vector<Zstring> pathsUpper;
+    for (int i = 0; i < 200'000; ++i)
+    {
+        const Zstring path = Zstr("Project") + numberTo<Zstring>(rng() % 100) + Zstr("/src/module") + numberTo<Zstring>(rng() % 1000) +
+                             Zstr("/file") + numberTo<Zstring>(i) + (i % 7 == 0 ? Zstr(".tmp") : Zstr(".cpp"));
+        paths.push_back(path);
+        pathsUpper.push_back(getUpperCase(path));
+    }
+
+    const NameFilter filter(joinMasks(masks), Zstr(""));
+
+    size_t matchCountDfa = 0;
+    StopWatch watchDfa;
+    for (const Zstring& path : paths)
+        matchCountDfa += filter.passFileFilter(path);
+    const auto elapsedDfa = watchDfa.elapsed();
+
+    size_t matchCountRef = 0;
+    StopWatch watchRef;
+    for (const Zstring& pathUpper : pathsUpper) //don't measure upper-case conversion
+        matchCountRef += refMatches(masks, pathUpper);
+    const auto elapsedRef = watchRef.elapsed();
+
+    std::cout << "Benchmark: " << masks.size() << " masks, " << paths.size() << " paths, " << matchCountDfa << '/' << matchCountRef << " matches\n" <<
+              "  NameFilter (DFA): " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsedDfa).count() << " ms\n" <<
+              "  mask by mask:     " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsedRef).count() << " ms\n";
+}
+}
+
+
+int main()
+{
+    std::mt19937 rng(42); //deterministic
+
+    const int errorCount = testEquivalence(rng, 20'000);
+    std::cout << "NameFilter DFA vs. matchesMask()/matchesMaskBegin(): " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+
+    benchmark(rng);
+    return errorCount == 0 ? 0 : 1;
+}
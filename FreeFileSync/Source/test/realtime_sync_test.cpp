@@ -0,0 +1,266 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../RealTimeSync/monitor.h"
+#include <iostream>
+#include <zen/file_access.h>
+#include <zen/file_io.h>
+#include <zen/file_traverser.h>
+#include <zen/dir_watcher.h>
+#include <sys/wait.h>
+#include "test_tools.h"
+
+using namespace zen;
+using namespace fff;
+
+/*  RealTimeSync: the change list passed to the command is the only input of the next partial comparison (FreeFileSync -ChangeList)
+    => a change the monitor does not report is never synchronized
+    - a file modified while the command is running is in the change list of the next execution
+    - base folder replaced while the command is running (watches outdated): the base folder is in the change list => full comparison
+    - changes made by the command itself don't trigger another execution; watches are kept => partial comparison
+        fanotify: filtered by process id => not in the next change list
+        inotify:  can't be told apart => in the change list of the next execution, which is triggered by the next change only
+
+    the "user" runs in a process that is not a descendant of this one: everything done by this process and its children counts as done by the command
+
+    the "command" mirrors left to right, but only the items in the change list: as done by a partial comparison + sync      */
+namespace
+{
+struct StopMonitoring {};
+
+
+std::vector<Zstring> getFolderItems(const Zstring& folderPath) //throw FileError
+{
+    std::vector<Zstring> itemNames;
+    traverseFolder(folderPath,
+    [&](const FileInfo&    fi) { itemNames.push_back(fi.itemName); },
+    [&](const FolderInfo&  fi) { itemNames.push_back(fi.itemName); },
+    [&](const SymlinkInfo& si) { itemNames.push_back(si.itemName); }); //throw FileError
+    return itemNames;
+}
+
+
+void removeItem(const Zstring& itemPath) //throw FileError
+{
+    if (const std::optional<ItemType> type = getItemTypeIfExists(itemPath)) //throw FileError
+    {
+        if (*type == ItemType::folder)
+            removeDirectoryPlainRecursion(itemPath); //throw FileError
+        else
+            removeFilePlain(itemPath); //throw FileError
+    }
+}
+
+
+void copyItem(const Zstring& sourcePath, const Zstring& targetPath) //throw FileError
+{
+    if (const std::optional<ItemType> type = getItemTypeIfExists(sourcePath)) //throw FileError
+    {
+        if (*type == ItemType::folder)
+        {
+            createDirectory(targetPath); //throw FileError, ErrorTargetExisting
+            for (const Zstring& itemName : getFolderItems(sourcePath)) //throw FileError
+                copyItem(appendPath(sourcePath, itemName), appendPath(targetPath, itemName)); //throw FileError
+        }
+        else
+            setFileContent(targetPath, getFileContent(sourcePath, nullptr /*notifyUnbufferedIO*/), nullptr /*notifyUnbufferedIO*/); //throw FileError
+    }
+}
+
+
+//run "fun" in a grandchild process that is reparented (to init or a subreaper) before it starts => not part of this process tree
+void runAsOtherProcess(const std::function<void()>& fun) //throw FileError
+{
+    int fdPipe[2] = {};
+    if (::pipe(fdPipe) != 0)
+        THROW_LAST_FILE_ERROR(L"Cannot create pipe.", "pipe");
+
+    const pid_t pid = ::fork();
+    if (pid < 0)
+        THROW_LAST_FILE_ERROR(L"Cannot fork process.", "fork");
+
+    if (pid == 0) //child
+    {
+        ::close(fdPipe[0]);
+        const pid_t childPid = ::getpid();
+        if (::fork() == 0) //grandchild
+        {
+            while (::getppid() == childPid) //wait until the child has exited
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            try
+            {
+                fun(); //throw FileError
+                [[maybe_unused]] const ssize_t bytesWritten = ::write(fdPipe[1], "1", 1);
+            }
+            catch (FileError&) {}
+        }
+        ::_exit(0); //no cleanup: process was forked from a multithreaded one
+    }
+    ::close(fdPipe[1]);
+    ZEN_ON_SCOPE_EXIT(::close(fdPipe[0]));
+    ::waitpid(pid, nullptr, 0);
+
+    char result = 0;
+    while (::read(fdPipe[0], &result, 1) < 0 && errno == EINTR) //EOF after the grandchild has exited
+        ;
+    if (result != '1')
+        throw FileError(L"Other process failed.");
+}
+
+
+//relative path => file content ("" for folders)
+std::map<Zstring, std::string> getFolderContent(const Zstring& folderPath, const Zstring& relPath = Zstring()) //throw FileError
+{
+    std::map<Zstring, std::string> output;
+    traverseFolder(appendPath(folderPath, relPath),
+    [&](const FileInfo& fi) { output.emplace(appendPath(relPath, fi.itemName), getFileContent(fi.fullPath, nullptr /*notifyUnbufferedIO*/)); }, //throw FileError
+    [&](const FolderInfo& fi)
+    {
+        output.emplace(appendPath(relPath, fi.itemName), "");
+        output.merge(getFolderContent(folderPath, appendPath(relPath, fi.itemName))); //throw FileError
+    },
+    nullptr); //throw FileError
+    return output;
+}
+
+
+int runTest() //throw FileError
+{
+    const TestFolder testFolder; //throw FileError
+    const Zstring& testFolderPath = testFolder.getPath();
+
+    const Zstring leftPath    = appendPath(testFolderPath, Zstr("left"));
+    const Zstring leftOldPath = appendPath(testFolderPath, Zstr("left.old"));
+    const Zstring rightPath   = appendPath(testFolderPath, Zstr("right"));
+    createDirectory(leftPath);  //throw FileError, ErrorTargetExisting
+    createDirectory(rightPath); //
+    createDirectory(appendPath(leftPath, Zstr("sub"))); //throw FileError, ErrorTargetExisting
+    setFileContent(appendPath(leftPath, Zstr("a.txt")), "initial", nullptr /*notifyUnbufferedIO*/); //throw FileError
+    setFileContent(appendPath(leftPath, Zstr("sub/b.txt")), "initial", nullptr /*notifyUnbufferedIO*/); //
+
+    TestCheck check;
+    const bool identifiesOwnChanges = DirWatcher(leftPath).identifiesOwnProcessTree(); //throw FileError
+
+    std::vector<std::vector<Zstring>> changeLists;
+    bool done = false;
+    auto lastExecTime = std::chrono::steady_clock::now();
+    size_t wakeUpCount = 0;
+
+    auto executeExternalCommand = [&](const Zstring& changedItemPath, const std::wstring& actionName, const std::vector<Zstring>& changedPaths) //throw FileError
+    {
+        changeLists.push_back(changedPaths);
+
+        //partial mirror left -> right: sync only what's in the change list
+        std::set<Zstring> relPaths;
+        for (const Zstring& itemPath : changedPaths)
+            for (const Zstring& baseFolderPath : {leftPath, rightPath})
+                if (itemPath == baseFolderPath)
+                    relPaths.insert(Zstring()); //full comparison
+                else if (startsWith(itemPath, appendSeparator(baseFolderPath)))
+                    relPaths.insert(Zstring(itemPath.begin() + baseFolderPath.size() + 1, itemPath.end()));
+
+        for (const Zstring& relPath : relPaths)
+            if (relPath.empty()) //keep the base folder
+            {
+                for (const Zstring& itemName : getFolderItems(rightPath)) //throw FileError
+                    removeItem(appendPath(rightPath, itemName)); //throw FileError
+                for (const Zstring& itemName : getFolderItems(leftPath)) //throw FileError
+                    copyItem(appendPath(leftPath, itemName), appendPath(rightPath, itemName)); //throw FileError
+            }
+            else if (itemExists(appendPath(rightPath, beforeLast(relPath, FILE_NAME_SEPARATOR, IfNotFoundReturn::none)))) //throw FileError
+            {
+                removeItem(appendPath(rightPath, relPath)); //throw FileError
+                copyItem(appendPath(leftPath, relPath), appendPath(rightPath, relPath)); //throw FileError
+            }
+
+        switch (changeLists.size())
+        {
+            case 1: //user modifies a file while the command is running
+                runAsOtherProcess([&] { setFileContent(appendPath(leftPath, Zstr("a.txt")), "modified during execution", nullptr /*notifyUnbufferedIO*/); }); //throw FileError
+                break;
+
+            case 2:
+                check(std::find(changedPaths.begin(), changedPaths.end(), appendPath(leftPath, Zstr("a.txt"))) != changedPaths.end(),
+                      "file modified during execution is in the next change list");
+                check(std::find(changedPaths.begin(), changedPaths.end(), leftPath) == changedPaths.end() &&
+                      std::find(changedPaths.begin(), changedPaths.end(), rightPath) == changedPaths.end(), "partial comparison: watches kept");
+                if (identifiesOwnChanges)
+                    check(std::none_of(changedPaths.begin(), changedPaths.end(), [&](const Zstring& itemPath) { return startsWith(itemPath, appendSeparator(rightPath)); }),
+                          "command's own changes are not reported");
+                else //no execution for changes during the last one
+                    check(std::find(changedPaths.begin(), changedPaths.end(), appendPath(leftPath, Zstr("wake1.txt"))) != changedPaths.end(),
+                          "execution triggered by the next change only");
+
+                //base folder replaced while the command is running: watches of the old folder are outdated
+                runAsOtherProcess([&]
+                {
+                    moveAndRenameItem(leftPath, leftOldPath, false /*replaceExisting*/); //throw FileError, ErrorMoveUnsupported, ErrorTargetExisting
+                    copyItem(leftOldPath, leftPath); //throw FileError
+                    setFileContent(appendPath(leftPath, Zstr("sub/b.txt")), "modified in replaced base folder", nullptr /*notifyUnbufferedIO*/); //throw FileError
+                    removeDirectoryPlainRecursion(leftOldPath); //throw FileError
+                }); //throw FileError
+                break;
+
+            case 3:
+                check(std::find(changedPaths.begin(), changedPaths.end(), leftPath) != changedPaths.end(), "full comparison after base folder was replaced");
+                done = true;
+                break;
+        }
+        lastExecTime = std::chrono::steady_clock::now();
+    };
+
+    const auto startTime = std::chrono::steady_clock::now();
+    try
+    {
+        rts::monitorDirectories({leftPath, rightPath}, std::chrono::seconds(0), executeExternalCommand,
+                                [&](const Zstring* missingFolderPath)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            if (done || now > startTime + std::chrono::seconds(30))
+                throw StopMonitoring();
+
+            //inotify: changes during execution are only reported with the next change
+            if (wakeUpCount < changeLists.size() && now > lastExecTime + std::chrono::seconds(1))
+            {
+                wakeUpCount = changeLists.size();
+                runAsOtherProcess([&] { setFileContent(appendPath(leftPath, Zstr("wake") + numberTo<Zstring>(wakeUpCount) + Zstr(".txt")), "", nullptr /*notifyUnbufferedIO*/); }); //throw FileError
+            }
+        },
+        [&](const std::wstring& msg)
+        {
+            check(false, utfTo<std::string>(msg));
+            throw StopMonitoring();
+        },
+        std::chrono::milliseconds(50));
+    }
+    catch (StopMonitoring&) {}
+
+    check(done, "three executions");
+    check(getFolderContent(leftPath) == getFolderContent(rightPath), "all changes synchronized"); //throw FileError
+
+    std::cout << (identifiesOwnChanges ? "fanotify" : "inotify") << " executions: " << changeLists.size() << ", change list sizes:";
+    for (const std::vector<Zstring>& changeList : changeLists)
+        std::cout << ' ' << changeList.size();
+    std::cout << '\n';
+    return check.getErrorCount();
+}
+}
+
+
+int main()
+{
+    try
+    {
+        const int errorCount = runTest(); //throw FileError
+        std::cout << "RealTimeSync change lists: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+        return errorCount == 0 ? 0 : 1;
+    }
+    catch (const FileError& e)
+    {
+        std::cerr << utfTo<std::string>(e.toString()) << '\n';
+        return 1;
+    }
+}
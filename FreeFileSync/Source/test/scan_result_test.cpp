@@ -0,0 +1,211 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../base/file_hierarchy.h"
+#include <iostream>
+#include <malloc.h> //mallinfo2()
+#include <zen/perf.h>
+#include <zen/crc.h>
+
+using namespace zen;
+using namespace fff;
+
+/*  FolderContainer stores scan results in ScanArena-backed arrays: compare memory and time with the previous hash map per folder level
+    - same content after building both from the same synthetic tree
+    - traverser "retry": items reported a second time are updated, not duplicated
+
+    usage: scan_result_test [file count]
+           default: 1M files; 10M files: scan_result_test 10000000      */
+namespace
+{
+//scan result until 2026-10-16
+struct LegacyFolderContainer
+{
+    using FolderList  = std::unordered_map<Zstring, std::pair<FolderAttributes, LegacyFolderContainer>>;
+    using FileList    = std::unordered_map<Zstring, FileAttributes>;
+    using SymlinkList = std::unordered_map<Zstring, LinkAttributes>;
+
+    FileList    files;
+    SymlinkList symlinks;
+    FolderList  folders;
+
+    void addFile(const Zstring& itemName, const FileAttributes& attr) { files.insert_or_assign(itemName, attr); }
+    void addLink(const Zstring& itemName, const LinkAttributes& attr) { symlinks.insert_or_assign(itemName, attr); }
+
+    LegacyFolderContainer& addFolder(const Zstring& itemName, const FolderAttributes& attr)
+    {
+        auto& p = folders[itemName];
+        p.first = attr;
+        return p.second;
+    }
+};
+
+
+const size_t FILES_PER_FOLDER   = 1000;
+const size_t FOLDERS_PER_PARENT = 100;
+
+//same item order as a traverser: 2-level hierarchy, 1000 files + 1 symlink per folder
+template <class Container>
+void fillTree(Container& root, size_t fileCount, time_t timeOffset)
+{
+    const size_t folderCount = (fileCount + FILES_PER_FOLDER - 1) / FILES_PER_FOLDER;
+
+    for (size_t i = 0; i * FOLDERS_PER_PARENT < folderCount; ++i)
+    {
+        Container& parent = root.addFolder(Zstr("Archive ") + numberTo<Zstring>(2000 + i), FolderAttributes());
+
+        for (size_t j = i * FOLDERS_PER_PARENT; j < std::min((i + 1) * FOLDERS_PER_PARENT, folderCount); ++j)
+        {
+            Container& folder = parent.addFolder(Zstr("Camera Upload ") + numberTo<Zstring>(j), FolderAttributes());
+
+            for (size_t k = j * FILES_PER_FOLDER; k < std::min((j + 1) * FILES_PER_FOLDER, fileCount); ++k)
+                folder.addFile(Zstr("IMG_20240101_") + numberTo<Zstring>(100000 + k) + Zstr(".jpg"),
+                               FileAttributes{static_cast<time_t>(1'700'000'000 + k) + timeOffset, 1'000'000 + k, k, false});
+
+            folder.addLink(Zstr("latest.jpg"), LinkAttributes{static_cast<time_t>(1'700'000'000 + j) + timeOffset});
+        }
+    }
+}
+
+
+//order-independent checksum of all items
+struct TreeDigest
+{
+    size_t   itemCount = 0;
+    uint64_t checksum  = 0;
+
+    void add(const Zstring& relPath, time_t modTime, uint64_t fileSize, AFS::FingerPrint filePrint)
+    {
+        ++itemCount;
+        checksum += getCrc32(relPath) ^ (static_cast<uint64_t>(modTime) * 31 + fileSize * 17 + filePrint);
+    }
+
+    bool operator==(const TreeDigest&) const = default;
+};
+
+
+void getDigest(const LegacyFolderContainer& folder, const Zstring& relPath, TreeDigest& digest)
+{
+    for (const auto& [fileName, attr] : folder.files)
+        digest.add(appendPath(relPath, fileName), attr.modTime, attr.fileSize, attr.filePrint);
+    for (const auto& [linkName, attr] : folder.symlinks)
+        digest.add(appendPath(relPath, linkName), attr.modTime, 0, 0);
+    for (const auto& [folderName, attrAndSub] : folder.folders)
+    {
+        digest.add(appendPath(relPath, folderName), 0, 0, 0);
+        getDigest(attrAndSub.second, appendPath(relPath, folderName), digest);
+    }
+}
+
+
+void getDigest(const FolderContainer& folder, const Zstring& relPath, TreeDigest& digest)
+{
+    for (size_t i = 0; i < folder.refFiles().size(); ++i)
+    {
+        const FileAttributes& attr = folder.refFiles().getAttr(i);
+        digest.add(appendPath(relPath, Zstring(folder.refFiles().getName(i))), attr.modTime, attr.fileSize, attr.filePrint);
+    }
+    for (size_t i = 0; i < folder.refSymlinks().size(); ++i)
+        digest.add(appendPath(relPath, Zstring(folder.refSymlinks().getName(i))), folder.refSymlinks().getAttr(i).modTime, 0, 0);
+
+    for (size_t i = 0; i < folder.refFolders().size(); ++i)
+    {
+        const Zstring folderPath = appendPath(relPath, Zstring(folder.refFolders().getName(i)));
+        digest.add(folderPath, 0, 0, 0);
+        getDigest(folder.getSubFolder(i), folderPath, digest);
+    }
+}
+
+
+size_t getHeapUsage()
+{
+    const struct mallinfo2 info = ::mallinfo2();
+    return info.uordblks + info.hblkhd; //allocated via brk() + mmap()
+}
+
+
+struct LegacyTree
+{
+    LegacyFolderContainer root;
+};
+
+struct ArenaTree
+{
+    ScanArena arena;
+    FolderContainer root{arena};
+};
+
+
+template <class Tree>
+TreeDigest runBenchmark(const char* description, size_t fileCount)
+{
+    ::malloc_trim(0);
+    const size_t heapBefore = getHeapUsage();
+
+    StopWatch watchBuild;
+    auto tree = std::make_unique<Tree>();
+    fillTree(tree->root, fileCount, 0);
+    const auto elapsedBuild = watchBuild.elapsed();
+    const size_t heapUsed = getHeapUsage() - heapBefore;
+
+    TreeDigest digest;
+    getDigest(tree->root, Zstring(), digest);
+
+    StopWatch watchTeardown;
+    tree.reset();
+    const auto elapsedTeardown = watchTeardown.elapsed();
+
+    std::cout << description << heapUsed / (1024 * 1024) << " MB, " << heapUsed / digest.itemCount << " bytes/item, " <<
+              "build: "    << std::chrono::duration_cast<std::chrono::milliseconds>(elapsedBuild   ).count() << " ms, " <<
+              "teardown: " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsedTeardown).count() << " ms\n";
+    return digest;
+}
+}
+
+
+int main(int argc, char* argv[])
+{
+    const size_t fileCount = argc > 1 ? stringTo<size_t>(argv[1]) : 1'000'000;
+    int errorCount = 0;
+
+    std::cout << "Scan result for " << fileCount << " files:\n";
+
+    const TreeDigest digestLegacy = runBenchmark<LegacyTree>("  hash map per folder level: ", fileCount);
+    const TreeDigest digestArena  = runBenchmark<ArenaTree >("  ScanArena + arrays:        ", fileCount);
+
+    if (digestArena != digestLegacy)
+    {
+        ++errorCount;
+        std::cerr << "FAILED: different content: " << digestArena.itemCount << " vs. " << digestLegacy.itemCount << " items\n";
+    }
+
+    //traverser "retry": same items reported again with new attributes => update instead of duplicate
+    {
+        const size_t retryFileCount = std::min<size_t>(fileCount, 50'000);
+
+        LegacyFolderContainer rootLegacy;
+        fillTree(rootLegacy, retryFileCount, 0);
+        fillTree(rootLegacy, retryFileCount, 1);
+
+        ScanArena arena;
+        FolderContainer root(arena);
+        fillTree(root, retryFileCount, 0);
+        root.expectDuplicates();
+        fillTree(root, retryFileCount, 1);
+
+        TreeDigest digestRetryLegacy, digestRetry;
+        getDigest(rootLegacy, Zstring(), digestRetryLegacy);
+        getDigest(root,       Zstring(), digestRetry);
+        if (digestRetry != digestRetryLegacy)
+        {
+            ++errorCount;
+            std::cerr << "FAILED: retry: " << digestRetry.itemCount << " vs. " << digestRetryLegacy.itemCount << " items\n";
+        }
+    }
+
+    std::cout << "ScanArena + arrays vs. hash map per folder level: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+    return errorCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "../base/synchronization.cpp" //DeviceBudget
+#include <iostream>
+#include "test_tools.h"
+
+using namespace zen;
+using namespace fff;
+
+/*  synchronization: worker threads are shared by both sides of a folder pair, work items are limited per target device (DeviceBudget)
+    - different devices: each side runs at most its own "deviceParallelOps" work items at a time, and does reach it
+      while other threads are waiting for the busy side
+    - same device on both sides: one budget for both      */
+namespace
+{
+struct MaxRunning
+{
+    size_t running[2] = {};
+    size_t maxRunning[2] = {};
+    size_t maxRunningTotal = 0;
+};
+
+
+MaxRunning runWorkItems(DeviceBudget& budget, const std::vector<SelectSide>& threadSides)
+{
+    std::mutex lockStats;
+    MaxRunning stats;
+    {
+        std::vector<InterruptibleThread> worker;
+        for (const SelectSide side : threadSides)
+            worker.emplace_back([&, side]
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                const size_t idx = side == SelectSide::left ? 0 : 1;
+
+                budget.acquire(side); //throw ThreadStopRequest
+                ZEN_ON_SCOPE_EXIT(budget.release(side));
+                {
+                    std::lock_guard dummy(lockStats);
+                    stats.maxRunning[idx] = std::max(stats.maxRunning[idx], ++stats.running[idx]);
+                    stats.maxRunningTotal = std::max(stats.maxRunningTotal, stats.running[0] + stats.running[1]);
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200)); //"file I/O"
+                {
+                    std::lock_guard dummy(lockStats);
+                    --stats.running[idx];
+                }
+            }
+        });
+        for (InterruptibleThread& wt : worker)
+            wt.join();
+    }
+    return stats;
+}
+
+
+int runTest()
+{
+    TestCheck check;
+
+    //native: devices below /mnt/ are told apart by name, no need to exist
+    const AfsDevice deviceA = createItemPathNative(Zstr("/mnt/DeviceA/folder")).afsDevice;
+    const AfsDevice deviceB = createItemPathNative(Zstr("/mnt/DeviceB/folder")).afsDevice;
+    check(deviceA != deviceB, "different devices");
+
+    {
+        //runSync(): 1 + 4 threads
+        DeviceBudget budget(deviceA, 1, deviceB, 4);
+        const MaxRunning stats = runWorkItems(budget, {SelectSide::left, SelectSide::left,
+                                                       SelectSide::right, SelectSide::right, SelectSide::right, SelectSide::right});
+        check(stats.maxRunning[0] == 1, "left: 1 parallel operation");
+        check(stats.maxRunning[1] == 4, "right: 4 parallel operations");
+        std::cout << "Different devices (1, 4): max. work items running: " << stats.maxRunning[0] << ", " << stats.maxRunning[1] << '\n';
+    }
+    {
+        DeviceBudget budget(deviceA, 2, deviceA, 2);
+        const MaxRunning stats = runWorkItems(budget, {SelectSide::left, SelectSide::right, SelectSide::left, SelectSide::right});
+        check(stats.maxRunningTotal == 2, "same device: shared budget");
+        std::cout << "Same device (2): max. work items running: " << stats.maxRunningTotal << '\n';
+    }
+    return check.getErrorCount();
+}
+}
+
+
+int main()
+{
+    const int errorCount = runTest();
+    std::cout << "Sync worker budget per device: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+    return errorCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#ifndef TEST_TOOLS_H_8347509834750983475
+#define TEST_TOOLS_H_8347509834750983475
+
+#include <iostream>
+#include <string>
+#include <unistd.h> //getpid()
+#include <zen/file_access.h>
+
+
+namespace fff
+{
+//non-fatal test assertion: report failure and continue with the next check
+class TestCheck
+{
+public:
+    void operator()(bool condition, const std::string& what)
+    {
+        if (!condition)
+        {
+            ++errorCount_;
+            std::cerr << "FAILED: " << what << '\n';
+        }
+    }
+
+    int getErrorCount() const { return errorCount_; }
+
+private:
+    int errorCount_ = 0;
+};
+
+
+//empty folder in the temp directory, removed with all content at scope exit
+class TestFolder
+{
+public:
+    TestFolder() : folderPath_(zen::appendPath(zen::getTempFolderPath(), //throw FileError
+                                                   Zstr("FreeFileSync_Test_") + zen::numberTo<Zstring>(::getpid())))
+    {
+        zen::createDirectory(folderPath_); //throw FileError, ErrorTargetExisting
+    }
+
+    ~TestFolder() { try { zen::removeDirectoryPlainRecursion(folderPath_); } catch (zen::FileError&) {} }
+
+    const Zstring& getPath() const { return folderPath_; }
+
+private:
+    TestFolder           (const TestFolder&) = delete;
+    TestFolder& operator=(const TestFolder&) = delete;
+
+    const Zstring folderPath_;
+};
+}
+
+#endif //TEST_TOOLS_H_8347509834750983475
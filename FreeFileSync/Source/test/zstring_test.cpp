@@ -0,0 +1,103 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include <iostream>
+#include <random>
+#include <glib.h>
+#include <zen/zstring.h>
+#include <zen/perf.h>
+#include "test_tools.h"
+
+using namespace zen;
+using namespace fff;
+
+/*  Zstring case folding and Unicode normalization: fast paths must yield the same results as glib
+    - random names over ASCII, precomposed Latin, combining characters, non-Latin and broken UTF-8
+    - equalUpperCase() against a pre-computed upper-case string == equalNoCase()   */
+namespace
+{
+//reference: always go through glib
+Zstring getNfcRef(const Zstring& str)
+{
+    const std::string strValid = utfTo<std::string>(utfTo<std::wstring>(str)); //broken UTF-8 => REPLACEMENT_CHAR (like getValidUtf())
+    gchar* strNorm = ::g_utf8_normalize(strValid.c_str(), strValid.size(), G_NORMALIZE_NFC);
+    if (!strNorm)
+        return Zstr("<error>");
+    ZEN_ON_SCOPE_EXIT(::g_free(strNorm));
+    return strNorm;
+}
+
+
+Zstring getUpperCaseRef(const Zstring& str)
+{
+    const Zstring strNorm = getNfcRef(str);
+    Zstring output;
+    UtfDecoder<char> decoder(strNorm.c_str(), strNorm.size());
+    while (const std::optional<impl::CodePoint> cp = decoder.getNext())
+        codePointToUtf<char>(::g_unichar_toupper(*cp), [&](char c) { output += c; });
+    return output;
+}
+
+
+int runTest()
+{
+    TestCheck check;
+    std::mt19937 rng(42); //deterministic
+
+    const std::vector<Zstring> alphabet
+    {
+        Zstr("a"), Zstr("Z"), Zstr("i"), Zstr("I"), Zstr("."), Zstr(" "),
+        Zstr("\xc3\xa9"), Zstr("\xc3\x89"), Zstr("\xc3\x9f"), Zstr("\xc3\xbc"), Zstr("\xc4\xb1"), Zstr("\xcb\xbf"), //é É ß ü ı U+02FF
+        Zstr("\xcc\x81"), Zstr("\xcc\x88"), Zstr("e\xcc\x81"), //combining: U+0301 U+0308, decomposed é
+        Zstr("\xd0\x96"), Zstr("\xd0\xb6"), Zstr("\xe1\x84\x80\xe1\x85\xa1"), //Ж ж, Hangul jamo (composes in NFC)
+        Zstr("\xc3"), Zstr("\xc0\x80"), Zstr("\x80"), Zstr("\xcc"), //broken UTF-8: truncated, overlong, lone continuation byte
+    };
+    auto randomName = [&](size_t lenMax)
+    {
+        Zstring name;
+        for (size_t i = std::uniform_int_distribution<size_t>(1, lenMax)(rng); i > 0; --i)
+            name += alphabet[rng() % alphabet.size()];
+        return name;
+    };
+
+    for (int i = 0; i < 100'000; ++i)
+    {
+        const Zstring name = randomName(6);
+
+        check(getUnicodeNormalForm(name) == getNfcRef(name), "getUnicodeNormalForm(): " + utfTo<std::string>(name));
+        check(getUpperCase(name) == getUpperCaseRef(name), "getUpperCase(): " + utfTo<std::string>(name));
+
+        const Zstring name2 = randomName(2);
+        const ZstringUpperCase nameUpper(name2);
+        for (const Zstring& other : {randomName(2), getUpperCase(name2), name2 + alphabet[rng() % alphabet.size()]})
+            check(equalUpperCase(nameUpper.view(), other) == equalNoCase(name2, other),
+                  "equalUpperCase(): " + utfTo<std::string>(name2) + " vs. " + utfTo<std::string>(other));
+    }
+
+    //precomposed Latin: no glib conversion
+    {
+        std::vector<Zstring> names;
+        for (int i = 0; i < 200'000; ++i)
+            names.push_back(Zstr("M\xc3\xbcller_") + numberTo<Zstring>(i) + Zstr("_Caf\xc3\xa9.txt"));
+
+        StopWatch watch;
+        size_t totalSize = 0;
+        for (const Zstring& name : names)
+            totalSize += getUnicodeNormalForm(name).size();
+        std::cout << "Benchmark: getUnicodeNormalForm() of " << names.size() << " Latin names: " <<
+                  std::chrono::duration_cast<std::chrono::milliseconds>(watch.elapsed()).count() << " ms (" << totalSize << " bytes)\n";
+    }
+    return check.getErrorCount();
+}
+}
+
+
+int main()
+{
+    const int errorCount = runTest();
+    std::cout << "Zstring case folding and Unicode normalization: " << (errorCount == 0 ? "OK" : numberTo<std::string>(errorCount) + " errors") << '\n';
+    return errorCount == 0 ? 0 : 1;
+}
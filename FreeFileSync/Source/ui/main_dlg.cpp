@@ -1106,6 +1106,10 @@ void MainDialog::setGlobalCfgOnInit(const XmlGlobalSettings& globalSettings)
 {
     globalCfg_ = globalSettings;
 
+    setNativeTraversalIoUring(globalSettings.ioUringTraversal);
+    setNativeTraversalSnapshot(globalSettings.folderSnapshot);
+    AFS::setDeviceIoLimits(getDeviceIoLimits(globalSettings.deviceIoLimits));
+
     DpiLayout layout;
     if (auto it = globalSettings.dpiLayouts.find(getDpiScalePercent());
         it != globalSettings.dpiLayouts.end())
@@ -4565,11 +4569,14 @@ void MainDialog::onCompare(wxCommandEvent& event)
         std::unique_ptr<LockHolder> dirLocks;
         folderCmp_ = compare(globalCfg_.warnDlgs,
                              globalCfg_.fileTimeTolerance,
+                             globalCfg_.contentHashCache,
                              requestPassword,
                              globalCfg_.runWithBackgroundPriority,
                              globalCfg_.createLockFile,
                              dirLocks,
                              fpCfgList,
+                             guiCfg.mainCfg.deviceParallelOps,
+                             {} /*changedItemPaths*/,
                              statusHandler); //throw CancelProcess
     }
     catch (CancelProcess&) {}
@@ -4854,6 +4861,7 @@ void MainDialog::onStartSync(wxCommandEvent& event)
                     globalCfg_.runWithBackgroundPriority,
                     extractSyncCfg(guiCfg.mainCfg),
                     folderCmp_,
+                    guiCfg.mainCfg.deviceParallelOps,
                     globalCfg_.warnDlgs,
                     statusHandler); //throw CancelProcess
     }
@@ -5166,6 +5174,7 @@ void MainDialog::startSyncForSelecction(const std::vector<FileSystemObject*>& se
                         globalCfg_.runWithBackgroundPriority,
                         fpCfgSelect,
                         folderCmpSelect,
+                        guiCfg.mainCfg.deviceParallelOps,
                         globalCfg_.warnDlgs,
                         statusHandler); //throw CancelProcess
         }
@@ -297,6 +297,247 @@ HttpSession::Result HttpSession::perform(const std::string& serverRelPath,
 }
 
 
+//----------------------------------------------------------------------------------------------------------------
+
+struct HttpMultiplexer::Transfer
+{
+    CURL* easyHandle = nullptr;
+    curl_slist* headers = nullptr; //"libcurl will not copy the entire list so you must keep it!"
+    char errorBuf[CURL_ERROR_SIZE] = {};
+    std::string response;
+    bool responseOom = false;
+
+    CURLcode rc = CURLE_OK; //protected by lockTransfers_
+    bool done = false;      //
+};
+
+
+HttpMultiplexer::HttpMultiplexer(const Zstring& server, bool useTls, const Zstring& caCertFilePath) : //throw SysError
+    serverPrefix_((useTls ? "https://" : "http://") + utfTo<std::string>(server)),
+    caCertFilePath_(utfTo<std::string>(caCertFilePath))
+{
+    multiHandle_ = ::curl_multi_init();
+    if (!multiHandle_)
+        throw SysError(formatSystemError("curl_multi_init", formatCurlStatusCode(CURLE_OUT_OF_MEMORY), L""));
+    ZEN_ON_SCOPE_FAIL(::curl_multi_cleanup(multiHandle_));
+
+    auto setMultiOption = [&](CURLMoption option, long value) //throw SysError
+    {
+        if (const CURLMcode rc = ::curl_multi_setopt(multiHandle_, option, value);
+            rc != CURLM_OK)
+            throw SysError(formatSystemError("curl_multi_setopt(" + numberTo<std::string>(static_cast<int>(option)) + ")",
+                                             L"CURLMcode " + numberTo<std::wstring>(static_cast<int>(rc)), utfTo<std::wstring>(::curl_multi_strerror(rc))));
+    };
+    setMultiOption(CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX); //throw SysError; default since libcurl 7.62, but let's be explicit
+    setMultiOption(CURLMOPT_MAX_HOST_CONNECTIONS, MAX_CONNECTIONS); //throw SysError; excess transfers are queued by libcurl
+
+    worker_ = std::thread([this]
+    {
+        setCurrentThreadName(Zstr("HTTP Multiplexer"));
+        runTransfers();
+    });
+}
+
+
+HttpMultiplexer::~HttpMultiplexer()
+{
+    {
+        std::lock_guard dummy(lockTransfers_);
+        shutdown_ = true;
+    }
+    ::curl_multi_wakeup(multiHandle_);
+    worker_.join();
+
+    ::curl_multi_cleanup(multiHandle_);
+}
+
+
+HttpMultiplexer::Result HttpMultiplexer::perform(const std::string& serverRelPath,
+                                                 const std::vector<std::string>& extraHeaders,
+                                                 const std::vector<CurlOption>& extraOptions,
+                                                 int timeoutSec) //throw SysError
+{
+    Transfer transfer;
+
+    transfer.easyHandle = ::curl_easy_init();
+    if (!transfer.easyHandle)
+        throw SysError(formatSystemError("curl_easy_init", formatCurlStatusCode(CURLE_OUT_OF_MEMORY), L""));
+    ZEN_ON_SCOPE_EXIT(::curl_easy_cleanup(transfer.easyHandle));
+    ZEN_ON_SCOPE_EXIT(::curl_slist_free_all(transfer.headers));
+
+    auto setCurlOption = [easyHandle = transfer.easyHandle](const CurlOption& curlOpt) //throw SysError
+    {
+        if (const CURLcode rc = ::curl_easy_setopt(easyHandle, curlOpt.option, curlOpt.value);
+            rc != CURLE_OK)
+            throw SysError(formatSystemError("curl_easy_setopt(" + numberTo<std::string>(static_cast<int>(curlOpt.option)) + ")",
+                                             formatCurlStatusCode(rc), utfTo<std::wstring>(::curl_easy_strerror(rc))));
+    };
+
+    //same defaults as HttpSession::perform():
+    setCurlOption({CURLOPT_PRIVATE, &transfer}); //throw SysError
+    setCurlOption({CURLOPT_ERRORBUFFER, transfer.errorBuf}); //throw SysError
+    setCurlOption({CURLOPT_USERAGENT, "FreeFileSync"}); //throw SysError; may be overwritten by caller
+    setCurlOption({CURLOPT_URL, (serverPrefix_ + serverRelPath).c_str()}); //throw SysError
+    setCurlOption({CURLOPT_ACCEPT_ENCODING, ""}); //throw SysError
+    setCurlOption({CURLOPT_NOSIGNAL, 1}); //throw SysError
+    setCurlOption({CURLOPT_CONNECTTIMEOUT, timeoutSec}); //throw SysError
+    setCurlOption({CURLOPT_LOW_SPEED_TIME, timeoutSec}); //throw SysError
+    setCurlOption({CURLOPT_LOW_SPEED_LIMIT, 1 /*[bytes]*/}); //throw SysError
+
+    //HTTP/2 over TLS if the server agrees + wait for an existing connection to multiplex on instead of opening a new one:
+    setCurlOption({CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS}); //throw SysError
+    setCurlOption({CURLOPT_PIPEWAIT, 1}); //throw SysError
+
+    //libcurl does *not* set FD_CLOEXEC for us! https://github.com/curl/curl/issues/2252
+    using SocketCbType = int (*)(void* clientp, curl_socket_t curlfd, curlsocktype purpose);
+    SocketCbType onSocketCreate = [](void* clientp, curl_socket_t curlfd, curlsocktype purpose)
+    {
+        return ::fcntl(curlfd, F_SETFD, FD_CLOEXEC) == -1 ? CURL_SOCKOPT_ERROR : CURL_SOCKOPT_OK;
+    };
+    setCurlOption({CURLOPT_SOCKOPTFUNCTION, onSocketCreate}); //throw SysError
+
+    if (caCertFilePath_.empty())
+    {
+        setCurlOption({CURLOPT_CAINFO, 0}); //throw SysError
+        setCurlOption({CURLOPT_SSL_VERIFYPEER, 0}); //throw SysError
+        setCurlOption({CURLOPT_SSL_VERIFYHOST, 0}); //throw SysError
+    }
+    else
+        setCurlOption({CURLOPT_CAINFO, caCertFilePath_.c_str()}); //throw SysError
+
+    //runs on worker thread: no exceptions!
+    curl_write_callback onBytesReceived = [](char* buffer, size_t size, size_t nitems, void* callbackData)
+    {
+        Transfer& t = *static_cast<Transfer*>(callbackData);
+        try
+        {
+            t.response.append(buffer, size * nitems);
+            return size * nitems;
+        }
+        catch (const std::bad_alloc&)
+        {
+            t.responseOom = true;
+            return size * nitems + 1; //signal error condition => CURLE_WRITE_ERROR
+        }
+    };
+    setCurlOption({CURLOPT_WRITEDATA, &transfer}); //throw SysError
+    setCurlOption({CURLOPT_WRITEFUNCTION, onBytesReceived}); //throw SysError
+
+    if (std::any_of(extraOptions.begin(), extraOptions.end(), [](const CurlOption& o)
+{
+    return o.option == CURLOPT_WRITEFUNCTION || o.option == CURLOPT_READFUNCTION ||
+           o.option == CURLOPT_HEADERFUNCTION || o.option == CURLOPT_PRIVATE;
+}))
+    /**/ throw std::logic_error(std::string(__FILE__) + '[' + numberTo<std::string>(__LINE__) + "] Contract violation!"); //buffered requests only!
+
+    for (const std::string& headerLine : extraHeaders)
+        transfer.headers = ::curl_slist_append(transfer.headers, headerLine.c_str());
+    transfer.headers = ::curl_slist_append(transfer.headers, "Expect:"); //see HttpSession::perform()
+
+    if (transfer.headers)
+        setCurlOption({CURLOPT_HTTPHEADER, transfer.headers}); //throw SysError
+
+    for (const CurlOption& option : extraOptions)
+        setCurlOption(option); //throw SysError
+
+    //=======================================================================================================
+    {
+        std::unique_lock dummy(lockTransfers_);
+        if (shutdown_)
+            throw SysError(formatSystemError("HttpMultiplexer::perform", L"", L"Function call not allowed during shutdown."));
+
+        newTransfers_.push_back(&transfer);
+        ::curl_multi_wakeup(multiHandle_);
+
+        conditionTransferDone_.wait(dummy, [&] { return transfer.done; }); //bounded by CURLOPT_CONNECTTIMEOUT, CURLOPT_LOW_SPEED_TIME
+    }
+    //=======================================================================================================
+
+    long httpStatus = 0; //optional
+    /*const CURLcode rc = */ ::curl_easy_getinfo(transfer.easyHandle, CURLINFO_RESPONSE_CODE, &httpStatus);
+
+    if (transfer.responseOom)
+        throw std::bad_alloc();
+
+    if (transfer.rc != CURLE_OK)
+    {
+        std::wstring errorMsg = trimCpy(utfTo<std::wstring>(transfer.errorBuf)); //optional
+
+        if (httpStatus != 0) //optional
+            errorMsg += (errorMsg.empty() ? L"" : L"\n") + formatHttpError(httpStatus);
+
+        throw SysError(formatSystemError("curl_multi_perform", formatCurlStatusCode(transfer.rc), errorMsg));
+    }
+
+    lastSuccessfulUseTime_ = std::chrono::steady_clock::now();
+    return {static_cast<int>(httpStatus), std::move(transfer.response)};
+}
+
+
+void HttpMultiplexer::runTransfers() //context of worker thread
+{
+    auto finishTransfer = [&](Transfer* transfer, CURLcode rc)
+    {
+        activeTransfers_.erase(transfer);
+        {
+            std::lock_guard dummy(lockTransfers_);
+            transfer->rc = rc;
+            transfer->done = true;
+        }
+        conditionTransferDone_.notify_all();
+    };
+
+    for (;;)
+    {
+        std::vector<Transfer*> newTransfers;
+        bool shutdown = false;
+        {
+            std::lock_guard dummy(lockTransfers_);
+            newTransfers.swap(newTransfers_);
+            shutdown = shutdown_;
+        }
+
+        for (Transfer* transfer : newTransfers)
+        {
+            activeTransfers_.insert(transfer);
+            if (::curl_multi_add_handle(multiHandle_, transfer->easyHandle) != CURLM_OK)
+                finishTransfer(transfer, CURLE_FAILED_INIT);
+        }
+
+        if (shutdown) //perform() must not wait forever
+        {
+            for (Transfer* transfer : std::vector<Transfer*>(activeTransfers_.begin(), activeTransfers_.end()))
+            {
+                ::curl_multi_remove_handle(multiHandle_, transfer->easyHandle);
+                finishTransfer(transfer, CURLE_ABORTED_BY_CALLBACK);
+            }
+            return;
+        }
+
+        int runningTransfers = 0;
+        ::curl_multi_perform(multiHandle_, &runningTransfers); //errors are reported per transfer below
+
+        int msgsInQueue = 0;
+        while (CURLMsg* msg = ::curl_multi_info_read(multiHandle_, &msgsInQueue))
+            if (msg->msg == CURLMSG_DONE)
+            {
+                CURL* const easyHandle = msg->easy_handle;
+                const CURLcode rc = msg->data.result; //"msg" is invalidated by curl_multi_remove_handle()
+
+                Transfer* transfer = nullptr;
+                ::curl_easy_getinfo(easyHandle, CURLINFO_PRIVATE, &transfer);
+                assert(transfer && transfer->easyHandle == easyHandle);
+
+                ::curl_multi_remove_handle(multiHandle_, easyHandle);
+                finishTransfer(transfer, rc);
+            }
+
+        //wait for socket activity, libcurl timeouts, or curl_multi_wakeup() (new transfer, shutdown)
+        ::curl_multi_poll(multiHandle_, nullptr, 0, 1000 /*timeout_ms*/, nullptr);
+    }
+}
+
+
 std::wstring zen::formatCurlStatusCode(CURLcode sc)
 {
     switch (sc)
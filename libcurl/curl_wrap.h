@@ -10,6 +10,11 @@
 #include <chrono>
 #include <span>
 #include <functional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_set>
 #include <zen/sys_error.h>
 
 
@@ -71,6 +76,55 @@ private:
 };
 
 
+/*  Multiplex the requests of many threads over a single HTTP/2 connection (curl multi interface):
+    - perform() is thread-safe and blocks until the request is complete; all transfers are driven by one worker thread
+    - request and response bodies are buffered => for small requests only (metadata, listings)
+        => no user callbacks are run on the worker thread
+    - server without HTTP/2 support: fall back to HTTP/1.1 with up to MAX_CONNECTIONS parallel connections  */
+class HttpMultiplexer
+{
+public:
+    HttpMultiplexer(const Zstring& server, bool useTls, const Zstring& caCertFilePath /*optional*/); //throw SysError
+    ~HttpMultiplexer();
+
+    struct Result
+    {
+        int statusCode = 0;
+        std::string response;
+    };
+    Result perform(const std::string& serverRelPath,
+                   const std::vector<std::string>& extraHeaders,
+                   const std::vector<CurlOption>& extraOptions, //pointer values (e.g. CURLOPT_POSTFIELDS) must remain valid until perform() returns
+                   int timeoutSec); //throw SysError
+
+    std::chrono::steady_clock::time_point getLastUseTime() const { return lastSuccessfulUseTime_; }
+
+private:
+    HttpMultiplexer           (const HttpMultiplexer&) = delete;
+    HttpMultiplexer& operator=(const HttpMultiplexer&) = delete;
+
+    struct Transfer;
+    void runTransfers(); //context of worker thread
+
+    static constexpr long MAX_CONNECTIONS = 8;
+
+    const std::string serverPrefix_;
+    const std::string caCertFilePath_; //optional
+    CURLM* multiHandle_ = nullptr;
+
+    std::mutex lockTransfers_;
+    std::condition_variable conditionTransferDone_;
+    std::vector<Transfer*> newTransfers_; //protected by lockTransfers_
+    bool shutdown_ = false;               //
+
+    std::unordered_set<Transfer*> activeTransfers_; //context of worker thread only
+
+    std::atomic<std::chrono::steady_clock::time_point> lastSuccessfulUseTime_{std::chrono::steady_clock::now()}; //perform() runs on many threads
+
+    std::thread worker_; //declare last! curl_multi_poll() is not interruptible => use shutdown_ + curl_multi_wakeup()
+};
+
+
 std::wstring formatCurlStatusCode(CURLcode sc);
 }
 
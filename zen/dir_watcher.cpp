@@ -12,64 +12,226 @@
 
     #include <map>
     #include <sys/inotify.h>
-    #include <fcntl.h> //fcntl
+    #include <sys/fanotify.h>
+    #include <poll.h>
+    #include <fcntl.h> //fcntl, open_by_handle_at
     #include <unistd.h> //close
     #include <limits.h> //NAME_MAX
+    #include <cstdio> //sscanf
+    #include <cstring> //strrchr
     #include "file_traverser.h"
+    #include "file_access.h"
+    #include "file_io.h"
 
 
 using namespace zen;
 
 
+namespace
+{
+//path of an open file descriptor with all symlinks resolved
+std::optional<Zstring> getFdPath(int fd)
+{
+    char buf[PATH_MAX] = {};
+    const ssize_t bufSize = ::readlink(("/proc/self/fd/" + numberTo<std::string>(fd)).c_str(), buf, sizeof(buf));
+    if (bufSize <= 0 || makeUnsigned(bufSize) >= sizeof(buf))
+        return {};
+    return Zstring(buf, bufSize);
+}
+
+
+struct ProcessStat
+{
+    pid_t parentPid = 0;
+    unsigned long long startTime = 0; //clock ticks since boot: (pid, startTime) identifies a process, even if its pid is reused later
+};
+//process has exited already => none
+std::optional<ProcessStat> getProcessStat(pid_t pid)
+{
+    const int fdStat = ::open(("/proc/" + numberTo<std::string>(pid) + "/stat").c_str(), O_RDONLY | O_CLOEXEC);
+    if (fdStat == -1)
+        return {};
+    ZEN_ON_SCOPE_EXIT(::close(fdStat));
+
+    char buf[1024] = {};
+    const ssize_t bytesRead = ::read(fdStat, buf, sizeof(buf) - 1);
+    if (bytesRead <= 0)
+        return {};
+
+    //"pid (comm) state ppid ... starttime(field 22) ...": comm may contain spaces and parentheses
+    const char* commEnd = std::strrchr(buf, ')');
+    char state = 0;
+    ProcessStat ps;
+    if (!commEnd || std::sscanf(commEnd + 1, " %c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu",
+                                &state, &ps.parentPid, &ps.startTime) != 3)
+        return {};
+    return ps;
+}
+
+
+//"pid" is this process or one of its descendants
+bool isOwnProcessTree(pid_t parentPid)
+{
+    const pid_t ownPid = ::getpid();
+
+    for (int i = 0; i < 100 && parentPid > 1; ++i) //don't loop endlessly: parent pids read at different times may be inconsistent
+    {
+        if (parentPid == ownPid)
+            return true;
+
+        const std::optional<ProcessStat> ps = getProcessStat(parentPid);
+        if (!ps) //parent has exited already => reparented; we don't know the original ancestors
+            return false;
+        parentPid = ps->parentPid;
+    }
+    return false;
+}
+
+
+//fanotify's filesystem mark does not cover file systems mounted below the base folder, while inotify does
+bool haveNestedMounts(const Zstring& dirPathReal) //throw FileError
+{
+    const Zstring dirPathRealPf = appendSeparator(dirPathReal);
+
+    for (const std::string_view line : splitCpy(getFileContent("/proc/self/mounts", nullptr /*notifyUnbufferedIO*/), '\n', SplitOnEmpty::skip)) //throw FileError
+    {
+        //format: <device> <mount point> <type> <options> 0 0
+        const std::string_view mountPointEsc = beforeFirst(afterFirst(line, ' ', IfNotFoundReturn::none), ' ', IfNotFoundReturn::all);
+
+        Zstring mountPoint; //special chars are octal-escaped: e.g. space as \040
+        for (size_t i = 0; i < mountPointEsc.size(); ++i)
+            if (mountPointEsc[i] == '\\' && i + 3 < mountPointEsc.size())
+            {
+                mountPoint += static_cast<char>((mountPointEsc[i + 1] - '0') * 64 + (mountPointEsc[i + 2] - '0') * 8 + (mountPointEsc[i + 3] - '0'));
+                i += 3;
+            }
+            else
+                mountPoint += mountPointEsc[i];
+
+        if (startsWith(mountPoint, dirPathRealPf) && mountPoint.size() > dirPathRealPf.size())
+            return true;
+    }
+    return false;
+}
+}
+
+
 struct DirWatcher::Impl
 {
-    int notifDescr = 0;
+    int notifDescr = -1;
+    bool fanotify = false;
+
+    //inotify:
     std::unordered_map<int, Zstring> watchedPaths; //watch descriptor and (sub-)directory paths -> owned by "notifDescr"
+
+    //fanotify:
+    int mountDescr = -1; //base directory: any file descriptor on the file system for open_by_handle_at()
+    Zstring baseDirPathReal; //symlinks resolved: same format as reported by /proc/self/fd
+    std::unordered_map<std::string /*file handle*/, Zstring /*real directory path*/> handlePaths; //buffer: reset after directory move/deletion
+    struct ProcessInfo
+    {
+        unsigned long long startTime = 0;
+        bool ownProcessTree = false;
+    };
+    std::unordered_map<pid_t, ProcessInfo> processInfos; //buffer: process may have exited before its later events are read
+
+    ~Impl()
+    {
+        if (notifDescr != -1) ::close(notifDescr); //associated watches/marks are removed automatically!
+        if (mountDescr != -1) ::close(mountDescr);
+    }
+
+    bool initFanotify(const Zstring& baseDirPath); //noexcept; false: use inotify instead
+    void addWatchesRecursive(const Zstring& dirPath); //throw FileError
+    void removeWatchesRecursive(const Zstring& dirPath);
+    std::optional<Zstring> getDirPathReal(file_handle& fh);
+    bool isOwnProcessTree(pid_t pid);
 };
 
 
-DirWatcher::DirWatcher(const Zstring& dirPath) : //throw FileError
-    baseDirPath_(dirPath),
-    pimpl_(std::make_unique<Impl>())
+bool DirWatcher::Impl::initFanotify(const Zstring& baseDirPath) //noexcept
+{
+    assert(notifDescr == -1);
+    //FAN_REPORT_DFID_NAME: kernel 5.9+; FAN_MARK_FILESYSTEM: CAP_SYS_ADMIN; open_by_handle_at(): CAP_DAC_READ_SEARCH
+    const int fanDescr = ::fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_CLOEXEC | FAN_NONBLOCK, O_RDONLY | O_CLOEXEC);
+    if (fanDescr == -1) //EPERM, EINVAL, ENOSYS
+        return false;
+    auto guardFan = makeGuard<ScopeGuardRunMode::onExit>([&] { ::close(fanDescr); });
+
+    const int dirDescr = ::open(baseDirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirDescr == -1)
+        return false;
+    auto guardDir = makeGuard<ScopeGuardRunMode::onExit>([&] { ::close(dirDescr); });
+
+    const std::optional<Zstring> dirPathReal = getFdPath(dirDescr);
+    if (!dirPathReal)
+        return false;
+    try
+    {
+        if (haveNestedMounts(*dirPathReal)) //throw FileError
+            return false;
+    }
+    catch (FileError&) { return false; }
+
+    //check *now* that file handles can be resolved
+    {
+        std::vector<std::byte> buf(sizeof(file_handle) + MAX_HANDLE_SZ);
+        file_handle& fh = reinterpret_cast<file_handle&>(buf[0]);
+        fh.handle_bytes = MAX_HANDLE_SZ;
+        int mountId = 0;
+        if (::name_to_handle_at(dirDescr, "", &fh, &mountId, AT_EMPTY_PATH) != 0)
+            return false;
+
+        const int testDescr = ::open_by_handle_at(dirDescr, &fh, O_PATH | O_CLOEXEC);
+        if (testDescr == -1) //EPERM
+            return false;
+        ::close(testDescr);
+    }
+
+    if (::fanotify_mark(fanDescr, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, //EXDEV: e.g. btrfs subvolume; ENODEV: no fsid
+                        FAN_CREATE      |
+                        FAN_DELETE      |
+                        FAN_MOVED_FROM  |
+                        FAN_MOVED_TO    |
+                        FAN_MODIFY      |
+                        FAN_CLOSE_WRITE |
+                        FAN_ONDIR, //"events for directories themselves"
+                        AT_FDCWD, baseDirPath.c_str()) != 0)
+        return false;
+
+    guardFan.dismiss();
+    guardDir.dismiss();
+    notifDescr = fanDescr;
+    mountDescr = dirDescr;
+    baseDirPathReal = *dirPathReal;
+    fanotify = true;
+    return true;
+}
+
+
+void DirWatcher::Impl::addWatchesRecursive(const Zstring& dirPath) //throw FileError
 {
-    //get all subdirectories
-    std::vector<Zstring> fullFolderList {baseDirPath_};
+    std::vector<Zstring> folderList{dirPath};
     {
         std::function<void(const Zstring& path)> traverse;
 
-        traverse = [&traverse, &fullFolderList](const Zstring& path) //throw FileError
+        traverse = [&traverse, &folderList](const Zstring& path) //throw FileError
         {
             traverseFolder(path, nullptr,
                            [&](const FolderInfo& fi )
             {
-                fullFolderList.push_back(fi.fullPath);
+                folderList.push_back(fi.fullPath);
                 traverse(fi.fullPath); //throw FileError
             },
             nullptr /*don't traverse into symlinks (analog to Windows)*/); //throw FileError
         };
 
-        traverse(baseDirPath_); //throw FileError
+        traverse(dirPath); //throw FileError
     }
 
-    //init
-    pimpl_->notifDescr  = ::inotify_init();
-    if (pimpl_->notifDescr == -1)
-        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(baseDirPath_)), "inotify_init");
-
-    ZEN_ON_SCOPE_FAIL( ::close(pimpl_->notifDescr); );
-
-    //set non-blocking mode
-    const int flags = ::fcntl(pimpl_->notifDescr, F_GETFL);
-    if (flags == -1)
-        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(baseDirPath_)), "fcntl(F_GETFL)");
-
-    if (::fcntl(pimpl_->notifDescr, F_SETFL, flags | O_NONBLOCK) != 0)
-        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(baseDirPath_)), "fcntl(F_SETFL, O_NONBLOCK)");
-
-    //add watches
-    for (const Zstring& subDirPath : fullFolderList)
+    for (const Zstring& subDirPath : folderList)
     {
-        int wd = ::inotify_add_watch(pimpl_->notifDescr, subDirPath.c_str(),
+        int wd = ::inotify_add_watch(notifDescr, subDirPath.c_str(),
                                      IN_ONLYDIR     | //"Only watch pathname if it is a directory."
                                      IN_DONT_FOLLOW | //don't follow symbolic links
                                      IN_CREATE      |
@@ -91,17 +253,101 @@ DirWatcher::DirWatcher(const Zstring& dirPath) : //throw FileError
             throw FileError(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(subDirPath)), formatSystemError("inotify_add_watch", ec));
         }
 
-        pimpl_->watchedPaths.emplace(wd, subDirPath);
+        watchedPaths.insert_or_assign(wd, subDirPath);
+    }
+}
+
+
+void DirWatcher::Impl::removeWatchesRecursive(const Zstring& dirPath)
+{
+    const Zstring dirPathPf = appendSeparator(dirPath);
+
+    std::erase_if(watchedPaths, [&](const auto& item)
+    {
+        const auto& [wd, path] = item;
+        if (path == dirPath || startsWith(path, dirPathPf))
+        {
+            ::inotify_rm_watch(notifDescr, wd); //ignore EINVAL: watch already removed (folder deleted)
+            return true;
+        }
+        return false;
+    });
+}
+
+
+std::optional<Zstring> DirWatcher::Impl::getDirPathReal(file_handle& fh)
+{
+    const std::string handleKey = std::string(reinterpret_cast<const char*>(&fh.handle_type), sizeof(fh.handle_type)) +
+                                  std::string(reinterpret_cast<const char*>(fh.f_handle), fh.handle_bytes);
+
+    if (auto it = handlePaths.find(handleKey);
+        it != handlePaths.end())
+        return it->second;
+
+    const int dirDescr = ::open_by_handle_at(mountDescr, &fh, O_PATH | O_CLOEXEC);
+    if (dirDescr == -1) //ESTALE: directory deleted in the meantime => reported by the parent directory, too
+        return {};
+    ZEN_ON_SCOPE_EXIT(::close(dirDescr));
+
+    std::optional<Zstring> dirPathReal = getFdPath(dirDescr);
+    if (dirPathReal)
+    {
+        if (handlePaths.size() > 100'000) //don't grow indefinitely: fanotify reports the whole file system
+            handlePaths.clear();
+        handlePaths.emplace(handleKey, *dirPathReal);
     }
+    return dirPathReal;
 }
 
 
-DirWatcher::~DirWatcher()
+bool DirWatcher::Impl::isOwnProcessTree(pid_t pid)
 {
-    ::close(pimpl_->notifDescr); //associated watches are removed automatically!
+    if (pid == ::getpid())
+        return true;
+
+    const auto it = processInfos.find(pid);
+
+    const std::optional<ProcessStat> ps = getProcessStat(pid);
+    if (!ps) //process has exited: buffered info is still valid unless the pid was reused (and exited again) in the meantime => see forgetProcesses()
+        return it != processInfos.end() && it->second.ownProcessTree;
+
+    if (it != processInfos.end() && it->second.startTime == ps->startTime) //else: pid was reused by a different process
+        return it->second.ownProcessTree;
+
+    if (processInfos.size() > 10'000) //don't grow indefinitely: fanotify reports all processes writing to the file system
+        processInfos.clear();
+
+    const bool ownProcessTree = ::isOwnProcessTree(ps->parentPid);
+    processInfos[pid] = {ps->startTime, ownProcessTree};
+    return ownProcessTree;
+}
+
+
+DirWatcher::DirWatcher(const Zstring& dirPath) : //throw FileError
+    baseDirPath_(dirPath),
+    pimpl_(std::make_unique<Impl>())
+{
+    if (pimpl_->initFanotify(baseDirPath_)) //no per-folder setup: instant start and no watch limit even for millions of folders
+        return;
+
+    //fall back to inotify: e.g. no CAP_SYS_ADMIN, kernel < 5.9
+    pimpl_->notifDescr = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (pimpl_->notifDescr == -1)
+        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(baseDirPath_)), "inotify_init1");
+
+    pimpl_->addWatchesRecursive(baseDirPath_); //throw FileError
 }
 
 
+DirWatcher::~DirWatcher() {}
+
+
+bool DirWatcher::identifiesOwnProcessTree() const { return pimpl_->fanotify; }
+
+
+void DirWatcher::forgetProcesses() { pimpl_->processInfos.clear(); }
+
+
 std::vector<DirWatcher::Change> DirWatcher::fetchChanges(const std::function<void()>& requestUiUpdate, std::chrono::milliseconds cbInterval) //throw FileError
 {
     std::vector<std::byte> buf(512 * (sizeof(inotify_event) + NAME_MAX + 1));
@@ -124,12 +370,97 @@ std::vector<DirWatcher::Change> DirWatcher::fetchChanges(const std::function<voi
 
     std::vector<Change> output;
 
+    if (pimpl_->fanotify)
+    {
+        const Zstring baseDirPathRealPf = appendSeparator(pimpl_->baseDirPathReal);
+
+        std::optional<std::pair<pid_t, bool /*ownProcessTree*/>> lastProcess; //consecutive events are usually from the same process: read once per buffer
+
+        auto md = reinterpret_cast<const fanotify_event_metadata*>(buf.data());
+        for (size_t len = bytesRead; FAN_EVENT_OK(md, len); md = FAN_EVENT_NEXT(md, len))
+        {
+            if (md->vers != FANOTIFY_METADATA_VERSION)
+                throw FileError(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(baseDirPath_)),
+                                formatSystemError("fanotify", L"", L"Unexpected metadata version: " + numberTo<std::wstring>(md->vers)));
+
+            if (md->mask & FAN_Q_OVERFLOW) //changes are lost => report everything as changed
+            {
+                output.push_back({ChangeType::update, baseDirPath_});
+                continue;
+            }
+            assert(md->fd == FAN_NOFD); //FAN_REPORT_DFID_NAME => no file descriptors
+
+            for (size_t infoPos = md->metadata_len; infoPos + sizeof(fanotify_event_info_header) <= md->event_len;)
+            {
+                auto& infoHdr = *reinterpret_cast<fanotify_event_info_header*>(reinterpret_cast<std::byte*>(const_cast<fanotify_event_metadata*>(md)) + infoPos);
+                if (infoHdr.len == 0) //corrupted?
+                    break;
+                infoPos += infoHdr.len;
+
+                if (infoHdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME)
+                    continue;
+
+                auto& fid = reinterpret_cast<fanotify_event_info_fid&>(infoHdr);
+                auto& fh = *reinterpret_cast<file_handle*>(fid.handle);
+                const char* itemName = reinterpret_cast<const char*>(fh.f_handle + fh.handle_bytes);
+
+                if (equalString(itemName, ".")) //event for directory itself
+                    continue;
+
+                if (const std::optional<Zstring> dirPathReal = pimpl_->getDirPathReal(fh))
+                {
+                    //filesystem-wide mark => filter out items outside of the base directory
+                    Zstring dirPath;
+                    if (*dirPathReal == pimpl_->baseDirPathReal)
+                        dirPath = baseDirPath_;
+                    else if (startsWith(*dirPathReal, baseDirPathRealPf))
+                        dirPath = appendPath(baseDirPath_, Zstring(makeStringView(dirPathReal->begin() + baseDirPathRealPf.size(), dirPathReal->end())));
+                    else
+                    {
+                        //base directory deleted or moved away: maybe re-created before the caller checks for existence => watch is outdated
+                        if ((md->mask & FAN_ONDIR) && (md->mask & (FAN_DELETE | FAN_MOVED_FROM)) && appendPath(*dirPathReal, itemName) == pimpl_->baseDirPathReal)
+                            output.push_back({ChangeType::baseFolderUnavailable, baseDirPath_});
+                        continue;
+                    }
+
+                    const Zstring itemPath = appendPath(dirPath, itemName);
+                    if (!lastProcess || lastProcess->first != md->pid)
+                        lastProcess = {md->pid, pimpl_->isOwnProcessTree(md->pid)};
+                    const bool ownProcessTree = lastProcess->second;
+
+                    if (md->mask & (FAN_CREATE | FAN_MOVED_TO))
+                        output.push_back({ChangeType::create, itemPath, ownProcessTree});
+                    else if (md->mask & (FAN_MODIFY | FAN_CLOSE_WRITE))
+                        output.push_back({ChangeType::update, itemPath, ownProcessTree});
+                    else if (md->mask & (FAN_DELETE | FAN_MOVED_FROM))
+                        output.push_back({ChangeType::remove, itemPath, ownProcessTree});
+                }
+
+                if ((md->mask & FAN_ONDIR) && (md->mask & (FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO)))
+                    pimpl_->handlePaths.clear(); //buffered paths of sub directories are outdated
+            }
+        }
+        return output;
+    }
+
     ssize_t bytePos = 0;
     while (bytePos < bytesRead)
     {
         inotify_event& evt = reinterpret_cast<inotify_event&>(buf[bytePos]);
 
-        if (evt.len != 0) //exclude case: deletion of "self", already reported by parent directory watch
+        if (evt.mask & IN_Q_OVERFLOW) //changes are lost => report everything as changed
+            output.push_back({ChangeType::update, baseDirPath_});
+        else if (evt.mask & IN_IGNORED) //watch was removed: directory deleted or moved, or inotify_rm_watch()
+            pimpl_->watchedPaths.erase(evt.wd);
+        else if (evt.mask & (IN_DELETE_SELF | IN_MOVE_SELF)) //evt.len == 0
+        {
+            //base directory deleted or moved away: maybe re-created before the caller checks for existence => watch is outdated
+            if (auto it = pimpl_->watchedPaths.find(evt.wd);
+                it != pimpl_->watchedPaths.end() && it->second == baseDirPath_)
+                output.push_back({ChangeType::baseFolderUnavailable, baseDirPath_});
+            //else: sub directory: already reported by parent directory watch
+        }
+        else if (evt.len != 0) //exclude case: deletion of "self", already reported by parent directory watch
         {
             auto it = pimpl_->watchedPaths.find(evt.wd);
             if (it != pimpl_->watchedPaths.end())
@@ -140,7 +471,21 @@ std::vector<DirWatcher::Change> DirWatcher::fetchChanges(const std::function<voi
 
                 if ((evt.mask & IN_CREATE) ||
                     (evt.mask & IN_MOVED_TO))
+                {
                     output.push_back({ChangeType::create, itemPath});
+
+                    if (evt.mask & IN_ISDIR) //watch new sub directories: no need to reset DirWatcher
+                        try
+                        {
+                            pimpl_->addWatchesRecursive(itemPath); //throw FileError
+                        }
+                        catch (FileError&)
+                        {
+                            if (itemExists(itemPath)) //throw FileError
+                                throw;
+                            //else: gone already, e.g. temporary folder
+                        }
+                }
                 else if ((evt.mask & IN_MODIFY) ||
                          (evt.mask & IN_CLOSE_WRITE))
                     output.push_back({ChangeType::update, itemPath});
@@ -148,7 +493,12 @@ std::vector<DirWatcher::Change> DirWatcher::fetchChanges(const std::function<voi
                          (evt.mask & IN_DELETE_SELF) ||
                          (evt.mask & IN_MOVE_SELF  ) ||
                          (evt.mask & IN_MOVED_FROM))
+                {
                     output.push_back({ChangeType::remove, itemPath});
+
+                    if ((evt.mask & IN_MOVED_FROM) && (evt.mask & IN_ISDIR)) //paths of moved sub directories are outdated: watched again via IN_MOVED_TO
+                        pimpl_->removeWatchesRecursive(itemPath);
+                }
             }
         }
         bytePos += sizeof(inotify_event) + evt.len;
@@ -157,3 +507,19 @@ std::vector<DirWatcher::Change> DirWatcher::fetchChanges(const std::function<voi
     return output;
 }
 
+
+bool DirWatcher::waitForChanges(const std::vector<const DirWatcher*>& watchers, std::chrono::milliseconds timeout) //throw FileError
+{
+    std::vector<pollfd> descriptors;
+    for (const DirWatcher* watcher : watchers)
+        descriptors.push_back({.fd = watcher->pimpl_->notifDescr, .events = POLLIN});
+
+    const int rv = ::poll(descriptors.data(), descriptors.size(), static_cast<int>(timeout.count()));
+    if (rv < 0)
+    {
+        if (errno == EINTR)
+            return true; //let caller check
+        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot monitor directory %x."), L"%x", watchers.empty() ? std::wstring() : fmtPath(watchers[0]->baseDirPath_)), "poll");
+    }
+    return rv > 0;
+}
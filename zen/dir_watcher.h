@@ -28,8 +28,10 @@ namespace zen
              Renaming of top watched directory handled incorrectly: Not notified(!) + additional changes in subfolders
              now do report FILE_ACTION_MODIFIED for directory (check that should prevent this fails!)
 
-    Linux: newly added subdirectories are reported but not automatically added for watching! -> reset Dirwatcher!
-           removal of base directory is NOT notified!
+    Linux: fanotify (filesystem-wide mark, kernel 5.9+, CAP_SYS_ADMIN): no per-folder setup => instant start, no watch limit
+           fallback inotify: one watch per folder; newly added subdirectories are watched once their creation is reported
+           event queue overflow is reported as "update" of the base directory => caller should recreate the DirWatcher
+           removal or move of the base directory is reported as "baseFolderUnavailable" (not if it is a mount point)
 
     macOS: everything works as expected; renaming of base directory is also detected
 
@@ -53,11 +55,22 @@ public:
     {
         ChangeType type = ChangeType::create;
         Zstring itemPath;
+        bool ownProcessTree = false; //made by this process or one of its child processes (e.g. a command run by the caller); see identifiesOwnProcessTree()
     };
 
+    //Linux fanotify: true; inotify: no process information => Change::ownProcessTree is always false
+    bool identifiesOwnProcessTree() const;
+
+    //drop buffered process information: call when child processes have ended, e.g. after a command run; else an exited process's pid may be reused meanwhile
+    void forgetProcesses();
+
     //extract accumulated changes since last call
     std::vector<Change> fetchChanges(const std::function<void()>& requestUiUpdate, std::chrono::milliseconds cbInterval); //throw FileError
 
+    //block until at least one watcher has changes to fetch or time-out: event-driven instead of polling fetchChanges()
+    //returns false on time-out
+    static bool waitForChanges(const std::vector<const DirWatcher*>& watchers, std::chrono::milliseconds timeout); //throw FileError
+
 private:
     DirWatcher           (const DirWatcher&) = delete;
     DirWatcher& operator=(const DirWatcher&) = delete;
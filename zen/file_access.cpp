@@ -25,6 +25,8 @@
 
     #include <fcntl.h> //open, close, AT_SYMLINK_NOFOLLOW, UTIME_OMIT
     #include <sys/stat.h>
+    #include <sys/ioctl.h>
+    #include <linux/fs.h> //FICLONE
 
 using namespace zen;
 
@@ -645,8 +647,56 @@ void zen::copySymlink(const Zstring& sourcePath, const Zstring& targetPath) //th
 }
 
 
+namespace
+{
+//in-kernel copy: no round trip through user space buffers; server-side copy for NFS 4.2/SMB3
+//=> returns false if not supported: nothing was copied, file offsets are unchanged
+bool tryCopyFileRange(FileInputPlain& fileIn, FileOutputPlain& fileOut, IOCallbackDivider& notifyIoDiv, //throw FileError, X
+                      const IoCallback& notifyBytesRead, const IoCallback& notifyBytesWritten) //throw X
+{
+    const size_t chunkSize = 16 * 1024 * 1024; //large enough for throughput; small enough for timely progress reporting + cancel
+    int64_t totalBytesCopied = 0;
+    for (;;)
+    {
+        const ssize_t bytesCopied = ::copy_file_range(fileIn.getHandle(), nullptr, fileOut.getHandle(), nullptr, chunkSize, 0 /*flags*/);
+        if (bytesCopied < 0)
+        {
+            const int ec = errno; //copy before making other system calls!
+            if (ec == EINTR)
+                continue;
+
+            if (totalBytesCopied == 0)
+                switch (ec) //not supported => use fallback; same as coreutils: https://github.com/coreutils/coreutils/blob/17479ef60c8edbd2fe8664e31a7f69704f0cd221/src/copy.c#L342
+                {
+                    case ENOSYS:     //kernel < 4.5
+                    case EXDEV:      //different file systems: kernel < 5.3 or >= 5.19
+                    case EOPNOTSUPP:
+                    case EINVAL:
+                    case EBADF:
+                    case ETXTBSY:
+                    case EPERM:      //seccomp filter, e.g. Docker
+                        return false;
+                }
+            throw FileError(replaceCpy(replaceCpy(_("Cannot copy file %x to %y."), L"%x", L'\n' + fmtPath(fileIn.getFilePath())), L"%y", L'\n' + fmtPath(fileOut.getFilePath())),
+                            formatSystemError("copy_file_range", ec));
+        }
+        if (bytesCopied == 0) //EOF
+            return totalBytesCopied > 0; //procfs, sysfs report 0 bytes for non-empty files => use fallback (cheap if file is truly empty)
+
+        totalBytesCopied += bytesCopied;
+        notifyIoDiv(2 * bytesCopied); //throw X; read + write
+        if (notifyBytesRead)    notifyBytesRead   (bytesCopied); //throw X
+        if (notifyBytesWritten) notifyBytesWritten(bytesCopied); //
+    }
+}
+}
+
+
 FileCopyResult zen::copyNewFile(const Zstring& sourceFile, const Zstring& targetFile, //throw FileError, ErrorTargetExisting, (ErrorFileLocked), X
-                                const IoCallback& notifyUnbufferedIO /*throw X*/)
+                                const IoCallback& notifyUnbufferedIO /*throw X*/,
+                                const IoDataCallback& onSourceData /*throw X*/,
+                                const IoCallback& notifyBytesRead    /*throw X*/,
+                                const IoCallback& notifyBytesWritten /*throw X*/)
 {
     int64_t totalBytesNotified = 0;
     IOCallbackDivider notifyIoDiv(notifyUnbufferedIO, totalBytesNotified);
@@ -675,26 +725,46 @@ FileCopyResult zen::copyNewFile(const Zstring& sourceFile, const Zstring& target
     }
     FileOutputPlain fileOut(fdTarget, targetFile); //pass ownership
 
-    //preallocate disk space + reduce fragmentation
-    fileOut.reserveSpace(sourceInfo.st_size); //throw FileError
+    FileCopyMethod copyMethod = FileCopyMethod::stream;
 
-    unbufferedStreamCopy([&](void* buffer, size_t bytesToRead)
+    //1. reflink: share extents on Btrfs/XFS => O(1) copy (same as "cp --reflink=auto")
+    if (::ioctl(fileOut.getHandle(), FICLONE, fileIn.getHandle()) == 0)
     {
-        const size_t bytesRead = fileIn.tryRead(buffer, bytesToRead); //throw FileError, (ErrorFileLocked)
-        notifyIoDiv(bytesRead); //throw X
-        return bytesRead;
-    },
-    fileIn.getBlockSize() /*throw FileError*/,
-
-    [&](const void* buffer, size_t bytesToWrite)
+        notifyIoDiv(2 * sourceInfo.st_size); //throw X; read + write; shared extents: nothing for notifyBytesRead/notifyBytesWritten
+        copyMethod = FileCopyMethod::sharedExtents;
+    }
+    else //EOPNOTSUPP, EXDEV (different volumes), EINVAL, ... => no problem: try next
     {
-        const size_t bytesWritten = fileOut.tryWrite(buffer, bytesToWrite); //throw FileError
-        notifyIoDiv(bytesWritten); //throw X
-        return bytesWritten;
-    },
-    fileOut.getBlockSize() /*throw FileError*/); //throw FileError, X
+        //preallocate disk space + reduce fragmentation
+        fileOut.reserveSpace(sourceInfo.st_size); //throw FileError
 
-    //possible improvement: copy_file_range() performs an in-kernel copy: https://github.com/coreutils/coreutils/blob/17479ef60c8edbd2fe8664e31a7f69704f0cd221/src/copy.c#L342
+        //2. in-kernel copy
+        if (tryCopyFileRange(fileIn, fileOut, notifyIoDiv, notifyBytesRead, notifyBytesWritten)) //throw FileError, X
+            copyMethod = FileCopyMethod::offloaded;
+        else
+            //3. copy via user space buffers
+            unbufferedStreamCopy([&](void* buffer, size_t bytesToRead)
+        {
+            const size_t bytesRead = fileIn.tryRead(buffer, bytesToRead); //throw FileError, (ErrorFileLocked)
+            notifyIoDiv(bytesRead); //throw X
+            if (notifyBytesRead)
+                notifyBytesRead(bytesRead); //throw X
+            if (onSourceData)
+                onSourceData(buffer, bytesRead); //throw X
+            return bytesRead;
+        },
+        fileIn.getBlockSize() /*throw FileError*/,
+
+        [&](const void* buffer, size_t bytesToWrite)
+        {
+            const size_t bytesWritten = fileOut.tryWrite(buffer, bytesToWrite); //throw FileError
+            notifyIoDiv(bytesWritten); //throw X
+            if (notifyBytesWritten)
+                notifyBytesWritten(bytesWritten); //throw X
+            return bytesWritten;
+        },
+        fileOut.getBlockSize() /*throw FileError*/); //throw FileError, X
+    }
 
 #if 0
     //clean file system cache: needed at all? no user complaints at all so far!!!
@@ -734,6 +804,7 @@ FileCopyResult zen::copyNewFile(const Zstring& sourceFile, const Zstring& target
         .sourceFileIdx = sourceInfo.st_ino,
         .targetFileIdx = targetFileIdx,
         .errorModTime  = errorModTime,
+        .copyMethod    = copyMethod,
     };
 }
 
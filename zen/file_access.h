@@ -83,6 +83,13 @@ void copyDirectoryAttributes(const Zstring& sourcePath, const Zstring& targetPat
 
 void copySymlink(const Zstring& sourcePath, const Zstring& targetPath); //throw FileError
 
+enum class FileCopyMethod
+{
+    stream,        //via user space buffers: onSourceData received all source data
+    offloaded,     //in-kernel/server-side copy (copy_file_range): data not seen by onSourceData
+    sharedExtents, //reflink: no data copied at all
+};
+
 struct FileCopyResult
 {
     uint64_t fileSize = 0;
@@ -90,11 +97,17 @@ struct FileCopyResult
     FileIndex sourceFileIdx = 0;
     FileIndex targetFileIdx = 0;
     std::optional<FileError> errorModTime; //failure to set modification time
+    FileCopyMethod copyMethod = FileCopyMethod::stream;
 };
 
 FileCopyResult copyNewFile(const Zstring& sourceFile, const Zstring& targetFile, //throw FileError, ErrorTargetExisting, ErrorFileLocked, X
                            //accummulated delta != file size! consider ADS, sparse, compressed files
-                           const IoCallback& notifyUnbufferedIO /*throw X*/);
+                           const IoCallback& notifyUnbufferedIO /*throw X*/,
+                           //optional: receives *all* source data, but only for FileCopyMethod::stream (reflink and in-kernel copy are preferred)
+                           const IoDataCallback& onSourceData /*throw X*/,
+                           //optional: bytes actually read from source/written to target; reflink transfers no data => not reported
+                           const IoCallback& notifyBytesRead    /*throw X*/,
+                           const IoCallback& notifyBytesWritten /*throw X*/);
 }
 
 #endif //FILE_ACCESS_H_8017341345614857
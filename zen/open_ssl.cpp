@@ -387,6 +387,41 @@ void zen::verifySignature(const std::string_view message, const std::string_view
 }
 
 
+zen::HashSha256::HashSha256() //throw SysError
+{
+    ctx_ = ::EVP_MD_CTX_new();
+    if (!ctx_)
+        throw SysError(formatLastOpenSSLError("EVP_MD_CTX_new"));
+    ZEN_ON_SCOPE_FAIL(::EVP_MD_CTX_free(ctx_));
+
+    if (::EVP_DigestInit_ex(ctx_, ::EVP_sha256(), nullptr /*ENGINE* impl*/) != 1)
+        throw SysError(formatLastOpenSSLError("EVP_DigestInit_ex"));
+}
+
+
+zen::HashSha256::~HashSha256() { ::EVP_MD_CTX_free(ctx_); }
+
+
+void zen::HashSha256::update(const void* buffer, size_t bytes) //throw SysError
+{
+    if (::EVP_DigestUpdate(ctx_, buffer, bytes) != 1)
+        throw SysError(formatLastOpenSSLError("EVP_DigestUpdate"));
+}
+
+
+zen::HashSha256::Digest zen::HashSha256::finalize() //throw SysError
+{
+    Digest digest{};
+    unsigned int digestLen = 0;
+    if (::EVP_DigestFinal_ex(ctx_, digest.data(), &digestLen) != 1)
+        throw SysError(formatLastOpenSSLError("EVP_DigestFinal_ex"));
+
+    if (digestLen != digest.size())
+        throw SysError(formatSystemError("EVP_DigestFinal_ex", L"", L"Unexpected digest length: " + numberTo<std::wstring>(digestLen)));
+    return digest;
+}
+
+
 bool zen::isPuttyKeyStream(const std::string_view keyStream)
 {
     return startsWith(trimCpy(keyStream, TrimSide::left), "PuTTY-User-Key-File-");
@@ -7,8 +7,11 @@
 #ifndef OPEN_SSL_H_801974580936508934568792347506
 #define OPEN_SSL_H_801974580936508934568792347506
 
+#include <array>
 #include "sys_error.h"
 
+struct evp_md_ctx_st; //EVP_MD_CTX
+
 
 namespace zen
 {
@@ -33,6 +36,26 @@ void verifySignature(const std::string_view message,
 std::string convertRsaKey(const std::string_view keyStream, RsaStreamType typeFrom, RsaStreamType typeTo, bool publicKey); //throw SysError
 
 
+//incremental SHA-256: hardware-accelerated by OpenSSL (SHA-NI, ARMv8 crypto extensions)
+class HashSha256
+{
+public:
+    using Digest = std::array<unsigned char, 32>;
+
+    HashSha256(); //throw SysError
+    ~HashSha256();
+
+    void update(const void* buffer, size_t bytes); //throw SysError
+    Digest finalize(); //throw SysError
+
+private:
+    HashSha256           (const HashSha256&) = delete;
+    HashSha256& operator=(const HashSha256&) = delete;
+
+    ::evp_md_ctx_st* ctx_ = nullptr;
+};
+
+
 bool isPuttyKeyStream(const std::string_view keyStream);
 std::string convertPuttyKeyToPkix(const std::string_view keyStream, const std::string_view passphrase); //throw SysError
 }
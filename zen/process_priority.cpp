@@ -7,6 +7,8 @@
 #include "process_priority.h"
 #include "i18n.h"
 
+    #include <unistd.h>      //syscall
+    #include <sys/syscall.h> //SYS_ioprio_get, SYS_ioprio_set
 
 using namespace zen;
 
@@ -17,38 +19,46 @@ PreventStandby::~PreventStandby() {}
 
 //solution for GNOME?: https://people.gnome.org/~mccann/gnome-session/docs/gnome-session.html#org.gnome.SessionManager.Inhibit
 
-struct ScheduleForBackgroundProcessing::Impl {};
-ScheduleForBackgroundProcessing::ScheduleForBackgroundProcessing() {}
-ScheduleForBackgroundProcessing::~ScheduleForBackgroundProcessing() {}
 
-/*
-struct ScheduleForBackgroundProcessing
+namespace
 {
-    - required functions ioprio_get/ioprio_set are not part of glibc: https://linux.die.net/man/2/ioprio_set
+/*  - required functions ioprio_get/ioprio_set are not part of glibc: https://linux.die.net/man/2/ioprio_set
     - and probably never will: https://sourceware.org/bugzilla/show_bug.cgi?id=4464
-    - /usr/include/linux/ioprio.h not available on Ubuntu, so we can't use it instead
-
-    ScheduleForBackgroundProcessing() : oldIoPrio(getIoPriority(IOPRIO_WHO_PROCESS, ::getpid()))
-    {
-        if (oldIoPrio != -1)
-            setIoPriority(::getpid(), IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0));
-    }
-    ~ScheduleForBackgroundProcessing()
-    {
-        if (oldIoPrio != -1)
-            setIoPriority(::getpid(), oldIoPrio);
-    }
-
-private:
-    static int getIoPriority(pid_t pid)
-    {
-        return ::syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, pid);
-    }
-    static int setIoPriority(pid_t pid, int ioprio)
-    {
-        return ::syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, pid, ioprio);
-    }
-
-    const int oldIoPrio;
+    - /usr/include/linux/ioprio.h not available on Ubuntu, so we can't use it instead => define what we need:   */
+const int IOPRIO_WHO_PROCESS = 1;
+const int IOPRIO_CLASS_IDLE  = 3;
+const int IOPRIO_CLASS_SHIFT = 13;
+
+constexpr int makeIoPriority(int ioClass, int ioData) { return (ioClass << IOPRIO_CLASS_SHIFT) | ioData; }
+
+//pid == 0: calling thread only! threads created afterwards inherit its I/O priority
+int getIoPriority() { return static_cast<int>(::syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0 /*pid*/)); }
+int setIoPriority(int ioPrio) { return static_cast<int>(::syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0 /*pid*/, ioPrio)); }
+}
+
+
+struct ScheduleForBackgroundProcessing::Impl
+{
+    int oldIoPrio = 0;
 };
-*/
+
+
+/* - idle class: only get disk time when no other process needs it; honored by BFQ (and former CFQ) I/O schedulers, ignored by "none"/mq-deadline
+   - CPU priority is left unchanged: unprivileged processes can't undo "nice" => would outlive the sync
+   - construct on the thread that later creates the worker threads (they inherit the I/O priority), destroy on the same thread */
+ScheduleForBackgroundProcessing::ScheduleForBackgroundProcessing() : pimpl_(std::make_unique<Impl>()) //throw FileError
+{
+    pimpl_->oldIoPrio = getIoPriority();
+    if (pimpl_->oldIoPrio == -1)
+        THROW_LAST_FILE_ERROR(_("Cannot change process I/O priorities."), "ioprio_get");
+
+    if (setIoPriority(makeIoPriority(IOPRIO_CLASS_IDLE, 0)) != 0)
+        THROW_LAST_FILE_ERROR(_("Cannot change process I/O priorities."), "ioprio_set");
+}
+
+
+ScheduleForBackgroundProcessing::~ScheduleForBackgroundProcessing()
+{
+    [[maybe_unused]] const int rv = setIoPriority(pimpl_->oldIoPrio);
+    assert(rv == 0);
+}
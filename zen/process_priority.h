@@ -24,7 +24,7 @@ private:
     const std::unique_ptr<Impl> pimpl_;
 };
 
-//lower CPU and file I/O priorities
+//lower file I/O priority (Linux: idle I/O scheduling class)
 class ScheduleForBackgroundProcessing
 {
 public:
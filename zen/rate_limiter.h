@@ -0,0 +1,60 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#ifndef RATE_LIMITER_H_3284750923847509823457
+#define RATE_LIMITER_H_3284750923847509823457
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <mutex>
+
+
+namespace zen
+{
+/* token bucket: limit the average rate of some resource usage (bytes, files, ...) while allowing bursts of up to one second
+    - thread-safe
+    - consume() takes tokens even if not yet available (=> debt) and returns how long the caller has to wait
+        => waiting callers are served in order, sleep happens *outside* the lock
+    - "now": explicit time for deterministic testing     */
+class TokenBucket
+{
+public:
+    explicit TokenBucket(double ratePerSec, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) :
+        ratePerSec_(ratePerSec), tokens_(ratePerSec), lastRefill_(now) { assert(ratePerSec > 0); }
+
+    std::chrono::steady_clock::duration consume(double tokens) { return consume(tokens, std::chrono::steady_clock::now()); }
+
+    std::chrono::steady_clock::duration consume(double tokens, std::chrono::steady_clock::time_point now)
+    {
+        std::lock_guard dummy(lockBucket_);
+
+        if (now > lastRefill_) //time_point from a different thread may be slightly older
+        {
+            tokens_ = std::min(tokens_ + std::chrono::duration<double>(now - lastRefill_).count() * ratePerSec_, ratePerSec_ /*bucket size*/);
+            lastRefill_ = now;
+        }
+
+        tokens_ -= tokens;
+        if (tokens_ >= 0)
+            return std::chrono::steady_clock::duration::zero();
+
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(-tokens_ / ratePerSec_));
+    }
+
+private:
+    TokenBucket           (const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    const double ratePerSec_;
+
+    std::mutex lockBucket_;
+    double tokens_; //negative: debt
+    std::chrono::steady_clock::time_point lastRefill_;
+};
+}
+
+#endif //RATE_LIMITER_H_3284750923847509823457
@@ -46,6 +46,7 @@ namespace zen
         void write(const void* buffer, size_t bytesToWrite); //throw X                          */
 
 using IoCallback = std::function<void(int64_t bytesDelta)>; //throw X
+using IoDataCallback = std::function<void(const void* buffer, size_t bytes)>; //throw X; observe data passing through, e.g. for hashing
 
 
 template <class BinContainer, class Function>
@@ -11,6 +11,7 @@
 #include <cwctype> //iswspace
 #include <cstdio>  //sprintf
 #include <cwchar>  //swprintf
+#include <cstring> //memcpy
 #include "stl_tools.h"
 #include "string_traits.h"
 #include "legacy_compiler.h" //<charconv> but without the compiler crashes :>
@@ -175,7 +176,19 @@ template <class S> inline
 bool isAsciiString(const S& str)
 {
     const auto* const first = strBegin(str);
-    return std::all_of(first, first + strLength(str), [](auto c) { return isAsciiChar(c); });
+    const size_t len = strLength(str);
+    size_t i = 0;
+
+    if constexpr (sizeof(*first) == 1) //perf: check 8 chars at a time (SWAR), see getUpperCase()
+        for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t))
+        {
+            uint64_t block = 0;
+            std::memcpy(&block, first + i, sizeof(block)); //no alignment requirements
+            if (block & 0x8080'8080'8080'8080ULL)
+                return false;
+        }
+
+    return std::all_of(first + i, first + len, [](auto c) { return isAsciiChar(c); });
 }
 
 
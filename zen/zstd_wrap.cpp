@@ -0,0 +1,52 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#include "zstd_wrap.h"
+#include <zstd.h>
+
+using namespace zen;
+
+
+std::string zen::compressZstd(const std::string_view& stream, int level) //throw SysError
+{
+    std::string output(ZSTD_compressBound(stream.size()), '\0'); //upper limit for buffer size, larger than input size!!!
+
+    //frame header stores uncompressed size => needed by decompressZstd()
+    const size_t bytesWritten = ZSTD_compress(output.data(), output.size(), stream.data(), stream.size(), level);
+    if (ZSTD_isError(bytesWritten))
+        throw SysError(formatSystemError("ZSTD_compress", L"", utfTo<std::wstring>(ZSTD_getErrorName(bytesWritten))));
+
+    output.resize(bytesWritten);
+    //caveat: physical memory consumption still *unchanged*!
+    return output;
+}
+
+
+std::string zen::decompressZstd(const std::string_view& stream) //throw SysError
+{
+    const unsigned long long uncompressedSize = ZSTD_getFrameContentSize(stream.data(), stream.size());
+    if (uncompressedSize == ZSTD_CONTENTSIZE_ERROR ||
+        uncompressedSize == ZSTD_CONTENTSIZE_UNKNOWN)
+        throw SysError(formatSystemError("ZSTD_getFrameContentSize", L"", L"Invalid frame header."));
+
+    std::string output;
+    try
+    {
+        output.resize(static_cast<size_t>(uncompressedSize)); //throw std::bad_alloc
+    }
+    //most likely this is due to data corruption:
+    catch (const std::length_error& e) { throw SysError(L"zstd error: " + _("Out of memory.") + L' ' + utfTo<std::wstring>(e.what())); }
+    catch (const    std::bad_alloc& e) { throw SysError(L"zstd error: " + _("Out of memory.") + L' ' + utfTo<std::wstring>(e.what())); }
+
+    const size_t bytesWritten = ZSTD_decompress(output.data(), output.size(), stream.data(), stream.size());
+    if (ZSTD_isError(bytesWritten))
+        throw SysError(formatSystemError("ZSTD_decompress", L"", utfTo<std::wstring>(ZSTD_getErrorName(bytesWritten))));
+
+    if (bytesWritten != output.size())
+        throw SysError(formatSystemError("ZSTD_decompress", L"", L"bytes written != uncompressed size."));
+
+    return output;
+}
@@ -0,0 +1,23 @@
+// *****************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under    *
+// * GNU General Public License: https://www.gnu.org/licenses/gpl-3.0          *
+// * Copyright (C) Zenju (zenju AT freefilesync DOT org) - All Rights Reserved *
+// *****************************************************************************
+
+#ifndef ZSTD_WRAP_H_3485709234857023948
+#define ZSTD_WRAP_H_3485709234857023948
+
+#include "sys_error.h"
+
+
+namespace zen
+{
+// compression level must be between 1 and 19 (22 with excessive memory usage):
+// 1: fastest compression
+// 3: zstd default
+std::string compressZstd(const std::string_view& stream, int level); //throw SysError
+
+std::string decompressZstd(const std::string_view& stream); //throw SysError
+}
+
+#endif //ZSTD_WRAP_H_3485709234857023948
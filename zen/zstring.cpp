@@ -43,6 +43,24 @@ Zstring getUnicodeNormalForm_NonAsciiValidUtf(const Zstring& str, UnicodeNormalF
 }
 
 
+/*  fast path for precomposed Latin, e.g. "Müller.txt", "Café": valid UTF-8 with code points below U+0300 only
+    - all these chars are NFC "quick check: yes" and non-combining => string already is in NFC, no matter the char sequence [verified!]
+    - lead bytes 0xC2-0xCB + one continuation byte: no broken UTF-8, no overlong encodings, no Unicode non-characters => getValidUtf() is a no-op   */
+bool isLatinNfc(const Zstring& str)
+{
+    static_assert(sizeof(Zchar) == 1);
+    for (auto it = str.begin(); it != str.end(); ++it)
+        if (const unsigned char c = *it;
+            c >= 0x80)
+        {
+            if (c < 0xc2 || c > 0xcb || ++it == str.end() ||
+                (static_cast<unsigned char>(*it) & 0xc0) != 0x80)
+                return false;
+        }
+    return true;
+}
+
+
 Zstring getValidUtf(const Zstring& str)
 {
     /*  1. do NOT fail on broken UTF encoding, instead normalize using REPLACEMENT_CHAR!
@@ -81,23 +99,65 @@ Zstring getValidUtf(const Zstring& str)
 }
 
 
+/*  ASCII upper-casing 8 chars at a time ("SIMD within a register"): portable, no intrinsics needed
+    - prerequisite: all chars < 0x80 => adding 0x1f/0x05 can't carry into the neighboring byte
+    - per byte: high bit set <=> 'a' <= c && c <= 'z'                                              */
+inline uint64_t getLowerCaseMaskAscii(uint64_t block)
+{
+    const uint64_t geA = block + 0x1f1f'1f1f'1f1f'1f1fULL; //c >= 'a' (0x61)
+    const uint64_t gtZ = block + 0x0505'0505'0505'0505ULL; //c >  'z' (0x7a)
+    return geA & ~gtZ & 0x8080'8080'8080'8080ULL;
+}
+
+
+bool haveLowerCaseAscii(const Zchar* first, const Zchar* last)
+{
+    static_assert(sizeof(Zchar) == 1);
+    for (; last - first >= 8; first += 8)
+    {
+        uint64_t block = 0;
+        std::memcpy(&block, first, 8); //let the compiler optimize: no alignment/aliasing issues
+        if (getLowerCaseMaskAscii(block) != 0)
+            return true;
+    }
+    return std::any_of(first, last, [](Zchar c) { return Zstr('a') <= c && c <= Zstr('z'); });
+}
+
+
+void upperCaseAsciiInPlace(Zchar* first, Zchar* last)
+{
+    static_assert(sizeof(Zchar) == 1);
+    for (; last - first >= 8; first += 8)
+    {
+        uint64_t block = 0;
+        std::memcpy(&block, first, 8);
+        block ^= getLowerCaseMaskAscii(block) >> 2; //flip 0x20: 'a' -> 'A'
+        std::memcpy(first, &block, 8);
+    }
+    for (; first != last; ++first)
+        *first = asciiToUpper(*first);
+}
+
+
 Zstring getUpperCaseAscii(const Zstring& str)
 {
     assert(isAsciiString(str));
 
+    if (!haveLowerCaseAscii(str.begin(), str.end())) //avoid needless memory allocation
+        return str;
+
     Zstring output = str;
-    for (Zchar& c : output)  //identical to LCMapStringEx(), g_unichar_toupper(), CFStringUppercase() [verified!]
-        c = asciiToUpper(c); //
+    upperCaseAsciiInPlace(output.begin(), output.end()); //identical to LCMapStringEx(), g_unichar_toupper(), CFStringUppercase() [verified!]
     return output;
 }
 
 
 Zstring getUpperCaseNonAscii(const Zstring& str)
 {
-    const Zstring& strValidUtf = getValidUtf(str);
     try
     {
-        const Zstring strNorm = getUnicodeNormalForm_NonAsciiValidUtf(strValidUtf, UnicodeNormalForm::native);
+        const Zstring strNorm = isLatinNfc(str) ? str : //fast path: no conversion needed
+                                getUnicodeNormalForm_NonAsciiValidUtf(getValidUtf(str), UnicodeNormalForm::native);
 
         Zstring output;
         output.reserve(strNorm.size());
@@ -126,6 +186,10 @@ Zstring getUnicodeNormalForm(const Zstring& str, UnicodeNormalForm form)
     if (isAsciiString(str)) //fast path: in the range of 3.5ns
         return str;
 
+    static_assert(UnicodeNormalForm::native == UnicodeNormalForm::nfc);
+    if (form == UnicodeNormalForm::nfc && isLatinNfc(str)) //fast path: no glib conversion, no memory allocation
+        return str;
+
     return getUnicodeNormalForm_NonAsciiValidUtf(getValidUtf(str), form); //slow path
 }
 
@@ -138,6 +202,29 @@ Zstring getUpperCase(const Zstring& str)
 }
 
 
+ZstringUpperCase::ZstringUpperCase(const Zstring& str)
+{
+    if (isAsciiString(str))
+    {
+        if (!haveLowerCaseAscii(str.begin(), str.end()))
+            str_ = str; //ref-counting: no memory allocation
+        else if (str.size() <= std::size(buf_))
+        {
+            std::copy(str.begin(), str.end(), buf_);
+            upperCaseAsciiInPlace(buf_, buf_ + str.size());
+            view_ = ZstringView(buf_, str.size());
+            return;
+        }
+        else
+            str_ = getUpperCaseAscii(str);
+    }
+    else
+        str_ = getUpperCaseNonAscii(str); //slow path
+
+    view_ = str_;
+}
+
+
 namespace
 {
 std::weak_ordering compareNoCaseUtf8(const char* lhs, size_t lhsLen, const char* rhs, size_t rhsLen)
@@ -291,6 +378,22 @@ std::weak_ordering compareNoCase(const Zstring& lhs, const Zstring& rhs)
 }
 
 
+bool equalUpperCase(ZstringView upperCase, const Zstring& str)
+{
+    if (isAsciiString(str)) //fast path: no memory allocation, stop at first difference
+    {
+        if (str.size() != upperCase.size())
+            return false;
+
+        for (size_t i = 0; i < str.size(); ++i)
+            if (asciiToUpper(str[i]) != upperCase[i])
+                return false;
+        return true;
+    }
+    return equalString(getUpperCaseNonAscii(str), upperCase); //caveat: upperCase *can* be ASCII, e.g. ı => I
+}
+
+
 bool equalNoCase(const Zstring& lhs, const Zstring& rhs)
 {
     const bool isAsciiL = isAsciiString(lhs);
@@ -44,6 +44,30 @@ Zstring getUnicodeNormalForm(const Zstring& str, UnicodeNormalForm form = Unicod
     - output is Unicode-normalized                                         */
 Zstring getUpperCase(const Zstring& str);
 
+/* getUpperCase() for temporary use in hot code paths, e.g. filtering each traversed path:
+    - no memory allocation for ASCII strings with up to 256 chars or without lower-case chars      */
+class ZstringUpperCase
+{
+public:
+    explicit ZstringUpperCase(const Zstring& str);
+
+    ZstringView view() const { return view_; }
+
+private:
+    ZstringUpperCase           (const ZstringUpperCase&) = delete;
+    ZstringUpperCase& operator=(const ZstringUpperCase&) = delete;
+
+    Zchar buf_[256];
+    Zstring str_; //ref-counted: no memory allocation for copies
+    ZstringView view_;
+};
+
+//getUpperCase(str) == upperCase: compare many strings against the same one, e.g. ZstringUpperCase::view(); no memory allocation for ASCII "str"
+bool equalUpperCase(ZstringView upperCase, const Zstring& str);
+
+//enumerate the chars of getUpperCase(str), e.g. for hashing: no memory allocation for ASCII strings
+template <class S, class Function> void forEachUpperCaseChar(const S& str, Function onChar);
+
 //------------------------------------------------------------------------------------------
 struct ZstringNorm //use as STL container key: better than repeated Unicode normalizations during std::map<>::find()
 {
@@ -100,4 +124,19 @@ const wchar_t RIGHT_ARROW_CURV_DOWN = L'\u2935'; //Right Arrow Curving Down
 
 const wchar_t* const TAB_SPACE = L"    "; //4: the only sensible space count for tabs
 
+
+
+
+//################################# inline implementation ########################################
+template <class S, class Function> inline
+void forEachUpperCaseChar(const S& str, Function onChar)
+{
+    if (zen::isAsciiString(str)) //fast path: no memory allocation
+        for (const Zchar c : str)
+            onChar(zen::asciiToUpper(c)); //no surprises: emulate getUpperCase() [verified!]
+    else
+        for (const Zchar c : getUpperCase(Zstring(str))) //Zstring: no memory allocation (ref-counting)
+            onChar(c);                                   //ZstringView: copy
+}
+
 #endif //ZSTRING_H_73425873425789